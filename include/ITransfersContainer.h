@@ -124,6 +124,9 @@ public:
   virtual std::vector<TransactionOutputInformation> getTransactionInputs(const Crypto::Hash& transactionHash, uint32_t flags) const = 0;
   virtual void getUnconfirmedTransactions(std::vector<Crypto::Hash>& transactions) const = 0;
   virtual std::vector<TransactionSpentOutputInformation> getSpentOutputs() const = 0;
+  // unlocked spendable outputs of all types, addressable by index for random sampling
+  virtual size_t unlockedOutputsCount() const = 0;
+  virtual bool getUnlockedOutput(size_t index, TransactionOutputInformation& output) const = 0;
 };
 
 }
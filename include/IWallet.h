@@ -202,8 +202,13 @@ public:
   virtual WalletTransactionWithTransfers getTransaction(const Crypto::Hash& transactionHash) const = 0;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(const Crypto::Hash& blockHash, size_t count) const = 0;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(uint32_t blockIndex, size_t count) const = 0;
+  // only blocks containing transactions with the payment id are returned
+  virtual std::vector<TransactionsInBlockInfo> getTransactionsByPaymentId(const Crypto::Hash& paymentId, const Crypto::Hash& blockHash, size_t count) const = 0;
+  virtual std::vector<TransactionsInBlockInfo> getTransactionsByPaymentId(const Crypto::Hash& paymentId, uint32_t blockIndex, size_t count) const = 0;
   virtual std::vector<Crypto::Hash> getBlockHashes(uint32_t blockIndex, size_t count) const = 0;
   virtual uint32_t getBlockCount() const  = 0;
+  // blocks per second scanned over the last few seconds
+  virtual double getSyncSpeed() const = 0;
   virtual std::vector<WalletTransactionWithTransfers> getUnconfirmedTransactions() const = 0;
   virtual std::vector<size_t> getDelayedTransactionIds() const = 0;
   virtual std::vector<TransactionOutputInformation> getTransfers(size_t index, uint32_t flags) const = 0;
@@ -133,8 +133,7 @@ bool BlockchainExplorerDataBuilder::fillBlockDetails(const Block &block, BlockDe
   Crypto::Hash tmpHash = core.getBlockIdByHeight(blockDetails.height);
   blockDetails.isOrphaned = hash != tmpHash;
 
-  Crypto::cn_context context;
-  if (!get_block_longhash(context, block, blockDetails.proofOfWork)) {
+  if (!core.getBlockProofOfWork(block, blockDetails.height, blockDetails.proofOfWork)) {
     return false;
   }
 
@@ -310,6 +310,8 @@ public:
   uint8_t* suffix();
   uint64_t suffixSize() const;
   void resizeSuffix(uint64_t newSuffixSize);
+  // grows the file in place and writes data at the end of the suffix, unlike resizeSuffix() it does not copy the file
+  void appendSuffix(const uint8_t* data, uint64_t size);
 
   void rename(const std::string& newPath, std::error_code& ec);
   void rename(const std::string& newPath);
@@ -762,6 +764,20 @@ void FileMappedVector<T>::resizeSuffix(uint64_t newSuffixSize) {
   }
 }
 
+template<class T>
+void FileMappedVector<T>::appendSuffix(const uint8_t* data, uint64_t size) {
+  assert(isOpened());
+
+  uint64_t offset = m_file.size();
+  m_file.resize(offset + size);
+  std::copy(data, data + size, m_file.data() + offset);
+  m_suffixSize += size;
+
+  if (m_autoFlush) {
+    m_file.flush(m_file.data() + offset, size);
+  }
+}
+
 template<class T>
 void FileMappedVector<T>::rename(const std::string& newPath, std::error_code& ec) {
   m_file.rename(newPath, ec);
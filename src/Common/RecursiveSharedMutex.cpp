@@ -0,0 +1,180 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#include "RecursiveSharedMutex.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Tools {
+
+namespace {
+
+struct SharedOwnership {
+  const RecursiveSharedMutex* mutex;
+  size_t depth;
+  uint64_t generation;
+  std::chrono::steady_clock::time_point since;
+};
+
+// shared ownership is tracked per thread, so nested readers never wait behind a queued writer
+thread_local std::vector<SharedOwnership> sharedOwnerships;
+
+std::vector<SharedOwnership>::iterator findSharedOwnership(const RecursiveSharedMutex* mutex) {
+  return std::find_if(sharedOwnerships.begin(), sharedOwnerships.end(), [mutex](const SharedOwnership& ownership) {
+    return ownership.mutex == mutex;
+  });
+}
+
+}
+
+RecursiveSharedMutex::RecursiveSharedMutex() :
+  m_ownerDepth(0), m_readers(0), m_waitingWriters(0), m_generation(0), m_ownerGeneration(0), m_exclusiveHolds(HOLD_TIME_BUCKETS), m_sharedHolds(HOLD_TIME_BUCKETS) {
+}
+
+void RecursiveSharedMutex::lock() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_owner == std::this_thread::get_id()) {
+    ++m_ownerDepth;
+    return;
+  }
+
+  if (findSharedOwnership(this) != sharedOwnerships.end()) {
+    throw std::logic_error("RecursiveSharedMutex: exclusive lock requested by a shared owner");
+  }
+
+  ++m_waitingWriters;
+  m_unlocked.wait(lock, [this] { return m_ownerDepth == 0 && m_readers == 0; });
+  --m_waitingWriters;
+
+  m_owner = std::this_thread::get_id();
+  m_ownerDepth = 1;
+  m_ownerGeneration = ++m_generation;
+  m_ownedSince = std::chrono::steady_clock::now();
+}
+
+void RecursiveSharedMutex::unlock() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (--m_ownerDepth != 0) {
+    return;
+  }
+
+  m_owner = std::thread::id();
+  recordHold(m_exclusiveHolds, std::chrono::steady_clock::now() - m_ownedSince);
+  released(lock);
+}
+
+void RecursiveSharedMutex::lock_shared() {
+  auto ownership = findSharedOwnership(this);
+  if (ownership != sharedOwnerships.end()) {
+    ++ownership->depth;
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_owner == std::this_thread::get_id()) {
+    ++m_ownerDepth;
+    return;
+  }
+
+  m_unlocked.wait(lock, [this] { return m_ownerDepth == 0 && m_waitingWriters == 0; });
+  ++m_readers;
+  ++m_generation;
+  m_readerGenerations.insert(m_generation);
+  sharedOwnerships.push_back(SharedOwnership{ this, 1, m_generation, std::chrono::steady_clock::now() });
+}
+
+void RecursiveSharedMutex::unlock_shared() {
+  auto ownership = findSharedOwnership(this);
+  if (ownership == sharedOwnerships.end()) {
+    // nested in exclusive ownership
+    std::unique_lock<std::mutex> lock(m_mutex);
+    --m_ownerDepth;
+    return;
+  }
+
+  if (--ownership->depth != 0) {
+    return;
+  }
+
+  std::chrono::steady_clock::duration holdTime = std::chrono::steady_clock::now() - ownership->since;
+  uint64_t generation = ownership->generation;
+  sharedOwnerships.erase(ownership);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  recordHold(m_sharedHolds, holdTime);
+  m_readerGenerations.erase(m_readerGenerations.find(generation));
+  --m_readers;
+  released(lock);
+}
+
+void RecursiveSharedMutex::setReleaseHandler(std::function<void(uint64_t oldestGeneration, uint64_t generation)>&& handler) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_releaseHandler = std::move(handler);
+}
+
+void RecursiveSharedMutex::getHoldTimes(std::vector<uint64_t>& exclusiveHolds, std::vector<uint64_t>& sharedHolds) const {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  exclusiveHolds = m_exclusiveHolds;
+  sharedHolds = m_sharedHolds;
+}
+
+void RecursiveSharedMutex::recordHold(std::vector<uint64_t>& histogram, std::chrono::steady_clock::duration holdTime) {
+  uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(holdTime).count();
+  size_t bucket = 0;
+  while (microseconds != 0 && bucket + 1 < HOLD_TIME_BUCKETS) {
+    microseconds >>= 1;
+    ++bucket;
+  }
+
+  ++histogram[bucket];
+}
+
+void RecursiveSharedMutex::released(std::unique_lock<std::mutex>& lock) {
+  if (m_releaseHandler) {
+    // readers only overlap each other, the exclusive owner is never released while readers are around
+    m_releaseHandler(m_readers != 0 ? *m_readerGenerations.begin() : m_generation + 1, m_generation);
+  }
+
+  if (m_readers != 0) {
+    return;
+  }
+
+  lock.unlock();
+  m_unlocked.notify_all();
+}
+
+}
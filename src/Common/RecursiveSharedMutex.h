@@ -0,0 +1,114 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace Tools {
+
+// Reader/writer lock, recursive for both kinds of ownership. Writers are preferred: new readers wait while a writer
+// is waiting, only threads that already own the lock are let through. Shared ownership requested by the exclusive owner
+// counts as recursion, requesting exclusive ownership while holding shared ownership is an error.
+// Hold times of the outermost ownership are collected in log2 histograms.
+// Every outermost ownership gets the next generation number, so data unlinked while the lock was held can be freed as
+// soon as all ownerships that might still reference it, those not newer than the current generation, are released.
+class RecursiveSharedMutex {
+public:
+  // Bucket 0 counts holds under 1 us, bucket i holds in [2^(i-1), 2^i) us, the last bucket collects the rest
+  static const size_t HOLD_TIME_BUCKETS = 24;
+
+  RecursiveSharedMutex();
+
+  RecursiveSharedMutex(const RecursiveSharedMutex&) = delete;
+  RecursiveSharedMutex& operator=(const RecursiveSharedMutex&) = delete;
+
+  void lock();
+  void unlock();
+  void lock_shared();
+  void unlock_shared();
+
+  // Called with internal state locked whenever an outermost ownership is released, with the generation of the oldest
+  // ownership still held (generation + 1 when the mutex is free) and the generation of the newest one
+  void setReleaseHandler(std::function<void(uint64_t oldestGeneration, uint64_t generation)>&& handler);
+  void getHoldTimes(std::vector<uint64_t>& exclusiveHolds, std::vector<uint64_t>& sharedHolds) const;
+
+private:
+  void recordHold(std::vector<uint64_t>& histogram, std::chrono::steady_clock::duration holdTime);
+  void released(std::unique_lock<std::mutex>& lock);
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_unlocked;
+  std::thread::id m_owner;
+  size_t m_ownerDepth;
+  size_t m_readers;
+  size_t m_waitingWriters;
+  std::chrono::steady_clock::time_point m_ownedSince;
+  uint64_t m_generation;
+  uint64_t m_ownerGeneration;
+  std::multiset<uint64_t> m_readerGenerations;
+  std::function<void(uint64_t, uint64_t)> m_releaseHandler;
+  std::vector<uint64_t> m_exclusiveHolds;
+  std::vector<uint64_t> m_sharedHolds;
+};
+
+// Shared counterpart of std::lock_guard
+template<class Mutex> class SharedLockGuard {
+public:
+  explicit SharedLockGuard(Mutex& mutex) : m_mutex(mutex) {
+    m_mutex.lock_shared();
+  }
+
+  ~SharedLockGuard() {
+    m_mutex.unlock_shared();
+  }
+
+  SharedLockGuard(const SharedLockGuard&) = delete;
+  SharedLockGuard& operator=(const SharedLockGuard&) = delete;
+
+private:
+  Mutex& m_mutex;
+};
+
+}
@@ -0,0 +1,150 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace Tools {
+
+WorkerPool::WorkerPool(size_t threadCount) : m_stopped(false) {
+  if (threadCount == 0) {
+    threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+
+  m_threads.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; ++i) {
+    m_threads.emplace_back(&WorkerPool::workerThread, this);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+
+  m_haveTask.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+size_t WorkerPool::threadCount() const {
+  return m_threads.size();
+}
+
+void WorkerPool::post(std::function<void()>&& task) {
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_tasks.push_back(std::move(task));
+  }
+
+  m_haveTask.notify_one();
+}
+
+bool WorkerPool::parallelFor(size_t count, const std::function<bool(size_t)>& job) {
+  if (count == 0) {
+    return true;
+  }
+
+  struct Batch {
+    std::atomic<size_t> next;
+    std::atomic<bool> failed;
+    size_t running;
+    std::mutex mutex;
+    std::condition_variable finished;
+  };
+
+  auto batch = std::make_shared<Batch>();
+  batch->next = 0;
+  batch->failed = false;
+
+  auto run = [batch, count, &job] {
+    while (!batch->failed.load(std::memory_order_relaxed)) {
+      size_t index = batch->next.fetch_add(1);
+      if (index >= count) {
+        break;
+      }
+
+      if (!job(index)) {
+        batch->failed = true;
+      }
+    }
+  };
+
+  // The calling thread takes a share of the work, so no more than count - 1 helpers are useful
+  size_t helpers = std::min(m_threads.size(), count - 1);
+  batch->running = helpers;
+  for (size_t i = 0; i < helpers; ++i) {
+    post([batch, run] {
+      run();
+
+      std::unique_lock<std::mutex> lock(batch->mutex);
+      if (--batch->running == 0) {
+        batch->finished.notify_one();
+      }
+    });
+  }
+
+  run();
+
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  batch->finished.wait(lock, [&batch] { return batch->running == 0; });
+  return !batch->failed;
+}
+
+void WorkerPool::workerThread() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_haveTask.wait(lock, [this] { return m_stopped || !m_tasks.empty(); });
+      if (m_tasks.empty()) {
+        return;
+      }
+
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+
+    task();
+  }
+}
+
+}
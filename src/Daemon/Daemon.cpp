@@ -532,6 +532,16 @@ int main(int argc, char* argv[])
             logger(INFO, BRIGHT_RED) << "File " << parameters::CRYPTONOTE_BLOCKINDEXES_FILENAME << " removed!";
         }
 
+        if(Tools::remove_blockchain_file(coreConfig.configFolder+"/"+parameters::CRYPTONOTE_OUTPUTKEYS_FILENAME))
+        {
+            logger(INFO, BRIGHT_RED) << "File " << parameters::CRYPTONOTE_OUTPUTKEYS_FILENAME << " removed!";
+        }
+
+        if(Tools::remove_blockchain_file(coreConfig.configFolder+"/"+parameters::CRYPTONOTE_PROOFOFWORK_FILENAME))
+        {
+            logger(INFO, BRIGHT_RED) << "File " << parameters::CRYPTONOTE_PROOFOFWORK_FILENAME << " removed!";
+        }
+
         if(Tools::remove_blockchain_file(coreConfig.configFolder+"/"+parameters::CRYPTONOTE_POOLDATA_FILENAME))
         {
             logger(INFO, BRIGHT_RED) << "File " << parameters::CRYPTONOTE_POOLDATA_FILENAME << " removed!";
@@ -595,6 +605,7 @@ int main(int argc, char* argv[])
     }
 
     logger(INFO) << "Starting core rpc server on address " << rpcConfig.getBindAddress();
+    rpcServer.setWorkerThreads(rpcConfig.threads);
     rpcServer.start(rpcConfig.bindIp, rpcConfig.bindPort);
     rpcServer.restrictRPC(command_line::get_arg(vm, arg_restricted_rpc));
     rpcServer.enableCors(command_line::get_arg(vm, arg_enable_cors));
@@ -0,0 +1,227 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+// Ping-pong over loopback TcpConnections on a single dispatcher, run once waking one context per
+// epoll_wait and once draining a batch of ready events per wakeup. Linux only, the batch size and the
+// statistics are specific to the epoll dispatcher.
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "Common/BenchmarkReport.h"
+#include "Common/CommandLine.h"
+#include "Common/JsonValue.h"
+#include "System/ContextGroup.h"
+#include "System/Dispatcher.h"
+#include "System/Ipv4Address.h"
+#include "System/TcpConnection.h"
+#include "System/TcpConnector.h"
+#include "System/TcpListener.h"
+
+namespace po = boost::program_options;
+using Common::JsonValue;
+
+namespace {
+  const command_line::arg_descriptor<uint32_t> arg_connections = {"connections", "active connections", 128};
+  const command_line::arg_descriptor<uint32_t> arg_round_trips = {"round-trips", "round trips per connection", 2000};
+  const command_line::arg_descriptor<uint32_t> arg_message_size = {"message-size", "bytes sent in each direction per round trip", 64};
+  const command_line::arg_descriptor<uint32_t> arg_batch = {"batch", "ready events drained per wakeup in the batched run", static_cast<uint32_t>(System::Dispatcher::DEFAULT_EVENT_BATCH_SIZE)};
+  const command_line::arg_descriptor<uint32_t> arg_stack_size = {"stack-size", "bytes reserved per context stack", static_cast<uint32_t>(System::Dispatcher::DEFAULT_STACK_SIZE)};
+  const command_line::arg_descriptor<uint16_t> arg_port = {"port", "loopback port used by the benchmark", 18999};
+
+  struct RunResult {
+    uint32_t batch;
+    double seconds;
+    uint64_t roundTrips;
+    System::DispatcherStatistics statistics;
+  };
+
+  void transfer(System::TcpConnection& connection, std::vector<uint8_t>& buffer, bool send) {
+    size_t done = 0;
+    while (done < buffer.size()) {
+      done += send ? connection.write(buffer.data() + done, buffer.size() - done) : connection.read(buffer.data() + done, buffer.size() - done);
+    }
+  }
+
+  RunResult run(uint32_t batch, uint32_t connections, uint32_t roundTrips, uint32_t messageSize, uint32_t stackSize, uint16_t port) {
+    System::Dispatcher dispatcher;
+    dispatcher.setEventBatchSize(batch);
+    dispatcher.setStackSize(stackSize);
+    System::ContextGroup group(dispatcher);
+    System::Ipv4Address loopback("127.0.0.1");
+
+    std::vector<System::TcpConnection> servers;
+    std::vector<System::TcpConnection> clients;
+    {
+      System::TcpListener listener(dispatcher, loopback, port);
+      group.spawn([&] {
+        while (servers.size() < connections) {
+          servers.push_back(listener.accept());
+        }
+      });
+
+      System::TcpConnector connector(dispatcher);
+      while (clients.size() < connections) {
+        clients.push_back(connector.connect(loopback, port));
+      }
+
+      group.wait();
+    }
+
+    System::DispatcherStatistics before = dispatcher.getStatistics();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < connections; ++i) {
+      System::TcpConnection& server = servers[i];
+      System::TcpConnection& client = clients[i];
+      group.spawn([&server, roundTrips, messageSize] {
+        std::vector<uint8_t> buffer(messageSize);
+        for (uint32_t round = 0; round < roundTrips; ++round) {
+          transfer(server, buffer, false);
+          transfer(server, buffer, true);
+        }
+      });
+
+      group.spawn([&client, roundTrips, messageSize] {
+        std::vector<uint8_t> buffer(messageSize, 0x5a);
+        for (uint32_t round = 0; round < roundTrips; ++round) {
+          transfer(client, buffer, true);
+          transfer(client, buffer, false);
+        }
+      });
+    }
+
+    group.wait();
+
+    RunResult result;
+    result.batch = batch;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.roundTrips = static_cast<uint64_t>(connections) * roundTrips;
+    System::DispatcherStatistics after = dispatcher.getStatistics();
+    result.statistics.wakeups = after.wakeups - before.wakeups;
+    result.statistics.events = after.events - before.events;
+    result.statistics.contextSwitches = after.contextSwitches - before.contextSwitches;
+    result.statistics.spawnedContexts = after.spawnedContexts - before.spawnedContexts;
+    result.statistics.reusedContexts = after.reusedContexts - before.reusedContexts;
+    result.statistics.waitTime = after.waitTime - before.waitTime;
+    result.statistics.runTime = after.runTime - before.runTime;
+    result.statistics.peakContexts = after.peakContexts;
+    result.statistics.liveStacks = after.liveStacks;
+    result.statistics.cachedContexts = after.cachedContexts;
+    result.statistics.releasedStacks = after.releasedStacks;
+    result.statistics.stackSize = after.stackSize;
+    return result;
+  }
+
+  JsonValue toJson(const RunResult& result) {
+    JsonValue run(JsonValue::OBJECT);
+    run.insert("batch", static_cast<int64_t>(result.batch));
+    run.insert("seconds", result.seconds);
+    run.insert("round_trips_per_second", result.roundTrips / result.seconds);
+    run.insert("wakeups", static_cast<int64_t>(result.statistics.wakeups));
+    run.insert("events", static_cast<int64_t>(result.statistics.events));
+    run.insert("events_per_wakeup", result.statistics.wakeups != 0 ? static_cast<double>(result.statistics.events) / result.statistics.wakeups : 0.0);
+    run.insert("context_switches", static_cast<int64_t>(result.statistics.contextSwitches));
+    run.insert("spawned_contexts", static_cast<int64_t>(result.statistics.spawnedContexts));
+    run.insert("reused_contexts", static_cast<int64_t>(result.statistics.reusedContexts));
+    run.insert("wait_time_us", static_cast<int64_t>(result.statistics.waitTime));
+    run.insert("run_time_us", static_cast<int64_t>(result.statistics.runTime));
+    run.insert("peak_contexts", static_cast<int64_t>(result.statistics.peakContexts));
+    run.insert("live_stacks", static_cast<int64_t>(result.statistics.liveStacks));
+    run.insert("cached_contexts", static_cast<int64_t>(result.statistics.cachedContexts));
+    run.insert("released_stacks", static_cast<int64_t>(result.statistics.releasedStacks));
+    run.insert("stack_size", static_cast<int64_t>(result.statistics.stackSize));
+    return run;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  po::options_description desc_general("General options");
+  command_line::add_arg(desc_general, command_line::arg_help);
+
+  po::options_description desc_params("Benchmark options");
+  command_line::add_arg(desc_params, arg_connections);
+  command_line::add_arg(desc_params, arg_round_trips);
+  command_line::add_arg(desc_params, arg_message_size);
+  command_line::add_arg(desc_params, arg_batch);
+  command_line::add_arg(desc_params, arg_stack_size);
+  command_line::add_arg(desc_params, arg_port);
+  command_line::add_arg(desc_params, Common::arg_benchmark_output);
+
+  po::options_description desc_all;
+  desc_all.add(desc_general).add(desc_params);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_all, [&]() {
+    po::store(command_line::parse_command_line(argc, argv, desc_all), vm);
+    if (command_line::get_arg(vm, command_line::arg_help)) {
+      std::cout << desc_all << std::endl;
+      return false;
+    }
+
+    po::notify(vm);
+    return true;
+  });
+
+  if (!r) {
+    return 1;
+  }
+
+  uint32_t connections = command_line::get_arg(vm, arg_connections);
+  uint32_t roundTrips = command_line::get_arg(vm, arg_round_trips);
+  uint32_t messageSize = std::max<uint32_t>(command_line::get_arg(vm, arg_message_size), 1);
+  uint32_t stackSize = command_line::get_arg(vm, arg_stack_size);
+  uint16_t port = command_line::get_arg(vm, arg_port);
+
+  return Common::runBenchmark(vm, [&] {
+    RunResult single = run(1, connections, roundTrips, messageSize, stackSize, port);
+    RunResult batched = run(command_line::get_arg(vm, arg_batch), connections, roundTrips, messageSize, stackSize, port);
+    JsonValue runs(JsonValue::ARRAY);
+    runs.pushBack(toJson(single));
+    runs.pushBack(toJson(batched));
+
+    JsonValue report(JsonValue::OBJECT);
+    report.insert("connections", static_cast<int64_t>(connections));
+    report.insert("round_trips", static_cast<int64_t>(roundTrips));
+    report.insert("message_size", static_cast<int64_t>(messageSize));
+    report.insert("runs", std::move(runs));
+    report.insert("speedup", single.seconds / batched.seconds);
+    return report;
+  });
+}
@@ -0,0 +1,103 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#include "BlockResponseCache.h"
+
+namespace DynexCN {
+
+BlockResponseCache::BlockResponseCache(size_t maxSize) : m_maxSize(maxSize), m_size(0), m_hits(0), m_misses(0), m_bytesServed(0) {
+}
+
+std::shared_ptr<const EncodedBlock> BlockResponseCache::find(const Crypto::Hash& blockHash) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_index.find(blockHash);
+  if (it == m_index.end()) {
+    ++m_misses;
+    return nullptr;
+  }
+
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+  ++m_hits;
+  m_bytesServed += (*it->second)->size;
+  return *it->second;
+}
+
+void BlockResponseCache::insert(const std::shared_ptr<const EncodedBlock>& block) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_index.find(block->hash);
+  if (it != m_index.end()) {
+    // encoded concurrently by another request
+    m_size -= (*it->second)->size;
+    m_entries.erase(it->second);
+    m_index.erase(it);
+  }
+
+  m_entries.push_front(block);
+  m_index.emplace(block->hash, m_entries.begin());
+  m_size += block->size;
+
+  while (m_size > m_maxSize && m_entries.size() > 1) {
+    const std::shared_ptr<const EncodedBlock>& last = m_entries.back();
+    m_size -= last->size;
+    m_index.erase(last->hash);
+    m_entries.pop_back();
+  }
+}
+
+void BlockResponseCache::erase(const Crypto::Hash& blockHash) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_index.find(blockHash);
+  if (it != m_index.end()) {
+    m_size -= (*it->second)->size;
+    m_entries.erase(it->second);
+    m_index.erase(it);
+  }
+}
+
+void BlockResponseCache::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.clear();
+  m_index.clear();
+  m_size = 0;
+}
+
+BlockResponseCache::Statistics BlockResponseCache::getStatistics() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Statistics statistics = { m_hits, m_misses, m_bytesServed, m_entries.size(), m_size };
+  return statistics;
+}
+
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DynexCNProtocol/DynexCNProtocolDefinitions.h"
+
+namespace DynexCN {
+
+// A block and its transactions in the encoding sent to syncing wallets. The base transaction is only part of the block blob.
+struct EncodedBlock {
+  Crypto::Hash hash;
+  std::string block;
+  std::vector<std::string> transactions;
+  std::vector<TransactionPrefixInfo> transactionPrefixes;
+  // approximate memory used by the entry
+  size_t size;
+};
+
+// Encoded blocks shared by every response that includes them, bounded by size and evicted in LRU order.
+// Safe to use from several threads.
+class BlockResponseCache {
+public:
+  static const size_t DEFAULT_MAX_SIZE = 64 * 1024 * 1024;
+
+  struct Statistics {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t bytesServed;
+    uint64_t entries;
+    uint64_t size;
+  };
+
+  explicit BlockResponseCache(size_t maxSize = DEFAULT_MAX_SIZE);
+
+  std::shared_ptr<const EncodedBlock> find(const Crypto::Hash& blockHash);
+  void insert(const std::shared_ptr<const EncodedBlock>& block);
+  void erase(const Crypto::Hash& blockHash);
+  void clear();
+  Statistics getStatistics() const;
+
+private:
+  typedef std::list<std::shared_ptr<const EncodedBlock>> Entries;
+
+  mutable std::mutex m_mutex;
+  size_t m_maxSize;
+  size_t m_size;
+  // most recently used first
+  Entries m_entries;
+  std::unordered_map<Crypto::Hash, Entries::iterator> m_index;
+  uint64_t m_hits;
+  uint64_t m_misses;
+  uint64_t m_bytesServed;
+};
+
+}
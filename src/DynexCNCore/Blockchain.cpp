@@ -40,13 +40,19 @@
 #include <algorithm>
 #include <numeric>
 #include <cstdio>
+#include <chrono>
 #include <cmath>
+#include <mutex>
+#include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
 #include "Common/Math.h"
 #include "Common/int-util.h"
+#include "Common/MemoryInputStream.h"
 #include "Common/ShuffleGenerator.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
+#include "Common/StreamTools.h"
+#include "Common/StringOutputStream.h"
 #include "Rpc/CoreRpcServerCommandsDefinitions.h"
 #include "Serialization/BinarySerializationTools.h"
 #include "DynexCNTools.h"
@@ -69,6 +75,10 @@ std::string appendPath(const std::string& path, const std::string& fileName) {
   return result;
 }
 
+const uint8_t CACHE_JOURNAL_PUSH = 1;
+const uint8_t CACHE_JOURNAL_POP = 2;
+const size_t CACHE_JOURNAL_COMPACTION_RECORDS = 10000;
+
 }
 
 namespace std {
@@ -81,7 +91,8 @@ bool operator<(const Crypto::KeyImage& keyImage1, const Crypto::KeyImage& keyIma
 }
 }
 
-#define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 1
+#define CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER 2
+#define CURRENT_BLOCKCACHE_JOURNAL_VER 1
 #define CURRENT_BLOCKCHAININDICES_STORAGE_ARCHIVE_VER 1
 
 namespace DynexCN {
@@ -157,8 +168,9 @@ void serialize(Blockchain::SpentKeyImage& value, ISerializer& s) {
 class BlockCacheSerializer {
 
 public:
-  BlockCacheSerializer(Blockchain& bs, const Crypto::Hash lastBlockHash, ILogger& logger) :
-    m_bs(bs), m_lastBlockHash(lastBlockHash), m_loaded(false), logger(logger, "BlockCacheSerializer") {
+  // resume: accept a cache of any chain prefix, the caller has to check it against the stored blocks
+  BlockCacheSerializer(Blockchain& bs, const Crypto::Hash lastBlockHash, ILogger& logger, bool resume = false) :
+    m_bs(bs), m_lastBlockHash(lastBlockHash), m_loaded(false), m_resume(resume), m_journalGeneration(0), logger(logger, "BlockCacheSerializer") {
   }
 
   void load(const std::string& filename) {
@@ -199,8 +211,8 @@ public:
     uint8_t version = CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER;
     s(version, "version");
 
-    // ignore old versions, do rebuild
-    if (version < CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER)
+    // ignore unknown versions, do rebuild
+    if (version < 1 || version > CURRENT_BLOCKCACHE_STORAGE_ARCHIVE_VER)
       return;
 
     std::string operation;
@@ -209,15 +221,21 @@ public:
       Crypto::Hash blockHash;
       s(blockHash, "last_block");
 
-      if (blockHash != m_lastBlockHash) {
+      if (!m_resume && blockHash != m_lastBlockHash) {
         return;
       }
 
+      m_lastBlockHash = blockHash;
     } else {
       operation = "- saving ";
       s(m_lastBlockHash, "last_block");
     }
 
+    // version 1 caches were written without a journal
+    if (version >= 2) {
+      s(m_journalGeneration, "journal_generation");
+    }
+
     logger(INFO) << operation << "block index...";
     s(m_bs.m_blockIndex, "block_index");
 
@@ -248,10 +266,20 @@ public:
     return m_loaded;
   }
 
+  uint32_t journalGeneration() const {
+    return m_journalGeneration;
+  }
+
+  void setJournalGeneration(uint32_t generation) {
+    m_journalGeneration = generation;
+  }
+
 private:
 
   LoggerRef logger;
   bool m_loaded;
+  bool m_resume;
+  uint32_t m_journalGeneration;
   Blockchain& m_bs;
   Crypto::Hash m_lastBlockHash;
 };
@@ -361,8 +389,15 @@ m_paymentIdIndex(blockchainIndexesEnabled),
 m_timestampIndex(blockchainIndexesEnabled),
 m_generatedTransactionsIndex(blockchainIndexesEnabled),
 m_orphanBlocksIndex(blockchainIndexesEnabled),
-m_blockchainIndexesEnabled(blockchainIndexesEnabled) {
+m_blockchainIndexesEnabled(blockchainIndexesEnabled),
+m_verificationThreads(0),
+m_blockCacheSize(1024),
+m_cacheJournalGeneration(0),
+m_cacheJournalRecords(0),
+m_cacheCompacting(false) {
   m_outputs.set_deleted_key(0);
+  // readers may hold references to cached blocks, evicted ones are freed once every ownership that saw them is released
+  m_blockchain_lock.setReleaseHandler([this](uint64_t oldestGeneration, uint64_t generation) { m_blocks.reclaim(oldestGeneration, generation); });
 }
 
 void Blockchain::lastKnownBlockHeightUpdated(uint32_t height) {
@@ -419,6 +454,120 @@ bool Blockchain::checkTransactionInputs(const DynexCN::Transaction& tx, BlockInf
   return true;
 }
 
+void Blockchain::checkTransactionsInputs(std::vector<TransactionInputsCheck>& checks) {
+  std::vector<RingSignatureCheck> ringSignatureChecks;
+  std::vector<size_t> checkOwners;
+  std::vector<BlockInfo> tails(checks.size());
+
+  {
+    Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+
+    for (size_t i = 0; i < checks.size(); ++i) {
+      TransactionInputsCheck& check = checks[i];
+      check.valid = false;
+
+      // same shortcuts as checkTransactionInputs(tx, maxUsedBlock, lastFailed)
+      if (check.maxUsedBlock.empty()) {
+        if (!check.lastFailed.empty() && getCurrentBlockchainHeight() > check.lastFailed.height && getBlockIdByHeight(check.lastFailed.height) == check.lastFailed.id) {
+          continue;
+        }
+      } else {
+        if (check.maxUsedBlock.height >= getCurrentBlockchainHeight()) {
+          continue;
+        }
+
+        if (getBlockIdByHeight(check.maxUsedBlock.height) != check.maxUsedBlock.id && check.lastFailed.id == getBlockIdByHeight(check.lastFailed.height)) {
+          continue;
+        }
+      }
+
+      tails[i].id = getTailId(tails[i].height);
+
+      size_t firstCheck = ringSignatureChecks.size();
+      if (!checkTransactionInputs(*check.transaction, &check.maxUsedBlock.height, &ringSignatureChecks)) {
+        ringSignatureChecks.resize(firstCheck);
+        check.lastFailed = tails[i];
+        continue;
+      }
+
+      if (!(check.maxUsedBlock.height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: max used block index=" << check.maxUsedBlock.height << " is not less then blockchain size = " << m_blocks.size(); continue; }
+      get_block_hash(m_blocks[check.maxUsedBlock.height].bl, check.maxUsedBlock.id);
+
+      check.valid = true;
+      checkOwners.resize(ringSignatureChecks.size(), i);
+    }
+  }
+
+  std::vector<uint8_t> results;
+  verifyRingSignatures(ringSignatureChecks, results);
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    TransactionInputsCheck& check = checks[checkOwners[i]];
+    if (!results[i] && check.valid) {
+      check.valid = false;
+      check.lastFailed = tails[checkOwners[i]];
+    }
+  }
+}
+
+bool Blockchain::checkRingSignature(const RingSignatureCheck& check) {
+  std::vector<const Crypto::PublicKey*> outputKeys;
+  outputKeys.reserve(check.outputKeys.size());
+  for (const auto& key : check.outputKeys) {
+    outputKeys.push_back(&key);
+  }
+
+  if (!Crypto::check_ring_signature(check.prefixHash, check.keyImage, outputKeys, check.signatures.data())) {
+    logger(ERROR) << "Failed to check ring signature for keyImage: " << check.keyImage;
+    return false;
+  }
+
+  return true;
+}
+
+bool Blockchain::verifyRingSignatures(const std::vector<RingSignatureCheck>& checks, size_t& failedCheck) {
+  std::atomic<size_t> firstFailed(checks.size());
+  auto verify = [&](size_t i) {
+    if (checkRingSignature(checks[i])) {
+      return true;
+    }
+
+    size_t expected = firstFailed;
+    while (i < expected && !firstFailed.compare_exchange_weak(expected, i)) {
+    }
+
+    return false;
+  };
+
+  bool result = true;
+  if (!m_verificationPool || checks.size() < 2) {
+    for (size_t i = 0; i < checks.size() && result; ++i) {
+      result = verify(i);
+    }
+  } else {
+    result = m_verificationPool->parallelFor(checks.size(), verify);
+  }
+
+  failedCheck = firstFailed;
+  return result;
+}
+
+void Blockchain::verifyRingSignatures(const std::vector<RingSignatureCheck>& checks, std::vector<uint8_t>& results) {
+  results.assign(checks.size(), 0);
+  auto verify = [&](size_t i) {
+    results[i] = checkRingSignature(checks[i]) ? 1 : 0;
+    return true;
+  };
+
+  if (!m_verificationPool || checks.size() < 2) {
+    for (size_t i = 0; i < checks.size(); ++i) {
+      verify(i);
+    }
+  } else {
+    m_verificationPool->parallelFor(checks.size(), verify);
+  }
+}
+
 bool Blockchain::haveSpentKeyImages(const DynexCN::Transaction& tx) {
   return this->haveTransactionKeyImagesAsSpent(tx);
 }
@@ -437,17 +586,17 @@ bool Blockchain::checkTransactionSize(size_t blobSize) {
 }
 
 bool Blockchain::haveTransaction(const Crypto::Hash &id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_transactionMap.find(id) != m_transactionMap.end();
 }
 
 bool Blockchain::have_tx_keyimg_as_spent(const Crypto::KeyImage &key_im) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return  checkIfSpent(key_im);
 }
 
 bool Blockchain::checkIfSpent(const Crypto::KeyImage& keyImage, uint32_t blockIndex) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   auto it = spentKeyImages.get<KeyImageTag>().find(keyImage);
   if (it == spentKeyImages.get<KeyImageTag>().end()) {
     return false;
@@ -457,7 +606,7 @@ bool Blockchain::checkIfSpent(const Crypto::KeyImage& keyImage, uint32_t blockIn
 }
 
 bool Blockchain::checkIfSpent(const Crypto::KeyImage& keyImage) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (spentKeyImages.get<KeyImageTag>().count(keyImage) != 0) {
     return true;
   }
@@ -466,7 +615,7 @@ bool Blockchain::checkIfSpent(const Crypto::KeyImage& keyImage) {
 }
 
 uint32_t Blockchain::getCurrentBlockchainHeight() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return static_cast<uint32_t>(m_blocks.size());
 }
 
@@ -479,18 +628,32 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
 
   m_config_folder = config_folder;
 
-  if (!m_blocks.open(appendPath(config_folder, m_currency.blocksFileName()), appendPath(config_folder, m_currency.blockIndexesFileName()), 1024)) {
+  if (m_verificationThreads != 1) {
+    m_verificationPool.reset(new Tools::WorkerPool(m_verificationThreads));
+    logger(INFO) << "Ring signature verification threads: " << m_verificationPool->threadCount();
+  }
+
+  if (!m_blocks.open(appendPath(config_folder, m_currency.blocksFileName()), appendPath(config_folder, m_currency.blockIndexesFileName()), m_blockCacheSize)) {
+    return false;
+  }
+
+  if (!m_outputKeys.open(appendPath(config_folder, m_currency.outputKeysFileName()))) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open output key table";
+    return false;
+  }
+
+  if (!m_proofOfWork.open(appendPath(config_folder, m_currency.proofOfWorkFileName()))) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open proof of work table";
     return false;
   }
 
+  uint64_t journalSize = 0;
   if (load_existing && !m_blocks.empty()) {
     logger(INFO, BRIGHT_WHITE) << "Loading blockchain...";
-    BlockCacheSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
-    loader.load(appendPath(config_folder, m_currency.blocksCacheFileName()));
-
-    if (!loader.loaded()) {
+    if (!loadCache(journalSize)) {
       logger(WARNING, BRIGHT_YELLOW) << "No actual blockchain cache found, rebuilding internal structures...";
       rebuildCache();
+      journalSize = 0;
     }
 
     if (m_blockchainIndexesEnabled) {
@@ -500,6 +663,11 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
     m_blocks.clear();
   }
 
+  syncOutputKeyTable();
+  // stale records are told apart by their block hash, only the length has to match
+  m_proofOfWork.resize(m_blocks.size());
+  openCacheJournal(journalSize);
+
   if (m_blocks.empty()) {
     logger(INFO, BRIGHT_WHITE)
       << "Blockchain not loaded, generating genesis block.";
@@ -572,68 +740,613 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
   return true;
 }
 
+// The table is flushed lazily, after a restart it may lag behind the cache or belong to a cache that was rebuilt.
+// A table whose last record still matches the outputs map is completed from that block, anything else is refilled.
+void Blockchain::syncOutputKeyTable() {
+  uint64_t outputCount = 0;
+  for (const auto& amountOutputs : m_outputs) {
+    outputCount += amountOutputs.second.size();
+  }
+
+  if (m_outputKeys.size() == 0 && outputCount == 0) {
+    return;
+  }
+
+  bool tailMatches = false;
+  if (m_outputKeys.size() != 0 && m_outputKeys.size() <= outputCount) {
+    const OutputKeyTable::Record& record = m_outputKeys.back();
+    size_t globalIndex = m_outputKeys.outputCount(record.amount) - 1;
+    auto it = m_outputs.find(record.amount);
+    if (it != m_outputs.end() && globalIndex < it->second.size() && it->second[globalIndex].first.block == record.blockHeight) {
+      const TransactionOutput& output = transactionByIndex(it->second[globalIndex].first).tx.outputs[it->second[globalIndex].second];
+      tailMatches = output.target.type() == typeid(KeyOutput) && boost::get<KeyOutput>(output.target).key == record.key;
+    }
+  }
+
+  if (tailMatches && m_outputKeys.size() == outputCount) {
+    return;
+  }
+
+  uint32_t startHeight = 0;
+  if (tailMatches) {
+    // outputs of the last block may be written partially
+    startHeight = m_outputKeys.back().blockHeight;
+    while (m_outputKeys.size() != 0 && m_outputKeys.back().blockHeight == startHeight) {
+      m_outputKeys.pop();
+    }
+  } else {
+    m_outputKeys.clear();
+  }
+
+  logger(INFO, BRIGHT_WHITE) << "Filling output key table from height " << startHeight << "...";
+  m_outputKeys.reserve(outputCount);
+  fillOutputKeyTable(startHeight);
+  m_outputKeys.flush();
+  if (m_outputKeys.size() != outputCount) {
+    throw std::runtime_error("Output key table doesn't match the blockchain cache");
+  }
+}
+
+void Blockchain::fillOutputKeyTable(uint32_t startHeight) {
+  const uint32_t SHARD_SIZE = 1000;
+
+  // blocks are read in parallel and appended in height order, a round is bounded to keep memory usage low
+  size_t shardsPerRound = m_verificationPool ? m_verificationPool->threadCount() * 2 : 1;
+  uint32_t height = startHeight;
+  while (height < m_blocks.size()) {
+    std::vector<uint32_t> shardStarts;
+    for (uint32_t shardStart = height; shardStart < m_blocks.size() && shardStarts.size() < shardsPerRound; shardStart += SHARD_SIZE) {
+      shardStarts.push_back(shardStart);
+    }
+
+    std::vector<std::vector<OutputKeyTable::Record>> shards(shardStarts.size());
+    std::string error;
+    std::mutex errorMutex;
+    auto fillShard = [&](size_t i) {
+      try {
+        uint32_t shardEnd = static_cast<uint32_t>(std::min<uint64_t>(shardStarts[i] + SHARD_SIZE, m_blocks.size()));
+        for (uint32_t b = shardStarts[i]; b < shardEnd; ++b) {
+          BlockEntry block;
+          m_blocks.read(b, block);
+          for (const TransactionEntry& transaction : block.transactions) {
+            for (const TransactionOutput& output : transaction.tx.outputs) {
+              if (output.target.type() == typeid(KeyOutput)) {
+                shards[i].push_back(OutputKeyTable::Record{ boost::get<KeyOutput>(output.target).key, output.amount, transaction.tx.unlockTime, b, 0 });
+              }
+            }
+          }
+        }
+
+        return true;
+      } catch (std::exception& e) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        error = e.what();
+        return false;
+      }
+    };
+
+    bool shardsFilled = true;
+    if (m_verificationPool) {
+      shardsFilled = m_verificationPool->parallelFor(shards.size(), fillShard);
+    } else {
+      for (size_t i = 0; i < shards.size() && shardsFilled; ++i) {
+        shardsFilled = fillShard(i);
+      }
+    }
+
+    if (!shardsFilled) {
+      throw std::runtime_error("Failed to fill output key table: " + error);
+    }
+
+    for (const auto& shard : shards) {
+      for (const OutputKeyTable::Record& record : shard) {
+        m_outputKeys.push(record.amount, record.key, record.unlockTime, record.blockHeight);
+      }
+    }
+
+    height = std::min<uint32_t>(height + static_cast<uint32_t>(shards.size()) * SHARD_SIZE, m_blocks.size());
+    logger(INFO, BRIGHT_WHITE) << "Height " << height << " of " << m_blocks.size();
+  }
+}
+
+// Index entries of a range of blocks, in chain order
+struct Blockchain::CacheShard {
+  struct TransactionInfo {
+    Crypto::Hash hash;
+    TransactionIndex index;
+    std::vector<Crypto::KeyImage> keyImages;
+    std::vector<std::pair<uint64_t, uint32_t>> multisignatureInputs;
+    std::vector<std::pair<uint64_t, uint16_t>> keyOutputs;
+    std::vector<std::pair<uint64_t, uint16_t>> multisignatureOutputs;
+
+    void serialize(ISerializer& s) {
+      s(hash, "hash");
+      s(index, "index");
+      s(keyImages, "key_images");
+      s(multisignatureInputs, "multisig_inputs");
+      s(keyOutputs, "outputs");
+      s(multisignatureOutputs, "multisig_outputs");
+    }
+  };
+
+  std::vector<Crypto::Hash> blockHashes;
+  std::vector<TransactionInfo> transactions;
+
+  void serialize(ISerializer& s) {
+    s(blockHashes, "block_hashes");
+    s(transactions, "transactions");
+  }
+};
+
 void Blockchain::rebuildCache() {
+  const uint32_t SHARD_SIZE = 1000;
+  const std::chrono::seconds SNAPSHOT_INTERVAL(300);
+
   std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
-  m_blockIndex.clear();
-  m_transactionMap.clear();
-  spentKeyImages.clear();
-  m_outputs.clear();
-  m_multisignatureOutputs.clear();
-  for (uint32_t b = 0; b < m_blocks.size(); ++b) {
-    if (b % 1000 == 0) {
-      logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
+  auto clearCache = [this] {
+    m_blockIndex.clear();
+    m_transactionMap.clear();
+    spentKeyImages.clear();
+    m_outputs.clear();
+    m_multisignatureOutputs.clear();
+  };
+
+  clearCache();
+  uint32_t startHeight = 0;
+  if (loadCacheSnapshot()) {
+    startHeight = m_blockIndex.size();
+    logger(INFO, BRIGHT_WHITE) << "Resuming rebuild from snapshot at height " << startHeight;
+  } else {
+    clearCache();
+  }
+
+  // shards are hashed in parallel and merged in height order, a round is bounded to keep memory usage low
+  size_t shardsPerRound = m_verificationPool ? m_verificationPool->threadCount() * 2 : 1;
+  std::chrono::steady_clock::time_point lastSnapshot = timePoint;
+  uint64_t transactionCount = 0;
+  uint32_t height = startHeight;
+  while (height < m_blocks.size()) {
+    std::vector<CacheShard> shards;
+    std::vector<uint32_t> shardStarts;
+    for (uint32_t shardStart = height; shardStart < m_blocks.size() && shardStarts.size() < shardsPerRound; shardStart += SHARD_SIZE) {
+      shardStarts.push_back(shardStart);
+    }
+
+    shards.resize(shardStarts.size());
+    std::string error;
+    std::mutex errorMutex;
+    auto rebuildShard = [&](size_t i) {
+      try {
+        uint32_t shardEnd = static_cast<uint32_t>(std::min<uint64_t>(shardStarts[i] + SHARD_SIZE, m_blocks.size()));
+        rebuildCacheShard(shardStarts[i], shardEnd, shards[i]);
+        return true;
+      } catch (std::exception& e) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        error = e.what();
+        return false;
+      }
+    };
+
+    bool shardsBuilt = true;
+    if (m_verificationPool) {
+      shardsBuilt = m_verificationPool->parallelFor(shards.size(), rebuildShard);
+    } else {
+      for (size_t i = 0; i < shards.size() && shardsBuilt; ++i) {
+        shardsBuilt = rebuildShard(i);
+      }
+    }
+
+    if (!shardsBuilt) {
+      throw std::runtime_error("Failed to rebuild blockchain cache: " + error);
+    }
+
+    for (const CacheShard& shard : shards) {
+      mergeCacheShard(shard);
+      height += static_cast<uint32_t>(shard.blockHashes.size());
+      transactionCount += shard.transactions.size();
+    }
+
+    logger(INFO, BRIGHT_WHITE) << "Height " << height << " of " << m_blocks.size();
+
+    if (height < m_blocks.size() && std::chrono::steady_clock::now() - lastSnapshot > SNAPSHOT_INTERVAL) {
+      storeCacheSnapshot();
+      lastSnapshot = std::chrono::steady_clock::now();
     }
-    const BlockEntry& block = m_blocks[b];
-    Crypto::Hash blockHash = get_block_hash(block.bl);
+  }
+
+  // the cache image written when the journal is opened supersedes the snapshot
+  boost::system::error_code ec;
+  boost::filesystem::remove(appendPath(m_config_folder, m_currency.blocksCacheFileName() + ".rebuild"), ec);
+
+  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
+  double seconds = std::max(duration.count(), 0.001);
+  logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures took: " << duration.count() << " s, " <<
+    (height - startHeight) << " blocks (" << static_cast<uint64_t>((height - startHeight) / seconds) << " blocks/s), " <<
+    transactionCount << " transactions (" << static_cast<uint64_t>(transactionCount / seconds) << " tx/s)";
+}
+
+void Blockchain::rebuildCacheShard(uint32_t startHeight, uint32_t endHeight, CacheShard& shard) {
+  shard.blockHashes.reserve(endHeight - startHeight);
+  for (uint32_t b = startHeight; b < endHeight; ++b) {
+    BlockEntry block;
+    m_blocks.read(b, block);
+    getBlockCacheEntries(block, get_block_hash(block.bl), b, shard);
+  }
+}
+
+void Blockchain::getBlockCacheEntries(const BlockEntry& block, const Crypto::Hash& blockHash, uint32_t height, CacheShard& shard) {
+  shard.blockHashes.push_back(blockHash);
+
+  for (uint16_t t = 0; t < block.transactions.size(); ++t) {
+    const Transaction& transaction = block.transactions[t].tx;
+    shard.transactions.emplace_back();
+    CacheShard::TransactionInfo& info = shard.transactions.back();
+    info.hash = getObjectHash(transaction);
+    info.index = { height, t };
+
+    for (const auto& input : transaction.inputs) {
+      if (input.type() == typeid(KeyInput)) {
+        info.keyImages.push_back(::boost::get<KeyInput>(input).keyImage);
+      } else if (input.type() == typeid(MultisignatureInput)) {
+        const auto& multisignatureInput = ::boost::get<MultisignatureInput>(input);
+        info.multisignatureInputs.emplace_back(multisignatureInput.amount, multisignatureInput.outputIndex);
+      }
+    }
+
+    for (uint16_t o = 0; o < transaction.outputs.size(); ++o) {
+      const auto& out = transaction.outputs[o];
+      if (out.target.type() == typeid(KeyOutput)) {
+        info.keyOutputs.emplace_back(out.amount, o);
+      } else if (out.target.type() == typeid(MultisignatureOutput)) {
+        info.multisignatureOutputs.emplace_back(out.amount, o);
+      }
+    }
+  }
+}
+
+void Blockchain::mergeCacheShard(const CacheShard& shard) {
+  for (const auto& blockHash : shard.blockHashes) {
     m_blockIndex.push(blockHash);
-    for (uint16_t t = 0; t < block.transactions.size(); ++t) {
-      const TransactionEntry& transaction = block.transactions[t];
-      Crypto::Hash transactionHash = getObjectHash(transaction.tx);
-      TransactionIndex transactionIndex = { b, t };
-      m_transactionMap.insert(std::make_pair(transactionHash, transactionIndex));
-
-      // process inputs
-      for (auto& i : transaction.tx.inputs) {
-        if (i.type() == typeid(KeyInput)) {
-          spentKeyImages.get<BlockIndexTag>().insert(SpentKeyImage{ b, ::boost::get<KeyInput>(i).keyImage });
-        } else if (i.type() == typeid(MultisignatureInput)) {
-          auto out = ::boost::get<MultisignatureInput>(i);
-          m_multisignatureOutputs[out.amount][out.outputIndex].isUsed = true;
-        }
+  }
+
+  for (const auto& transaction : shard.transactions) {
+    m_transactionMap.insert(std::make_pair(transaction.hash, transaction.index));
+
+    for (const auto& keyImage : transaction.keyImages) {
+      spentKeyImages.get<BlockIndexTag>().insert(SpentKeyImage{ transaction.index.block, keyImage });
+    }
+
+    for (const auto& input : transaction.multisignatureInputs) {
+      m_multisignatureOutputs[input.first][input.second].isUsed = true;
+    }
+
+    for (const auto& output : transaction.keyOutputs) {
+      m_outputs[output.first].push_back(std::make_pair(transaction.index, output.second));
+    }
+
+    for (const auto& output : transaction.multisignatureOutputs) {
+      MultisignatureOutputUsage usage = { transaction.index, output.second, false };
+      m_multisignatureOutputs[output.first].push_back(usage);
+    }
+  }
+}
+
+void Blockchain::undoCacheShard(const CacheShard& shard) {
+  for (auto transaction = shard.transactions.rbegin(); transaction != shard.transactions.rend(); ++transaction) {
+    for (auto output = transaction->multisignatureOutputs.rbegin(); output != transaction->multisignatureOutputs.rend(); ++output) {
+      auto amountOutputs = m_multisignatureOutputs.find(output->first);
+      amountOutputs->second.pop_back();
+      if (amountOutputs->second.empty()) {
+        m_multisignatureOutputs.erase(amountOutputs);
       }
+    }
 
-      // process outputs
-      for (uint16_t o = 0; o < transaction.tx.outputs.size(); ++o) {
-        const auto& out = transaction.tx.outputs[o];
-        if (out.target.type() == typeid(KeyOutput)) {
-          m_outputs[out.amount].push_back(std::make_pair<>(transactionIndex, o));
-        } else if (out.target.type() == typeid(MultisignatureOutput)) {
-          MultisignatureOutputUsage usage = { transactionIndex, o, false };
-          m_multisignatureOutputs[out.amount].push_back(usage);
-        }
+    for (auto output = transaction->keyOutputs.rbegin(); output != transaction->keyOutputs.rend(); ++output) {
+      auto amountOutputs = m_outputs.find(output->first);
+      amountOutputs->second.pop_back();
+      if (amountOutputs->second.empty()) {
+        m_outputs.erase(amountOutputs);
       }
     }
+
+    for (const auto& input : transaction->multisignatureInputs) {
+      m_multisignatureOutputs[input.first][input.second].isUsed = false;
+    }
+
+    for (const auto& keyImage : transaction->keyImages) {
+      spentKeyImages.get<KeyImageTag>().erase(keyImage);
+    }
+
+    m_transactionMap.erase(transaction->hash);
   }
 
-  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
-  logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures took: " << duration.count();
+  for (size_t i = 0; i < shard.blockHashes.size(); ++i) {
+    m_blockIndex.pop();
+  }
 }
 
-bool Blockchain::storeCache() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+// Snapshots written during a rebuild cover a prefix of the chain, a later rebuild continues from there
+bool Blockchain::loadCacheSnapshot() {
+  std::string snapshotFile = appendPath(m_config_folder, m_currency.blocksCacheFileName() + ".rebuild");
+  if (!std::ifstream(snapshotFile, std::ios::binary)) {
+    return false;
+  }
+
+  BlockCacheSerializer loader(*this, NULL_HASH, logger.getLogger(), true);
+  loader.load(snapshotFile);
+
+  uint32_t snapshotHeight = m_blockIndex.size();
+  if (loader.loaded() && snapshotHeight > 0 && snapshotHeight <= m_blocks.size()) {
+    BlockEntry block;
+    m_blocks.read(snapshotHeight - 1, block);
+    if (get_block_hash(block.bl) == m_blockIndex.getTailId()) {
+      return true;
+    }
+  }
 
-  logger(INFO, BRIGHT_WHITE) << "Saving blockchain at height " << m_blocks.size() - 1 << "...";
-  BlockCacheSerializer ser(*this, getTailId(), logger.getLogger());
-  if (!ser.save(appendPath(m_config_folder, m_currency.blocksCacheFileName()))) {
-    logger(ERROR, BRIGHT_RED) << "Failed to save blockchain cache";
+  logger(WARNING, BRIGHT_YELLOW) << "Rebuild snapshot doesn't match the blockchain, ignoring it";
+  return false;
+}
+
+bool Blockchain::storeCacheSnapshot() {
+  logger(INFO, BRIGHT_WHITE) << "Saving rebuild snapshot at height " << m_blockIndex.size() - 1 << "...";
+  BlockCacheSerializer ser(*this, m_blockIndex.getTailId(), logger.getLogger());
+  if (!ser.save(appendPath(m_config_folder, m_currency.blocksCacheFileName() + ".rebuild"))) {
+    logger(ERROR, BRIGHT_RED) << "Failed to save rebuild snapshot";
+    return false;
+  }
+
+  return true;
+}
+
+// The cache is a compacted image plus a journal of per-block deltas appended since the image was written.
+// The image stores the generation of the first journal it does not include, journals are replayed in generation order.
+bool Blockchain::loadCache(uint64_t& journalSize) {
+  std::string cacheFile = appendPath(m_config_folder, m_currency.blocksCacheFileName());
+  BlockCacheSerializer loader(*this, NULL_HASH, logger.getLogger(), true);
+  loader.load(cacheFile);
+  if (!loader.loaded()) {
+    return false;
+  }
+
+  m_cacheJournalGeneration = loader.journalGeneration();
+  m_cacheJournalRecords = 0;
+  uint32_t cacheHeight = m_blockIndex.size();
+  uint32_t generation = m_cacheJournalGeneration;
+  uint64_t previousJournalSize = 0;
+  if (!replayCacheJournal(cacheFile + ".journal.prev", generation, previousJournalSize) ||
+      !replayCacheJournal(cacheFile + ".journal", generation, journalSize)) {
+    logger(WARNING, BRIGHT_YELLOW) << "Blockchain cache journal doesn't match the cache";
+    return false;
+  }
+
+  if (m_blockIndex.size() != m_blocks.size() || m_blockIndex.getTailId() != get_block_hash(m_blocks.back().bl)) {
     return false;
   }
 
+  if (m_blockIndex.size() != cacheHeight || m_cacheJournalRecords != 0) {
+    logger(INFO, BRIGHT_WHITE) << "Replayed " << m_cacheJournalRecords << " cache journal records, height " << cacheHeight << " -> " << m_blockIndex.size();
+  }
+
+  // only a single journal following the image can be continued, anything else is compacted on open
+  if (previousJournalSize != 0 || generation != m_cacheJournalGeneration + 1) {
+    journalSize = 0;
+  }
+
   return true;
 }
 
+bool Blockchain::replayCacheJournal(const std::string& fileName, uint32_t& generation, uint64_t& journalSize) {
+  journalSize = 0;
+  std::ifstream file(fileName, std::ios::binary);
+  if (!file) {
+    return true;
+  }
+
+  StdInputStream stream(file);
+  uint8_t version;
+  uint32_t journalGeneration;
+  try {
+    Common::read(stream, version);
+    Common::read(stream, journalGeneration);
+  } catch (std::exception&) {
+    return true;
+  }
+
+  if (version != CURRENT_BLOCKCACHE_JOURNAL_VER || journalGeneration > generation) {
+    return false;
+  }
+
+  if (journalGeneration < generation) {
+    // already compacted into the image
+    return true;
+  }
+
+  journalSize = file.tellg();
+  for (;;) {
+    std::string record;
+    Crypto::Hash checksum;
+    try {
+      uint32_t recordSize;
+      Common::read(stream, recordSize);
+      Common::read(stream, record, recordSize);
+      Common::read(stream, &checksum, sizeof(checksum));
+    } catch (std::exception&) {
+      // end of journal or a record torn by a crash
+      break;
+    }
+
+    if (Crypto::cn_fast_hash(record.data(), record.size()) != checksum) {
+      logger(WARNING, BRIGHT_YELLOW) << "Corrupted record in blockchain cache journal, discarding the rest";
+      break;
+    }
+
+    uint8_t type;
+    uint32_t height;
+    CacheShard shard;
+    MemoryInputStream recordStream(record.data(), record.size());
+    BinaryInputStreamSerializer s(recordStream);
+    s(type, "type");
+    s(height, "height");
+    s(shard, "shard");
+
+    if (type == CACHE_JOURNAL_PUSH && height == m_blockIndex.size()) {
+      mergeCacheShard(shard);
+    } else if (type == CACHE_JOURNAL_POP && height + 1 == m_blockIndex.size() && shard.blockHashes.size() == 1 &&
+      m_blockIndex.getTailId() == shard.blockHashes.front()) {
+      undoCacheShard(shard);
+    } else {
+      return false;
+    }
+
+    ++m_cacheJournalRecords;
+    journalSize = file.tellg();
+  }
+
+  ++generation;
+  return true;
+}
+
+void Blockchain::openCacheJournal(uint64_t journalSize) {
+  if (journalSize == 0) {
+    compactCache(false);
+    return;
+  }
+
+  // drop a trailing record torn by a crash before appending
+  std::string journalFile = appendPath(m_config_folder, m_currency.blocksCacheFileName() + ".journal");
+  boost::filesystem::resize_file(journalFile, journalSize);
+  m_cacheJournal.open(journalFile, std::ios::binary | std::ios::app);
+  if (!m_cacheJournal) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open blockchain cache journal " << journalFile;
+  }
+}
+
+void Blockchain::appendCacheJournal(uint8_t type, uint32_t height, CacheShard& shard) {
+  std::string record;
+  StringOutputStream recordStream(record);
+  BinaryOutputStreamSerializer s(recordStream);
+  s(type, "type");
+  s(height, "height");
+  s(shard, "shard");
+
+  Crypto::Hash checksum = Crypto::cn_fast_hash(record.data(), record.size());
+  StdOutputStream stream(m_cacheJournal);
+  Common::write(stream, static_cast<uint32_t>(record.size()));
+  Common::write(stream, record);
+  Common::write(stream, &checksum, sizeof(checksum));
+  m_cacheJournal.flush();
+  if (!m_cacheJournal) {
+    logger(ERROR, BRIGHT_RED) << "Failed to write blockchain cache journal";
+    m_cacheJournal.close();
+    return;
+  }
+
+  if (++m_cacheJournalRecords >= CACHE_JOURNAL_COMPACTION_RECORDS) {
+    compactCache(true);
+  }
+}
+
+// Serializes the cache under the lock and starts a new journal generation, the image is written to disk
+// in the background and the previous journal is removed once the image is in place
+void Blockchain::compactCache(bool background) {
+  if (m_cacheCompacting && background) {
+    return;
+  }
+
+  if (m_cacheCompactionThread.joinable()) {
+    m_cacheCompactionThread.join();
+  }
+
+  std::string cacheFile = appendPath(m_config_folder, m_currency.blocksCacheFileName());
+  std::shared_ptr<std::string> image = std::make_shared<std::string>();
+  {
+    BlockCacheSerializer ser(*this, m_blockIndex.size() != 0 ? m_blockIndex.getTailId() : NULL_HASH, logger.getLogger());
+    ser.setJournalGeneration(m_cacheJournalGeneration + 1);
+    StringOutputStream stream(*image);
+    BinaryOutputStreamSerializer s(stream);
+    DynexCN::serialize(ser, s);
+  }
+
+  m_outputKeys.flush();
+  m_proofOfWork.flush();
+
+  // A previous journal left behind means the last image never reached the disk and that journal is still
+  // needed to get from the image on disk to the current one. It must not be overwritten by the rotation,
+  // so the new image is written first, and if that fails too the current journal is kept and appended to.
+  boost::system::error_code ec;
+  bool imageStored = false;
+  if (boost::filesystem::exists(cacheFile + ".journal.prev", ec)) {
+    imageStored = storeCacheImage(cacheFile, *image);
+    if (!imageStored) {
+      logger(ERROR, BRIGHT_RED) << "Failed to save blockchain cache, keeping the current journal";
+      m_cacheJournalRecords = 0;
+      return;
+    }
+  }
+
+  m_cacheJournal.close();
+  boost::filesystem::rename(cacheFile + ".journal", cacheFile + ".journal.prev", ec);
+
+  ++m_cacheJournalGeneration;
+  m_cacheJournalRecords = 0;
+  m_cacheJournal.open(cacheFile + ".journal", std::ios::binary | std::ios::trunc);
+  StdOutputStream journalStream(m_cacheJournal);
+  Common::write(journalStream, static_cast<uint8_t>(CURRENT_BLOCKCACHE_JOURNAL_VER));
+  Common::write(journalStream, m_cacheJournalGeneration);
+  m_cacheJournal.flush();
+  if (!m_cacheJournal) {
+    logger(ERROR, BRIGHT_RED) << "Failed to create blockchain cache journal";
+    m_cacheJournal.close();
+  }
+
+  uint32_t height = m_blockIndex.size();
+  auto storeImage = [this, cacheFile, image, height, imageStored] {
+    if (!imageStored && !storeCacheImage(cacheFile, *image)) {
+      logger(ERROR, BRIGHT_RED) << "Failed to save blockchain cache";
+    } else {
+      boost::system::error_code ec;
+      boost::filesystem::remove(cacheFile + ".journal.prev", ec);
+      logger(INFO) << "Blockchain cache compacted at height " << height;
+    }
+
+    m_cacheCompacting = false;
+  };
+
+  m_cacheCompacting = true;
+  if (background && !imageStored) {
+    m_cacheCompactionThread = std::thread(storeImage);
+  } else {
+    storeImage();
+  }
+}
+
+bool Blockchain::storeCacheImage(const std::string& cacheFile, const std::string& image) {
+  std::string tempFile = cacheFile + ".tmp";
+  std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+  file.write(image.data(), image.size());
+  file.close();
+  if (!file) {
+    return false;
+  }
+
+  boost::system::error_code ec;
+  boost::filesystem::rename(tempFile, cacheFile, ec);
+  return !ec;
+}
+
 bool Blockchain::deinit() {
-  storeCache();
+  {
+    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    if (m_cacheCompactionThread.joinable()) {
+      m_cacheCompactionThread.join();
+    }
+
+    m_cacheJournal.close();
+    m_outputKeys.close();
+    m_proofOfWork.close();
+  }
+
   if (m_blockchainIndexesEnabled) {
     storeBlockchainIndices();
   }
@@ -650,12 +1363,17 @@ bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
   spentKeyImages.clear();
   m_alternative_chains.clear();
   m_outputs.clear();
+  m_outputKeys.clear();
+  m_proofOfWork.clear();
+  m_responseCache.clear();
 
   m_paymentIdIndex.clear();
   m_timestampIndex.clear();
   m_generatedTransactionsIndex.clear();
   m_orphanBlocksIndex.clear();
 
+  compactCache(false);
+
   block_verification_context bvc = boost::value_initialized<block_verification_context>();
   addNewBlock(b, bvc);
   return bvc.m_added_to_main_chain && !bvc.m_verification_failed;
@@ -663,24 +1381,24 @@ bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
 
 Crypto::Hash Blockchain::getTailId(uint32_t& height) {
   assert(!m_blocks.empty());
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   height = getCurrentBlockchainHeight() - 1;
   return getTailId();
 }
 
 Crypto::Hash Blockchain::getTailId() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_blocks.empty() ? NULL_HASH : m_blockIndex.getTailId();
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   assert(m_blockIndex.size() != 0);
   return doBuildSparseChain(m_blockIndex.getTailId());
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain(const Crypto::Hash& startBlockId) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   assert(haveBlock(startBlockId));
   return doBuildSparseChain(startBlockId);
 }
@@ -717,13 +1435,13 @@ std::vector<Crypto::Hash> Blockchain::doBuildSparseChain(const Crypto::Hash& sta
 }
 
 Crypto::Hash Blockchain::getBlockIdByHeight(uint32_t height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   assert(height < m_blockIndex.size());
   return m_blockIndex.getBlockId(height);
 }
 
 bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   uint32_t height = 0;
 
@@ -744,12 +1462,12 @@ bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
 }
 
 bool Blockchain::getBlockHeight(const Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lock(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lock(m_blockchain_lock);
   return m_blockIndex.getBlockHeight(blockId, blockHeight);
 }
 
 difficulty_type Blockchain::getDifficultyForNextBlock() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   std::vector<uint64_t> timestamps;
   std::vector<difficulty_type> cumulative_difficulties;
   uint8_t BlockMajorVersion = getBlockMajorVersionForHeight(static_cast<uint32_t>(m_blocks.size()));
@@ -766,8 +1484,139 @@ difficulty_type Blockchain::getDifficultyForNextBlock() {
   return m_currency.nextDifficulty(static_cast<uint32_t>(m_blocks.size()), BlockMajorVersion, timestamps, cumulative_difficulties);
 }
 
+void Blockchain::getBlockCacheStatistics(uint64_t& hits, uint64_t& misses) {
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  hits = m_blocks.cacheHits();
+  misses = m_blocks.cacheMisses();
+}
+
+BlockResponseCache::Statistics Blockchain::getResponseCacheStatistics() {
+  return m_responseCache.getStatistics();
+}
+
+// Wallets polling the tip request the same blocks, each block is encoded once while it stays in the cache
+std::shared_ptr<const EncodedBlock> Blockchain::getEncodedBlock(uint32_t height) {
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (height >= m_blocks.size()) {
+    return nullptr;
+  }
+
+  Crypto::Hash blockHash = m_blockIndex.getBlockId(height);
+  std::shared_ptr<const EncodedBlock> cached = m_responseCache.find(blockHash);
+  if (cached) {
+    return cached;
+  }
+
+  const BlockEntry& entry = m_blocks[height];
+  std::shared_ptr<EncodedBlock> encoded = std::make_shared<EncodedBlock>();
+  encoded->hash = blockHash;
+  encoded->block = asString(toBinaryArray(entry.bl));
+  encoded->size = encoded->block.size();
+  encoded->transactions.reserve(entry.transactions.size() - 1);
+  encoded->transactionPrefixes.reserve(entry.transactions.size() - 1);
+  for (size_t i = 1; i < entry.transactions.size(); ++i) {
+    encoded->transactions.push_back(asString(toBinaryArray(entry.transactions[i].tx)));
+    encoded->transactionPrefixes.emplace_back();
+    encoded->transactionPrefixes.back().txHash = entry.bl.transactionHashes[i - 1];
+    encoded->transactionPrefixes.back().txPrefix = entry.transactions[i].tx;
+    // the blob and roughly as much for the decoded prefix
+    encoded->size += 2 * encoded->transactions.back().size();
+  }
+
+  m_responseCache.insert(encoded);
+  return encoded;
+}
+
+std::shared_ptr<const EncodedBlock> Blockchain::getEncodedBlock(const Crypto::Hash& blockHash) {
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  uint32_t height;
+  if (!m_blockIndex.getBlockHeight(blockHash, height)) {
+    return nullptr;
+  }
+
+  return getEncodedBlock(height);
+}
+
+// Blocks older than the wallet's creation time are sent as hashes only, they are neither encoded nor cached
+bool Blockchain::getSyncBlock(uint32_t height, uint64_t minTimestamp, Crypto::Hash& blockHash, std::shared_ptr<const EncodedBlock>& encoded) {
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (height >= m_blocks.size()) {
+    return false;
+  }
+
+  blockHash = m_blockIndex.getBlockId(height);
+  if (m_blocks[height].bl.timestamp < minTimestamp) {
+    encoded.reset();
+  } else {
+    encoded = getEncodedBlock(height);
+  }
+
+  return true;
+}
+
+bool Blockchain::getBlockProofOfWork(const Block& block, uint32_t height, Crypto::Hash& proofOfWork) {
+  Crypto::Hash blockHash = get_block_hash(block);
+  if (m_proofOfWork.find(height, blockHash, proofOfWork)) {
+    return true;
+  }
+
+  // blocks from the checkpoint zone and orphaned blocks, hashed without holding the blockchain lock
+  Crypto::cn_context context;
+  if (!get_block_longhash(context, block, proofOfWork)) {
+    return false;
+  }
+
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (height < m_blockIndex.size() && m_blockIndex.getBlockId(height) == blockHash) {
+    m_proofOfWork.update(height, blockHash, proofOfWork);
+  }
+
+  return true;
+}
+
+void Blockchain::precomputeProofOfWork(const std::vector<Block>& blocks) {
+  std::vector<uint32_t> heights;
+  std::vector<Crypto::Hash> blockHashes;
+  std::vector<BinaryArray> blobs;
+  for (const Block& block : blocks) {
+    if (block.baseTransaction.inputs.size() != 1 || block.baseTransaction.inputs.front().type() != typeid(BaseInput)) {
+      continue;
+    }
+
+    uint32_t height = boost::get<BaseInput>(block.baseTransaction.inputs.front()).blockIndex;
+    Crypto::Hash blockHash = get_block_hash(block);
+    Crypto::Hash proofOfWork;
+    BinaryArray blob;
+    if (m_proofOfWork.find(height, blockHash, proofOfWork) || !get_block_longhash_blob(block, blob)) {
+      continue;
+    }
+
+    heights.push_back(height);
+    blockHashes.push_back(blockHash);
+    blobs.push_back(std::move(blob));
+  }
+
+  if (blobs.empty()) {
+    return;
+  }
+
+  std::vector<Crypto::Hash> proofsOfWork;
+  Crypto::cn_slow_hash_batch(blobs, proofsOfWork, m_verificationPool ? m_verificationPool->threadCount() : 1);
+
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  for (size_t i = 0; i < blobs.size(); ++i) {
+    if (heights[i] < m_blockIndex.size() && m_blockIndex.getBlockId(heights[i]) == blockHashes[i]) {
+      m_proofOfWork.update(heights[i], blockHashes[i], proofsOfWork[i]);
+    }
+  }
+}
+
+void Blockchain::getLockStatistics(std::vector<uint64_t>& exclusiveHolds, std::vector<uint64_t>& sharedHolds) {
+  m_blockchain_lock.getHoldTimes(exclusiveHolds, sharedHolds);
+}
+
 difficulty_type Blockchain::getAvgDifficultyForHeight(uint32_t height, uint32_t window) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   height = std::min<uint32_t>(height, (uint32_t)m_blocks.size() - 1);
   if (height <= 1)
     return 1;
@@ -791,7 +1640,7 @@ uint64_t Blockchain::getBlockTimestamp(uint32_t height) {
 }
 
 uint64_t Blockchain::getMinimalFee(uint32_t height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (height == 0 || m_blocks.size() <= 1) {
     return 0;
   }
@@ -823,7 +1672,7 @@ uint64_t Blockchain::getMinimalFee(uint32_t height) {
 }
 
 uint64_t Blockchain::getCoinsInCirculation() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (m_blocks.empty()) {
     return 0;
   } else {
@@ -1165,7 +2014,7 @@ bool Blockchain::validate_miner_transaction(const Block& b, uint32_t height, siz
 }
 
 bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (!(from_height < m_blocks.size())) {
     logger(ERROR, BRIGHT_RED)
       << "Internal error: get_backward_blocks_sizes called with from_height="
@@ -1181,7 +2030,7 @@ bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>&
 }
 
 bool Blockchain::get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (!m_blocks.size()) {
     return true;
   }
@@ -1197,7 +2046,7 @@ bool Blockchain::complete_timestamps_vector(uint8_t blockMajorVersion, uint64_t
   if (timestamps.size() >= m_currency.timestampCheckWindow(blockMajorVersion))
     return true;
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   size_t need_elements = m_currency.timestampCheckWindow(blockMajorVersion) - timestamps.size();
   if (!(start_top_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: passed start_height = " << start_top_height << " not less then m_blocks.size()=" << m_blocks.size(); return false; }
   size_t stop_offset = start_top_height > need_elements ? start_top_height - need_elements : 0;
@@ -1405,7 +2254,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (start_offset >= m_blocks.size())
     return false;
   for (size_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
@@ -1419,7 +2268,7 @@ bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Bloc
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (start_offset >= m_blocks.size()) {
     return false;
   }
@@ -1432,22 +2281,19 @@ bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Bloc
 }
 
 bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp) { //Deprecated. Should be removed with DynexCNProtocolHandler.
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   rsp.current_blockchain_height = getCurrentBlockchainHeight();
-  std::list<Block> blocks;
-  getBlocks(arg.blocks, blocks, rsp.missed_ids);
-  for (const auto& bl : blocks) {
-    std::list<Crypto::Hash> missed_tx_id;
-    std::list<Transaction> txs;
-    getTransactions(bl.transactionHashes, txs, rsp.missed_ids);
-    if (!(!missed_tx_id.size())) { logger(ERROR, BRIGHT_RED) << "Internal error: have missed missed_tx_id.size()=" << missed_tx_id.size() << ENDL << "for block id = " << get_block_hash(bl); return false; } //WTF???
+  for (const auto& blockId : arg.blocks) {
+    uint32_t height = 0;
+    if (!m_blockIndex.getBlockHeight(blockId, height)) {
+      rsp.missed_ids.push_back(blockId);
+      continue;
+    }
+
     rsp.blocks.push_back(block_complete_entry());
-    block_complete_entry& e = rsp.blocks.back();
-    //pack block
-    e.block = asString(toBinaryArray(bl));
-    //pack transactions
-    for (Transaction& tx : txs) {
-      e.txs.push_back(asString(toBinaryArray(tx)));
+    if (!getRawBlock(height, rsp.blocks.back())) {
+      logger(ERROR, BRIGHT_RED) << "Internal error: failed to read stored block " << blockId << " at height " << height;
+      return false;
     }
   }
 
@@ -1462,8 +2308,56 @@ bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTI
   return true;
 }
 
+// Copies block and transaction blobs out of the stored entry without encoding them again and without
+// putting the entry into the decoded block cache. The walk follows the field order of BlockEntry::serialize.
+bool Blockchain::getRawBlock(uint32_t height, block_complete_entry& entry) {
+  try {
+    Common::ArrayView<uint8_t> blob = m_blocks.blob(height);
+    const char* data = reinterpret_cast<const char*>(blob.getData());
+    Common::MemoryInputStream stream(blob.getData(), blob.getSize());
+    BinaryInputStreamSerializer serializer(stream);
+
+    Block block;
+    serializer(block, "block");
+    entry.block.assign(data, stream.getPosition());
+
+    uint32_t blockHeight;
+    uint64_t blockCumulativeSize;
+    difficulty_type cumulativeDifficulty;
+    uint64_t alreadyGeneratedCoins;
+    serializer(blockHeight, "height");
+    serializer(blockCumulativeSize, "block_cumulative_size");
+    serializer(cumulativeDifficulty, "cumulative_difficulty");
+    serializer(alreadyGeneratedCoins, "already_generated_coins");
+
+    size_t transactionCount;
+    serializer.beginArray(transactionCount, "transactions");
+    entry.txs.clear();
+    for (size_t i = 0; i < transactionCount; ++i) {
+      // TransactionEntry fields, objects have no framing in the binary format
+      size_t transactionStart = stream.getPosition();
+      Transaction transaction;
+      serializer(transaction, "tx");
+      size_t transactionEnd = stream.getPosition();
+      std::vector<uint32_t> globalOutputIndexes;
+      serializer(globalOutputIndexes, "indexes");
+
+      // the first entry is the base transaction, it is a part of the block blob
+      if (i > 0) {
+        entry.txs.emplace_back(data + transactionStart, transactionEnd - transactionStart);
+      }
+    }
+
+    serializer.endArray();
+    return true;
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Failed to read block at height " << height << ": " << e.what();
+    return false;
+  }
+}
+
 bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   for (auto& alt_bl : m_alternative_chains) {
     blocks.push_back(alt_bl.second.bl);
   }
@@ -1472,31 +2366,29 @@ bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
 }
 
 uint32_t Blockchain::getAlternativeBlocksCount() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return static_cast<uint32_t>(m_alternative_chains.size());
 }
 
-bool Blockchain::add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  const Transaction& tx = transactionByIndex(amount_outs[i].first).tx;
-  if (!(tx.outputs.size() > amount_outs[i].second)) {
-    logger(ERROR, BRIGHT_RED) << "internal error: in global outs index, transaction out index="
-      << amount_outs[i].second << " more than transaction outputs = " << tx.outputs.size() << ", for tx id = " << getObjectHash(tx); return false;
+bool Blockchain::add_out_to_get_random_outs(COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i) {
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  const OutputKeyTable::Record* record = m_outputKeys.find(amount, static_cast<uint32_t>(i));
+  if (record == nullptr) {
+    logger(ERROR, BRIGHT_RED) << "internal error: output key table has no output " << i << " for amount " << amount; return false;
   }
-  if (!(tx.outputs[amount_outs[i].second].target.type() == typeid(KeyOutput))) { logger(ERROR, BRIGHT_RED) << "unknown tx out type"; return false; }
 
   //check if transaction is unlocked
-  if (!is_tx_spendtime_unlocked(tx.unlockTime))
+  if (!is_tx_spendtime_unlocked(record->unlockTime))
     return false;
 
   COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry& oen = *result_outs.outs.insert(result_outs.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry());
   oen.global_amount_index = static_cast<uint32_t>(i);
-  oen.out_key = boost::get<KeyOutput>(tx.outputs[amount_outs[i].second].target).key;
+  oen.out_key = record->key;
   return true;
 }
 
 size_t Blockchain::find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (amount_outs.empty()) {
     return 0;
   }
@@ -1513,7 +2405,7 @@ size_t Blockchain::find_end_of_allowed_index(const std::vector<std::pair<Transac
 }
 
 bool Blockchain::getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   for (uint64_t amount : req.amounts) {
     COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs = *res.outs.insert(res.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount());
@@ -1543,7 +2435,7 @@ bool Blockchain::getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_
         size_t i = (size_t)(frac*up_index_limit);
         if(used.count(i))
           continue;
-        bool added = add_out_to_get_random_outs(amount_outs, result_outs, amount, i);
+        bool added = add_out_to_get_random_outs(result_outs, amount, i);
         used.insert(i);
         if(added)
           ++j;
@@ -1552,7 +2444,7 @@ bool Blockchain::getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_
     }else
     {
       for(size_t i = 0; i != up_index_limit; i++)
-        add_out_to_get_random_outs(amount_outs, result_outs, amount, i);
+        add_out_to_get_random_outs(result_outs, amount, i);
     }
   }
   return true;
@@ -1562,7 +2454,7 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
   assert(!qblock_ids.empty());
   assert(qblock_ids.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   uint32_t blockIndex;
   // assert above guarantees that method returns true
   m_blockIndex.findSupplement(qblock_ids, blockIndex);
@@ -1570,7 +2462,7 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
 }
 
 uint64_t Blockchain::blockDifficulty(size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (!(i < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "wrong block index i = " << i << " at Blockchain::block_difficulty()"; return false; }
   if (i == 0)
     return m_blocks[i].cumulative_difficulty;
@@ -1579,7 +2471,7 @@ uint64_t Blockchain::blockDifficulty(size_t i) {
 }
 
 uint64_t Blockchain::blockCumulativeDifficulty(size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (!(i < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "wrong block index i = " << i << " at Blockchain::block_difficulty()"; return false; }
 
   return m_blocks[i].cumulative_difficulty;
@@ -1647,7 +2539,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
   assert(!remoteBlockIds.empty());
   assert(remoteBlockIds.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   totalBlockCount = getCurrentBlockchainHeight();
   startBlockIndex = findBlockchainSupplement(remoteBlockIds);
 
@@ -1655,7 +2547,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
 }
 
 bool Blockchain::haveBlock(const Crypto::Hash& id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (m_blockIndex.hasBlock(id))
     return true;
 
@@ -1666,12 +2558,12 @@ bool Blockchain::haveBlock(const Crypto::Hash& id) {
 }
 
 size_t Blockchain::getTotalTransactions() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_transactionMap.size();
 }
 
 bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   auto it = m_transactionMap.find(tx_id);
   if (it == m_transactionMap.end()) {
     logger(WARNING, YELLOW) << "warning: get_tx_outputs_gindexs failed to find transaction with id = " << tx_id;
@@ -1689,7 +2581,7 @@ bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, st
 }
 
 bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   auto it = m_multisignatureOutputs.find(amount);
   if (it == m_multisignatureOutputs.end()) {
     return false;
@@ -1712,15 +2604,26 @@ bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, Multis
 
 
 bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::vector<RingSignatureCheck> ringSignatureChecks;
+
+  {
+    Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+
+    if (tail)
+      tail->id = getTailId(tail->height);
 
-  if (tail)
-    tail->id = getTailId(tail->height);
+    bool res = checkTransactionInputs(tx, &max_used_block_height, &ringSignatureChecks);
+    if (!res) return false;
+    if (!(max_used_block_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: max used block index=" << max_used_block_height << " is not less then blockchain size = " << m_blocks.size(); return false; }
+    get_block_hash(m_blocks[max_used_block_height].bl, max_used_block_id);
+  }
+
+  size_t failedCheck = 0;
+  if (!verifyRingSignatures(ringSignatureChecks, failedCheck)) {
+    logger(INFO, BRIGHT_WHITE) << "Failed to check ring signature for tx " << getObjectHash(tx);
+    return false;
+  }
 
-  bool res = checkTransactionInputs(tx, &max_used_block_height);
-  if (!res) return false;
-  if (!(max_used_block_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: max used block index=" << max_used_block_height << " is not less then blockchain size = " << m_blocks.size(); return false; }
-  get_block_hash(m_blocks[max_used_block_height].bl, max_used_block_id);
   return true;
 }
 
@@ -1736,12 +2639,12 @@ bool Blockchain::haveTransactionKeyImagesAsSpent(const Transaction &tx) {
   return false;
 }
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height) {
+bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height, std::vector<RingSignatureCheck>* deferredChecks) {
   Crypto::Hash tx_prefix_hash = getObjectHash(*static_cast<const TransactionPrefix*>(&tx));
-  return checkTransactionInputs(tx, tx_prefix_hash, pmax_used_block_height);
+  return checkTransactionInputs(tx, tx_prefix_hash, pmax_used_block_height, deferredChecks);
 }
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height) {
+bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height, std::vector<RingSignatureCheck>* deferredChecks) {
   size_t inputIndex = 0;
   if (pmax_used_block_height) {
     *pmax_used_block_height = 0;
@@ -1761,7 +2664,7 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
         return false;
       }
 
-      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height)) {
+      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height, deferredChecks)) {
         logger(INFO, BRIGHT_WHITE) <<
           "Failed to check ring signature for tx " << transactionHash;
         return false;
@@ -1815,34 +2718,8 @@ bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time, uint32_t height)
   return false;
 }
 
-bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-
-  struct outputs_visitor {
-    std::vector<const Crypto::PublicKey *>& m_results_collector;
-    Blockchain& m_bch;
-    LoggerRef logger;
-    outputs_visitor(std::vector<const Crypto::PublicKey *>& results_collector, Blockchain& bch, ILogger& logger) :m_results_collector(results_collector), m_bch(bch), logger(logger, "outputs_visitor") {
-    }
-
-    bool handle_output(const Transaction& tx, const TransactionOutput& out, size_t transactionOutputIndex) {
-      //check tx unlock time
-      if (!m_bch.is_tx_spendtime_unlocked(tx.unlockTime)) {
-        logger(INFO, BRIGHT_WHITE) <<
-          "One of outputs for one of inputs have wrong tx.unlockTime = " << tx.unlockTime;
-        return false;
-      }
-
-      if (out.target.type() != typeid(KeyOutput)) {
-        logger(INFO, BRIGHT_WHITE) <<
-          "Output have wrong type id, which=" << out.target.which();
-        return false;
-      }
-
-      m_results_collector.push_back(&boost::get<KeyOutput>(out.target).key);
-      return true;
-    }
-  };
+bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height, std::vector<RingSignatureCheck>* deferredChecks) {
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   // additional key_image check, fix discovered by Monero Lab and suggested by "fluffypony" (bitcointalk.org)
   static const Crypto::KeyImage I = { { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } };
@@ -1853,9 +2730,8 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
   }
 
   //check ring signature
-  std::vector<const Crypto::PublicKey *> output_keys;
-  outputs_visitor vi(output_keys, *this, logger.getLogger());
-  if (!scanOutputKeysForIndexes(txin, vi, pmax_related_block_height)) {
+  std::vector<Crypto::PublicKey> output_keys;
+  if (!getOutputKeysForIndexes(txin, output_keys, pmax_related_block_height)) {
     logger(INFO, BRIGHT_WHITE) <<
       "Failed to get output keys for tx with amount = " << m_currency.formatAmount(txin.amount) <<
       " and count indexes " << txin.outputIndexes.size();
@@ -1873,11 +2749,44 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
     return true;
   }
 
-  bool check_tx_ring_signature = Crypto::check_ring_signature(tx_prefix_hash, txin.keyImage, output_keys, sig.data());
-  if (!check_tx_ring_signature) {
-    logger(ERROR) << "Failed to check ring signature for keyImage: " << txin.keyImage;
+  RingSignatureCheck check = { tx_prefix_hash, txin.keyImage, std::move(output_keys), sig };
+  if (deferredChecks) {
+    deferredChecks->push_back(std::move(check));
+    return true;
+  }
+
+  return checkRingSignature(check);
+}
+
+bool Blockchain::getOutputKeysForIndexes(const KeyInput& txin, std::vector<Crypto::PublicKey>& outputKeys, uint32_t* pmax_related_block_height) {
+  if (txin.outputIndexes.empty()) {
+    return false;
+  }
+
+  std::vector<uint32_t> absoluteOffsets = relative_output_offsets_to_absolute(txin.outputIndexes);
+  const OutputKeyTable::Record* record = nullptr;
+  outputKeys.reserve(absoluteOffsets.size());
+  for (uint32_t i : absoluteOffsets) {
+    record = m_outputKeys.find(txin.amount, i);
+    if (record == nullptr) {
+      logger(INFO) << "Wrong index in transaction inputs: " << i << ", outputs with this amount: " << m_outputKeys.outputCount(txin.amount);
+      return false;
+    }
+
+    if (!is_tx_spendtime_unlocked(record->unlockTime)) {
+      logger(INFO, BRIGHT_WHITE) <<
+        "One of outputs for one of inputs have wrong tx.unlockTime = " << record->unlockTime;
+      return false;
+    }
+
+    outputKeys.push_back(record->key);
+  }
+
+  if (pmax_related_block_height != nullptr && *pmax_related_block_height < record->blockHeight) {
+    *pmax_related_block_height = record->blockHeight;
   }
-  return check_tx_ring_signature;
+
+  return true;
 }
 
 uint64_t Blockchain::get_adjusted_time() {
@@ -2170,6 +3079,8 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   size_t coinbase_blob_size = getObjectBinarySize(blockData.baseTransaction);
   size_t cumulative_block_size = coinbase_blob_size;
   uint64_t fee_summary = 0;
+  std::vector<RingSignatureCheck> ringSignatureChecks;
+  std::vector<size_t> ringSignatureOwners;
   for (size_t i = 0; i < transactions.size(); ++i) {
     const Crypto::Hash& tx_id = blockData.transactionHashes[i];
     block.transactions.resize(block.transactions.size() + 1);
@@ -2179,7 +3090,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
 
     blob_size = toBinaryArray(block.transactions.back().tx).size();
     fee = getInputAmount(block.transactions.back().tx) - getOutputAmount(block.transactions.back().tx);
-    if (!checkTransactionInputs(block.transactions.back().tx)) {
+    if (!checkTransactionInputs(block.transactions.back().tx, NULL, &ringSignatureChecks)) {
       logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << " has at least one transaction with wrong inputs: " << tx_id;
       bvc.m_verification_failed = true;
@@ -2189,6 +3100,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
       return false;
     }
 
+    ringSignatureOwners.resize(ringSignatureChecks.size(), i);
     ++transactionIndex.transaction;
     pushTransaction(block, tx_id, transactionIndex);
 
@@ -2196,6 +3108,16 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     fee_summary += fee;
   }
 
+  // signatures of all inputs are checked at once, key images and ring members were resolved above
+  size_t failedCheck = 0;
+  if (!verifyRingSignatures(ringSignatureChecks, failedCheck)) {
+    logger(INFO, BRIGHT_WHITE) <<
+      "Block " << blockHash << " has at least one transaction with wrong inputs: " << blockData.transactionHashes[ringSignatureOwners[failedCheck]];
+    bvc.m_verification_failed = true;
+    popTransactions(block, minerTransactionHash);
+    return false;
+  }
+
   if (!checkCumulativeBlockSize(blockHash, cumulative_block_size, m_blocks.size())) {
     bvc.m_verification_failed = true;
     return false;
@@ -2227,7 +3149,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     block.cumulative_difficulty += m_blocks.back().cumulative_difficulty;
   }
 
-  pushBlock(block);
+  pushBlock(block, proof_of_work);
 
   auto block_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - blockProcessingStart).count();
 
@@ -2250,11 +3172,18 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   return true;
 }
 
-bool Blockchain::pushBlock(BlockEntry& block) {
+bool Blockchain::pushBlock(BlockEntry& block, const Crypto::Hash& proofOfWork) {
   Crypto::Hash blockHash = get_block_hash(block.bl);
 
   m_blocks.push_back(block);
   m_blockIndex.push(blockHash);
+  m_proofOfWork.push(blockHash, proofOfWork);
+
+  if (m_cacheJournal.is_open()) {
+    CacheShard shard;
+    getBlockCacheEntries(block, blockHash, m_blockIndex.size() - 1, shard);
+    appendCacheJournal(CACHE_JOURNAL_PUSH, m_blockIndex.size() - 1, shard);
+  }
 
   m_timestampIndex.add(block.bl.timestamp, blockHash);
   m_generatedTransactionsIndex.add(block.bl);
@@ -2333,6 +3262,8 @@ bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transact
       auto& amountOutputs = m_outputs[transaction.tx.outputs[output].amount];
       transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
       amountOutputs.push_back(std::make_pair<>(transactionIndex, output));
+      m_outputKeys.push(transaction.tx.outputs[output].amount, boost::get<KeyOutput>(transaction.tx.outputs[output].target).key,
+        transaction.tx.unlockTime, block.height);
     } else if (transaction.tx.outputs[output].target.type() == typeid(MultisignatureOutput)) {
       auto& amountOutputs = m_multisignatureOutputs[transaction.tx.outputs[output].amount];
       transaction.m_global_output_indexes[output] = static_cast<uint32_t>(amountOutputs.size());
@@ -2376,6 +3307,13 @@ void Blockchain::popTransaction(const Transaction& transaction, const Crypto::Ha
         continue;
       }
 
+      if (m_outputKeys.outputCount(output.amount) != amountOutputs->second.size() || m_outputKeys.back().amount != output.amount) {
+        logger(ERROR, BRIGHT_RED) <<
+          "Blockchain consistency broken - output key table doesn't match outputs map.";
+      } else {
+        m_outputKeys.pop();
+      }
+
       amountOutputs->second.pop_back();
       if (amountOutputs->second.empty()) {
         m_outputs.erase(amountOutputs);
@@ -2545,16 +3483,27 @@ void Blockchain::removeLastBlock() {
   }
 
   logger(DEBUGGING) << "Removing last block with height " << m_blocks.back().height;
+  Crypto::Hash blockHash = getBlockIdByHeight(m_blocks.back().height);
+  CacheShard shard;
+  if (m_cacheJournal.is_open()) {
+    getBlockCacheEntries(m_blocks.back(), blockHash, m_blocks.back().height, shard);
+  }
+
   popTransactions(m_blocks.back(), getObjectHash(m_blocks.back().bl.baseTransaction));
+  m_responseCache.erase(blockHash);
 
-  Crypto::Hash blockHash = getBlockIdByHeight(m_blocks.back().height);
   m_timestampIndex.remove(m_blocks.back().bl.timestamp, blockHash);
   m_generatedTransactionsIndex.remove(m_blocks.back().bl);
 
   m_blocks.pop_back();
   m_blockIndex.pop();
+  m_proofOfWork.pop();
 
   assert(m_blockIndex.size() == m_blocks.size());
+
+  if (m_cacheJournal.is_open()) {
+    appendCacheJournal(CACHE_JOURNAL_POP, m_blockIndex.size(), shard);
+  }
 }
 
 bool Blockchain::checkUpgradeHeight(const UpgradeDetector& upgradeDetector) {
@@ -2570,7 +3519,7 @@ bool Blockchain::checkUpgradeHeight(const UpgradeDetector& upgradeDetector) {
 }
 
 bool Blockchain::getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_t& height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   assert(startOffset < m_blocks.size());
 
@@ -2586,12 +3535,12 @@ bool Blockchain::getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_
 }
 
 std::vector<Crypto::Hash> Blockchain::getBlockIds(uint32_t startHeight, uint32_t maxCount) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_blockIndex.getBlockIds(startHeight, maxCount);
 }
 
 bool Blockchain::getBlockContainingTransaction(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   auto it = m_transactionMap.find(txId);
   if (it == m_transactionMap.end()) {
     return false;
@@ -2603,7 +3552,7 @@ bool Blockchain::getBlockContainingTransaction(const Crypto::Hash& txId, Crypto:
 }
 
 bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& generatedCoins) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   // try to find block in main chain
   uint32_t height = 0;
@@ -2624,7 +3573,7 @@ bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& ge
 }
 
 bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   // try to find block in main chain
   uint32_t height = 0;
@@ -2645,7 +3594,7 @@ bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
 }
 
 bool Blockchain::getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& outputReference) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   MultisignatureOutputsContainer::const_iterator amountIter = m_multisignatureOutputs.find(txInMultisig.amount);
   if (amountIter == m_multisignatureOutputs.end()) {
     logger(DEBUGGING) << "Transaction contains multisignature input with invalid amount.";
@@ -2712,22 +3661,22 @@ bool Blockchain::loadBlockchainIndices() {
 }
 
 bool Blockchain::getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_generatedTransactionsIndex.find(height, generatedTransactions);
 }
 
 bool Blockchain::getOrphanBlockIdsByHeight(uint32_t height, std::vector<Crypto::Hash>& blockHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_orphanBlocksIndex.find(height, blockHashes);
 }
 
 bool Blockchain::getBlockIdsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& blocksNumberWithinTimestamps) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_timestampIndex.find(timestampBegin, timestampEnd, blocksNumberLimit, hashes, blocksNumberWithinTimestamps);
 }
 
 bool Blockchain::getTransactionIdsByPaymentId(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_paymentIdIndex.find(paymentId, transactionHashes);
 }
 
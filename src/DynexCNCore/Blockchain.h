@@ -38,6 +38,9 @@
 #pragma once
 
 #include <atomic>
+#include <fstream>
+#include <memory>
+#include <thread>
 
 #include "google/sparse_hash_set"
 #include "google/sparse_hash_map"
@@ -52,13 +55,18 @@
 
 #include "Common/ObserverManager.h"
 #include "Common/Util.h"
+#include "Common/RecursiveSharedMutex.h"
+#include "Common/WorkerPool.h"
 
 #include "DynexCNCore/BlockIndex.h"
+#include "DynexCNCore/BlockResponseCache.h"
 #include "DynexCNCore/Checkpoints.h"
 #include "DynexCNCore/Currency.h"
 #include "DynexCNCore/IBlockchainStorageObserver.h"
 #include "DynexCNCore/ITransactionValidator.h"
-#include "DynexCNCore/SwappedVector.h"
+#include "DynexCNCore/MappedVector.h"
+#include "DynexCNCore/OutputKeyTable.h"
+#include "DynexCNCore/ProofOfWorkTable.h"
 #include "DynexCNCore/UpgradeDetector.h"
 #include "DynexCNCore/DynexCNFormatUtils.h"
 #include "DynexCNCore/TransactionPool.h"
@@ -76,6 +84,7 @@
 
 namespace DynexCN {
 
+  struct block_complete_entry;
   struct NOTIFY_REQUEST_GET_OBJECTS_request;
   struct NOTIFY_RESPONSE_GET_OBJECTS_request;
   struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request;
@@ -95,9 +104,12 @@ namespace DynexCN {
     // ITransactionValidator
     virtual bool checkTransactionInputs(const DynexCN::Transaction& tx, BlockInfo& maxUsedBlock) override;
     virtual bool checkTransactionInputs(const DynexCN::Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) override;
+    virtual void checkTransactionsInputs(std::vector<TransactionInputsCheck>& checks) override;
     virtual bool haveSpentKeyImages(const DynexCN::Transaction& tx) override;
     virtual bool checkTransactionSize(size_t blobSize) override;
 
+    void setVerificationThreads(size_t threads) { m_verificationThreads = threads; }
+    void setBlockCacheSize(size_t size) { m_blockCacheSize = size; }
     bool init() { return init(Tools::getDefaultDataDirectory(), true); }
     bool init(const std::string& config_folder, bool load_existing);
     bool deinit();
@@ -157,6 +169,18 @@ namespace DynexCN {
     bool isBlockInMainChain(const Crypto::Hash& blockId);
     bool isInCheckpointZone(const uint32_t height);
     uint64_t getAvgDifficultyForHeight(uint32_t height, uint32_t window);
+    void getBlockCacheStatistics(uint64_t& hits, uint64_t& misses);
+    BlockResponseCache::Statistics getResponseCacheStatistics();
+    // Encoded main chain block for wallet sync responses, nullptr if there is no such block
+    std::shared_ptr<const EncodedBlock> getEncodedBlock(uint32_t height);
+    std::shared_ptr<const EncodedBlock> getEncodedBlock(const Crypto::Hash& blockHash);
+    // Hash of a main chain block, and its encoded form only if the block isn't older than minTimestamp
+    bool getSyncBlock(uint32_t height, uint64_t minTimestamp, Crypto::Hash& blockHash, std::shared_ptr<const EncodedBlock>& encoded);
+    // Proof of work recorded during validation, computed and recorded here if the block was accepted without it
+    bool getBlockProofOfWork(const Block& block, uint32_t height, Crypto::Hash& proofOfWork);
+    // Hashes the main chain blocks of an explorer page that have no proof of work recorded, in parallel
+    void precomputeProofOfWork(const std::vector<Block>& blocks);
+    void getLockStatistics(std::vector<uint64_t>& exclusiveHolds, std::vector<uint64_t>& sharedHolds);
 
     template<class visitor_t> bool scanOutputKeysForIndexes(const KeyInput& tx_in_to_key, visitor_t& vis, uint32_t* pmax_related_block_height = NULL);
 
@@ -165,7 +189,7 @@ namespace DynexCN {
 
     template<class t_ids_container, class t_blocks_container, class t_missed_container>
     bool getBlocks(const t_ids_container& block_ids, t_blocks_container& blocks, t_missed_container& missed_bs) {
-      std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
+      Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
       for (const auto& bl_id : block_ids) {
         try {
@@ -187,7 +211,7 @@ namespace DynexCN {
 
     template<class t_ids_container, class t_tx_container, class t_missed_container>
     void getBlockchainTransactions(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs) {
-      std::lock_guard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
+      Tools::SharedLockGuard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
 
       for (const auto& tx_id : txs_ids) {
         auto it = m_transactionMap.find(tx_id);
@@ -293,6 +317,14 @@ namespace DynexCN {
       }
     };
 
+    // Ring members gathered under m_blockchain_lock, verified later without it
+    struct RingSignatureCheck {
+      Crypto::Hash prefixHash;
+      Crypto::KeyImage keyImage;
+      std::vector<Crypto::PublicKey> outputKeys;
+      std::vector<Crypto::Signature> signatures;
+    };
+
     struct BlockIndexTag {};
     struct KeyImageTag {};
 
@@ -315,7 +347,7 @@ namespace DynexCN {
 
     const Currency& m_currency;
     tx_memory_pool& m_tx_pool;
-    std::recursive_mutex m_blockchain_lock; // TODO: add here reader/writer lock
+    Tools::RecursiveSharedMutex m_blockchain_lock;
     Crypto::cn_context m_cn_context;
     Tools::ObserverManager<IBlockchainStorageObserver> m_observerManager;
 
@@ -328,7 +360,7 @@ namespace DynexCN {
     Checkpoints m_checkpoints;
     std::atomic<bool> m_is_in_checkpoint_zone;
 
-    typedef SwappedVector<BlockEntry> Blocks;
+    typedef MappedVector<BlockEntry> Blocks;
     typedef std::unordered_map<Crypto::Hash, uint32_t> BlockMap;
     typedef std::unordered_map<Crypto::Hash, TransactionIndex> TransactionMap;
     typedef BasicUpgradeDetector<Blocks> UpgradeDetector;
@@ -337,6 +369,9 @@ namespace DynexCN {
     friend class BlockchainIndicesSerializer;
 
     Blocks m_blocks;
+    OutputKeyTable m_outputKeys;
+    ProofOfWorkTable m_proofOfWork;
+    BlockResponseCache m_responseCache;
     DynexCN::BlockIndex m_blockIndex;
     TransactionMap m_transactionMap;
     MultisignatureOutputsContainer m_multisignatureOutputs;
@@ -352,12 +387,38 @@ namespace DynexCN {
 
     IntrusiveLinkedList<MessageQueue<BlockchainMessage>> m_messageQueueList;
 
+    size_t m_verificationThreads;
+    size_t m_blockCacheSize;
+    std::unique_ptr<Tools::WorkerPool> m_verificationPool;
+
+    std::ofstream m_cacheJournal;
+    uint32_t m_cacheJournalGeneration;
+    size_t m_cacheJournalRecords;
+    std::atomic<bool> m_cacheCompacting;
+    std::thread m_cacheCompactionThread;
+
     Logging::LoggerRef logger;
 
     uint32_t m_lastKnownBlockHeight;
 
+    struct CacheShard;
+
     void rebuildCache();
-    bool storeCache();
+    void rebuildCacheShard(uint32_t startHeight, uint32_t endHeight, CacheShard& shard);
+    void getBlockCacheEntries(const BlockEntry& block, const Crypto::Hash& blockHash, uint32_t height, CacheShard& shard);
+    void mergeCacheShard(const CacheShard& shard);
+    void undoCacheShard(const CacheShard& shard);
+    bool loadCacheSnapshot();
+    bool storeCacheSnapshot();
+    bool loadCache(uint64_t& journalSize);
+    bool replayCacheJournal(const std::string& fileName, uint32_t& generation, uint64_t& journalSize);
+    void openCacheJournal(uint64_t journalSize);
+    void appendCacheJournal(uint8_t type, uint32_t height, CacheShard& shard);
+    void compactCache(bool background);
+    bool storeCacheImage(const std::string& cacheFile, const std::string& image);
+    void syncOutputKeyTable();
+    void fillOutputKeyTable(uint32_t startHeight);
+    bool getOutputKeysForIndexes(const KeyInput& txin, std::vector<Crypto::PublicKey>& outputKeys, uint32_t* pmax_related_block_height);
     bool switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::iterator>& alt_chain, bool discard_disconnected_chain);
     bool handle_alternative_block(const Block& b, const Crypto::Hash& id, block_verification_context& bvc, bool sendNewAlternativeBlockMessage = true);
     difficulty_type get_next_difficulty_for_alternative_chain(const std::list<blocks_ext_by_hash::iterator>& alt_chain, BlockEntry& bei);
@@ -365,7 +426,7 @@ namespace DynexCN {
     bool validate_miner_transaction(const Block& b, uint32_t height, size_t cumulativeBlockSize, uint64_t alreadyGeneratedCoins, uint64_t fee, uint64_t& reward, int64_t& emissionChange);
     bool rollback_blockchain_switching(std::list<Block>& original_chain, size_t rollback_height);
     bool get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count);
-    bool add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount& result_outs, uint64_t amount, size_t i);
+    bool add_out_to_get_random_outs(COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_outs_for_amount& result_outs, uint64_t amount, size_t i);
     size_t find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs);
     bool check_block_timestamp_main(const Block& b);
     bool check_block_timestamp(std::vector<uint64_t> timestamps, const Block& b);
@@ -377,13 +438,17 @@ namespace DynexCN {
     std::vector<Crypto::Hash> doBuildSparseChain(const Crypto::Hash& startBlockId) const;
     bool getBlockCumulativeSize(const Block& block, size_t& cumulativeSize);
     bool update_next_cumulative_size_limit();
-    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height = NULL);
+    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL, std::vector<RingSignatureCheck>* deferredChecks = NULL);
+    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL, std::vector<RingSignatureCheck>* deferredChecks = NULL);
+    bool checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height = NULL, std::vector<RingSignatureCheck>* deferredChecks = NULL);
+    bool checkRingSignature(const RingSignatureCheck& check);
+    bool verifyRingSignatures(const std::vector<RingSignatureCheck>& checks, size_t& failedCheck);
+    void verifyRingSignatures(const std::vector<RingSignatureCheck>& checks, std::vector<uint8_t>& results);
     const TransactionEntry& transactionByIndex(TransactionIndex index);
+    bool getRawBlock(uint32_t height, block_complete_entry& entry);
     bool pushBlock(const Block& blockData, block_verification_context& bvc);
     bool pushBlock(const Block& blockData, const std::vector<Transaction>& transactions, block_verification_context& bvc);
-    bool pushBlock(BlockEntry& block);
+    bool pushBlock(BlockEntry& block, const Crypto::Hash& proofOfWork);
     void popBlock();
     bool pushTransaction(BlockEntry& block, const Crypto::Hash& transactionHash, TransactionIndex transactionIndex);
     void popTransaction(const Transaction& transaction, const Crypto::Hash& transactionHash);
@@ -402,6 +467,7 @@ namespace DynexCN {
     void sendMessage(const BlockchainMessage& message);
 
     friend class LockedBlockchainStorage;
+    friend class SharedLockedBlockchainStorage;
   };
 
   class LockedBlockchainStorage: boost::noncopyable {
@@ -417,11 +483,28 @@ namespace DynexCN {
   private:
 
     Blockchain& m_bc;
-    std::lock_guard<std::recursive_mutex> m_lock;
+    std::lock_guard<Tools::RecursiveSharedMutex> m_lock;
+  };
+
+  // Read-only access, runs concurrently with other readers
+  class SharedLockedBlockchainStorage: boost::noncopyable {
+  public:
+
+    SharedLockedBlockchainStorage(Blockchain& bc)
+      : m_bc(bc), m_lock(bc.m_blockchain_lock) {}
+
+    Blockchain* operator -> () {
+      return &m_bc;
+    }
+
+  private:
+
+    Blockchain& m_bc;
+    Tools::SharedLockGuard<Tools::RecursiveSharedMutex> m_lock;
   };
 
   template<class visitor_t> bool Blockchain::scanOutputKeysForIndexes(const KeyInput& tx_in_to_key, visitor_t& vis, uint32_t* pmax_related_block_height) {
-    std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
+    Tools::SharedLockGuard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
     auto it = m_outputs.find(tx_in_to_key.amount);
     if (it == m_outputs.end() || !tx_in_to_key.outputIndexes.size())
       return false;
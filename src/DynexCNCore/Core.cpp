@@ -176,6 +176,8 @@ bool core::init(const CoreConfig& config, const MinerConfig& minerConfig, bool l
   bool r = m_mempool.init(m_config_folder);
   if (!(r)) { logger(ERROR, BRIGHT_RED) << "Failed to initialize memory pool"; return false; }
 
+  m_blockchain.setVerificationThreads(config.verificationThreads);
+  m_blockchain.setBlockCacheSize(config.blockCacheSize);
   r = m_blockchain.init(m_config_folder, load_existing);
   if (!(r)) { logger(ERROR, BRIGHT_RED) << "Failed to initialize blockchain storage"; return false; }
 
@@ -216,7 +218,7 @@ size_t core::addChain(const std::vector<const IBlock*>& chain) {
       getObjectHash(tx, txHash, blobSize);
       tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
 
-      if (!handleIncomingTransaction(tx, txHash, blobSize, tvc, true, get_block_height(block->getBlock()))) {
+      if (!handleIncomingTransaction(tx, txHash, blobSize, tvc, true, get_block_height(block->getBlock()), false)) {
         logger(ERROR, BRIGHT_RED) << "core::addChain() failed to handle transaction " << txHash << " from block " << blocksCounter << "/" << chain.size();
         allTransactionsAdded = false;
         break;
@@ -267,7 +269,7 @@ bool core::handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_contex
   uint32_t blockHeight;
   bool ok = getBlockContainingTx(tx_hash, blockId, blockHeight);
   if (!ok) blockHeight = this->get_current_blockchain_height();
-  return handleIncomingTransaction(tx, tx_hash, tx_blob.size(), tvc, keeped_by_block, blockHeight);
+  return handleIncomingTransaction(tx, tx_hash, tx_blob.size(), tvc, keeped_by_block, blockHeight, false);
 }
 
 bool core::get_stat_info(core_stat_info& st_inf) {
@@ -796,7 +798,7 @@ std::vector<Crypto::Hash> core::buildSparseChain() {
 }
 
 std::vector<Crypto::Hash> core::buildSparseChain(const Crypto::Hash& startBlockId) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
   assert(m_blockchain.haveBlock(startBlockId));
   return m_blockchain.buildSparseChain(startBlockId);
 }
@@ -806,7 +808,7 @@ bool core::handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_R
 }
 
 Crypto::Hash core::getBlockIdByHeight(uint32_t height) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
   if (height < m_blockchain.getCurrentBlockchainHeight()) {
     return m_blockchain.getBlockIdByHeight(height);
   } else {
@@ -877,7 +879,7 @@ void core::poolUpdated() {
 bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
   uint32_t& resStartHeight, uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockFullInfo>& entries) {
 
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   uint32_t currentHeight = lbs->getCurrentBlockchainHeight();
   uint32_t startOffset = 0;
@@ -905,26 +907,19 @@ bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t
     return true;
   }
 
-  std::list<Block> blocks;
-  lbs->getBlocks(startFullOffset, blocksLeft, blocks);
-
-  for (auto& b : blocks) {
+  uint32_t endHeight = static_cast<uint32_t>(std::min(uint64_t(startFullOffset) + blocksLeft, uint64_t(currentHeight)));
+  for (uint32_t height = startFullOffset; height < endHeight; ++height) {
     BlockFullInfo item;
+    std::shared_ptr<const EncodedBlock> encoded;
+    if (!lbs->getSyncBlock(height, timestamp, item.block_id, encoded)) {
+      break;
+    }
 
-    item.block_id = get_block_hash(b);
-
-    if (b.timestamp >= timestamp) {
-      // query transactions
-      std::list<Transaction> txs;
-      std::list<Crypto::Hash> missedTxs;
-      lbs->getTransactions(b.transactionHashes, txs, missedTxs);
-
+    if (encoded) {
       // fill data
       block_complete_entry& completeEntry = item;
-      completeEntry.block = asString(toBinaryArray(b));
-      for (auto& tx : txs) {
-        completeEntry.txs.push_back(asString(toBinaryArray(tx)));
-      }
+      completeEntry.block = encoded->block;
+      completeEntry.txs.assign(encoded->transactions.begin(), encoded->transactions.end());
     }
 
     entries.push_back(std::move(item));
@@ -934,7 +929,7 @@ bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t
 }
 
 bool core::findStartAndFullOffsets(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& startOffset, uint32_t& startFullOffset) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   if (knownBlockIds.empty()) {
     logger(ERROR, BRIGHT_RED) << "knownBlockIds is empty";
@@ -957,7 +952,7 @@ bool core::findStartAndFullOffsets(const std::vector<Crypto::Hash>& knownBlockId
 std::vector<Crypto::Hash> core::findIdsForShortBlocks(uint32_t startOffset, uint32_t startFullOffset) {
   assert(startOffset <= startFullOffset);
 
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   std::vector<Crypto::Hash> result;
   if (startOffset < startFullOffset) {
@@ -969,7 +964,7 @@ std::vector<Crypto::Hash> core::findIdsForShortBlocks(uint32_t startOffset, uint
 
 bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& resStartHeight,
   uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockShortInfo>& entries) {
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   resCurrentHeight = lbs->getCurrentBlockchainHeight();
   resStartHeight = 0;
@@ -993,28 +988,17 @@ bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint6
     return true;
   }
 
-  std::list<Block> blocks;
-  lbs->getBlocks(resFullOffset, blocksLeft, blocks);
-
-  for (auto& b : blocks) {
+  uint32_t endHeight = static_cast<uint32_t>(std::min(uint64_t(resFullOffset) + blocksLeft, uint64_t(resCurrentHeight)));
+  for (uint32_t height = resFullOffset; height < endHeight; ++height) {
     BlockShortInfo item;
+    std::shared_ptr<const EncodedBlock> encoded;
+    if (!lbs->getSyncBlock(height, timestamp, item.blockId, encoded)) {
+      break;
+    }
 
-    item.blockId = get_block_hash(b);
-
-    if (b.timestamp >= timestamp) {
-      std::list<Transaction> txs;
-      std::list<Crypto::Hash> missedTxs;
-      lbs->getTransactions(b.transactionHashes, txs, missedTxs);
-
-      item.block = asString(toBinaryArray(b));
-
-      for (const auto& tx: txs) {
-        TransactionPrefixInfo info;
-        info.txPrefix = tx;
-        info.txHash = getObjectHash(tx);
-
-        item.txPrefixes.push_back(std::move(info));
-      }
+    if (encoded) {
+      item.block = encoded->block;
+      item.txPrefixes = encoded->transactionPrefixes;
     }
 
     entries.push_back(std::move(item));
@@ -1067,6 +1051,14 @@ bool core::getBlockCumulativeDifficulty(uint32_t height, difficulty_type& diffic
   return true;
 }
 
+bool core::getBlockProofOfWork(const Block& block, uint32_t height, Crypto::Hash& proofOfWork) {
+  return m_blockchain.getBlockProofOfWork(block, height, proofOfWork);
+}
+
+void core::precomputeProofOfWork(const std::vector<Block>& blocks) {
+  m_blockchain.precomputeProofOfWork(blocks);
+}
+
 bool core::getBlockContainingTx(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight) {
   return m_blockchain.getBlockContainingTransaction(txId, blockId, blockHeight);
 }
@@ -1205,7 +1197,11 @@ bool core::getPaymentId(const Transaction& transaction, Crypto::Hash& paymentId)
   return getPaymentIdFromTransactionExtraNonce(extraNonce.nonce, paymentId);
 }
 
-bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock, uint32_t height) {
+bool core::checkTransactionSemantic(const Transaction& tx) {
+  return check_tx_semantic(tx, true);
+}
+
+bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock, uint32_t height, bool semanticChecked) {
   if (!check_tx_syntax(tx)) {
     logger(INFO) << "WRONG TRANSACTION BLOB, Failed to check tx " << txHash << " syntax, rejected";
     tvc.m_verification_failed = true;
@@ -1239,7 +1235,7 @@ bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash&
 
   }
 
-  if (!check_tx_semantic(tx, keptByBlock)) {
+  if (!semanticChecked && !check_tx_semantic(tx, keptByBlock)) {
     logger(INFO) << "WRONG TRANSACTION BLOB, Failed to check tx " << txHash << " semantic, rejected";
     tvc.m_verification_failed = true;
     return false;
@@ -1266,7 +1262,7 @@ bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash&
 
 std::unique_ptr<IBlock> core::getBlock(const Crypto::Hash& blockId) {
   std::lock_guard<decltype(m_mempool)> lk(m_mempool);
-  LockedBlockchainStorage lbs(m_blockchain);
+  SharedLockedBlockchainStorage lbs(m_blockchain);
 
   std::unique_ptr<BlockWithTransactions> blockPtr(new BlockWithTransactions());
   if (!lbs->getBlockByHash(blockId, blockPtr->block)) {
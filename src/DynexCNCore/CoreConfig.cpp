@@ -37,11 +37,20 @@
 
 #include "CoreConfig.h"
 
+#include <algorithm>
+
 #include "Common/Util.h"
 #include "Common/CommandLine.h"
 
 namespace DynexCN {
 
+namespace {
+
+const command_line::arg_descriptor<uint32_t> arg_verification_threads = { "verification-threads", "Number of threads verifying ring signatures, 0 - use all cores", 0 };
+const command_line::arg_descriptor<uint32_t> arg_block_cache_size = { "block-cache-size", "Number of decoded blocks kept in memory", 1024 };
+
+}
+
 CoreConfig::CoreConfig() {
   configFolder = Tools::getDefaultDataDirectory();
 }
@@ -51,9 +60,19 @@ void CoreConfig::init(const boost::program_options::variables_map& options) {
     configFolder = command_line::get_arg(options, command_line::arg_data_dir);
     configFolderDefaulted = options[command_line::arg_data_dir.name].defaulted();
   }
+
+  if (options.count(arg_verification_threads.name) != 0) {
+    verificationThreads = command_line::get_arg(options, arg_verification_threads);
+  }
+
+  if (options.count(arg_block_cache_size.name) != 0) {
+    blockCacheSize = std::max<uint32_t>(1, command_line::get_arg(options, arg_block_cache_size));
+  }
 }
 
 void CoreConfig::initOptions(boost::program_options::options_description& desc) {
+  command_line::add_arg(desc, arg_verification_threads);
+  command_line::add_arg(desc, arg_block_cache_size);
 }
 
 } //namespace DynexCN
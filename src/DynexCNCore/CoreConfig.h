@@ -52,6 +52,8 @@ public:
 
   std::string configFolder;
   bool configFolderDefaulted = true;
+  size_t verificationThreads = 0;
+  size_t blockCacheSize = 1024;
     
 };
 
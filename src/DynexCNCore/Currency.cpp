@@ -99,6 +99,8 @@ namespace DynexCN {
 			m_blocksFileName = "testnet_" + m_blocksFileName;
 			m_blocksCacheFileName = "testnet_" + m_blocksCacheFileName;
 			m_blockIndexesFileName = "testnet_" + m_blockIndexesFileName;
+			m_outputKeysFileName = "testnet_" + m_outputKeysFileName;
+			m_proofOfWorkFileName = "testnet_" + m_proofOfWorkFileName;
 			m_txPoolFileName = "testnet_" + m_txPoolFileName;
 			m_blockchainIndicesFileName = "testnet_" + m_blockchainIndicesFileName;
 		}
@@ -829,6 +831,8 @@ bool Currency::checkProofOfWorkV2(Crypto::cn_context& context, const Block& bloc
 		blocksFileName(parameters::CRYPTONOTE_BLOCKS_FILENAME);
 		blocksCacheFileName(parameters::CRYPTONOTE_BLOCKSCACHE_FILENAME);
 		blockIndexesFileName(parameters::CRYPTONOTE_BLOCKINDEXES_FILENAME);
+		outputKeysFileName(parameters::CRYPTONOTE_OUTPUTKEYS_FILENAME);
+		proofOfWorkFileName(parameters::CRYPTONOTE_PROOFOFWORK_FILENAME);
 		txPoolFileName(parameters::CRYPTONOTE_POOLDATA_FILENAME);
 		blockchainIndicesFileName(parameters::CRYPTONOTE_BLOCKCHAIN_INDICES_FILENAME);
 
@@ -156,6 +156,8 @@ public:
   const std::string& blocksFileName() const { return m_blocksFileName; }
   const std::string& blocksCacheFileName() const { return m_blocksCacheFileName; }
   const std::string& blockIndexesFileName() const { return m_blockIndexesFileName; }
+  const std::string& outputKeysFileName() const { return m_outputKeysFileName; }
+  const std::string& proofOfWorkFileName() const { return m_proofOfWorkFileName; }
   const std::string& txPoolFileName() const { return m_txPoolFileName; }
   const std::string& blockchainIndicesFileName() const { return m_blockchainIndicesFileName; }
 
@@ -273,6 +275,8 @@ private:
   std::string m_blocksFileName;
   std::string m_blocksCacheFileName;
   std::string m_blockIndexesFileName;
+  std::string m_outputKeysFileName;
+  std::string m_proofOfWorkFileName;
   std::string m_txPoolFileName;
   std::string m_blockchainIndicesFileName;
 
@@ -362,6 +366,8 @@ public:
   CurrencyBuilder& blocksFileName(const std::string& val) { m_currency.m_blocksFileName = val; return *this; }
   CurrencyBuilder& blocksCacheFileName(const std::string& val) { m_currency.m_blocksCacheFileName = val; return *this; }
   CurrencyBuilder& blockIndexesFileName(const std::string& val) { m_currency.m_blockIndexesFileName = val; return *this; }
+  CurrencyBuilder& outputKeysFileName(const std::string& val) { m_currency.m_outputKeysFileName = val; return *this; }
+  CurrencyBuilder& proofOfWorkFileName(const std::string& val) { m_currency.m_proofOfWorkFileName = val; return *this; }
   CurrencyBuilder& txPoolFileName(const std::string& val) { m_currency.m_txPoolFileName = val; return *this; }
   CurrencyBuilder& blockchainIndicesFileName(const std::string& val) { m_currency.m_blockchainIndicesFileName = val; return *this; }
   
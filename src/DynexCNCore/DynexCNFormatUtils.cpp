@@ -535,17 +535,19 @@ bool get_aux_block_header_hash(const Block& b, Hash& res) {
   return getObjectHash(blob, res);
 }
 
-bool get_block_longhash(cn_context &context, const Block& b, Hash& res) {
-  BinaryArray bd;
+bool get_block_longhash_blob(const Block& b, BinaryArray& blob) {
   if (b.majorVersion == BLOCK_MAJOR_VERSION_1 || b.majorVersion >= BLOCK_MAJOR_VERSION_4) {
-    if (!get_block_hashing_blob(b, bd)) {
-      return false;
-    }
+    return get_block_hashing_blob(b, blob);
   } else if (b.majorVersion == BLOCK_MAJOR_VERSION_2 || b.majorVersion == BLOCK_MAJOR_VERSION_3) {
-    if (!get_parent_block_hashing_blob(b, bd)) {
-      return false;
-    }
-  } else {
+    return get_parent_block_hashing_blob(b, blob);
+  }
+
+  return false;
+}
+
+bool get_block_longhash(cn_context &context, const Block& b, Hash& res) {
+  BinaryArray bd;
+  if (!get_block_longhash_blob(b, bd)) {
     return false;
   }
 
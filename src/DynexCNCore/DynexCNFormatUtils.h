@@ -94,6 +94,8 @@ bool get_parent_block_hashing_blob(const Block& b, BinaryArray& blob);
 bool get_aux_block_header_hash(const Block& b, Crypto::Hash& res);
 bool get_block_hash(const Block& b, Crypto::Hash& res);
 Crypto::Hash get_block_hash(const Block& b);
+// input of the proof-of-work hash
+bool get_block_longhash_blob(const Block& b, BinaryArray& blob);
 bool get_block_longhash(Crypto::cn_context &context, const Block& b, Crypto::Hash& res);
 bool get_inputs_money_amount(const Transaction& tx, uint64_t& money);
 uint64_t get_outs_money_amount(const Transaction& tx);
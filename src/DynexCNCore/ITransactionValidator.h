@@ -37,6 +37,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "DynexCNCore/DynexCNBasic.h"
 
 namespace DynexCN {
@@ -59,12 +61,20 @@ namespace DynexCN {
     }
   };
 
+  struct TransactionInputsCheck {
+    const DynexCN::Transaction* transaction;
+    BlockInfo maxUsedBlock;
+    BlockInfo lastFailed;
+    bool valid;
+  };
+
   class ITransactionValidator {
   public:
     virtual ~ITransactionValidator() {}
     
     virtual bool checkTransactionInputs(const DynexCN::Transaction& tx, BlockInfo& maxUsedBlock) = 0;
     virtual bool checkTransactionInputs(const DynexCN::Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) = 0;
+    virtual void checkTransactionsInputs(std::vector<TransactionInputsCheck>& checks) = 0;
     virtual bool haveSpentKeyImages(const DynexCN::Transaction& tx) = 0;
     virtual bool checkTransactionSize(size_t blobSize) = 0;
   };
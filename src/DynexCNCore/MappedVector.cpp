@@ -34,8 +34,7 @@
 // Copyright (c) 2016-2018, The Karbowanec developers
 // Copyright (c) 2017-2022, The CROAT.community developers
 
-
-#include "SwappedVector.h"
+#include "MappedVector.h"
 
 namespace {
 #ifdef _MSC_VER
@@ -0,0 +1,524 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "Common/ArrayView.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/VectorOutputStream.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
+#include "System/MemoryMappedFile.h"
+
+// Append-only vector of serialized items backed by a memory-mapped file. Items are stored back to back in the
+// items file, the index file holds the item count followed by the size of every item. The items file is grown in GROWTH_STEP chunks, bytes past the last item are unused.
+// Decoded items are kept in an LRU cache of poolSize entries, raw items can be borrowed with blob() without copying.
+// Reading is safe from several threads as long as the vector is not modified. Items evicted from the cache are retired
+// rather than destroyed, so references returned by operator[] stay valid until the owner reports with reclaim() that
+// every reader which might hold one is gone.
+template<class T> class MappedVector {
+public:
+  typedef T value_type;
+
+  static const uint64_t GROWTH_STEP = 64 * 1024 * 1024;
+
+  class const_iterator {
+  public:
+    typedef ptrdiff_t difference_type;
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef const T* pointer;
+    typedef const T& reference;
+    typedef T value_type;
+
+    const_iterator() {
+    }
+
+    const_iterator(MappedVector* mappedVector, size_t index) : m_mappedVector(mappedVector), m_index(index) {
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return m_index != other.m_index;
+    }
+
+    bool operator<(const const_iterator& other) const {
+      return m_index < other.m_index;
+    }
+
+    bool operator<=(const const_iterator& other) const {
+      return m_index <= other.m_index;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return m_index == other.m_index;
+    }
+
+    bool operator>(const const_iterator& other) const {
+      return m_index > other.m_index;
+    }
+
+    bool operator>=(const const_iterator& other) const {
+      return m_index >= other.m_index;
+    }
+
+    const_iterator& operator++() {
+      ++m_index;
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator i = *this;
+      ++m_index;
+      return i;
+    }
+
+    const_iterator& operator--() {
+      --m_index;
+      return *this;
+    }
+
+    const_iterator operator--(int) {
+      const_iterator i = *this;
+      --m_index;
+      return i;
+    }
+
+    const_iterator& operator+=(difference_type n) {
+      m_index += n;
+      return *this;
+    }
+
+    const_iterator& operator-=(difference_type n) {
+      m_index -= n;
+      return *this;
+    }
+
+    const_iterator operator+(difference_type n) const {
+      return const_iterator(m_mappedVector, m_index + n);
+    }
+
+    friend const_iterator operator+(difference_type n, const const_iterator& i) {
+      return const_iterator(i.m_mappedVector, n + i.m_index);
+    }
+
+    difference_type operator-(const const_iterator& other) const {
+      return m_index - other.m_index;
+    }
+
+    const_iterator operator-(difference_type n) const {
+      return const_iterator(m_mappedVector, m_index - n);
+    }
+
+    const T& operator*() const {
+      return (*m_mappedVector)[m_index];
+    }
+
+    const T* operator->() const {
+      return &(*m_mappedVector)[m_index];
+    }
+
+    const T& operator[](difference_type offset) const {
+      return (*m_mappedVector)[m_index + offset];
+    }
+
+    size_t index() const {
+      return m_index;
+    }
+
+  private:
+    MappedVector* m_mappedVector;
+    size_t m_index;
+  };
+
+  MappedVector();
+  ~MappedVector();
+
+  bool open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize);
+  void close();
+
+  bool empty() const;
+  uint64_t size() const;
+  const_iterator begin();
+  const_iterator end();
+  const T& operator[](uint64_t index);
+  const T& front();
+  const T& back();
+  void clear();
+  void pop_back();
+  void push_back(const T& item);
+
+  // Serialized item, stays valid until the next push_back, pop_back or clear
+  Common::ArrayView<uint8_t> blob(uint64_t index) const;
+  // Decodes an item bypassing the cache, may be called from several threads while the vector is not modified
+  void read(uint64_t index, T& item) const;
+
+  uint64_t cacheHits() const;
+  uint64_t cacheMisses() const;
+  // Stamps the items retired so far with generation and frees those stamped before oldestGeneration, the oldest reader
+  // still around, see RecursiveSharedMutex::setReleaseHandler
+  void reclaim(uint64_t oldestGeneration, uint64_t generation);
+
+private:
+  struct ItemEntry {
+    std::unique_ptr<T> item;
+    std::list<uint64_t>::iterator cacheIter;
+  };
+
+  System::MemoryMappedFile m_itemsFile;
+  std::fstream m_indexesFile;
+  size_t m_poolSize;
+  std::vector<uint64_t> m_offsets;
+  uint64_t m_itemsFileSize;
+  std::mutex m_cacheMutex;
+  std::unordered_map<uint64_t, ItemEntry> m_items;
+  std::list<uint64_t> m_cache;
+  // retired items in retire order with their stamp, unstamped ones carry the largest generation
+  std::deque<std::pair<uint64_t, std::unique_ptr<T>>> m_retired;
+  std::atomic<uint64_t> m_cacheHits;
+  std::atomic<uint64_t> m_cacheMisses;
+
+  void reserve(uint64_t itemsFileSize);
+  const T& prepare(uint64_t index, std::unique_ptr<T>&& item);
+  void retire(typename std::unordered_map<uint64_t, ItemEntry>::iterator itemIter);
+};
+
+template<class T> MappedVector<T>::MappedVector() : m_poolSize(0), m_itemsFileSize(0), m_cacheHits(0), m_cacheMisses(0) {
+}
+
+template<class T> MappedVector<T>::~MappedVector() {
+  close();
+}
+
+template<class T> bool MappedVector<T>::open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize) {
+  if (poolSize == 0) {
+    return false;
+  }
+
+  std::error_code ec;
+  m_indexesFile.open(indexFileName, std::ios::in | std::ios::out | std::ios::binary);
+  if (m_indexesFile && boost::filesystem::exists(itemFileName)) {
+    uint64_t count;
+    m_indexesFile.read(reinterpret_cast<char*>(&count), sizeof count);
+    if (!m_indexesFile) {
+      return false;
+    }
+
+    std::vector<uint64_t> offsets;
+    uint64_t itemsFileSize = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+      uint32_t itemSize;
+      m_indexesFile.read(reinterpret_cast<char*>(&itemSize), sizeof itemSize);
+      if (!m_indexesFile) {
+        return false;
+      }
+
+      offsets.emplace_back(itemsFileSize);
+      itemsFileSize += itemSize;
+    }
+
+    // an empty file can not be mapped, the items file always has at least one growth step
+    if (boost::filesystem::file_size(itemFileName) < itemsFileSize + 1) {
+      boost::system::error_code resizeError;
+      boost::filesystem::resize_file(itemFileName, (itemsFileSize / GROWTH_STEP + 1) * GROWTH_STEP, resizeError);
+      if (resizeError) {
+        return false;
+      }
+    }
+
+    m_itemsFile.open(itemFileName, ec);
+    if (ec) {
+      return false;
+    }
+
+    m_offsets.swap(offsets);
+    m_itemsFileSize = itemsFileSize;
+  } else {
+    m_itemsFile.create(itemFileName, GROWTH_STEP, true, ec);
+    if (ec) {
+      return false;
+    }
+
+    m_indexesFile.close();
+    m_indexesFile.clear();
+    m_indexesFile.open(indexFileName, std::ios::out | std::ios::binary);
+    uint64_t count = 0;
+    m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
+    if (!m_indexesFile) {
+      return false;
+    }
+
+    m_indexesFile.close();
+    m_indexesFile.open(indexFileName, std::ios::in | std::ios::out | std::ios::binary);
+    m_offsets.clear();
+    m_itemsFileSize = 0;
+  }
+
+  m_poolSize = poolSize;
+  m_items.clear();
+  m_cache.clear();
+  m_retired.clear();
+  m_cacheHits = 0;
+  m_cacheMisses = 0;
+  return true;
+}
+
+template<class T> void MappedVector<T>::close() {
+  if (m_itemsFile.isOpened()) {
+    std::error_code ignore;
+    m_itemsFile.close(ignore);
+  }
+}
+
+template<class T> bool MappedVector<T>::empty() const {
+  return m_offsets.empty();
+}
+
+template<class T> uint64_t MappedVector<T>::size() const {
+  return m_offsets.size();
+}
+
+template<class T> typename MappedVector<T>::const_iterator MappedVector<T>::begin() {
+  return const_iterator(this, 0);
+}
+
+template<class T> typename MappedVector<T>::const_iterator MappedVector<T>::end() {
+  return const_iterator(this, m_offsets.size());
+}
+
+template<class T> const T& MappedVector<T>::operator[](uint64_t index) {
+  {
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    auto itemIter = m_items.find(index);
+    if (itemIter != m_items.end()) {
+      if (itemIter->second.cacheIter != --m_cache.end()) {
+        m_cache.splice(m_cache.end(), m_cache, itemIter->second.cacheIter);
+      }
+
+      ++m_cacheHits;
+      return *itemIter->second.item;
+    }
+  }
+
+  if (index >= m_offsets.size()) {
+    throw std::runtime_error("MappedVector::operator[]");
+  }
+
+  // decode without holding the cache, a concurrent reader may have cached the item meanwhile
+  std::unique_ptr<T> item(new T());
+  read(index, *item);
+  ++m_cacheMisses;
+
+  std::lock_guard<std::mutex> lock(m_cacheMutex);
+  auto itemIter = m_items.find(index);
+  if (itemIter != m_items.end()) {
+    return *itemIter->second.item;
+  }
+
+  return prepare(index, std::move(item));
+}
+
+template<class T> const T& MappedVector<T>::front() {
+  return operator[](0);
+}
+
+template<class T> const T& MappedVector<T>::back() {
+  return operator[](m_offsets.size() - 1);
+}
+
+template<class T> Common::ArrayView<uint8_t> MappedVector<T>::blob(uint64_t index) const {
+  if (index >= m_offsets.size() || !m_itemsFile.isOpened()) {
+    throw std::runtime_error("MappedVector::blob");
+  }
+
+  uint64_t itemEnd = index + 1 < m_offsets.size() ? m_offsets[index + 1] : m_itemsFileSize;
+  return Common::ArrayView<uint8_t>(m_itemsFile.data() + m_offsets[index], static_cast<size_t>(itemEnd - m_offsets[index]));
+}
+
+template<class T> void MappedVector<T>::read(uint64_t index, T& item) const {
+  Common::ArrayView<uint8_t> itemBlob = blob(index);
+  Common::MemoryInputStream stream(itemBlob.getData(), itemBlob.getSize());
+  DynexCN::BinaryInputStreamSerializer archive(stream);
+  serialize(item, archive);
+}
+
+template<class T> uint64_t MappedVector<T>::cacheHits() const {
+  return m_cacheHits;
+}
+
+template<class T> uint64_t MappedVector<T>::cacheMisses() const {
+  return m_cacheMisses;
+}
+
+template<class T> void MappedVector<T>::reclaim(uint64_t oldestGeneration, uint64_t generation) {
+  std::lock_guard<std::mutex> lock(m_cacheMutex);
+  for (auto it = m_retired.rbegin(); it != m_retired.rend() && it->first == std::numeric_limits<uint64_t>::max(); ++it) {
+    it->first = generation;
+  }
+
+  while (!m_retired.empty() && m_retired.front().first < oldestGeneration) {
+    m_retired.pop_front();
+  }
+}
+
+template<class T> void MappedVector<T>::clear() {
+  if (!m_indexesFile) {
+    throw std::runtime_error("MappedVector::clear");
+  }
+
+  m_indexesFile.seekp(0);
+  uint64_t count = 0;
+  m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
+  if (!m_indexesFile) {
+    throw std::runtime_error("MappedVector::clear");
+  }
+
+  m_offsets.clear();
+  m_itemsFileSize = 0;
+
+  std::lock_guard<std::mutex> lock(m_cacheMutex);
+  while (!m_items.empty()) {
+    retire(m_items.begin());
+  }
+}
+
+template<class T> void MappedVector<T>::pop_back() {
+  if (!m_indexesFile) {
+    throw std::runtime_error("MappedVector::pop_back");
+  }
+
+  m_indexesFile.seekp(0);
+  uint64_t count = m_offsets.size() - 1;
+  m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
+  if (!m_indexesFile) {
+    throw std::runtime_error("MappedVector::pop_back");
+  }
+
+  m_itemsFileSize = m_offsets.back();
+  m_offsets.pop_back();
+
+  std::lock_guard<std::mutex> lock(m_cacheMutex);
+  auto itemIter = m_items.find(m_offsets.size());
+  if (itemIter != m_items.end()) {
+    retire(itemIter);
+  }
+}
+
+template<class T> void MappedVector<T>::push_back(const T& item) {
+  std::vector<uint8_t> itemBlob;
+
+  {
+    Common::VectorOutputStream stream(itemBlob);
+    DynexCN::BinaryOutputStreamSerializer archive(stream);
+    serialize(const_cast<T&>(item), archive);
+  }
+
+  reserve(m_itemsFileSize + itemBlob.size());
+  std::copy(itemBlob.begin(), itemBlob.end(), m_itemsFile.data() + m_itemsFileSize);
+
+  {
+    if (!m_indexesFile) {
+      throw std::runtime_error("MappedVector::push_back");
+    }
+
+    m_indexesFile.seekp(sizeof(uint64_t) + sizeof(uint32_t) * m_offsets.size());
+    uint32_t itemSize = static_cast<uint32_t>(itemBlob.size());
+    m_indexesFile.write(reinterpret_cast<char*>(&itemSize), sizeof itemSize);
+    if (!m_indexesFile) {
+      throw std::runtime_error("MappedVector::push_back");
+    }
+
+    m_indexesFile.seekp(0);
+    uint64_t count = m_offsets.size() + 1;
+    m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
+    if (!m_indexesFile) {
+      throw std::runtime_error("MappedVector::push_back");
+    }
+  }
+
+  m_offsets.push_back(m_itemsFileSize);
+  m_itemsFileSize += itemBlob.size();
+
+  std::lock_guard<std::mutex> lock(m_cacheMutex);
+  prepare(m_offsets.size() - 1, std::unique_ptr<T>(new T(item)));
+}
+
+template<class T> void MappedVector<T>::reserve(uint64_t itemsFileSize) {
+  if (!m_itemsFile.isOpened()) {
+    throw std::runtime_error("MappedVector::reserve");
+  }
+
+  if (itemsFileSize < m_itemsFile.size()) {
+    return;
+  }
+
+  std::string path = m_itemsFile.path();
+  m_itemsFile.close();
+  boost::filesystem::resize_file(path, (itemsFileSize / GROWTH_STEP + 1) * GROWTH_STEP);
+  m_itemsFile.open(path);
+}
+
+template<class T> const T& MappedVector<T>::prepare(uint64_t index, std::unique_ptr<T>&& item) {
+  if (m_items.size() == m_poolSize) {
+    retire(m_items.find(m_cache.front()));
+  }
+
+  auto itemIter = m_items.emplace(index, ItemEntry()).first;
+  itemIter->second.item = std::move(item);
+  m_cache.push_back(index);
+  itemIter->second.cacheIter = --m_cache.end();
+  return *itemIter->second.item;
+}
+
+template<class T> void MappedVector<T>::retire(typename std::unordered_map<uint64_t, ItemEntry>::iterator itemIter) {
+  m_cache.erase(itemIter->second.cacheIter);
+  m_retired.emplace_back(std::numeric_limits<uint64_t>::max(), std::move(itemIter->second.item));
+  m_items.erase(itemIter);
+}
@@ -0,0 +1,133 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#include "OutputKeyTable.h"
+
+#include <cassert>
+#include <system_error>
+
+namespace DynexCN {
+
+bool OutputKeyTable::open(const std::string& fileName) {
+  m_positions.clear();
+  try {
+    m_records.open(fileName, Common::FileMappedVectorOpenMode::OPEN_OR_CREATE);
+  } catch (std::exception&) {
+    // a damaged table is recreated empty and refilled by the owner
+    std::error_code ec;
+    if (m_records.isOpened()) {
+      m_records.close(ec);
+    }
+
+    boost::system::error_code removeError;
+    boost::filesystem::remove(fileName, removeError);
+    try {
+      m_records.open(fileName, Common::FileMappedVectorOpenMode::CREATE);
+    } catch (std::exception&) {
+      return false;
+    }
+  }
+
+  m_records.setAutoFlush(false);
+  for (uint64_t i = 0; i < m_records.size(); ++i) {
+    m_positions[m_records[i].amount].push_back(static_cast<uint32_t>(i));
+  }
+
+  return true;
+}
+
+void OutputKeyTable::close() {
+  if (m_records.isOpened()) {
+    m_records.flush();
+    m_records.close();
+  }
+
+  m_positions.clear();
+}
+
+uint64_t OutputKeyTable::size() const {
+  return m_records.size();
+}
+
+const OutputKeyTable::Record& OutputKeyTable::back() const {
+  return m_records.back();
+}
+
+size_t OutputKeyTable::outputCount(uint64_t amount) const {
+  auto it = m_positions.find(amount);
+  return it != m_positions.end() ? it->second.size() : 0;
+}
+
+const OutputKeyTable::Record* OutputKeyTable::find(uint64_t amount, uint32_t globalIndex) const {
+  auto it = m_positions.find(amount);
+  if (it == m_positions.end() || globalIndex >= it->second.size()) {
+    return nullptr;
+  }
+
+  return &m_records[it->second[globalIndex]];
+}
+
+void OutputKeyTable::reserve(uint64_t count) {
+  m_records.reserve(count);
+}
+
+void OutputKeyTable::push(uint64_t amount, const Crypto::PublicKey& key, uint64_t unlockTime, uint32_t blockHeight) {
+  m_positions[amount].push_back(static_cast<uint32_t>(m_records.size()));
+  m_records.push_back(Record{ key, amount, unlockTime, blockHeight, 0 });
+}
+
+void OutputKeyTable::pop() {
+  assert(!m_records.empty());
+  auto it = m_positions.find(m_records.back().amount);
+  assert(it != m_positions.end() && it->second.back() == m_records.size() - 1);
+  it->second.pop_back();
+  if (it->second.empty()) {
+    m_positions.erase(it);
+  }
+
+  m_records.pop_back();
+}
+
+void OutputKeyTable::clear() {
+  m_records.clear();
+  m_positions.clear();
+}
+
+void OutputKeyTable::flush() {
+  m_records.flush();
+}
+
+}
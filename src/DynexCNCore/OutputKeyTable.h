@@ -0,0 +1,83 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CryptoTypes.h"
+#include "Common/FileMappedVector.h"
+
+namespace DynexCN {
+
+// Key, unlock time and height of every key output in chain order, kept in a memory-mapped file so that ring members
+// and decoys are resolved without decoding the transactions they come from. Outputs of an amount are addressed by
+// their global index through position lists that are rebuilt in memory when the table is opened.
+// The table is only flushed on request, the owner checks it against the blockchain after a restart.
+class OutputKeyTable {
+public:
+  struct Record {
+    Crypto::PublicKey key;
+    uint64_t amount;
+    uint64_t unlockTime;
+    uint32_t blockHeight;
+    uint32_t reserved;
+  };
+
+  bool open(const std::string& fileName);
+  void close();
+
+  uint64_t size() const;
+  const Record& back() const;
+  size_t outputCount(uint64_t amount) const;
+  // Returns nullptr if the amount has no output with this global index
+  const Record* find(uint64_t amount, uint32_t globalIndex) const;
+
+  void reserve(uint64_t count);
+  void push(uint64_t amount, const Crypto::PublicKey& key, uint64_t unlockTime, uint32_t blockHeight);
+  void pop();
+  void clear();
+  void flush();
+
+private:
+  Common::FileMappedVector<Record> m_records;
+  std::unordered_map<uint64_t, std::vector<uint32_t>> m_positions;
+};
+
+}
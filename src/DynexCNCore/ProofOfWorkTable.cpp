@@ -0,0 +1,135 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#include "ProofOfWorkTable.h"
+
+#include <cassert>
+#include <system_error>
+
+#include "crypto/hash.h"
+#include "DynexCNCore/DynexCNBasic.h"
+
+namespace DynexCN {
+
+bool ProofOfWorkTable::open(const std::string& fileName) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  try {
+    m_records.open(fileName, Common::FileMappedVectorOpenMode::OPEN_OR_CREATE);
+  } catch (std::exception&) {
+    // a damaged table is recreated empty, the hashes are computed again on demand
+    std::error_code ec;
+    if (m_records.isOpened()) {
+      m_records.close(ec);
+    }
+
+    boost::system::error_code removeError;
+    boost::filesystem::remove(fileName, removeError);
+    try {
+      m_records.open(fileName, Common::FileMappedVectorOpenMode::CREATE);
+    } catch (std::exception&) {
+      return false;
+    }
+  }
+
+  m_records.setAutoFlush(false);
+  return true;
+}
+
+void ProofOfWorkTable::close() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (m_records.isOpened()) {
+    m_records.flush();
+    m_records.close();
+  }
+}
+
+uint64_t ProofOfWorkTable::size() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_records.size();
+}
+
+bool ProofOfWorkTable::find(uint32_t height, const Crypto::Hash& blockHash, Crypto::Hash& proofOfWork) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (height >= m_records.size() || m_records[height].blockHash != blockHash) {
+    return false;
+  }
+
+  proofOfWork = m_records[height].proofOfWork;
+  return true;
+}
+
+void ProofOfWorkTable::update(uint32_t height, const Crypto::Hash& blockHash, const Crypto::Hash& proofOfWork) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (height < m_records.size()) {
+    m_records[height] = Record{ blockHash, proofOfWork };
+  }
+}
+
+void ProofOfWorkTable::resize(uint64_t count) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  if (count < m_records.size()) {
+    m_records.erase(m_records.cbegin() + count, m_records.cend());
+    return;
+  }
+
+  m_records.reserve(count);
+  while (m_records.size() < count) {
+    m_records.push_back(Record{ NULL_HASH, NULL_HASH });
+  }
+}
+
+void ProofOfWorkTable::push(const Crypto::Hash& blockHash, const Crypto::Hash& proofOfWork) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_records.push_back(Record{ proofOfWork != NULL_HASH ? blockHash : NULL_HASH, proofOfWork });
+}
+
+void ProofOfWorkTable::pop() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  assert(!m_records.empty());
+  m_records.pop_back();
+}
+
+void ProofOfWorkTable::clear() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_records.clear();
+}
+
+void ProofOfWorkTable::flush() {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_records.flush();
+}
+
+}
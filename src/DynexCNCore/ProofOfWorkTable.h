@@ -0,0 +1,82 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "CryptoTypes.h"
+#include "Common/FileMappedVector.h"
+
+namespace DynexCN {
+
+// Proof-of-work hash of every main chain block by height, kept in a memory-mapped file next to the output key table.
+// Each record carries the hash of the block it was computed for, so records left behind by an unflushed shutdown or
+// written for a block that was reorganized away are recognised as stale instead of being trusted.
+// Blocks accepted inside the checkpoint zone have no record until their hash is computed on demand.
+class ProofOfWorkTable {
+public:
+  struct Record {
+    Crypto::Hash blockHash;
+    Crypto::Hash proofOfWork;
+  };
+
+  bool open(const std::string& fileName);
+  void close();
+
+  uint64_t size() const;
+  // Returns false if no proof of work is recorded for this block
+  bool find(uint32_t height, const Crypto::Hash& blockHash, Crypto::Hash& proofOfWork) const;
+  // Replaces the record of a block that is already in the table
+  void update(uint32_t height, const Crypto::Hash& blockHash, const Crypto::Hash& proofOfWork);
+
+  // Truncates the table or pads it with empty records
+  void resize(uint64_t count);
+  // A null proof of work, for blocks accepted without checking it, leaves the record empty
+  void push(const Crypto::Hash& blockHash, const Crypto::Hash& proofOfWork);
+  void pop();
+  void clear();
+  void flush();
+
+private:
+  // records are updated in place by readers that only hold the blockchain lock shared
+  mutable std::mutex m_mutex;
+  Common::FileMappedVector<Record> m_records;
+};
+
+}
@@ -301,16 +301,24 @@ namespace DynexCN {
   void tx_memory_pool::get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) const {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
     std::unordered_set<Crypto::Hash> ready_tx_ids;
+    std::vector<TransactionInputsCheck> inputsChecks;
+    std::vector<Crypto::Hash> inputsCheckIds;
     for (const auto& tx : m_transactions) {
-      TransactionCheckInfo checkInfo(tx);
 	  if (m_validated_transactions.find(tx.id) != m_validated_transactions.end()) {
 		  ready_tx_ids.insert(tx.id);
 		  logger(DEBUGGING) << "MemPool - tx " << tx.id << " loaded from cache";
+	  } else {
+		  inputsChecks.push_back({ &tx.tx, tx.maxUsedBlock, tx.lastFailedBlock, false });
+		  inputsCheckIds.push_back(tx.id);
 	  }
-	  else if (is_transaction_ready_to_go(tx.tx, checkInfo)) {
-		  ready_tx_ids.insert(tx.id);
-		  m_validated_transactions.insert(tx.id);
-		  logger(DEBUGGING) << "MemPool - tx " << tx.id << " added to cache";
+    }
+
+    m_validator.checkTransactionsInputs(inputsChecks);
+    for (size_t i = 0; i < inputsChecks.size(); ++i) {
+	  if (inputsChecks[i].valid && !m_validator.haveSpentKeyImages(*inputsChecks[i].transaction)) {
+		  ready_tx_ids.insert(inputsCheckIds[i]);
+		  m_validated_transactions.insert(inputsCheckIds[i]);
+		  logger(DEBUGGING) << "MemPool - tx " << inputsCheckIds[i] << " added to cache";
 	  }
     }
 
@@ -368,19 +376,6 @@ namespace DynexCN {
     return std::unique_lock<std::recursive_mutex>(m_transactions_lock);
   }
 
-  //---------------------------------------------------------------------------------
-  bool tx_memory_pool::is_transaction_ready_to_go(const Transaction& tx, TransactionCheckInfo& txd) const {
-
-    if (!m_validator.checkTransactionInputs(tx, txd.maxUsedBlock, txd.lastFailedBlock))
-      return false;
-
-    //if we here, transaction seems valid, but, anyway, check for key_images collisions with blockchain, just to be sure
-    if (m_validator.haveSpentKeyImages(tx))
-      return false;
-
-    //transaction is ok.
-    return true;
-  }
   //---------------------------------------------------------------------------------
   std::string tx_memory_pool::print_pool(bool short_format) const {
     std::stringstream ss;
@@ -419,44 +414,89 @@ namespace DynexCN {
     max_total_size = std::min(max_total_size, maxCumulativeSize) - m_currency.minerTxBlobReservedSize();
 
     BlockTemplate blockTemplate;
+    std::unordered_set<Crypto::Hash> processed;
+
+    // a transaction that fails its inputs check frees room for transactions skipped by size, so select again until nothing fails
+    for (;;) {
+      // apply the size and fee limits first, assuming every selected transaction makes it into the block
+      std::vector<decltype(m_fee_index.begin())> candidates;
+      size_t plannedSize = total_size;
+      for (auto i = m_fee_index.begin(); i != m_fee_index.end(); ++i) {
+        const auto& txd = *i;
+        if (processed.count(txd.id) != 0) {
+          continue;
+        }
+
+        size_t blockSizeLimit = (txd.fee == 0) ? median_size : max_total_size;
+        if (blockSizeLimit < plannedSize + txd.blobSize) {
+          continue;
+        }
+
+        processed.insert(txd.id);
 
-    for (auto i = m_fee_index.begin(); i != m_fee_index.end(); ++i) {
-      const auto& txd = *i;
+        tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+        if (!m_core.check_tx_fee(txd.tx, txd.blobSize, tvc, m_core.get_current_blockchain_height())) {
+          logger(DEBUGGING) << "Transaction " << txd.id << " not included to block template because fee is too small";
+          continue;
+        }
 
-      size_t blockSizeLimit = (txd.fee == 0) ? median_size : max_total_size;
-      if (blockSizeLimit < total_size + txd.blobSize) {
-        continue;
+        candidates.push_back(i);
+        plannedSize += txd.blobSize;
       }
 
-      tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
-      if (!m_core.check_tx_fee(txd.tx, txd.blobSize, tvc, m_core.get_current_blockchain_height())) {
-        logger(DEBUGGING) << "Transaction " << txd.id << " not included to block template because fee is too small";
-        continue;
+      if (candidates.empty()) {
+        break;
       }
 
-      TransactionCheckInfo checkInfo(txd);
-	  bool ready = false;
-	  if (m_validated_transactions.find(txd.id) != m_validated_transactions.end()) {
-		  ready = true;
-		  logger(DEBUGGING) << "Fill block template - tx added from cache: " << txd.id;
-	  }
-	  else if (is_transaction_ready_to_go(txd.tx, checkInfo)) {
-		  ready = true;
-		  m_validated_transactions.insert(txd.id);
-		  logger(DEBUGGING) << "Fill block template - tx added to cache: " << txd.id;
-	  }
+      // check inputs of the selected not yet validated transactions in one batch, ring signatures are verified in parallel
+      std::vector<TransactionInputsCheck> inputsChecks;
+      std::unordered_map<Crypto::Hash, size_t> inputsCheckIndexes;
+      for (const auto& i : candidates) {
+        const auto& txd = *i;
+        if (m_validated_transactions.find(txd.id) == m_validated_transactions.end()) {
+          inputsCheckIndexes.emplace(txd.id, inputsChecks.size());
+          inputsChecks.push_back({ &txd.tx, txd.maxUsedBlock, txd.lastFailedBlock, false });
+        }
+      }
+
+      m_validator.checkTransactionsInputs(inputsChecks);
+
+      bool rejected = false;
+      for (const auto& i : candidates) {
+        const auto& txd = *i;
+        TransactionCheckInfo checkInfo(txd);
+        bool ready = false;
+        if (m_validated_transactions.find(txd.id) != m_validated_transactions.end()) {
+          ready = true;
+          logger(DEBUGGING) << "Fill block template - tx added from cache: " << txd.id;
+        } else {
+          const TransactionInputsCheck& inputsCheck = inputsChecks[inputsCheckIndexes[txd.id]];
+          checkInfo.maxUsedBlock = inputsCheck.maxUsedBlock;
+          checkInfo.lastFailedBlock = inputsCheck.lastFailed;
+          if (inputsCheck.valid && !m_validator.haveSpentKeyImages(txd.tx)) {
+            ready = true;
+            m_validated_transactions.insert(txd.id);
+            logger(DEBUGGING) << "Fill block template - tx added to cache: " << txd.id;
+          }
+        }
+
+        // update item state
+        m_fee_index.modify(i, [&checkInfo](TransactionCheckInfo& item) {
+          item = checkInfo;
+        });
+
+        if (ready && blockTemplate.addTransaction(txd.id, txd.tx)) {
+          total_size += txd.blobSize;
+          fee += txd.fee;
+          logger(DEBUGGING) << "Transaction " << txd.id << " included to block template";
+        } else {
+          rejected = true;
+          logger(DEBUGGING) << "Transaction " << txd.id << " is failed to include to block template";
+        }
+      }
 
-      // update item state
-      m_fee_index.modify(i, [&checkInfo](TransactionCheckInfo& item) {
-        item = checkInfo;
-      });
-
-      if (ready && blockTemplate.addTransaction(txd.id, txd.tx)) {
-        total_size += txd.blobSize;
-        fee += txd.fee;
-        logger(DEBUGGING) << "Transaction " << txd.id << " included to block template";
-      } else {
-        logger(DEBUGGING) << "Transaction " << txd.id << " is failed to include to block template";
+      if (!rejected) {
+        break;
       }
     }
 
@@ -0,0 +1,370 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "BlockImportPipeline.h"
+
+#include <unordered_set>
+
+#include <boost/scope_exit.hpp>
+#include <boost/utility/value_init.hpp>
+
+#include "Common/StringTools.h"
+#include "DynexCNCore/DynexCNFormatUtils.h"
+#include "DynexCNCore/DynexCNTools.h"
+#include "DynexCNCore/Currency.h"
+#include "DynexCNCore/ICore.h"
+#include "DynexCNCore/VerificationContext.h"
+
+using namespace Logging;
+
+namespace DynexCN {
+
+namespace {
+
+uint64_t elapsedMicroseconds(BlockImportPipeline::Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(BlockImportPipeline::Clock::now() - start).count();
+}
+
+}
+
+BlockImportPipeline::BlockImportPipeline(const Currency& currency, ICore& core, Logging::ILogger& log, CommitFailedCallback&& commitFailed) :
+  m_currency(currency),
+  m_core(core),
+  logger(log, "import"),
+  m_commitFailed(std::move(commitFailed)),
+  m_failed(false),
+  m_stopped(false),
+  m_decodeChunks(0),
+  m_decodeQueued(0),
+  m_decodeBusy(0),
+  m_decoded(0),
+  m_decodeBusyTime(0),
+  m_commitChunks(0),
+  m_commitQueued(0),
+  m_commitBusy(0),
+  m_committed(0),
+  m_commitBusyTime(0),
+  m_lastReport(Clock::now()),
+  m_lastDecodeBusyTime(0),
+  m_lastCommitBusyTime(0) {
+}
+
+BlockImportPipeline::~BlockImportPipeline() {
+  stop();
+}
+
+void BlockImportPipeline::startThreads() {
+  if (!m_decodePool) {
+    m_decodePool.reset(new Tools::WorkerPool());
+    m_commitThread = std::thread(std::bind(&BlockImportPipeline::commitThread, this));
+  }
+}
+
+void BlockImportPipeline::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stopped) {
+      return;
+    }
+
+    m_stopped = true;
+    m_commitQueue.clear();
+    m_commitQueued = 0;
+  }
+
+  m_haveCommit.notify_all();
+  if (m_commitThread.joinable()) {
+    m_commitThread.join();
+  }
+
+  // finishes the decode tasks already posted
+  m_decodePool.reset();
+}
+
+void BlockImportPipeline::decode(std::vector<block_complete_entry>&& entries, DecodeCallback&& done) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stopped) {
+      return;
+    }
+
+    startThreads();
+  }
+
+  struct Batch {
+    std::vector<block_complete_entry> entries;
+    DecodeResult result;
+    DecodeCallback done;
+    std::atomic<size_t> remaining;
+    std::mutex errorMutex;
+  };
+
+  size_t count = entries.size();
+  std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+  batch->entries = std::move(entries);
+  batch->result.blocks.resize(count);
+  batch->done = std::move(done);
+  batch->remaining = count;
+
+  if (count == 0) {
+    batch->done(std::move(batch->result));
+    return;
+  }
+
+  ++m_decodeChunks;
+  m_decodeQueued += count;
+
+  // one task per block rather than parallelFor, the pool threads must never wait for each other
+  for (size_t i = 0; i < count; ++i) {
+    m_decodePool->post([this, batch, i] {
+      --m_decodeQueued;
+      ++m_decodeBusy;
+      auto start = Clock::now();
+
+      std::string error;
+      if (!decodeBlock(batch->entries[i], batch->result.blocks[i], error)) {
+        std::lock_guard<std::mutex> lock(batch->errorMutex);
+        if (batch->result.error.empty()) {
+          batch->result.error = error;
+        }
+      }
+
+      m_decodeBusyTime += elapsedMicroseconds(start);
+      --m_decodeBusy;
+      ++m_decoded;
+
+      if (--batch->remaining == 0) {
+        if (!batch->result.error.empty()) {
+          batch->result.blocks.clear();
+        }
+
+        --m_decodeChunks;
+        batch->done(std::move(batch->result));
+      }
+    });
+  }
+}
+
+bool BlockImportPipeline::decodeBlock(const block_complete_entry& entry, PreparedBlock& prepared, std::string& error) {
+  BinaryArray blockBlob = Common::asBinaryArray(entry.block);
+  if (blockBlob.size() > m_currency.maxBlockBlobSize()) {
+    error = "too big block size " + std::to_string(blockBlob.size());
+    return false;
+  }
+
+  if (!fromBinaryArray(prepared.block, blockBlob)) {
+    error = "failed to parse block " + Common::toHex(blockBlob);
+    return false;
+  }
+
+  prepared.hash = get_block_hash(prepared.block);
+  if (prepared.block.transactionHashes.size() != entry.txs.size()) {
+    error = "block " + Common::podToHex(prepared.hash) + " has " + std::to_string(prepared.block.transactionHashes.size()) +
+      " transactions, " + std::to_string(entry.txs.size()) + " sent";
+    return false;
+  }
+
+  std::unordered_set<Crypto::Hash> expected(prepared.block.transactionHashes.begin(), prepared.block.transactionHashes.end());
+  prepared.transactions.resize(entry.txs.size());
+  for (size_t i = 0; i < entry.txs.size(); ++i) {
+    PreparedTransaction& tx = prepared.transactions[i];
+    BinaryArray txBlob = Common::asBinaryArray(entry.txs[i]);
+    Crypto::Hash prefixHash;
+    if (!parseAndValidateTransactionFromBinaryArray(txBlob, tx.transaction, tx.hash, prefixHash)) {
+      error = "failed to parse transaction " + std::to_string(i) + " of block " + Common::podToHex(prepared.hash);
+      return false;
+    }
+
+    // a transaction that is not part of the block would be added to the pool and the block rejected later on
+    if (expected.count(tx.hash) == 0) {
+      error = "transaction " + Common::podToHex(tx.hash) + " doesn't belong to block " + Common::podToHex(prepared.hash);
+      return false;
+    }
+
+    if (!m_core.checkTransactionSemantic(tx.transaction)) {
+      error = "transaction " + Common::podToHex(tx.hash) + " of block " + Common::podToHex(prepared.hash) + " failed semantic checks";
+      return false;
+    }
+
+    tx.blobSize = txBlob.size();
+  }
+
+  return true;
+}
+
+void BlockImportPipeline::commit(std::vector<PreparedBlock>&& blocks, const net_connection_id& source) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stopped || m_failed || blocks.empty()) {
+      return;
+    }
+
+    startThreads();
+    m_commitQueued += blocks.size();
+    ++m_commitChunks;
+    m_commitQueue.push_back(CommitJob{std::move(blocks), source});
+  }
+
+  m_haveCommit.notify_one();
+}
+
+void BlockImportPipeline::resume() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_failed = false;
+}
+
+size_t BlockImportPipeline::backlog() const {
+  return m_decodeChunks + m_commitChunks;
+}
+
+void BlockImportPipeline::getOccupancy(StageOccupancy& decode, StageOccupancy& commit) {
+  auto now = Clock::now();
+  double period = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(now - m_lastReport).count());
+  uint64_t decodeBusyTime = m_decodeBusyTime;
+  uint64_t commitBusyTime = m_commitBusyTime;
+
+  decode.queued = m_decodeQueued;
+  decode.busy = m_decodeBusy;
+  decode.threads = m_decodePool ? m_decodePool->threadCount() : 0;
+  decode.processed = m_decoded;
+  decode.utilization = period > 0 && decode.threads > 0 ? (decodeBusyTime - m_lastDecodeBusyTime) / (period * decode.threads) : 0.0;
+
+  commit.queued = m_commitQueued;
+  commit.busy = m_commitBusy;
+  commit.threads = m_commitThread.joinable() ? 1 : 0;
+  commit.processed = m_committed;
+  commit.utilization = period > 0 && commit.threads > 0 ? (commitBusyTime - m_lastCommitBusyTime) / period : 0.0;
+
+  m_lastReport = now;
+  m_lastDecodeBusyTime = decodeBusyTime;
+  m_lastCommitBusyTime = commitBusyTime;
+}
+
+void BlockImportPipeline::commitThread() {
+  for (;;) {
+    CommitJob job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_haveCommit.wait(lock, [this] { return m_stopped || !m_commitQueue.empty(); });
+      if (m_stopped) {
+        return;
+      }
+
+      job = std::move(m_commitQueue.front());
+      m_commitQueue.pop_front();
+      m_commitQueued -= job.blocks.size();
+      ++m_commitBusy;
+    }
+
+    auto start = Clock::now();
+    std::string error;
+    bool committed = commitBlocks(job.blocks, error);
+    m_commitBusyTime += elapsedMicroseconds(start);
+
+    if (!committed) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_failed = true;
+      m_commitChunks -= m_commitQueue.size();
+      m_commitQueue.clear();
+      m_commitQueued = 0;
+    }
+
+    --m_commitBusy;
+    --m_commitChunks;
+
+    if (!committed) {
+      m_commitFailed(job.source, error);
+    } else {
+      uint32_t height;
+      Crypto::Hash top;
+      m_core.get_blockchain_top(height, top);
+      logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << height;
+    }
+  }
+}
+
+bool BlockImportPipeline::commitBlocks(const std::vector<PreparedBlock>& blocks, std::string& error) {
+  m_core.pause_mining();
+  BOOST_SCOPE_EXIT_ALL(this) { m_core.update_block_template_and_resume_mining(); };
+
+  for (const PreparedBlock& prepared : blocks) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_stopped) {
+        return true;
+      }
+    }
+
+    // dismiss what has been added meanwhile, e.g. a block relayed by a synchronized peer
+    if (m_core.have_block(prepared.hash)) {
+      ++m_committed;
+      continue;
+    }
+
+    for (const PreparedTransaction& tx : prepared.transactions) {
+      logger(DEBUGGING) << "transaction " << Common::podToHex(tx.hash) << " came in commitBlocks";
+
+      tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+      if (tx.blobSize > m_currency.maxTransactionSizeLimit() && m_core.getCurrentBlockMajorVersion() >= BLOCK_MAJOR_VERSION_4) {
+        tvc.m_verification_failed = true;
+      } else {
+        m_core.handleIncomingTransaction(tx.transaction, tx.hash, tx.blobSize, tvc, true, m_core.get_current_blockchain_height(), true);
+      }
+
+      if (tvc.m_verification_failed) {
+        error = "transaction verification failed, tx_id = " + Common::podToHex(tx.hash);
+        return false;
+      }
+    }
+
+    block_verification_context bvc = boost::value_initialized<block_verification_context>();
+    m_core.handle_incoming_block(prepared.block, bvc, false, false);
+    ++m_committed;
+
+    if (bvc.m_verification_failed) {
+      error = "block " + Common::podToHex(prepared.hash) + " verification failed";
+      return false;
+    } else if (bvc.m_marked_as_orphaned) {
+      error = "block " + Common::podToHex(prepared.hash) + " received at sync phase was marked as orphaned";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}
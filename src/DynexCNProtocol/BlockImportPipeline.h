@@ -0,0 +1,158 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Common/WorkerPool.h"
+#include "DynexCNProtocol/DynexCNProtocolDefinitions.h"
+#include "P2p/P2pProtocolTypes.h"
+
+#include <Logging/LoggerRef.h>
+
+namespace DynexCN
+{
+  class Currency;
+  class ICore;
+
+  struct PreparedTransaction {
+    Transaction transaction;
+    Crypto::Hash hash;
+    size_t blobSize;
+  };
+
+  // a block from the network, parsed and through the checks that need no blockchain state
+  struct PreparedBlock {
+    Block block;
+    Crypto::Hash hash;
+    std::vector<PreparedTransaction> transactions;
+  };
+
+  // Imports synchronized blocks in stages so that download, decoding and the core overlap:
+  // decoding and stateless checks run on a worker pool, a single commit thread hands the blocks to the
+  // core in submission order. The protocol handler drives it from the p2p dispatcher and keeps the
+  // queues bounded by not requesting more blocks while backlog() is at its limit.
+  class BlockImportPipeline {
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct DecodeResult {
+      std::vector<PreparedBlock> blocks;
+      // empty if every block passed
+      std::string error;
+    };
+
+    struct StageOccupancy {
+      size_t queued = 0;        // blocks waiting for the stage
+      size_t busy = 0;          // threads working in the stage
+      size_t threads = 0;
+      uint64_t processed = 0;   // blocks that went through the stage
+      double utilization = 0.0; // busy share of the stage threads since the previous report
+    };
+
+    typedef std::function<void(DecodeResult&&)> DecodeCallback;
+    // called on the commit thread when a block or one of its transactions is rejected by the core
+    typedef std::function<void(const net_connection_id& source, const std::string& error)> CommitFailedCallback;
+
+    BlockImportPipeline(const Currency& currency, ICore& core, Logging::ILogger& logger, CommitFailedCallback&& commitFailed);
+    ~BlockImportPipeline();
+
+    // decode stage, done is called on a worker thread
+    void decode(std::vector<block_complete_entry>&& entries, DecodeCallback&& done);
+    // commit stage. After a failed commit the queued and newly committed chunks are dropped until resume(),
+    // they build on the failed one
+    void commit(std::vector<PreparedBlock>&& blocks, const net_connection_id& source);
+    void resume();
+    void stop();
+
+    // chunks being decoded or waiting for the commit
+    size_t backlog() const;
+    // snapshots of both stages, utilization is measured since the previous call
+    void getOccupancy(StageOccupancy& decode, StageOccupancy& commit);
+
+  private:
+    struct CommitJob {
+      std::vector<PreparedBlock> blocks;
+      net_connection_id source;
+    };
+
+    bool decodeBlock(const block_complete_entry& entry, PreparedBlock& prepared, std::string& error);
+    bool commitBlocks(const std::vector<PreparedBlock>& blocks, std::string& error);
+    void commitThread();
+    void startThreads();
+
+    const Currency& m_currency;
+    ICore& m_core;
+    Logging::LoggerRef logger;
+    CommitFailedCallback m_commitFailed;
+
+    // created with the first chunk, nodes that never synchronize don't pay for the threads
+    std::unique_ptr<Tools::WorkerPool> m_decodePool;
+    std::thread m_commitThread;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_haveCommit;
+    std::deque<CommitJob> m_commitQueue;
+    bool m_failed;
+    bool m_stopped;
+
+    std::atomic<size_t> m_decodeChunks;
+    std::atomic<size_t> m_decodeQueued;
+    std::atomic<size_t> m_decodeBusy;
+    std::atomic<uint64_t> m_decoded;
+    std::atomic<uint64_t> m_decodeBusyTime;
+    std::atomic<size_t> m_commitChunks;
+    std::atomic<size_t> m_commitQueued;
+    std::atomic<size_t> m_commitBusy;
+    std::atomic<uint64_t> m_committed;
+    std::atomic<uint64_t> m_commitBusyTime;
+
+    Clock::time_point m_lastReport;
+    uint64_t m_lastDecodeBusyTime;
+    uint64_t m_lastCommitBusyTime;
+  };
+}
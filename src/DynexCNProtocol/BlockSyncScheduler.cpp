@@ -0,0 +1,250 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "BlockSyncScheduler.h"
+
+#include <algorithm>
+
+namespace DynexCN {
+
+double BlockSyncScheduler::PeerStats::blocksPerSecond() const {
+  double seconds = std::chrono::duration<double>(busy).count();
+  return seconds > 0 ? blocks / seconds : 0.0;
+}
+
+double BlockSyncScheduler::PeerStats::bytesPerSecond() const {
+  double seconds = std::chrono::duration<double>(busy).count();
+  return seconds > 0 ? bytes / seconds : 0.0;
+}
+
+BlockSyncScheduler::BlockSyncScheduler(size_t chunkSize) :
+  m_chunkSize(std::max<size_t>(chunkSize, 1)),
+  m_nextSequence(0),
+  m_lastHeight(0) {
+}
+
+size_t BlockSyncScheduler::addBlockIds(uint32_t startHeight, const std::vector<Crypto::Hash>& blockIds) {
+  size_t added = 0;
+  for (size_t i = 0; i < blockIds.size(); ++i) {
+    const Crypto::Hash& id = blockIds[i];
+    uint32_t height = startHeight + static_cast<uint32_t>(i);
+    if (m_scheduledIds.count(id) != 0) {
+      continue;
+    }
+
+    // another branch than the one being downloaded, it is picked up again once this one is imported
+    if (!m_chunks.empty() && height != m_lastHeight + 1) {
+      break;
+    }
+
+    if (m_chunks.empty() || m_chunks.back().state != ChunkState::Pending || m_chunks.back().blockIds.size() >= m_chunkSize) {
+      Chunk chunk;
+      chunk.sequence = m_nextSequence++;
+      m_chunks.push_back(std::move(chunk));
+    }
+
+    Chunk& chunk = m_chunks.back();
+    chunk.blockIds.push_back(id);
+    chunk.lastHeight = height;
+    m_scheduledIds.emplace(id, chunk.sequence);
+    m_lastHeight = height;
+    ++added;
+  }
+
+  return added;
+}
+
+void BlockSyncScheduler::reset() {
+  m_chunks.clear();
+  m_scheduledIds.clear();
+  m_lastHeight = 0;
+}
+
+bool BlockSyncScheduler::empty() const {
+  return m_chunks.empty();
+}
+
+size_t BlockSyncScheduler::pendingCount() const {
+  return std::count_if(m_chunks.begin(), m_chunks.end(), [](const Chunk& chunk) { return chunk.state == ChunkState::Pending; });
+}
+
+bool BlockSyncScheduler::isBusy(const net_connection_id& peer) const {
+  return m_inFlight.count(peer) != 0;
+}
+
+bool BlockSyncScheduler::assign(const net_connection_id& peer, uint32_t peerHeight, std::vector<Crypto::Hash>& blockIds) {
+  if (isBusy(peer)) {
+    return false;
+  }
+
+  Chunk* candidate = nullptr;
+  for (auto& chunk : m_chunks) {
+    if (chunk.state != ChunkState::Pending || chunk.lastHeight >= peerHeight) {
+      continue;
+    }
+
+    if (chunk.failedPeers.count(peer) == 0) {
+      candidate = &chunk;
+      break;
+    }
+
+    // retry with a peer that failed this chunk only if it has nothing better to do
+    if (candidate == nullptr) {
+      candidate = &chunk;
+    }
+  }
+
+  if (candidate == nullptr) {
+    return false;
+  }
+
+  auto now = Clock::now();
+  candidate->state = ChunkState::Requested;
+  candidate->peer = peer;
+  candidate->requested = now;
+  m_inFlight[peer] = Request{candidate->sequence, now};
+  blockIds = candidate->blockIds;
+  return true;
+}
+
+bool BlockSyncScheduler::answer(const net_connection_id& peer, size_t blockCount, size_t bytes, uint64_t& sequence) {
+  auto flight = m_inFlight.find(peer);
+  if (flight == m_inFlight.end()) {
+    return false;
+  }
+
+  Request request = flight->second;
+  m_inFlight.erase(flight);
+
+  PeerStats& stats = m_peerStats[peer];
+  stats.busy += Clock::now() - request.requested;
+  ++stats.chunks;
+  stats.blocks += blockCount;
+  stats.bytes += bytes;
+
+  // after a stall the chunk may already be requested from somebody else, whoever is decoded first wins
+  Chunk* chunk = findChunk(request.sequence);
+  if (chunk != nullptr && chunk->state == ChunkState::Requested && chunk->peer == peer) {
+    chunk->state = ChunkState::Answered;
+  }
+
+  sequence = request.sequence;
+  return true;
+}
+
+bool BlockSyncScheduler::deliver(uint64_t sequence, const net_connection_id& peer, std::vector<PreparedBlock>&& blocks) {
+  Chunk* chunk = findChunk(sequence);
+  if (chunk == nullptr || chunk->state == ChunkState::Received) {
+    // a late answer after a stall or a reset, somebody else has delivered the chunk
+    return true;
+  }
+
+  bool matches = blocks.size() == chunk->blockIds.size() && std::equal(blocks.begin(), blocks.end(), chunk->blockIds.begin(),
+    [](const PreparedBlock& block, const Crypto::Hash& id) { return block.hash == id; });
+  if (!matches) {
+    reject(sequence, peer);
+    return false;
+  }
+
+  chunk->state = ChunkState::Received;
+  chunk->peer = peer;
+  chunk->blocks = std::move(blocks);
+  return true;
+}
+
+void BlockSyncScheduler::reject(uint64_t sequence, const net_connection_id& peer) {
+  Chunk* chunk = findChunk(sequence);
+  if (chunk != nullptr && chunk->state == ChunkState::Answered && chunk->peer == peer) {
+    requeue(*chunk, peer);
+  }
+}
+
+bool BlockSyncScheduler::popReady(std::vector<PreparedBlock>& blocks, net_connection_id& source) {
+  if (m_chunks.empty() || m_chunks.front().state != ChunkState::Received) {
+    return false;
+  }
+
+  Chunk& chunk = m_chunks.front();
+  for (const auto& id : chunk.blockIds) {
+    m_scheduledIds.erase(id);
+  }
+
+  blocks = std::move(chunk.blocks);
+  source = chunk.peer;
+  m_chunks.pop_front();
+  return true;
+}
+
+std::vector<net_connection_id> BlockSyncScheduler::expire(Clock::time_point deadline) {
+  std::vector<net_connection_id> stalled;
+  for (auto& chunk : m_chunks) {
+    if (chunk.state == ChunkState::Requested && chunk.requested < deadline) {
+      ++m_peerStats[chunk.peer].stalls;
+      stalled.push_back(chunk.peer);
+      requeue(chunk, chunk.peer);
+    }
+  }
+
+  return stalled;
+}
+
+void BlockSyncScheduler::removePeer(const net_connection_id& peer) {
+  m_inFlight.erase(peer);
+  m_peerStats.erase(peer);
+  for (auto& chunk : m_chunks) {
+    // answered chunks are still decoded and delivered after the peer is gone
+    if (chunk.state == ChunkState::Requested && chunk.peer == peer) {
+      requeue(chunk, peer);
+    }
+  }
+}
+
+BlockSyncScheduler::Chunk* BlockSyncScheduler::findChunk(uint64_t sequence) {
+  if (m_chunks.empty() || sequence < m_chunks.front().sequence) {
+    return nullptr;
+  }
+
+  uint64_t index = sequence - m_chunks.front().sequence;
+  return index < m_chunks.size() ? &m_chunks[static_cast<size_t>(index)] : nullptr;
+}
+
+void BlockSyncScheduler::requeue(Chunk& chunk, const net_connection_id& failedPeer) {
+  chunk.state = ChunkState::Pending;
+  chunk.failedPeers.insert(failedPeer);
+}
+
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "crypto/hash.h"
+#include "DynexCNProtocol/BlockImportPipeline.h"
+#include "P2p/P2pProtocolTypes.h"
+
+namespace DynexCN
+{
+  // Splits the block ids learned from chain entries into chunks that can be downloaded from
+  // several peers at once and hands the received chunks back strictly in chain order.
+  // Not thread safe, it is driven from the protocol handler on the p2p dispatcher.
+  class BlockSyncScheduler {
+  public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct PeerStats {
+      uint64_t chunks = 0;
+      uint64_t blocks = 0;
+      uint64_t bytes = 0;
+      uint64_t stalls = 0;
+      Clock::duration busy = Clock::duration::zero();
+
+      double blocksPerSecond() const;
+      double bytesPerSecond() const;
+    };
+
+    explicit BlockSyncScheduler(size_t chunkSize);
+
+    // ids must continue the chain: blockIds[i] is at startHeight + i. Ids already scheduled are skipped,
+    // returns the number of ids added
+    size_t addBlockIds(uint32_t startHeight, const std::vector<Crypto::Hash>& blockIds);
+    // drops everything, e.g. after a chunk failed to import
+    void reset();
+
+    // nothing left to request, download or import
+    bool empty() const;
+    // chunks nobody has been asked for yet
+    size_t pendingCount() const;
+    bool isBusy(const net_connection_id& peer) const;
+
+    // takes the oldest pending chunk within peerHeight the peer has not failed before
+    bool assign(const net_connection_id& peer, uint32_t peerHeight, std::vector<Crypto::Hash>& blockIds);
+    // the peer answered, frees it for the next request while the answer is decoded. Returns the chunk
+    // it was asked for, false if it was not asked for anything
+    bool answer(const net_connection_id& peer, size_t blockCount, size_t bytes, uint64_t& sequence);
+    // stores a decoded answer, false if the blocks are not the ones of the chunk
+    bool deliver(uint64_t sequence, const net_connection_id& peer, std::vector<PreparedBlock>&& blocks);
+    // the answer failed to decode, the chunk goes back to the queue
+    void reject(uint64_t sequence, const net_connection_id& peer);
+    // next received chunk in chain order, false if the head of the queue is still missing
+    bool popReady(std::vector<PreparedBlock>& blocks, net_connection_id& source);
+
+    // chunks requested before deadline go back to the queue, returns the peers that stalled
+    std::vector<net_connection_id> expire(Clock::time_point deadline);
+    // the peer is gone or misbehaved, its chunk goes back to the queue and its statistics are dropped
+    void removePeer(const net_connection_id& peer);
+
+    const std::map<net_connection_id, PeerStats>& peerStats() const { return m_peerStats; }
+
+  private:
+    enum class ChunkState {
+      Pending,
+      Requested,
+      // answered, waiting for the decode stage
+      Answered,
+      Received
+    };
+
+    struct Chunk {
+      uint64_t sequence;
+      uint32_t lastHeight;
+      std::vector<Crypto::Hash> blockIds;
+      ChunkState state = ChunkState::Pending;
+      net_connection_id peer;
+      Clock::time_point requested;
+      std::set<net_connection_id> failedPeers;
+      std::vector<PreparedBlock> blocks;
+    };
+
+    Chunk* findChunk(uint64_t sequence);
+    void requeue(Chunk& chunk, const net_connection_id& failedPeer);
+
+    const size_t m_chunkSize;
+    uint64_t m_nextSequence;
+    // chunks in chain order, the front is the next one to import
+    std::deque<Chunk> m_chunks;
+    std::unordered_map<Crypto::Hash, uint64_t> m_scheduledIds;
+    uint32_t m_lastHeight;
+    struct Request {
+      uint64_t sequence;
+      Clock::time_point requested;
+    };
+
+    // peer -> chunk it was asked for, kept after a stall or a reset until the peer answers
+    std::map<net_connection_id, Request> m_inFlight;
+    std::map<net_connection_id, PeerStats> m_peerStats;
+  };
+}
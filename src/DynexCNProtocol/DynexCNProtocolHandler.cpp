@@ -37,7 +37,9 @@
 
 #include "DynexCNProtocolHandler.h"
 
+#include <algorithm>
 #include <future>
+#include <iomanip>
 #include <boost/scope_exit.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <System/Dispatcher.h>
@@ -77,7 +79,13 @@ DynexCNProtocolHandler::DynexCNProtocolHandler(const Currency& currency, System:
   m_stop(false),
   m_observedHeight(0),
   m_blockchainHeight(0),  
+  m_syncScheduler(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT),
+  m_syncIdsExhausted(false),
+  m_lastImportReport(BlockImportPipeline::Clock::now()),
   m_peersCount(0),
+  m_importPipeline(currency, rcore, log, [this](const net_connection_id& source, const std::string& error) {
+    onChunkCommitFailed(source, error);
+  }),
   logger(log, "protocol") {
   
   if (!m_p2p) {
@@ -115,6 +123,9 @@ void DynexCNProtocolHandler::onConnectionClosed(DynexCNConnectionContext& contex
     m_observerManager.notify(&IDynexCNProtocolObserver::lastKnownBlockHeightUpdated, m_observedHeight);
   }
 
+  m_syncScheduler.removePeer(context.m_connection_id);
+  m_chainRequests.erase(context.m_connection_id);
+
   if (context.m_state != DynexCNConnectionContext::state_befor_handshake) {
     m_peersCount--;
     m_observerManager.notify(&IDynexCNProtocolObserver::peerCountUpdated, m_peersCount.load());
@@ -123,19 +134,14 @@ void DynexCNProtocolHandler::onConnectionClosed(DynexCNConnectionContext& contex
 
 void DynexCNProtocolHandler::stop() {
   m_stop = true;
+  m_importPipeline.stop();
 }
 
 bool DynexCNProtocolHandler::start_sync(DynexCNConnectionContext& context) {
   logger(Logging::TRACE) << context << "Starting synchronization";
 
   if (context.m_state == DynexCNConnectionContext::state_synchronizing) {
-    assert(context.m_needed_objects.empty());
-    assert(context.m_requested_objects.empty());
-
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+    requestChain(context);
   }
 
   return true;
@@ -152,15 +158,32 @@ void DynexCNProtocolHandler::log_connections() {
     << std::setw(20) << "Peer id"
     << std::setw(25) << "Recv/Sent (inactive,sec)"
     << std::setw(25) << "State"
-    << std::setw(20) << "Lifetime(seconds)" << ENDL;
+    << std::setw(20) << "Lifetime(seconds)"
+    << std::setw(25) << "Sync (blocks/s, KiB/s)" << ENDL;
+
+  std::map<net_connection_id, BlockSyncScheduler::PeerStats> syncStats;
+  {
+    std::lock_guard<std::mutex> lock(m_syncStatsMutex);
+    syncStats = m_syncStats;
+  }
 
   m_p2p->for_each_connection([&](const DynexCNConnectionContext& cntxt, PeerIdType peer_id) {
+    std::stringstream sync;
+    auto stats = syncStats.find(cntxt.m_connection_id);
+    if (stats != syncStats.end()) {
+      sync << std::fixed << std::setprecision(1) << stats->second.blocksPerSecond() << ", " << stats->second.bytesPerSecond() / 1024;
+      if (stats->second.stalls != 0) {
+        sync << " (" << stats->second.stalls << " stalled)";
+      }
+    }
+
     ss << std::setw(25) << std::left << std::string(cntxt.m_is_income ? "[INC]" : "[OUT]") +
       Common::ipAddressToString(cntxt.m_remote_ip) + ":" + std::to_string(cntxt.m_remote_port)
       << std::setw(20) << std::hex << peer_id
       // << std::setw(25) << std::to_string(cntxt.m_recv_cnt) + "(" + std::to_string(time(NULL) - cntxt.m_last_recv) + ")" + "/" + std::to_string(cntxt.m_send_cnt) + "(" + std::to_string(time(NULL) - cntxt.m_last_send) + ")"
       << std::setw(25) << get_protocol_state_string(cntxt.m_state)
-      << std::setw(20) << std::to_string(time(NULL) - cntxt.m_started) << ENDL;
+      << std::setw(20) << std::to_string(time(NULL) - cntxt.m_started)
+      << std::setw(25) << sync.str() << ENDL;
   });
   logger(INFO) << "Connections: " << ENDL << ss.str();
 }
@@ -315,10 +338,7 @@ int DynexCNProtocolHandler::handle_notify_new_block(int command, NOTIFY_NEW_BLOC
     }
   } else if (bvc.m_marked_as_orphaned) {
     context.m_state = DynexCNConnectionContext::state_synchronizing;
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+    requestChain(context);
   }
 
   return 1;
@@ -402,173 +422,189 @@ int DynexCNProtocolHandler::handle_response_get_objects(int command, NOTIFY_RESP
 
   context.m_remote_blockchain_height = arg.current_blockchain_height;
 
-  size_t count = 0;
-  std::vector<Crypto::Hash> block_hashes;
-  block_hashes.reserve(arg.blocks.size());
-  std::vector<parsed_block_entry> parsed_blocks;
-  parsed_blocks.reserve(arg.blocks.size());
+  size_t bytes = 0;
   for (const block_complete_entry& block_entry : arg.blocks) {
-    ++count;
-    Block b;
-    BinaryArray block_blob = asBinaryArray(block_entry.block);
-    if (block_blob.size() > m_currency.maxBlockBlobSize()) {
-      logger(Logging::ERROR) << context << "sent wrong block: too big size " << block_blob.size() << ", dropping connection";
-      context.m_state = DynexCNConnectionContext::state_shutdown;
-      return 1;
-    }
-    if (!fromBinaryArray(b, block_blob)) {
-      logger(Logging::ERROR) << context << "sent wrong block: failed to parse and validate block: \r\n"
-        << toHex(block_blob) << "\r\n dropping connection";
-      context.m_state = DynexCNConnectionContext::state_shutdown;
-      return 1;
-    }
-
-    //to avoid concurrency in core between connections, suspend connections which delivered block later then first one
-    auto blockHash = get_block_hash(b);
-    if (count == 2) {
-      if (m_core.have_block(blockHash)) {
-        context.m_state = DynexCNConnectionContext::state_idle;
-        context.m_needed_objects.clear();
-        context.m_requested_objects.clear();
-        logger(Logging::DEBUGGING) << context << "Connection set to idle state.";
-        return 1;
-      }
-    }
-
-    auto req_it = context.m_requested_objects.find(blockHash);
-    if (req_it == context.m_requested_objects.end()) {
-      logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id=" << Common::podToHex(blockHash)
-        << " wasn't requested, dropping connection";
-      context.m_state = DynexCNConnectionContext::state_shutdown;
-      return 1;
-    }
-    if (b.transactionHashes.size() != block_entry.txs.size()) {
-      logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id=" << Common::podToHex(blockHash)
-        << ", transactionHashes.size()=" << b.transactionHashes.size() << " mismatch with block_complete_entry.m_txs.size()=" << block_entry.txs.size() << ", dropping connection";
-      context.m_state = DynexCNConnectionContext::state_shutdown;
-      return 1;
+    bytes += block_entry.block.size();
+    for (const auto& tx_blob : block_entry.txs) {
+      bytes += tx_blob.size();
     }
-
-    context.m_requested_objects.erase(req_it);
-
-    block_hashes.push_back(blockHash);
-
-    parsed_block_entry parsedBlock;
-    parsedBlock.block = b;
-    for (auto& tx_blob : block_entry.txs) {
-      auto transactionBinary = asBinaryArray(tx_blob);
-      parsedBlock.txs.push_back(transactionBinary);
-    }
-    parsed_blocks.push_back(parsedBlock);
   }
 
-  if (context.m_requested_objects.size()) {
-    logger(Logging::ERROR, Logging::BRIGHT_RED) << context <<
-      "returned not all requested objects (context.m_requested_objects.size()="
-      << context.m_requested_objects.size() << "), dropping connection";
+  uint64_t sequence;
+  if (!m_syncScheduler.answer(context.m_connection_id, arg.blocks.size(), bytes, sequence)) {
+    logger(Logging::ERROR) << context << "sent NOTIFY_RESPONSE_GET_OBJECTS without being asked for blocks, dropping connection";
     context.m_state = DynexCNConnectionContext::state_shutdown;
     return 1;
   }
 
-  uint32_t height;
-  Crypto::Hash top;
-  {
-    m_core.pause_mining();
-
-    // we lock all the rest to avoid having multiple connections redo a lot
-    // of the same work, and one of them doing it for nothing: subsequent
-    // connections will wait until the current one's added its blocks, then
-    // will add any extra it has, if any
-    std::lock_guard<std::recursive_mutex> lk(m_sync_lock);
-
-    // dismiss what another connection might already have done (likely everything)
-    m_core.get_blockchain_top(height, top);
-    uint64_t dismiss = 1;
-    for (const auto &h : block_hashes) {
-      if (top == h) {
-        logger(Logging::DEBUGGING) << "Found current top block in synced blocks, dismissing "
-          << dismiss << "/" << arg.blocks.size() << " blocks";
-        while (dismiss--) {
-          arg.blocks.erase(arg.blocks.begin());
-          parsed_blocks.erase(parsed_blocks.begin());
-        }
-        break;
-      }
-      ++dismiss;
+  // parsing and the stateless checks run on the import pipeline threads, the connection is free for the next chunk meanwhile
+  net_connection_id peer = context.m_connection_id;
+  m_importPipeline.decode(std::move(arg.blocks), [this, peer, sequence](BlockImportPipeline::DecodeResult&& decoded) {
+    if (m_stop) {
+      return;
     }
 
-    BOOST_SCOPE_EXIT_ALL(this) { m_core.update_block_template_and_resume_mining(); };
+    auto result = std::make_shared<BlockImportPipeline::DecodeResult>(std::move(decoded));
+    m_dispatcher.remoteSpawn([this, peer, sequence, result] {
+      onChunkDecoded(peer, sequence, *result);
+    });
+  });
+
+  scheduleDownloads();
+  return 1;
+}
 
-    int result = processObjects(context, parsed_blocks);
-    if (result != 0) {
-      return result;
+void DynexCNProtocolHandler::onChunkDecoded(const net_connection_id& peer, uint64_t sequence, BlockImportPipeline::DecodeResult& result) {
+  if (m_stop) {
+    return;
+  }
+
+  bool accepted;
+  if (!result.error.empty()) {
+    logger(Logging::ERROR) << "Peer " << peer << " sent wrong NOTIFY_RESPONSE_GET_OBJECTS: " << result.error << ", dropping connection";
+    m_syncScheduler.reject(sequence, peer);
+    accepted = false;
+  } else {
+    accepted = m_syncScheduler.deliver(sequence, peer, std::move(result.blocks));
+    if (!accepted) {
+      logger(Logging::ERROR, Logging::BRIGHT_RED) << "Peer " << peer << " sent wrong NOTIFY_RESPONSE_GET_OBJECTS: the blocks don't match the requested ones, dropping connection";
     }
   }
 
-  m_core.get_blockchain_top(height, top);
-  logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << height;
+  if (!accepted) {
+    m_syncScheduler.removePeer(peer);
+    m_p2p->for_each_connection([&](DynexCNConnectionContext& ctx, PeerIdType peerId) {
+      if (ctx.m_connection_id == peer) {
+        m_p2p->drop_connection(ctx, true);
+      }
+    });
+  }
 
-  if (!m_stop && context.m_state == DynexCNConnectionContext::state_synchronizing) {
-    request_missing_objects(context, true);
+  // chunks enter the commit stage strictly in chain order
+  std::vector<PreparedBlock> blocks;
+  net_connection_id source;
+  while (m_syncScheduler.popReady(blocks, source)) {
+    m_importPipeline.commit(std::move(blocks), source);
   }
 
-  return 1;
+  scheduleDownloads();
 }
 
-int DynexCNProtocolHandler::processObjects(DynexCNConnectionContext& context, const std::vector<parsed_block_entry>& blocks) {
+void DynexCNProtocolHandler::onChunkCommitFailed(const net_connection_id& source, const std::string& error) {
+  // called on the commit thread
+  if (m_stop) {
+    return;
+  }
 
-  for (const parsed_block_entry& block_entry : blocks) {
+  m_dispatcher.remoteSpawn([this, source, error] {
     if (m_stop) {
-      break;
+      return;
     }
 
-    //process transactions
-    for (auto& transactionBinary : block_entry.txs) {
-      Crypto::Hash transactionHash = Crypto::cn_fast_hash(transactionBinary.data(), transactionBinary.size());
-      logger(DEBUGGING) << "transaction " << transactionHash << " came in processObjects";
-
-      tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
-      m_core.handle_incoming_tx(transactionBinary, tvc, true);
-      if (tvc.m_verification_failed) {
-        logger(Logging::DEBUGGING) << context << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
-          << Common::podToHex(getBinaryArrayHash(transactionBinary)) << ", dropping connection";
-        context.m_state = DynexCNConnectionContext::state_shutdown;
-        return 1;
+    logger(Logging::DEBUGGING) << "Peer " << source << " sent a chunk that failed to import: " << error << ", dropping connection";
+
+    // everything scheduled after the bad chunk builds on it: start over from the local top
+    m_syncScheduler.reset();
+    m_syncIdsExhausted = false;
+    m_importPipeline.resume();
+    m_p2p->for_each_connection([&](DynexCNConnectionContext& ctx, PeerIdType peerId) {
+      if (ctx.m_connection_id == source) {
+        m_p2p->drop_connection(ctx, true);
+      } else if (ctx.m_state == DynexCNConnectionContext::state_synchronizing && m_chainRequests.count(ctx.m_connection_id) == 0) {
+        requestChain(ctx);
       }
+    });
+  });
+}
+
+void DynexCNProtocolHandler::scheduleDownloads() {
+  if (m_stop) {
+    return;
+  }
+
+  if (m_syncScheduler.empty()) {
+    m_syncIdsExhausted = false;
+  }
+
+  m_p2p->for_each_connection([&](DynexCNConnectionContext& ctx, PeerIdType peerId) {
+    if (ctx.m_state != DynexCNConnectionContext::state_synchronizing && ctx.m_state != DynexCNConnectionContext::state_normal) {
+      return;
     }
 
-    // process block
-    block_verification_context bvc = boost::value_initialized<block_verification_context>();
-    m_core.handle_incoming_block(block_entry.block, bvc, false, false);
+    if (m_syncScheduler.isBusy(ctx.m_connection_id) || m_chainRequests.count(ctx.m_connection_id) != 0) {
+      return;
+    }
 
-    if (bvc.m_verification_failed) {
-      logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection";
-      context.m_state = DynexCNConnectionContext::state_shutdown;
-      return 1;
-    } else if (bvc.m_marked_as_orphaned) {
-      logger(Logging::INFO) << context << "Block received at sync phase was marked as orphaned, dropping connection";
-      context.m_state = DynexCNConnectionContext::state_shutdown;
-      return 1;
-    } else if (bvc.m_already_exists) {
-      logger(Logging::DEBUGGING) << context << "Block already exists, switching to idle state";
-      context.m_state = DynexCNConnectionContext::state_idle;
-      context.m_needed_objects.clear();
-      context.m_requested_objects.clear();
-      return 1;
+    // the download stage waits while decoding or committing falls behind
+    if (m_importPipeline.backlog() >= CURRENCY_PROTOCOL_IMPORT_BACKLOG) {
+      return;
     }
 
-    m_dispatcher.yield();
-  }
+    NOTIFY_REQUEST_GET_OBJECTS::request req;
+    if (m_syncScheduler.assign(ctx.m_connection_id, ctx.m_remote_blockchain_height, req.blocks)) {
+      logger(Logging::TRACE) << ctx << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size();
+      post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, req, ctx);
+      return;
+    }
 
-  return 0;
+    if (ctx.m_state != DynexCNConnectionContext::state_synchronizing) {
+      return;
+    }
 
+    if (m_syncScheduler.empty()) {
+      request_missing_objects(ctx);
+    } else if (m_syncScheduler.pendingCount() == 0 && !m_syncIdsExhausted && m_chainRequests.empty()) {
+      // every known block is on its way, look further ahead in the meantime
+      requestChain(ctx);
+    }
+  });
 }
 
-
 bool DynexCNProtocolHandler::on_idle() {
+  auto deadline = BlockSyncScheduler::Clock::now() - std::chrono::seconds(CURRENCY_PROTOCOL_SYNC_CHUNK_TIMEOUT);
+  for (const auto& peer : m_syncScheduler.expire(deadline)) {
+    logger(Logging::DEBUGGING) << "Peer " << peer << " stalled on a block chunk, handing it to another peer";
+  }
+
+  scheduleDownloads();
+
+  {
+    std::lock_guard<std::mutex> lock(m_syncStatsMutex);
+    m_syncStats = m_syncScheduler.peerStats();
+  }
+
+  reportImportStages();
+
   return m_core.on_idle();
 }
 
+void DynexCNProtocolHandler::reportImportStages() {
+  auto now = BlockImportPipeline::Clock::now();
+  if (now - m_lastImportReport < std::chrono::seconds(CURRENCY_PROTOCOL_IMPORT_REPORT_INTERVAL)) {
+    return;
+  }
+
+  BlockImportPipeline::StageOccupancy decode;
+  BlockImportPipeline::StageOccupancy commit;
+  m_importPipeline.getOccupancy(decode, commit);
+  m_lastImportReport = now;
+  if (m_syncScheduler.empty() && decode.queued + decode.busy + commit.queued + commit.busy == 0) {
+    return;
+  }
+
+  size_t downloading = 0;
+  m_p2p->for_each_connection([&](DynexCNConnectionContext& ctx, PeerIdType peerId) {
+    if (m_syncScheduler.isBusy(ctx.m_connection_id)) {
+      ++downloading;
+    }
+  });
+
+  logger(Logging::INFO) << std::fixed << std::setprecision(0) << "Block import: download " << downloading << " chunks in flight, "
+    << m_syncScheduler.pendingCount() << " pending; decode " << decode.queued << " queued, " << decode.busy << "/" << decode.threads
+    << " busy, " << decode.utilization * 100 << "% utilized; commit " << commit.queued << " queued, "
+    << commit.utilization * 100 << "% utilized, " << commit.processed << " blocks committed";
+}
+
 int DynexCNProtocolHandler::handle_request_chain(int command, NOTIFY_REQUEST_CHAIN::request& arg, DynexCNConnectionContext& context) {
   logger(Logging::TRACE) << context << "NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << arg.block_ids.size();
 
@@ -592,40 +628,16 @@ int DynexCNProtocolHandler::handle_request_chain(int command, NOTIFY_REQUEST_CHA
   return 1;
 }
 
-bool DynexCNProtocolHandler::request_missing_objects(DynexCNConnectionContext& context, bool check_having_blocks) {
-  if (context.m_needed_objects.size()) {
-    //we know objects that we need, request this objects
-    NOTIFY_REQUEST_GET_OBJECTS::request req;
-    size_t count = 0;
-    auto it = context.m_needed_objects.begin();
-
-    while (it != context.m_needed_objects.end() && count < BLOCKS_SYNCHRONIZING_DEFAULT_COUNT) {
-      if (!(check_having_blocks && m_core.have_block(*it))) {
-        req.blocks.push_back(*it);
-        ++count;
-        context.m_requested_objects.insert(*it);
-      }
-      it = context.m_needed_objects.erase(it);
-    }
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size() << ", txs.size()=" << req.txs.size();
-    post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, req, context);
-  } else if (context.m_last_response_height < context.m_remote_blockchain_height - 1) {//we have to fetch more objects ids, request blockchain entry
-
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+bool DynexCNProtocolHandler::request_missing_objects(DynexCNConnectionContext& context) {
+  if (context.m_last_response_height < context.m_remote_blockchain_height - 1) {//we have to fetch more objects ids, request blockchain entry
+    requestChain(context);
   } else {
-    if (!(context.m_last_response_height ==
-      context.m_remote_blockchain_height - 1 &&
-      !context.m_needed_objects.size() &&
-      !context.m_requested_objects.size())) {
+    if (context.m_last_response_height != context.m_remote_blockchain_height - 1 || !m_syncScheduler.empty()) {
       logger(Logging::ERROR, Logging::BRIGHT_RED)
         << "request_missing_blocks final condition failed!"
         << "\r\nm_last_response_height=" << context.m_last_response_height
         << "\r\nm_remote_blockchain_height=" << context.m_remote_blockchain_height
-        << "\r\nm_needed_objects.size()=" << context.m_needed_objects.size()
-        << "\r\nm_requested_objects.size()=" << context.m_requested_objects.size() 
+        << "\r\nscheduled chunks pending=" << m_syncScheduler.pendingCount()
         << "\r\non connection [" << context << "]";
       return false;
     }
@@ -639,6 +651,15 @@ bool DynexCNProtocolHandler::request_missing_objects(DynexCNConnectionContext& c
   return true;
 }
 
+void DynexCNProtocolHandler::requestChain(DynexCNConnectionContext& context) {
+  NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
+  r.block_ids = m_core.buildSparseChain();
+  logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
+  if (post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context)) {
+    m_chainRequests.insert(context.m_connection_id);
+  }
+}
+
 bool DynexCNProtocolHandler::on_connection_synchronized() {
   bool val_expected = false;
   if (m_synchronized.compare_exchange_strong(val_expected, true)) {
@@ -664,6 +685,8 @@ int DynexCNProtocolHandler::handle_response_chain_entry(int command, NOTIFY_RESP
   logger(Logging::TRACE) << context << "NOTIFY_RESPONSE_CHAIN_ENTRY: m_block_ids.size()=" << arg.m_block_ids.size()
     << ", m_start_height=" << arg.start_height << ", m_total_height=" << arg.total_height;
 
+  m_chainRequests.erase(context.m_connection_id);
+
   if (!arg.m_block_ids.size()) {
     logger(Logging::ERROR) << context << "sent empty m_block_ids, dropping connection";
     context.m_state = DynexCNConnectionContext::state_shutdown;
@@ -689,14 +712,22 @@ int DynexCNProtocolHandler::handle_response_chain_entry(int command, NOTIFY_RESP
       << arg.total_height << "\r\nm_start_height=" << arg.start_height
       << "\r\nm_block_ids.size()=" << arg.m_block_ids.size();
     context.m_state = DynexCNConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  // the entry starts with blocks we have, the rest is split into chunks for all peers to download
+  size_t known = 0;
+  while (known < arg.m_block_ids.size() && m_core.have_block(arg.m_block_ids[known])) {
+    ++known;
   }
 
-  for (auto& bl_id : arg.m_block_ids) {
-    if (!m_core.have_block(bl_id))
-      context.m_needed_objects.push_back(bl_id);
+  std::vector<Crypto::Hash> needed(arg.m_block_ids.begin() + known, arg.m_block_ids.end());
+  bool scheduled = !m_syncScheduler.empty();
+  if (m_syncScheduler.addBlockIds(arg.start_height + static_cast<uint32_t>(known), needed) == 0 && scheduled) {
+    m_syncIdsExhausted = true;
   }
 
-  request_missing_objects(context, false);
+  scheduleDownloads();
   return 1;
 }
 
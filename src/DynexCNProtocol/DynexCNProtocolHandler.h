@@ -38,11 +38,16 @@
 #pragma once
 
 #include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
 
 #include <Common/ObserverManager.h>
 
 #include "DynexCNCore/ICore.h"
 
+#include "DynexCNProtocol/BlockImportPipeline.h"
+#include "DynexCNProtocol/BlockSyncScheduler.h"
 #include "DynexCNProtocol/DynexCNProtocolDefinitions.h"
 #include "DynexCNProtocol/DynexCNProtocolHandlerCommon.h"
 #include "DynexCNProtocol/IDynexCNProtocolObserver.h"
@@ -55,6 +60,9 @@
 #include <Logging/LoggerRef.h>
 
 #define CURRENCY_PROTOCOL_MAX_OBJECT_REQUEST_COUNT 500
+#define CURRENCY_PROTOCOL_SYNC_CHUNK_TIMEOUT 60 // seconds before a block chunk is handed to another peer
+#define CURRENCY_PROTOCOL_IMPORT_BACKLOG 8 // downloaded block chunks waiting to be decoded or committed
+#define CURRENCY_PROTOCOL_IMPORT_REPORT_INTERVAL 60 // seconds between import stage reports while synchronizing
 
 namespace System {
   class Dispatcher;
@@ -70,18 +78,6 @@ namespace DynexCN
   {
   public:
 
-
-    struct parsed_block_entry
-    {
-      Block block;
-      std::vector<BinaryArray> txs;
-
-      void serialize(ISerializer& s) {
-        KV_MEMBER(block);
-        KV_MEMBER(txs);
-      }
-    };
-
     DynexCNProtocolHandler(const Currency& currency, System::Dispatcher& dispatcher, ICore& rcore, IP2pEndpoint* p_net_layout, Logging::ILogger& log);
 
     virtual bool addObserver(IDynexCNProtocolObserver* observer) override;
@@ -123,11 +119,15 @@ namespace DynexCN
     virtual void add_observer(IDynexCNProtocolObserver* observer) override;
     //----------------------------------------------------------------------------------
     uint32_t get_current_blockchain_height();
-    bool request_missing_objects(DynexCNConnectionContext& context, bool check_having_blocks);
+    bool request_missing_objects(DynexCNConnectionContext& context);
+    void requestChain(DynexCNConnectionContext& context);
+    void scheduleDownloads();
+    void onChunkDecoded(const net_connection_id& peer, uint64_t sequence, BlockImportPipeline::DecodeResult& result);
+    void onChunkCommitFailed(const net_connection_id& source, const std::string& error);
+    void reportImportStages();
     bool on_connection_synchronized();
     void updateObservedHeight(uint32_t peerHeight, const DynexCNConnectionContext& context);
     void recalculateMaxObservedHeight(const DynexCNConnectionContext& context);
-    int processObjects(DynexCNConnectionContext& context, const std::vector<parsed_block_entry>& blocks);
     Logging::LoggerRef logger;
 
   private:
@@ -140,7 +140,6 @@ namespace DynexCN
     IP2pEndpoint* m_p2p;
     std::atomic<bool> m_synchronized;
     std::atomic<bool> m_stop;
-    std::recursive_mutex m_sync_lock;
 
     mutable std::mutex m_observedHeightMutex;
     uint32_t m_observedHeight;
@@ -148,7 +147,20 @@ namespace DynexCN
     mutable std::mutex m_blockchainHeightMutex;
     uint32_t m_blockchainHeight;    
 
+    BlockSyncScheduler m_syncScheduler;
+    // the last chain entry brought no new ids, wait until the scheduled ones are imported
+    bool m_syncIdsExhausted;
+    std::set<net_connection_id> m_chainRequests;
+
+    mutable std::mutex m_syncStatsMutex;
+    std::map<net_connection_id, BlockSyncScheduler::PeerStats> m_syncStats;
+    BlockImportPipeline::Clock::time_point m_lastImportReport;
+
+
     std::atomic<size_t> m_peersCount;
     Tools::ObserverManager<IDynexCNProtocolObserver> m_observerManager;
+
+    // last member, its threads are stopped before the rest of the handler goes away
+    BlockImportPipeline m_importPipeline;
   };
 }
@@ -29,11 +29,19 @@
 #include <future>
 #include <numeric>
 #include <sstream>
+#include <fstream>
 #include <iostream>
 #include <thread>
 #include <cassert>
 #include <atomic>
 #include <random>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <cmath>
+#include <chrono>
+#include <cstdarg>
+#include <cinttypes>
 
 #include <string.h>
 #include <exception>
@@ -50,6 +58,10 @@
 #include <boost/chrono.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 //using std::cout;
 //using std::endl;
 //using std::vector;
@@ -97,6 +109,26 @@ typedef std::vector< value_type > state_type;
 #define         MAX_LITS_SYSTEM 25
 #define         PARAM_COUNT     9
 
+// dxdt kernels:
+#define DXDT_KERNEL_REFERENCE 0 // per-variable vectors, sort + accumulate
+#define DXDT_KERNEL_CSR       1 // flat clause layout, SIMD 3-sat path, compensated sums
+#define DXDT_KERNEL_COMPARE   2 // CSR kernel checked against the reference kernel every step
+#define DXDT_CLAUSE_BLOCK     1024 // clauses per work item
+#define DXDT_VAR_BLOCK        4096 // variables per work item
+
+// adaptive step size control:
+#define DMM_STEP_H_INIT       0.125
+#define DMM_STEP_H_MIN        0.0078125
+#define DMM_STEP_H_MAX        1.0
+#define DMM_STEP_TOLERANCE    0.05 // accepted local error of a voltage per step
+#define DMM_STEP_SAFETY       0.9
+#define DMM_STEP_MAX_GROWTH   2.0
+#define DMM_STEP_MAX_SHRINK   0.2
+
+// loc file:
+#define DMM_LOG_SAMPLE_MS     100  // energy-only improvements are logged at most this often
+#define DMM_LOG_FLUSH_MS      1000 // the buffer is written at most this often
+
 // FTP server for jobs:
 #define FTP_ADDRESS "ftp.dynexcoin.org"
 #define FTP_PORT "21"
@@ -124,6 +156,40 @@ typedef std::vector< value_type > state_type;
 
 
 #include "DynexCNCore/Currency.h" // DynexCN::AccountPublicAddress
+#include "DynexCNCore/DynexCNBasicImpl.h" // DynexCN::getAccountAddressAsStr
+#include "DynexchipBenchmark.h"
+#include "Common/WorkerPool.h"
+
+// SIMD wrappers for the 3-sat path of the CSR kernel:
+#if defined(__AVX__)
+#define DXDT_SIMD_LANES 4
+typedef __m256d dxdt_simd;
+static inline dxdt_simd simd_set1(double v) { return _mm256_set1_pd(v); }
+static inline dxdt_simd simd_load(const double* p) { return _mm256_loadu_pd(p); }
+static inline void simd_store(double* p, dxdt_simd v) { _mm256_storeu_pd(p, v); }
+static inline dxdt_simd simd_add(dxdt_simd a, dxdt_simd b) { return _mm256_add_pd(a, b); }
+static inline dxdt_simd simd_sub(dxdt_simd a, dxdt_simd b) { return _mm256_sub_pd(a, b); }
+static inline dxdt_simd simd_mul(dxdt_simd a, dxdt_simd b) { return _mm256_mul_pd(a, b); }
+static inline dxdt_simd simd_min(dxdt_simd a, dxdt_simd b) { return _mm256_min_pd(a, b); }
+static inline dxdt_simd simd_max(dxdt_simd a, dxdt_simd b) { return _mm256_max_pd(a, b); }
+static inline dxdt_simd simd_and(dxdt_simd a, dxdt_simd b) { return _mm256_and_pd(a, b); }
+static inline dxdt_simd simd_cmpeq(dxdt_simd a, dxdt_simd b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+#elif defined(__SSE2__)
+#define DXDT_SIMD_LANES 2
+typedef __m128d dxdt_simd;
+static inline dxdt_simd simd_set1(double v) { return _mm_set1_pd(v); }
+static inline dxdt_simd simd_load(const double* p) { return _mm_loadu_pd(p); }
+static inline void simd_store(double* p, dxdt_simd v) { _mm_storeu_pd(p, v); }
+static inline dxdt_simd simd_add(dxdt_simd a, dxdt_simd b) { return _mm_add_pd(a, b); }
+static inline dxdt_simd simd_sub(dxdt_simd a, dxdt_simd b) { return _mm_sub_pd(a, b); }
+static inline dxdt_simd simd_mul(dxdt_simd a, dxdt_simd b) { return _mm_mul_pd(a, b); }
+static inline dxdt_simd simd_min(dxdt_simd a, dxdt_simd b) { return _mm_min_pd(a, b); }
+static inline dxdt_simd simd_max(dxdt_simd a, dxdt_simd b) { return _mm_max_pd(a, b); }
+static inline dxdt_simd simd_and(dxdt_simd a, dxdt_simd b) { return _mm_and_pd(a, b); }
+static inline dxdt_simd simd_cmpeq(dxdt_simd a, dxdt_simd b) { return _mm_cmpeq_pd(a, b); }
+#else
+#define DXDT_SIMD_LANES 1
+#endif
 
 //---------------------------------------------------------------------------------------------------------------------------
 // oberver & protocol handler
@@ -218,20 +284,95 @@ class dynex_chip_thread_obj {
     	double *partable;
     	double *defaults;
     	bool unit_clauses=false;
+    	// offline (benchmark) runs: no network, fixed seed, progress kept in memory
+    	bool offline = false;
+    	std::vector<Dynex::benchmark_loc_point> loc_trace;
+    	// dxdt kernel:
+    	int dxdt_kernel = DXDT_KERNEL_CSR;
+    	int dxdt_threads = 1;
+    	std::unique_ptr<Tools::WorkerPool> dxdt_pool;
+    	std::vector<int> csr_clause_begin;  // m+1 offsets into csr_var/csr_q
+    	std::vector<int> csr_var;           // variable (0-based) of every literal
+    	std::vector<double> csr_q;          // polarity of every literal, +1/-1
+    	std::vector<int> csr_var_begin;     // n+1 offsets into csr_var_lits
+    	std::vector<int> csr_var_lits;      // literal positions of every variable, in clause order
+    	std::vector<int> sat3_clauses;      // clauses with 3 literals ...
+    	std::vector<int> sat3_var[3];       // ... and their literals as structure of arrays
+    	std::vector<double> sat3_q[3];
+    	std::vector<int> other_clauses;     // all remaining clauses
+    	std::vector<double> lit_contrib;    // voltage contribution of every literal
+    	std::vector<double> dxdt_ref, C_ref; // DXDT_KERNEL_COMPARE scratch buffers
+    	double dxdt_max_deviation = 0.0;    // DXDT_KERNEL_COMPARE: largest difference to the reference kernel
     	struct node {
 		    int id;                 //chip-id
 		    int *model;             //current assignment
 		    int *temporal;          //temp assignment for oracle (not used in production)
 		    int *optimal;           //best assignment and solution afterwards
 		};
+		// state of the adaptive integrator, buffers are allocated once per job:
+		struct dmm_integrator {
+		    std::vector<double> x, x_trial;       // accepted state, proposed state
+		    std::vector<double> dxdt, dxdt_trial; // derivatives at x and x_trial
+		    std::vector<double> C, C_trial;       // clause states at x and x_trial
+		    double t;
+		    double h;
+		    int rejected = 0;
+		};
+		// buffered writer for the loc file:
+		class dmm_progress_log {
+		    public:
+		        void open(const char* path) {
+		            file = path;
+		            buffer.clear();
+		            last_record = last_flush = std::chrono::steady_clock::now() - std::chrono::hours(1);
+		        }
+		        // lines with always == false are dropped when the previous line is younger than DMM_LOG_SAMPLE_MS
+		        void record(bool always, const char* format, ...) {
+		            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		            if (!always && now - last_record < std::chrono::milliseconds(DMM_LOG_SAMPLE_MS)) return;
+		            char line[256];
+		            va_list args;
+		            va_start(args, format);
+		            vsnprintf(line, sizeof(line), format, args);
+		            va_end(args);
+		            buffer += line;
+		            last_record = now;
+		            if (now - last_flush >= std::chrono::milliseconds(DMM_LOG_FLUSH_MS)) flush();
+		        }
+		        void flush() {
+		            if (!buffer.empty() && !file.empty()) {
+		                FILE *floc = fopen(file.c_str(), "a");
+		                if (floc) {
+		                    fwrite(buffer.data(), 1, buffer.size(), floc);
+		                    fclose(floc);
+		                }
+		                buffer.clear();
+		            }
+		            last_flush = std::chrono::steady_clock::now();
+		        }
+		    private:
+		        std::string file;
+		        std::string buffer;
+		        std::chrono::steady_clock::time_point last_record;
+		        std::chrono::steady_clock::time_point last_flush;
+		};
+		dmm_progress_log loc_log;
+		double steps_per_second = 0.0; // accepted integration steps per second, updated every 1000 steps
+
 		int solved;
         int global;    
         double global_energy;
         
 
-	    void operator()(int chip_id, int _thread_count, uint64_t dynex_minute_rate, std::string _addr_string, std::atomic<bool>& dynex_quit_flag)
+	    friend bool Dynex::run_benchmark(const Dynex::benchmark_params& params, Dynex::benchmark_result& result);
+
+	    void operator()(int chip_id, int _thread_count, uint64_t dynex_minute_rate, std::string _addr_string, int _dxdt_kernel, int _dxdt_threads, std::atomic<bool>& dynex_quit_flag)
 	    {
 	    	bool search_for_work = true;
+	    	dxdt_kernel = _dxdt_kernel;
+	    	// 0 shares the cores between all chips:
+	    	dxdt_threads = _dxdt_threads;
+	    	if (dxdt_threads <= 0) dxdt_threads = std::max(1, int(std::thread::hardware_concurrency()) / std::max(1, _thread_count));
 	    	addr_string = _addr_string;
 	    	my_minute_rate = dynex_minute_rate;
 
@@ -305,6 +446,28 @@ class dynex_chip_thread_obj {
 			if (!inputfile_downloaded) {
 				return false;
 			}
+			prepare_work(chip_id);
+
+            /// run solver -----------------------------------------------------------------------------------
+            apply(chip_id, dynex_quit_flag);
+            release_work();
+            
+			return true;
+		}
+
+		// frees the arrays of the input file and of prepare_work
+		void release_work() {
+			free(cls); free(clauseSizes); free(numOccurrenceT); free(occurrence); free(occurenceCounter);
+			maxNumOccurences = 0;
+			free(v_best); free(loc_thread); free(unit_clause_vars); free(energy_thread); free(energy_thread_min);
+			free(global_thread); free(global_all_runs_thread); free(time_thread); free(time_thread_actual);
+			free(walltime_thread); free(t_init); free(t_begin_thread); free(t_end_thread); free(stepcounter);
+			free(initial_assignments); free(thread_params); free(partable); free(defaults);
+			unit_clauses = false;
+		}
+
+		// allocates memory, sets params and initial assignments of the loaded input file
+		void prepare_work(int chip_id) {
 			/// initialize arrays:
 		    v_best = (double *) calloc((size_t) (n+m*2), sizeof(double));
 		    loc_thread = (int *) calloc((size_t) 1, sizeof(int));
@@ -336,6 +499,9 @@ class dynex_chip_thread_obj {
 		        }
 		    }
 		    if (dynex_debugger) printf("c %d UNIT CLAUSES DETECTED.\n",cnt_unit_clauses);
+		    /// flat clause layout for the dxdt kernel: ---------------------------------------------------
+		    dmm_build_csr();
+		    if (dxdt_threads > 1 && !dxdt_pool) dxdt_pool.reset(new Tools::WorkerPool(dxdt_threads));
 		    /// set _all_runs vars: ---------------------------------------------------------------------
 		    global_all_runs_thread[0] = m;
 		    /// set t_init: -----------------------------------------------------------------------------
@@ -381,6 +547,7 @@ class dynex_chip_thread_obj {
 		    std::random_device rd;
 			std::seed_seq sd{rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd()};
 		    std::mt19937 generator(sd); 
+		    if (offline) generator.seed(seed); // reproducible benchmark runs
 		    std::uniform_real_distribution<double>  rand_v_double(-1.0, 1.0); // voltage continous between -1 and +1 
 		    std::uniform_int_distribution<int>      rand_v(-1, 1); // voltage -1, 0 or +1
 		    std::uniform_real_distribution<double>  rand_Xs(0.0, 1.0);
@@ -406,15 +573,19 @@ class dynex_chip_thread_obj {
 	            }
 	        }
 		    
-		    /// prepare LOC file -----------------------------------------------------------------------------
+		    /// prepare LOC file (offline runs keep their progress in loc_trace) ------------------------------
 		    strcpy(LOC_FILE, job_input_file.c_str());
 		    std::string adds = "."+std::to_string(chip_id)+".loc.txt";
 	        char APPEND[128]; strcpy(APPEND, adds.c_str());
 	        strcat(LOC_FILE,APPEND);
-            FILE *floc = fopen(LOC_FILE, "w");
-            fprintf(floc,"INSTANCE;STEPS;WALLTIME;ODE_TIME;LOC;ENERGY\n");
-            fprintf(floc,"%d;%d,%.5f;%.5f;%d;%d\n",0,0,0.0,0.0,m,m);
-            fclose(floc);
+	        if (!offline) {
+                FILE *floc = fopen(LOC_FILE, "w");
+                fprintf(floc,"INSTANCE;STEPS;WALLTIME;ODE_TIME;LOC;ENERGY\n");
+                fprintf(floc,"%d;%d,%.5f;%.5f;%d;%d\n",0,0,0.0,0.0,m,m);
+                fclose(floc);
+            }
+            loc_log.open(offline? "" : LOC_FILE);
+            loc_trace.clear();
 
             /// prepare SOLUTION file ------------------------------------------------------------------------
 		    strcpy(SOLUTION_FILE, job_input_file.c_str());
@@ -427,199 +598,379 @@ class dynex_chip_thread_obj {
 		    adds = "."+addr_string+"."+std::to_string(chip_id)+".proofofwork.txt";
 		    char APPENDSS[128]; strcpy(APPENDSS,adds.c_str());
 		    strcat(PROOF_OF_WORK_FILE,APPENDSS);
-
-            /// run solver -----------------------------------------------------------------------------------
-            apply(chip_id, dynex_quit_flag);
-            
-			return true;
 		}
 
 		// ---------------------------------------------------------------------------------------------------------------
 		// DXDT CALCULATION:
 		// ---------------------------------------------------------------------------------------------------------------
-		std::vector<double> dmm_generate_dxdt(int chip_id, std::vector<double> x , double t ) {
-			
-			//timers:
-        	t_end_thread[0] = ptime::microsec_clock::local_time().time_of_day().total_milliseconds();
-        	double time_spent = (double)(t_end_thread[0] - t_begin_thread[0])/1000;
-        	time_thread_actual[0] = t;
-        	energy_thread[0] = 0.0;
-        	//vectors:
-        	std::vector<double> dxdt(n+m*2); // dxdt vector
-        	std::vector< std::vector <double >> dxdt_v(n); // vector for storing all voltages
-        	/* main ODE routine */
-	        if (solved!=1) {
-	            int loc;
-	            // Loop ---------------------------------------------------------------------------------------------------------------
-	            loc = m;
-	            // screen info variables:
-	            double C_rem, R_rem, G_rem;
-	            int cnt_xl_pos = 0;
-	            int cnt_xs_pos = 0;
-	            // loop through each clause:
-	            for (int clause = 0; clause < m; clause++) {
-	                // number of literals in this clause:
-	                int ksat = clauseSizes[clause];
-	                // Xl & Xs:
-	                double Xs = x[clause+n];   if (Xs<0.0) Xs = double(0.0); if (Xs>1.0) Xs = double(1.0); //Xs bounds
-	                double Xl = x[clause+n+m]; if (Xl<1.0) Xl = double(1.0); if (Xl>xl_max) Xl = double(xl_max); //Xl bounds
-	                double C  = double(0.0);
-	                double Ri, Rj, Rk, Gi, Gj, Gk;
-	                // 3-sat:
-	                if (ksat==3) {
-	                    int Qi = (cls[clause*MAX_LITS_SYSTEM+0]>0)? 1:-1; // +1 if literal is >0, otherwise -1
-	                    int Qj = (cls[clause*MAX_LITS_SYSTEM+1]>0)? 1:-1; // +1 if literal is >0, otherwise -1
-	                    int Qk = (cls[clause*MAX_LITS_SYSTEM+2]>0)? 1:-1; // +1 if literal is >0, otherwise -1
-	                    int liti = abs(cls[clause*MAX_LITS_SYSTEM+0]);
-	                    int litj = abs(cls[clause*MAX_LITS_SYSTEM+1]);
-	                    int litk = abs(cls[clause*MAX_LITS_SYSTEM+2]);
-	                    double Vi = x[liti-1]; if (Vi<-1.0) Vi = -1.0; if (Vi>1.0) Vi = 1.0; //V bounds
-	                    double Vj = x[litj-1]; if (Vj<-1.0) Vj = -1.0; if (Vj>1.0) Vj = 1.0; //V bounds
-	                    double Vk = x[litk-1]; if (Vk<-1.0) Vk = -1.0; if (Vk>1.0) Vk = 1.0; //V bounds
-	                    double i = double(1.0)-double(Qi)*Vi;
-	                    double j = double(1.0)-double(Qj)*Vj;
-	                    double k = double(1.0)-double(Qk)*Vk;
-	                    C = double(fmin(i, fmin(j, k)));
-	                    C = C / double(2.0);
-	                    if (C<0.0) C=double(0.0);
-	                    if (C>1.0) C=double(1.0);
-	                    
-	                    // equation Gn,m(vn,vj,vk)= 1/2 qn,mmin[(1−qj,mvj),(1−qk,mvk)] (5.x):
-	                    Gi = double(Qi) * fmin(j,k) / double(2.0);
-	                    Gj = double(Qj) * fmin(i,k) / double(2.0);
-	                    Gk = double(Qk) * fmin(i,j) / double(2.0);
-	                    
-	                    // equation Rn,m (vn , vj , vk ) = 1/2(qn,m −vn), Cm(vn,vj,vk)= 1/2(1−qn,mvn), 0 otherwise (5.x):
-	                    if (C == double(i/double(2.0)) ) {Ri = (double(Qi)-Vi)/2.0;} else {Ri = double(0.0);} //Qi*i/2.0*-1;} //= 0.0
-	                    if (C == double(j/double(2.0)) ) {Rj = (double(Qj)-Vj)/2.0;} else {Rj = double(0.0);} //Qj*j/2.0*-1;} //= 0.0
-	                    if (C == double(k/double(2.0)) ) {Rk = (double(Qk)-Vk)/2.0;} else {Rk = double(0.0);} //Qk*k/2.0*-1;} //= 0.0
-	                    
-	                    // equation Vn = SUM xl,mxs,mGn,m + (1 + ζxl,m)(1 − xs,m)Rn,m (5.x):
-	                    double _Vi = Xl * Xs * Gi + (double(1.0) + dmm_zeta * Xl) * (double(1.0) - Xs) * Ri ;
-	                    double _Vj = Xl * Xs * Gj + (double(1.0) + dmm_zeta * Xl) * (double(1.0) - Xs) * Rj ;
-	                    double _Vk = Xl * Xs * Gk + (double(1.0) + dmm_zeta * Xl) * (double(1.0) - Xs) * Rk ;
+		// builds the flat clause layout used by the CSR kernel, called once per job after the input file is parsed
+		void dmm_build_csr() {
+			csr_clause_begin.assign(m+1, 0);
+			for (int clause = 0; clause < m; clause++) csr_clause_begin[clause+1] = csr_clause_begin[clause] + clauseSizes[clause];
+			int lits = csr_clause_begin[m];
+			csr_var.resize(lits);
+			csr_q.resize(lits);
+			std::vector<int> var_count(n+1, 0);
+			for (int clause = 0; clause < m; clause++) {
+				for (int i = 0; i < clauseSizes[clause]; i++) {
+					int lit = cls[clause*MAX_LITS_SYSTEM+i];
+					csr_var[csr_clause_begin[clause]+i] = abs(lit)-1;
+					csr_q[csr_clause_begin[clause]+i] = (lit>0)? 1.0:-1.0;
+					var_count[abs(lit)]++;
+				}
+			}
+			// transposed index: literal positions per variable, in clause order so the summation order is fixed
+			csr_var_begin.assign(n+1, 0);
+			for (int v = 0; v < n; v++) csr_var_begin[v+1] = csr_var_begin[v] + var_count[v+1];
+			csr_var_lits.resize(lits);
+			std::vector<int> fill(csr_var_begin.begin(), csr_var_begin.end()-1);
+			for (int pos = 0; pos < lits; pos++) csr_var_lits[fill[csr_var[pos]]++] = pos;
+			// 3-sat clauses are evaluated lane-wise, everything else goes through the scalar path:
+			sat3_clauses.clear();
+			other_clauses.clear();
+			for (int k = 0; k < 3; k++) { sat3_var[k].clear(); sat3_q[k].clear(); }
+			for (int clause = 0; clause < m; clause++) {
+				if (clauseSizes[clause] == 3) {
+					sat3_clauses.push_back(clause);
+					for (int k = 0; k < 3; k++) {
+						sat3_var[k].push_back(csr_var[csr_clause_begin[clause]+k]);
+						sat3_q[k].push_back(csr_q[csr_clause_begin[clause]+k]);
+					}
+				} else {
+					other_clauses.push_back(clause);
+				}
+			}
+			lit_contrib.assign(lits, 0.0);
+			dxdt_max_deviation = 0.0;
+		}
 
-	                    //sum of vectors method:
-	                    if (_Vi!=0.0) dxdt_v[liti-1].push_back(_Vi);
-	                    if (_Vj!=0.0) dxdt_v[litj-1].push_back(_Vj);
-	                    if (_Vk!=0.0) dxdt_v[litk-1].push_back(_Vk);
+		// runs job(block) for every block, on the chip's worker pool when it has one
+		void dmm_for_blocks(size_t count, const std::function<void(size_t)>& job) {
+			if (dxdt_pool) {
+				dxdt_pool->parallelFor(count, [&](size_t block) { job(block); return true; });
+			} else {
+				for (size_t block = 0; block < count; block++) job(block);
+			}
+		}
 
-	                    // do not change unit_clauses:
-	                    if (unit_clauses) {
-	                        if (unit_clause_vars[liti]!=0) dxdt[liti-1] = 0.0;
-	                        if (unit_clause_vars[litj]!=0) dxdt[litj-1] = 0.0;
-	                        if (unit_clause_vars[litk]!=0) dxdt[litk-1] = 0.0;
-	                    }
+		// reference kernel: voltages are collected per variable, sorted and accumulated
+		void dmm_dxdt_reference(const std::vector<double>& x, std::vector<double>& dxdt, std::vector<double>& clause_C) {
+	        std::vector< std::vector <double >> dxdt_v(n); // vector for storing all voltages
+	        // loop through each clause:
+	        for (int clause = 0; clause < m; clause++) {
+	            // number of literals in this clause:
+	            int ksat = clauseSizes[clause];
+	            // Xl & Xs:
+	            double Xs = x[clause+n];   if (Xs<0.0) Xs = double(0.0); if (Xs>1.0) Xs = double(1.0); //Xs bounds
+	            double Xl = x[clause+n+m]; if (Xl<1.0) Xl = double(1.0); if (Xl>xl_max) Xl = double(xl_max); //Xl bounds
+	            double C  = double(0.0);
+	            double Ri, Rj, Rk, Gi, Gj, Gk;
+	            // 3-sat:
+	            if (ksat==3) {
+	                int Qi = (cls[clause*MAX_LITS_SYSTEM+0]>0)? 1:-1; // +1 if literal is >0, otherwise -1
+	                int Qj = (cls[clause*MAX_LITS_SYSTEM+1]>0)? 1:-1; // +1 if literal is >0, otherwise -1
+	                int Qk = (cls[clause*MAX_LITS_SYSTEM+2]>0)? 1:-1; // +1 if literal is >0, otherwise -1
+	                int liti = abs(cls[clause*MAX_LITS_SYSTEM+0]);
+	                int litj = abs(cls[clause*MAX_LITS_SYSTEM+1]);
+	                int litk = abs(cls[clause*MAX_LITS_SYSTEM+2]);
+	                double Vi = x[liti-1]; if (Vi<-1.0) Vi = -1.0; if (Vi>1.0) Vi = 1.0; //V bounds
+	                double Vj = x[litj-1]; if (Vj<-1.0) Vj = -1.0; if (Vj>1.0) Vj = 1.0; //V bounds
+	                double Vk = x[litk-1]; if (Vk<-1.0) Vk = -1.0; if (Vk>1.0) Vk = 1.0; //V bounds
+	                double i = double(1.0)-double(Qi)*Vi;
+	                double j = double(1.0)-double(Qj)*Vj;
+	                double k = double(1.0)-double(Qk)*Vk;
+	                C = double(fmin(i, fmin(j, k)));
+	                C = C / double(2.0);
+	                if (C<0.0) C=double(0.0);
+	                if (C>1.0) C=double(1.0);
+	                
+	                // equation Gn,m(vn,vj,vk)= 1/2 qn,mmin[(1−qj,mvj),(1−qk,mvk)] (5.x):
+	                Gi = double(Qi) * fmin(j,k) / double(2.0);
+	                Gj = double(Qj) * fmin(i,k) / double(2.0);
+	                Gk = double(Qk) * fmin(i,j) / double(2.0);
+	                
+	                // equation Rn,m (vn , vj , vk ) = 1/2(qn,m −vn), Cm(vn,vj,vk)= 1/2(1−qn,mvn), 0 otherwise (5.x):
+	                if (C == double(i/double(2.0)) ) {Ri = (double(Qi)-Vi)/2.0;} else {Ri = double(0.0);} //Qi*i/2.0*-1;} //= 0.0
+	                if (C == double(j/double(2.0)) ) {Rj = (double(Qj)-Vj)/2.0;} else {Rj = double(0.0);} //Qj*j/2.0*-1;} //= 0.0
+	                if (C == double(k/double(2.0)) ) {Rk = (double(Qk)-Vk)/2.0;} else {Rk = double(0.0);} //Qk*k/2.0*-1;} //= 0.0
+	                
+	                // equation Vn = SUM xl,mxs,mGn,m + (1 + ζxl,m)(1 − xs,m)Rn,m (5.x):
+	                double _Vi = Xl * Xs * Gi + (double(1.0) + dmm_zeta * Xl) * (double(1.0) - Xs) * Ri ;
+	                double _Vj = Xl * Xs * Gj + (double(1.0) + dmm_zeta * Xl) * (double(1.0) - Xs) * Rj ;
+	                double _Vk = Xl * Xs * Gk + (double(1.0) + dmm_zeta * Xl) * (double(1.0) - Xs) * Rk ;
+
+	                //sum of vectors method:
+	                if (_Vi!=0.0) dxdt_v[liti-1].push_back(_Vi);
+	                if (_Vj!=0.0) dxdt_v[litj-1].push_back(_Vj);
+	                if (_Vk!=0.0) dxdt_v[litk-1].push_back(_Vk);
+
+	                // do not change unit_clauses:
+	                if (unit_clauses) {
+	                    if (unit_clause_vars[liti]!=0) dxdt[liti-1] = 0.0;
+	                    if (unit_clause_vars[litj]!=0) dxdt[litj-1] = 0.0;
+	                    if (unit_clause_vars[litk]!=0) dxdt[litk-1] = 0.0;
 	                }
-	                // 2-sat:
-	                if (ksat==2) {
-	                    int Qi = (cls[clause*MAX_LITS_SYSTEM+0]>0)? 1:-1; // +1 if literal is >0, otherwise -1
-	                    int Qj = (cls[clause*MAX_LITS_SYSTEM+1]>0)? 1:-1; // +1 if literal is >0, otherwise -1
-	                    int liti = abs(cls[clause*MAX_LITS_SYSTEM+0]);
-	                    int litj = abs(cls[clause*MAX_LITS_SYSTEM+1]);
-	                    double Vi = x[liti-1]; if (Vi<-1.0) Vi = -1.0; if (Vi>1.0) Vi = 1.0; 
-	                    double Vj = x[litj-1]; if (Vj<-1.0) Vj = -1.0; if (Vj>1.0) Vj = 1.0;
-	                    double i = double(1.0)-double(Qi)*Vi;
-	                    double j = double(1.0)-double(Qj)*Vj;
-	                    C = double(fmin(i, j));
-	                    C = C / double(2.0) ;
-	                    if (C<0.0) C=double(0.0);
-	                    if (C>1.0) C=double(1.0);
-	                    //voltage:
-	                    Gi = double(Qi) * j / double(2.0);
-	                    Gj = double(Qj) * i / double(2.0);
-	                    
-	                    if (C == double(i/double(2.0)) ) {Ri = (double(Qi)-Vi)/2.0;} else {Ri = double(0.0);} //Qi*i/2.0*-1;} //= 0.0
-	                    if (C == double(j/double(2.0)) ) {Rj = (double(Qj)-Vj)/2.0;} else {Rj = double(0.0);} //Qj*j/2.0*-1;} //= 0.0
+	            }
+	            // 2-sat:
+	            if (ksat==2) {
+	                int Qi = (cls[clause*MAX_LITS_SYSTEM+0]>0)? 1:-1; // +1 if literal is >0, otherwise -1
+	                int Qj = (cls[clause*MAX_LITS_SYSTEM+1]>0)? 1:-1; // +1 if literal is >0, otherwise -1
+	                int liti = abs(cls[clause*MAX_LITS_SYSTEM+0]);
+	                int litj = abs(cls[clause*MAX_LITS_SYSTEM+1]);
+	                double Vi = x[liti-1]; if (Vi<-1.0) Vi = -1.0; if (Vi>1.0) Vi = 1.0; 
+	                double Vj = x[litj-1]; if (Vj<-1.0) Vj = -1.0; if (Vj>1.0) Vj = 1.0;
+	                double i = double(1.0)-double(Qi)*Vi;
+	                double j = double(1.0)-double(Qj)*Vj;
+	                C = double(fmin(i, j));
+	                C = C / double(2.0) ;
+	                if (C<0.0) C=double(0.0);
+	                if (C>1.0) C=double(1.0);
+	                //voltage:
+	                Gi = double(Qi) * j / double(2.0);
+	                Gj = double(Qj) * i / double(2.0);
+	                
+	                if (C == double(i/double(2.0)) ) {Ri = (double(Qi)-Vi)/2.0;} else {Ri = double(0.0);} //Qi*i/2.0*-1;} //= 0.0
+	                if (C == double(j/double(2.0)) ) {Rj = (double(Qj)-Vj)/2.0;} else {Rj = double(0.0);} //Qj*j/2.0*-1;} //= 0.0
 
-	                    double _Vi = Xl * Xs * Gi + (double(1.0) + dmm_zeta * Xl) * (double(1.0) - Xs) * Ri;
-	                    double _Vj = Xl * Xs * Gj + (double(1.0) + dmm_zeta * Xl) * (double(1.0) - Xs) * Rj;
+	                double _Vi = Xl * Xs * Gi + (double(1.0) + dmm_zeta * Xl) * (double(1.0) - Xs) * Ri;
+	                double _Vj = Xl * Xs * Gj + (double(1.0) + dmm_zeta * Xl) * (double(1.0) - Xs) * Rj;
 
-	                    //sum of vectors method:
-	                    if (_Vi!=0.0) dxdt_v[liti-1].push_back(_Vi);
-	                    if (_Vj!=0.0) dxdt_v[litj-1].push_back(_Vj);
-	                    
-	                    // do not change unit_clauses:
-	                    if (unit_clauses) {
-	                        if (unit_clause_vars[liti]!=0) dxdt[liti-1] = 0.0;
-	                        if (unit_clause_vars[litj]!=0) dxdt[litj-1] = 0.0;
-	                    }
-	                }
+	                //sum of vectors method:
+	                if (_Vi!=0.0) dxdt_v[liti-1].push_back(_Vi);
+	                if (_Vj!=0.0) dxdt_v[litj-1].push_back(_Vj);
 	                
-	                // k-sat:
-	                if (ksat!=1 && ksat!=2 && ksat!=3) {
-	                    int lit[MAX_LITS_SYSTEM], Q[MAX_LITS_SYSTEM];
-	                    double V[MAX_LITS_SYSTEM], _i[MAX_LITS_SYSTEM], R[MAX_LITS_SYSTEM], G[MAX_LITS_SYSTEM];
-
-	                    double c_min=INT_MAX;
-	                    for (int i=0; i<ksat; i++) {
-	                        Q[i] = (cls[clause*MAX_LITS_SYSTEM+i]>0)? 1:-1; // +1 if literal is >0, otherwise -1
-	                        lit[i] = abs(cls[clause*MAX_LITS_SYSTEM+i]);
-	                        V[i] = x[lit[i]-1]; if (V[i]<-1.0) V[i]=-1.0; if (V[i]>1.0) V[i]=1.0; //boundary for v € [-1,1]:
-	                        _i[i] = double(1.0)-double(Q[i])*V[i];
-	                        // find min:
-	                        if (_i[i]<c_min) c_min = _i[i]; 
-	                    }
-	                    C = c_min / double(2.0);
-	                    if (C<0.0) printf("*\n");//C=0.0; // never triggered?
-	                    if (C>1.0) printf("*\n");//C=1.0; // never triggered?
-	                    
-	                    for (int i=0; i<ksat; i++) {
-	                        //find min of others:
-	                        double g_min = INT_MAX;
-	                        for (int ii=0; ii<ksat; ii++) {if (ii!=i && _i[ii]<g_min) g_min = _i[ii];}
-	                        G[i] = double(Q[i]) * g_min / double(2.0);
-	                        double comp = _i[i]/double(2.0);
-	                        if (comp<0.0) printf("*\n");//comp = 0.0; // never triggered?
-	                        if (comp>1.0) printf("*\n");//comp = 1.0; // never triggered?
-	                        if (C != comp) {R[i] = double(0.0);} else {R[i] = (double(Q[i])-V[i]) / double(2.0);}
-	                        double _V = Xl * Xs * G[i] + (double(1.0) + dmm_zeta * Xl) * (double(1.0) - Xs) * R[i];
-	                        
-	                        //sum of vectors method:
-	                        if (_V!=0.0) dxdt_v[lit[i]-1].push_back(_V);
-	                    
-	                        // do not change unit_clauses:
-	                        if (unit_clauses) {
-	                            if (unit_clause_vars[lit[i]]!=0) dxdt[lit[i]-1] = 0.0;
-	                        }
-	                    }
+	                // do not change unit_clauses:
+	                if (unit_clauses) {
+	                    if (unit_clause_vars[liti]!=0) dxdt[liti-1] = 0.0;
+	                    if (unit_clause_vars[litj]!=0) dxdt[litj-1] = 0.0;
 	                }
-
-	                //update energy:
-	                energy_thread[0] += C;
-	                //update loc:
-	                if (C<0.5) loc--; //this clause is sat, reduce loc
-	                
-	                // Calculate new Xs:
-	                dxdt[n+clause] = dmm_beta * (Xs + dmm_epsilon) * (C - dmm_gamma);
+	            }
+	            
+	            // k-sat:
+	            if (ksat!=1 && ksat!=2 && ksat!=3) {
+	                int lit[MAX_LITS_SYSTEM], Q[MAX_LITS_SYSTEM];
+	                double V[MAX_LITS_SYSTEM], _i[MAX_LITS_SYSTEM], R[MAX_LITS_SYSTEM], G[MAX_LITS_SYSTEM];
+
+	                double c_min=INT_MAX;
+	                for (int i=0; i<ksat; i++) {
+	                    Q[i] = (cls[clause*MAX_LITS_SYSTEM+i]>0)? 1:-1; // +1 if literal is >0, otherwise -1
+	                    lit[i] = abs(cls[clause*MAX_LITS_SYSTEM+i]);
+	                    V[i] = x[lit[i]-1]; if (V[i]<-1.0) V[i]=-1.0; if (V[i]>1.0) V[i]=1.0; //boundary for v € [-1,1]:
+	                    _i[i] = double(1.0)-double(Q[i])*V[i];
+	                    // find min:
+	                    if (_i[i]<c_min) c_min = _i[i]; 
+	                }
+	                C = c_min / double(2.0);
+	                if (C<0.0) printf("*\n");//C=0.0; // never triggered?
+	                if (C>1.0) printf("*\n");//C=1.0; // never triggered?
 	                
-	                // Calculate new Xl:
-	                dxdt[n+m+clause] = dmm_alpha * (C - dmm_delta);
+	                for (int i=0; i<ksat; i++) {
+	                    //find min of others:
+	                    double g_min = INT_MAX;
+	                    for (int ii=0; ii<ksat; ii++) {if (ii!=i && _i[ii]<g_min) g_min = _i[ii];}
+	                    G[i] = double(Q[i]) * g_min / double(2.0);
+	                    double comp = _i[i]/double(2.0);
+	                    if (comp<0.0) printf("*\n");//comp = 0.0; // never triggered?
+	                    if (comp>1.0) printf("*\n");//comp = 1.0; // never triggered?
+	                    if (C != comp) {R[i] = double(0.0);} else {R[i] = (double(Q[i])-V[i]) / double(2.0);}
+	                    double _V = Xl * Xs * G[i] + (double(1.0) + dmm_zeta * Xl) * (double(1.0) - Xs) * R[i];
+	                    
+	                    //sum of vectors method:
+	                    if (_V!=0.0) dxdt_v[lit[i]-1].push_back(_V);
 	                
-	                // update info variables:
-	                if (clause==0) {
-	                    C_rem = C; 
-	                    if (ksat<=3) {
-	                        G_rem = Gi; R_rem = Ri;
-	                    } else {
-	                        G_rem = 0.0;
-	                        R_rem = 0.0;
-	                    }
-	                    if (ksat==1) {
-	                        G_rem = 0.0; 
-	                        R_rem = 0.0;
+	                    // do not change unit_clauses:
+	                    if (unit_clauses) {
+	                        if (unit_clause_vars[lit[i]]!=0) dxdt[lit[i]-1] = 0.0;
 	                    }
 	                }
+	            }
+
+	            // Calculate new Xs:
+	            dxdt[n+clause] = dmm_beta * (Xs + dmm_epsilon) * (C - dmm_gamma);
+	            
+	            // Calculate new Xl:
+	            dxdt[n+m+clause] = dmm_alpha * (C - dmm_delta);
+	            
+	            clause_C[clause] = C;
+	        } //---clause calculation loop
+
+	        // summation of voltages SUM dxdt_v[n] => dxdt[n]: ------------------------------------------------------
+	        for (int i=0; i<n; i++) {
+	            std::sort(dxdt_v[i].begin(), dxdt_v[i].end()); //summing with smallest first increases accuracy
+	            dxdt[i] = accumulate(dxdt_v[i].begin(), dxdt_v[i].end(), (double) 0.0);
+	        }
+		}
+
+		// scalar clause evaluation for the CSR kernel, any clause size:
+		double dmm_clause_csr(const std::vector<double>& x, int clause, std::vector<double>& dxdt) {
+			int begin = csr_clause_begin[clause];
+			int ksat = csr_clause_begin[clause+1] - begin;
+			double Xs = x[clause+n];   if (Xs<0.0) Xs = 0.0; if (Xs>1.0) Xs = 1.0; //Xs bounds
+			double Xl = x[clause+n+m]; if (Xl<1.0) Xl = 1.0; if (Xl>xl_max) Xl = double(xl_max); //Xl bounds
+			double C = 0.0;
+			// unit clauses have no dynamics:
+			if (ksat >= 2) {
+				double V[MAX_LITS_SYSTEM], _i[MAX_LITS_SYSTEM];
+				double c_min = INT_MAX;
+				for (int i=0; i<ksat; i++) {
+					V[i] = x[csr_var[begin+i]]; if (V[i]<-1.0) V[i]=-1.0; if (V[i]>1.0) V[i]=1.0;
+					_i[i] = 1.0 - csr_q[begin+i]*V[i];
+					if (_i[i]<c_min) c_min = _i[i];
+				}
+				C = c_min / 2.0;
+				if (C<0.0) C = 0.0;
+				if (C>1.0) C = 1.0;
+				for (int i=0; i<ksat; i++) {
+					double g_min = INT_MAX;
+					for (int ii=0; ii<ksat; ii++) {if (ii!=i && _i[ii]<g_min) g_min = _i[ii];}
+					double G = csr_q[begin+i] * g_min / 2.0;
+					double R = (C == _i[i]/2.0)? (csr_q[begin+i]-V[i]) / 2.0 : 0.0;
+					lit_contrib[begin+i] = Xl * Xs * G + (1.0 + dmm_zeta * Xl) * (1.0 - Xs) * R;
+				}
+			} else {
+				for (int i=0; i<ksat; i++) lit_contrib[begin+i] = 0.0;
+			}
+			dxdt[n+clause] = dmm_beta * (Xs + dmm_epsilon) * (C - dmm_gamma);
+			dxdt[n+m+clause] = dmm_alpha * (C - dmm_delta);
+			return C;
+		}
+
+		// 3-sat clauses [begin, end) of sat3_clauses, DXDT_SIMD_LANES clauses at a time:
+		void dmm_clauses_sat3(const std::vector<double>& x, size_t begin, size_t end, std::vector<double>& dxdt, std::vector<double>& clause_C) {
+			size_t s = begin;
+#if DXDT_SIMD_LANES > 1
+			const dxdt_simd zero = simd_set1(0.0), one = simd_set1(1.0), minus_one = simd_set1(-1.0), half = simd_set1(0.5);
+			const dxdt_simd xl_top = simd_set1(double(xl_max)), zeta = simd_set1(dmm_zeta);
+			const dxdt_simd alpha = simd_set1(dmm_alpha), beta = simd_set1(dmm_beta), gamma = simd_set1(dmm_gamma);
+			const dxdt_simd delta = simd_set1(dmm_delta), epsilon = simd_set1(dmm_epsilon);
+			double lanes[8][DXDT_SIMD_LANES];
+			for (; s + DXDT_SIMD_LANES <= end; s += DXDT_SIMD_LANES) {
+				// gather:
+				for (int l = 0; l < DXDT_SIMD_LANES; l++) {
+					int clause = sat3_clauses[s+l];
+					lanes[0][l] = x[sat3_var[0][s+l]];
+					lanes[1][l] = x[sat3_var[1][s+l]];
+					lanes[2][l] = x[sat3_var[2][s+l]];
+					lanes[3][l] = x[clause+n];
+					lanes[4][l] = x[clause+n+m];
+				}
+				dxdt_simd Vi = simd_min(simd_max(simd_load(lanes[0]), minus_one), one);
+				dxdt_simd Vj = simd_min(simd_max(simd_load(lanes[1]), minus_one), one);
+				dxdt_simd Vk = simd_min(simd_max(simd_load(lanes[2]), minus_one), one);
+				dxdt_simd Xs = simd_min(simd_max(simd_load(lanes[3]), zero), one);
+				dxdt_simd Xl = simd_min(simd_max(simd_load(lanes[4]), one), xl_top);
+				dxdt_simd Qi = simd_load(&sat3_q[0][s]);
+				dxdt_simd Qj = simd_load(&sat3_q[1][s]);
+				dxdt_simd Qk = simd_load(&sat3_q[2][s]);
+				dxdt_simd i = simd_sub(one, simd_mul(Qi, Vi));
+				dxdt_simd j = simd_sub(one, simd_mul(Qj, Vj));
+				dxdt_simd k = simd_sub(one, simd_mul(Qk, Vk));
+				dxdt_simd C = simd_mul(simd_min(i, simd_min(j, k)), half);
+				C = simd_min(simd_max(C, zero), one);
+				dxdt_simd Gi = simd_mul(simd_mul(Qi, simd_min(j, k)), half);
+				dxdt_simd Gj = simd_mul(simd_mul(Qj, simd_min(i, k)), half);
+				dxdt_simd Gk = simd_mul(simd_mul(Qk, simd_min(i, j)), half);
+				dxdt_simd Ri = simd_and(simd_cmpeq(C, simd_mul(i, half)), simd_mul(simd_sub(Qi, Vi), half));
+				dxdt_simd Rj = simd_and(simd_cmpeq(C, simd_mul(j, half)), simd_mul(simd_sub(Qj, Vj), half));
+				dxdt_simd Rk = simd_and(simd_cmpeq(C, simd_mul(k, half)), simd_mul(simd_sub(Qk, Vk), half));
+				dxdt_simd XlXs = simd_mul(Xl, Xs);
+				dxdt_simd XlXsR = simd_mul(simd_add(one, simd_mul(zeta, Xl)), simd_sub(one, Xs));
+				simd_store(lanes[0], simd_add(simd_mul(XlXs, Gi), simd_mul(XlXsR, Ri)));
+				simd_store(lanes[1], simd_add(simd_mul(XlXs, Gj), simd_mul(XlXsR, Rj)));
+				simd_store(lanes[2], simd_add(simd_mul(XlXs, Gk), simd_mul(XlXsR, Rk)));
+				simd_store(lanes[3], C);
+				simd_store(lanes[4], simd_mul(simd_mul(beta, simd_add(Xs, epsilon)), simd_sub(C, gamma)));
+				simd_store(lanes[5], simd_mul(alpha, simd_sub(C, delta)));
+				// scatter:
+				for (int l = 0; l < DXDT_SIMD_LANES; l++) {
+					int clause = sat3_clauses[s+l];
+					int pos = csr_clause_begin[clause];
+					lit_contrib[pos+0] = lanes[0][l];
+					lit_contrib[pos+1] = lanes[1][l];
+					lit_contrib[pos+2] = lanes[2][l];
+					clause_C[clause] = lanes[3][l];
+					dxdt[n+clause] = lanes[4][l];
+					dxdt[n+m+clause] = lanes[5][l];
+				}
+			}
+#endif
+			for (; s < end; s++) {
+				int clause = sat3_clauses[s];
+				clause_C[clause] = dmm_clause_csr(x, clause, dxdt);
+			}
+		}
+
+		// CSR kernel: clauses write their literal contributions into flat slots in parallel, then every variable sums its
+		// own slots in clause order with compensated summation. The result does not depend on the number of threads.
+		void dmm_dxdt_csr(const std::vector<double>& x, std::vector<double>& dxdt, std::vector<double>& clause_C) {
+			size_t sat3_blocks = (sat3_clauses.size() + DXDT_CLAUSE_BLOCK - 1) / DXDT_CLAUSE_BLOCK;
+			size_t other_blocks = (other_clauses.size() + DXDT_CLAUSE_BLOCK - 1) / DXDT_CLAUSE_BLOCK;
+			dmm_for_blocks(sat3_blocks + other_blocks, [&](size_t block) {
+				if (block < sat3_blocks) {
+					size_t begin = block * DXDT_CLAUSE_BLOCK;
+					dmm_clauses_sat3(x, begin, std::min(begin + DXDT_CLAUSE_BLOCK, sat3_clauses.size()), dxdt, clause_C);
+				} else {
+					size_t begin = (block - sat3_blocks) * DXDT_CLAUSE_BLOCK;
+					size_t end = std::min(begin + DXDT_CLAUSE_BLOCK, other_clauses.size());
+					for (size_t c = begin; c < end; c++) clause_C[other_clauses[c]] = dmm_clause_csr(x, other_clauses[c], dxdt);
+				}
+			});
+			size_t var_blocks = (size_t(n) + DXDT_VAR_BLOCK - 1) / DXDT_VAR_BLOCK;
+			dmm_for_blocks(var_blocks, [&](size_t block) {
+				int end = std::min(int(block + 1) * DXDT_VAR_BLOCK, n);
+				for (int v = int(block) * DXDT_VAR_BLOCK; v < end; v++) {
+					// Neumaier summation:
+					double sum = 0.0, comp = 0.0;
+					for (int p = csr_var_begin[v]; p < csr_var_begin[v+1]; p++) {
+						double value = lit_contrib[csr_var_lits[p]];
+						double tmp = sum + value;
+						if (fabs(sum) >= fabs(value)) comp += (sum - tmp) + value; else comp += (value - tmp) + sum;
+						sum = tmp;
+					}
+					dxdt[v] = sum + comp;
+				}
+			});
+		}
+
+		// derivative of x with the selected kernel, no side effects on the solver state:
+		void dmm_rhs(const std::vector<double>& x, std::vector<double>& dxdt, std::vector<double>& clause_C) {
+			if (dxdt_kernel == DXDT_KERNEL_REFERENCE) {
+				dmm_dxdt_reference(x, dxdt, clause_C);
+			} else {
+				dmm_dxdt_csr(x, dxdt, clause_C);
+			}
+			if (dxdt_kernel == DXDT_KERNEL_COMPARE) {
+				dxdt_ref.resize(n+m*2);
+				C_ref.resize(m);
+				dmm_dxdt_reference(x, dxdt_ref, C_ref);
+				for (int i=0; i<n+m*2; i++) dxdt_max_deviation = std::max(dxdt_max_deviation, fabs(dxdt[i]-dxdt_ref[i]));
+				for (int i=0; i<m; i++) dxdt_max_deviation = std::max(dxdt_max_deviation, fabs(clause_C[i]-C_ref[i]));
+			}
+		}
+
+		// ---------------------------------------------------------------------------------------------------------------
+		// SOLVER STATE UPDATE (loc, energy, best assignment, solution check) for an accepted state:
+		// ---------------------------------------------------------------------------------------------------------------
+		void dmm_update_state(int chip_id, const std::vector<double>& x, const std::vector<double>& clause_C, double t) {
+			
+			//timers:
+        	t_end_thread[0] = ptime::microsec_clock::local_time().time_of_day().total_milliseconds();
+        	double time_spent = (double)(t_end_thread[0] - t_begin_thread[0])/1000;
+        	time_thread_actual[0] = t;
+        	energy_thread[0] = 0.0;
+        	/* main ODE routine */
+	        if (solved!=1) {
+	            // energy and loc, in clause order: -----------------------------------------------------------------------
+	            int loc = m;
+	            double C_rem = (m>0)? clause_C[0] : 0.0;
+	            int cnt_xl_pos = 0;
+	            int cnt_xs_pos = 0;
+	            for (int clause = 0; clause < m; clause++) {
+	                energy_thread[0] += clause_C[clause];
+	                if (clause_C[clause]<0.5) loc--; //this clause is sat, reduce loc
 	                if (x[n+m+clause]>1.0) cnt_xl_pos++;
 	                if (x[n+clause]>0.0) cnt_xs_pos++;
-	            } //---clause calculation loop
-
-	            // summation of voltages SUM dxdt_v[n] => dxdt[n]: ------------------------------------------------------
-	            for (int i=0; i<n; i++) {
-	                std::sort(dxdt_v[i].begin(), dxdt_v[i].end()); //summing with smallest first increases accuracy
-	                dxdt[i] = accumulate(dxdt_v[i].begin(), dxdt_v[i].end(), (double) 0.0);
 	            }
-
 	            // update global_all_runs_thread & update v_best: --------------------------------------------------------
 	            if (loc <= global_all_runs_thread[0]) {
 	                global_all_runs_thread[0] = loc;
@@ -633,9 +984,18 @@ class dynex_chip_thread_obj {
 
 	            //new lower lock (global)? or lower energy (global)? -----------------------------------------------------
 	            if (loc<global || energy_thread[0]<global_energy) {
+	                bool new_global = loc<global;
 	                if (loc<global) {
 	                    global = loc;
 	                    global_best_thread = 0;
+	                    if (offline) {
+	                        Dynex::benchmark_loc_point point;
+	                        point.walltime = time_spent;
+	                        point.steps = stepcounter[0];
+	                        point.loc = loc;
+	                        point.energy = energy_thread[0];
+	                        loc_trace.push_back(point);
+	                    }
 	                }
 	                if (energy_thread[0]<global_energy) {
 	                    global_energy = energy_thread[0];
@@ -668,10 +1028,8 @@ class dynex_chip_thread_obj {
 	                    << " Σe=" << energy_thread[0] << " " << std::endl;
 	                    fflush(stdout);
 	                } 
-	                // loc file; -----------------------------------------------------------------------------------------
-                    FILE *floc = fopen(LOC_FILE, "a");
-                    fprintf(floc,"%d;%d,%.5f;%.5f;%d;%.2f\n",chip_id, stepcounter[0], time_spent,t,global,global_energy);
-                    fclose(floc);
+	                // loc file, energy-only improvements are sampled: ------------------------------------------------
+	                loc_log.record(new_global, "%d;%d,%.5f;%.5f;%d;%.2f\n",chip_id, stepcounter[0], time_spent,t,global,global_energy);
 	            }
 
 	            // update energy of thread: ------------------------------------------------------------------------------
@@ -721,14 +1079,16 @@ class dynex_chip_thread_obj {
                         if (dynex_debugger) printf(TEXT_YELLOW); 
                         if (dynex_debugger) printf("c [%d] SAT (VERIFIED)\n",chip_id); 
                         solved = 1;
-                        std::cout << log_time() << TEXT_CYAN << "[DYNEX CHIP " << chip_id << "] " << TEXT_YELLOW << "FOUND A SOLUTION." << TEXT_DEFAULT << std::endl;
                         //write solution to file:
-                        FILE *fs = fopen(SOLUTION_FILE, "w");
-                        for (int i=0; i<n; i++) {
-                            if (x[i]>=0) fprintf(fs,"%d, ",i+1);
-                            if (x[i]<0) fprintf(fs,"%d, ",(i+1)*-1);
+                        if (!offline) {
+                            std::cout << log_time() << TEXT_CYAN << "[DYNEX CHIP " << chip_id << "] " << TEXT_YELLOW << "FOUND A SOLUTION." << TEXT_DEFAULT << std::endl;
+                            FILE *fs = fopen(SOLUTION_FILE, "w");
+                            for (int i=0; i<n; i++) {
+                                if (x[i]>=0) fprintf(fs,"%d, ",i+1);
+                                if (x[i]<0) fprintf(fs,"%d, ",(i+1)*-1);
+                            }
+                            fclose(fs);    
                         }
-                        fclose(fs);    
                     }
                     if (!sat) {
                     	if (dynex_debugger) printf(TEXT_RED); 
@@ -738,46 +1098,70 @@ class dynex_chip_thread_obj {
 	                
 
 	                // update locfile:
-                    FILE *floc = fopen(LOC_FILE, "a");
-                    fprintf(floc,"%d;%d,%.5f;%.5f;%d;%.2f\n",chip_id, stepcounter[0], time_spent,t,global,global_energy);
-                    fclose(floc);
+	                loc_log.record(true, "%d;%d,%.5f;%.5f;%d;%.2f\n",chip_id, stepcounter[0], time_spent,t,global,global_energy);
+	                loc_log.flush();
             
 	            } // ---output
 	        }
-
-
-		    return dxdt;
 		}
 
 		// ---------------------------------------------------------------------------------------------------------------
 		// ODE INTEGRATION STEP:
 		// ---------------------------------------------------------------------------------------------------------------
-		std::vector<double> dmm_dostep(int chip_id, std::vector<double> _x, std::vector<double> dxdt, double h) {
-
+		// x_trial = x + h * dxdt with the variable bounds, returns the largest voltage change
+		double dmm_euler(const dmm_integrator& in, std::vector<double>& x_trial, double h) {
+		    double max_dv = 0.0;
 		    //update V:
 		    for (int i=0; i<n; i++) {
-		        _x[i] = _x[i] + h * dxdt[i];
-		        if (unit_clause_vars[i+1]!=0) _x[i] = unit_clause_vars[i+1]; //TODO: assign +1 or -1
-		        if (_x[i]<-1.0) _x[i]=-1.0;   
-		        if (_x[i]>1.0) _x[i]=1.0;
+		        double v = in.x[i] + h * in.dxdt[i];
+		        if (unit_clause_vars[i+1]!=0) v = unit_clause_vars[i+1]; //TODO: assign +1 or -1
+		        if (v<-1.0) v=-1.0;
+		        if (v>1.0) v=1.0;
+		        max_dv = std::max(max_dv, fabs(v-in.x[i]));
+		        x_trial[i] = v;
 		    }
 		    //update XS:
 		    for (int i=n; i<n+m; i++) {
-		        _x[i] = _x[i] + h * dxdt[i];
-		        if (_x[i]<0.0) _x[i]=0.0;
-		        if (_x[i]>1.0) _x[i]=1.0;
+		        double v = in.x[i] + h * in.dxdt[i];
+		        if (v<0.0) v=0.0;
+		        if (v>1.0) v=1.0;
+		        x_trial[i] = v;
 		    }
 		    //update Xl:
 		    for (int i=n+m; i<n+m*2; i++) {
-		        _x[i] = _x[i] + h * dxdt[i];
-		        if (_x[i]<1.0) _x[i]=1.0;  
-		        if (_x[i]>xl_max) _x[i]=xl_max;
+		        double v = in.x[i] + h * in.dxdt[i];
+		        if (v<1.0) v=1.0;
+		        if (v>xl_max) v=xl_max;
+		        x_trial[i] = v;
 		    }
-		    
-		    // increase stepcounter for this thread:
-		    stepcounter[0]++;
+		    return max_dv;
+		}
 
-		    return _x;
+		// one accepted step of size in.h (or h_min). The derivative at the proposed state gives the embedded error
+		// estimate and becomes the derivative of the next step when the state is accepted.
+		void dmm_step(dmm_integrator& in) {
+		    while (true) {
+		        double max_dv = dmm_euler(in, in.x_trial, in.h);
+		        dmm_rhs(in.x_trial, in.dxdt_trial, in.C_trial);
+		        // local error of euler against heun, over the voltages:
+		        double err = 0.0;
+		        for (int i=0; i<n; i++) err = std::max(err, fabs(in.dxdt_trial[i]-in.dxdt[i]));
+		        err *= in.h / 2.0;
+		        double factor = (err > 0.0)? DMM_STEP_SAFETY * sqrt(DMM_STEP_TOLERANCE / err) : DMM_STEP_MAX_GROWTH;
+		        factor = std::min(DMM_STEP_MAX_GROWTH, std::max(DMM_STEP_MAX_SHRINK, factor));
+		        // voltages must not flip by a full unit in one step:
+		        bool accepted = (err <= DMM_STEP_TOLERANCE && max_dv < 1.0) || in.h <= DMM_STEP_H_MIN;
+		        if (accepted) {
+		            in.x.swap(in.x_trial);
+		            in.dxdt.swap(in.dxdt_trial);
+		            in.C.swap(in.C_trial);
+		            in.t += in.h;
+		            in.h = std::min(DMM_STEP_H_MAX, std::max(DMM_STEP_H_MIN, in.h * factor));
+		            return;
+		        }
+		        in.rejected++;
+		        in.h = std::max(DMM_STEP_H_MIN, in.h * std::min(factor, 0.5));
+		    }
 		}
 
 		// generate proof-of-work  ------------------------------------------------------------------------------------------------------
@@ -790,7 +1174,7 @@ class dynex_chip_thread_obj {
 			std::time_t t = std::time(nullptr);
 		    char mbstr[100];
 		    std::strftime(mbstr, sizeof(mbstr), "%H:%M:%S %Y-%m-%d", std::localtime(&t));
-		    fprintf(fs,"{{\"ADDRESS\":\"%s\"},{\"TIMESTAMP\":\"%s\"},{\"LOC\":%d},{\"STEPS\":%d},{\"RATE\":%llu}{\"DATA\":",addr_string.c_str(), mbstr, global,stepcounter[0], my_minute_rate );
+		    fprintf(fs,"{{\"ADDRESS\":\"%s\"},{\"TIMESTAMP\":\"%s\"},{\"LOC\":%d},{\"STEPS\":%d},{\"RATE\":%" PRIu64 "}{\"DATA\":",addr_string.c_str(), mbstr, global,stepcounter[0], my_minute_rate );
 			for (int i=0; i<n; i++) {
                 if (v_best[i]>=0) fprintf(fs,"%d, ",i+1);
                 if (v_best[i]<0) fprintf(fs,"%d, ",(i+1)*-1);
@@ -911,12 +1295,20 @@ class dynex_chip_thread_obj {
 		    energy_thread[0] = m;
 		    energy_thread_min[0] = m;
 
-		    //defining vector: -------------------------------------------------------------------------------
+		    //integrator with preallocated state and derivative buffers: -------------------------------------
 		    int size_of_vector = n+m*2;
-		    state_type x(size_of_vector);
+		    dmm_integrator in;
+		    in.x.assign(initial_assignments, initial_assignments + size_of_vector);
+		    in.x_trial.resize(size_of_vector);
+		    in.dxdt.resize(size_of_vector);
+		    in.dxdt_trial.resize(size_of_vector);
+		    in.C.resize(m);
+		    in.C_trial.resize(m);
+		    in.t = 0.0; // start time
+		    in.h = DMM_STEP_H_INIT; //init stepsize adaptive
+		    const std::vector<double>& x = in.x;
 
 		    // initial conditions: ---------------------------------------------------------------------------
-		    for (int i=0; i<n+m*2; i++) x[i] = initial_assignments[i]; 
 		    if (dynex_debugger) {
 		        std::cout << TEXT_DEFAULT << "c [" << node->id << "] INITIAL ASSIGNMENTS SET: "
 		        << std::setprecision(2) << std::fixed << log_time() << TEXT_CYAN
@@ -936,48 +1328,47 @@ class dynex_chip_thread_obj {
 
 		    //timers: ----------------------------------------------------------------------------------------
 		    t_begin_thread[0] = ptime::microsec_clock::local_time().time_of_day().total_milliseconds(); 
+		    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+		    std::chrono::steady_clock::time_point status_time = started;
+		    int status_steps = 0;
 
     		// ODE integration: ------------------------------------------------------------------------------
     		if (dynex_debugger) printf("c [%d] ADAPTIVE TIME STEP INTEGRATION...\n",node->id);
-    		double t = 0.0; // start time
-        	double h = 0.125; //thread_params[8]; //init stepsize adaptive
+    		dmm_rhs(in.x, in.dxdt, in.C);
+    		dmm_update_state(node->id, in.x, in.C, in.t);
 
         	// run until exit: -------------------------------------------------------------------------------
         	while (solved!=1 && !dynex_quit_flag) {
         		//max steps reached?
         		if (stepcounter[0]>maxsteps) {
         			std::cout << log_time() << "[DYNEX CHIP " << node->id << "] MAX "<<stepcounter[0]<<" INTEGRATION STEPS REACHED - WE QUIT. " << std::endl;
+        			loc_log.flush();
         			return 0;
         		}
         		// status update?
         		if (stepcounter[0] >0 && stepcounter[0] % 1000 == 0) { //10000
-        			// screen update:
-        			std::cout << log_time() << "[DYNEX CHIP " << node->id << "] REQUEST FEE - " << stepcounter[0] << " INTEGRATION STEPS (MAX " << maxsteps << ")" << std::endl;
-        			// collect fees:
-        			// build and submit proof-of-work-file:
-        			bool res = dynex_proof_of_work(node->id);
+        			// steps per second since the last update:
+        			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        			double elapsed = std::chrono::duration<double>(now - status_time).count();
+        			if (elapsed > 0.0) steps_per_second = (stepcounter[0] - status_steps) / elapsed;
+        			status_time = now;
+        			status_steps = stepcounter[0];
+        			if (!offline) {
+        				// screen update:
+        				std::cout << log_time() << "[DYNEX CHIP " << node->id << "] REQUEST FEE - " << stepcounter[0] << " INTEGRATION STEPS (MAX " << maxsteps << ", " << std::setprecision(1) << std::fixed << steps_per_second << " STEPS/S)" << std::endl;
+        				// collect fees:
+        				// build and submit proof-of-work-file:
+        				bool res = dynex_proof_of_work(node->id);
+        			}
+        			if (dxdt_kernel == DXDT_KERNEL_COMPARE) {
+        				std::cout << log_time() << "[DYNEX CHIP " << node->id << "] DXDT KERNEL MAX DEVIATION " << dxdt_max_deviation << std::endl;
+        			}
         		}
 
-        		auto dxdt = dmm_generate_dxdt(node->id, x, t);
         		// adaptive step:
-        		bool adaptive_accepted = false;
-                double h_min = 0.0078125; //0.000125; //
-                double h_max = 10000; 
-                auto x_tmp = x;
-                int varchanges2;
-                while (!adaptive_accepted) {
-                    x_tmp = dmm_dostep(node->id, x, dxdt, h);
-                    varchanges2 = 0; // # vars changing by x %
-                    for (int i=0; i<n; i++) {
-                        if (fabs(x_tmp[i]-x[i])>=1) varchanges2++; // maximum allowed voltage change
-                    }
-                    if (varchanges2>0) {h = h * 1/2; } else {adaptive_accepted = true;}
-                    stepcounter[0]--;
-                    if (h<=h_min) adaptive_accepted = true;
-                }
-                x = x_tmp;
-                stepcounter[0]++;
-                t = t + h; // increase ODE time by stepsize
+        		dmm_step(in);
+        		stepcounter[0]++;
+        		dmm_update_state(node->id, in.x, in.C, in.t);
 
 	            // solved? if yes, we are done
 	            if (solved) {
@@ -990,6 +1381,7 @@ class dynex_chip_thread_obj {
 	            }
         	}
         	//---
+        	loc_log.flush();
 
 			return 0;
 		}
@@ -1030,6 +1422,109 @@ class dynex_chip_thread_obj {
 		    free(node.optimal);
 		}
 
+		// parses a DIMACS cnf, generates arrays for cls, occurences, etc.
+		bool parse_input_file(int chip_id, std::istream& s) {
+			//parse input file:
+			int cls_cnt = 0;
+			bool p_found = false;
+			for (std::string line; std::getline(s, line); ) {
+				if (line.empty() || line.find("%") == 0) {
+					// blank lines and the SATLIB end marker
+				}
+				else if (line.find("c") == 0) {
+					if (dynex_debugger) std::cout << "skipped:" << line << std::endl;
+				}
+				else if (line.find("p") == 0) {
+					std::vector<std::string> tokens = splitString(line, ' ');
+					n = std::stoi(tokens[2]);
+					m = std::stoi(tokens[3]);
+					p_found = true;
+					if (dynex_debugger) std::cout << "number of variables: "<<n<<" clauses: "<<m<<std::endl;
+					/// reserve  memory 
+					cls = (int *) calloc((size_t) m*MAX_LITS_SYSTEM, sizeof(int));
+					clauseSizes = (int *) calloc((size_t) m, sizeof(int));
+					numOccurrenceT = (int *) calloc((size_t) n+1, sizeof(int));
+					
+				} else if (p_found && cls_cnt < m) {
+					//std::cout << "data:" << line << std::endl;
+					std::vector<std::string> tokens = splitString(line, ' ');
+					int cnt = 0;
+					for (auto& token : tokens)
+				    {
+				      if (std::atoi(token.c_str())==0) {
+				      	//std::cout << "(EOF)" << "\n";
+				      } else {
+				      	//std::cout << token << "\n";
+				      	int lit = std::atoi(token.c_str());
+				      	if (cnt >= MAX_LITS_SYSTEM || abs(lit) > n) {
+				            if (dynex_debugger) printf("c [%d] ERROR: CLAUSE %d HAS MORE THAN %d LITERALS OR AN UNKNOWN VARIABLE.\n",chip_id,cls_cnt,MAX_LITS_SYSTEM);
+				            return false;
+				        }
+				      	cls[cls_cnt*MAX_LITS_SYSTEM+cnt] = lit;
+				      	clauseSizes[cls_cnt] = cnt+1;
+				      	numOccurrenceT[abs(lit)]++;
+				      	if (numOccurrenceT[abs(lit)]>maxNumOccurences) {maxNumOccurences=numOccurrenceT[abs(lit)];}
+				      	cnt++;
+				      }
+				    }
+				    cls_cnt++;
+				}
+				
+			}
+			if (!p_found) {
+				std::cout << log_time() << TEXT_CYAN << "[DYNEX CHIP "<<chip_id<<"] INPUT FILE HAS NO VALID FORMAT." << TEXT_DEFAULT << std::endl;
+				return false;
+			}
+
+			if (dynex_debugger) {
+				printf("c [%d] MAX VARIABLE OCCURENCE: %'d\n", chip_id, maxNumOccurences);
+				printf("c [%d] FIRST 10 CLAUSES:\n",chip_id);
+			    for (int i = 0; i < 10; i++) {
+			        printf("c [%d] CLAUSE %i: ",chip_id, i);
+			        for (int j = 0; j < clauseSizes[i]; j++) {printf(" %d",cls[i*MAX_LITS_SYSTEM+j]);}
+			        printf(" (%d)",clauseSizes[i]);
+			        printf("\n");
+			    }
+			    printf("c [%d] LAST 10 CLAUSES:\n",chip_id);
+			    for (int i = m-1; i > (m-10); i--) {
+			        printf("c [%d] CLAUSE %i: ",chip_id ,i);
+			        for (int j = 0; j < clauseSizes[i]; j++) {printf(" %d",cls[i*MAX_LITS_SYSTEM+j]);}
+			        printf(" (%d)",clauseSizes[i]);
+			        printf("\n");
+			    }
+			}
+					    
+			//build occurence array: [var][cls...] /////////////////////////////////////////
+					    occurrence = (int *) calloc((size_t) (n+1)*maxNumOccurences, sizeof(int));
+					    occurenceCounter = (int *) calloc((size_t) n+1, sizeof(int));
+					    
+					    for (int i=0; i<m; i++) {
+					        for (int j = 0; j < clauseSizes[i]; j++) {
+					            int lit = abs(cls[i*MAX_LITS_SYSTEM+j]);
+					            occurrence[lit*maxNumOccurences+occurenceCounter[lit]] = i;
+					            occurenceCounter[lit]++;
+					        }
+					    }
+					    //output:
+					    if (dynex_debugger) {
+					        printf("c [%d] OCCURENCES: ",chip_id);
+					        for (int i=1; i<=20; i++) printf("%d->%d ",i,occurenceCounter[i]);
+					        printf("\n");
+					    }
+			return true;
+		}
+
+		// loads a local input file (offline runs):
+		bool load_input_file(int chip_id, const std::string& path) {
+			std::ifstream file(path);
+			if (!file) {
+				std::cout << log_time() << TEXT_CYAN << "[DYNEX CHIP "<<chip_id<<"] CANNOT OPEN INPUT FILE " << path << TEXT_DEFAULT << std::endl;
+				return false;
+			}
+			job_input_file = path;
+			return parse_input_file(chip_id, file);
+		}
+
 		// download input file: ---------------------------------------------------------------------------------------------------------
 		// downloads and parses input file, generates arrays for cls, occurences, unit clauses, etc.
 		bool download_input_file(int chip_id) {
@@ -1118,90 +1613,9 @@ class dynex_chip_thread_obj {
 						//if (dynex_debugger) {std::cout<<"DATA: " << s.str()  << std::endl;}
 						socket_trsans.close();
 
-						//parse input file:
-						int cls_cnt = 0;
-						bool p_found = false;
-						for (std::string line; std::getline(s, line); ) {
-							if (line.find("c") == 0) {
-								if (dynex_debugger) std::cout << "skipped:" << line << std::endl;
-							}
-							else if (line.find("p") == 0) {
-								std::vector<std::string> tokens = splitString(line, ' ');
-								n = std::stoi(tokens[2]);
-								m = std::stoi(tokens[3]);
-								p_found = true;
-								if (dynex_debugger) std::cout << "number of variables: "<<n<<" clauses: "<<m<<std::endl;
-								/// reserve  memory 
-    							cls = (int *) calloc((size_t) m*MAX_LITS_SYSTEM, sizeof(int));
-								clauseSizes = (int *) calloc((size_t) m, sizeof(int));
-								numOccurrenceT = (int *) calloc((size_t) n+1, sizeof(int));
-								
-							} else {
-								//std::cout << "data:" << line << std::endl;
-								std::vector<std::string> tokens = splitString(line, ' ');
-								int cnt = 0;
-								for (auto& token : tokens)
-							    {
-							      if (std::atoi(token.c_str())==0) {
-							      	//std::cout << "(EOF)" << "\n";
-							      } else {
-							      	//std::cout << token << "\n";
-							      	int lit = std::atoi(token.c_str());
-							      	cls[cls_cnt*MAX_LITS_SYSTEM+cnt] = lit;
-							      	clauseSizes[cls_cnt] = cnt+1;
-							      	numOccurrenceT[abs(lit)]++;
-							      	if (numOccurrenceT[abs(lit)]>maxNumOccurences) {maxNumOccurences=numOccurrenceT[abs(lit)];}
-							      	cnt++;
-							      	if (cnt > MAX_LITS_SYSTEM) {
-							            if (dynex_debugger) printf("c [%d] ERROR: CLAUSE %d HAS MORE THAN %d LITERALS.\n",chip_id,cnt,MAX_LITS_SYSTEM);
-							            return false;
-							        }
-							      }
-							    }
-							    cls_cnt++;
-							}
-							
-						}
-						if (!p_found) {
-							std::cout << log_time() << TEXT_CYAN << "[DYNEX CHIP "<<chip_id<<"] INPUT FILE HAS NO VALID FORMAT." << TEXT_DEFAULT << std::endl;
+						if (!parse_input_file(chip_id, s)) {
 							return false;
 						}
-
-						if (dynex_debugger) {
-							printf("c [%d] MAX VARIABLE OCCURENCE: %'d\n", chip_id, maxNumOccurences);
-							printf("c [%d] FIRST 10 CLAUSES:\n",chip_id);
-						    for (int i = 0; i < 10; i++) {
-						        printf("c [%d] CLAUSE %i: ",chip_id, i);
-						        for (int j = 0; j < clauseSizes[i]; j++) {printf(" %d",cls[i*MAX_LITS_SYSTEM+j]);}
-						        printf(" (%d)",clauseSizes[i]);
-						        printf("\n");
-						    }
-						    printf("c [%d] LAST 10 CLAUSES:\n",chip_id);
-						    for (int i = m-1; i > (m-10); i--) {
-						        printf("c [%d] CLAUSE %i: ",chip_id ,i);
-						        for (int j = 0; j < clauseSizes[i]; j++) {printf(" %d",cls[i*MAX_LITS_SYSTEM+j]);}
-						        printf(" (%d)",clauseSizes[i]);
-						        printf("\n");
-						    }
-						}
-					    
-						//build occurence array: [var][cls...] /////////////////////////////////////////
-					    occurrence = (int *) calloc((size_t) (n+1)*maxNumOccurences, sizeof(int));
-					    occurenceCounter = (int *) calloc((size_t) n+1, sizeof(int));
-					    
-					    for (int i=0; i<m; i++) {
-					        for (int j = 0; j < clauseSizes[i]; j++) {
-					            int lit = abs(cls[i*MAX_LITS_SYSTEM+j]);
-					            occurrence[lit*maxNumOccurences+occurenceCounter[lit]] = i;
-					            occurenceCounter[lit]++;
-					        }
-					    }
-					    //output:
-					    if (dynex_debugger) {
-					        printf("c [%d] OCCURENCES: ",chip_id);
-					        for (int i=1; i<=20; i++) printf("%d->%d ",i,occurenceCounter[i]);
-					        printf("\n");
-					    }
 				}
 			}
 			client.close();
@@ -1384,6 +1798,8 @@ namespace Dynex {
 			  public:
 			  	// dynex chip variables:
 			  	int 								dynex_chip_threads;
+			  	int 								dynex_dxdt_kernel = DXDT_KERNEL_CSR;
+			  	int 								dynex_dxdt_threads = 0; // per chip, 0 = cores / chips
 			  	uint64_t 							dynex_minute_rate;
 			  	bool 								dynex_chips_running = false; 
 			  	int 								dynex_chip_state = DYNEX_STATE_OFF; 
@@ -1416,7 +1832,7 @@ namespace Dynex {
 			    	// start chip threads:
 			    	for (size_t i=0; i<threads_count; i++) {
 			    		dynex_quit_flag = false;
-				    	std::thread observer_th(dynex_chip_thread_obj(), i, dynex_chip_threads, dynex_minute_rate, addr_str, std::ref(dynex_quit_flag));
+				    	std::thread observer_th(dynex_chip_thread_obj(), i, dynex_chip_threads, dynex_minute_rate, addr_str, dynex_dxdt_kernel, dynex_dxdt_threads, std::ref(dynex_quit_flag));
 				    	observer_th.detach();
 						assert(!observer_th.joinable());
 						std::this_thread::sleep_for(std::chrono::milliseconds(5000));
@@ -1466,5 +1882,60 @@ namespace Dynex {
 			    //bool worker_thread(uint32_t th_local_index);
 	  };
 
-}
+	  // offline solver run: --------------------------------------------------------------------------------------------
+	  bool run_benchmark(const benchmark_params& params, benchmark_result& result) {
+	  	auto to_param = [](double value) {
+	  		std::ostringstream ss;
+	  		ss << std::setprecision(17) << value;
+	  		return ss.str();
+	  	};
+
+	  	dynex_chip_thread_obj chip;
+	  	chip.offline = true;
+	  	chip.dxdt_kernel = params.kernel;
+	  	chip.dxdt_threads = std::max(1, params.threads);
+	  	chip.job_param_01 = to_param(params.alpha);
+	  	chip.job_param_02 = to_param(params.beta);
+	  	chip.job_param_03 = to_param(params.gamma);
+	  	chip.job_param_04 = to_param(params.delta);
+	  	chip.job_param_05 = to_param(params.epsilon);
+	  	chip.job_param_06 = to_param(params.zeta);
+	  	chip.job_max_simtime = "0";
+	  	chip.job_max_xl = std::to_string(params.xl_max);
+	  	chip.job_max_steps = std::to_string(params.max_steps);
+	  	chip.job_seed = std::to_string(params.seed);
+	  	chip.addr_string = "benchmark";
+	  	if (!chip.load_input_file(0, params.cnf_file)) {
+	  		return false;
+	  	}
+	  	chip.prepare_work(0);
+
+	  	dynex_chip_thread_obj::node node;
+	  	node.id = 0;
+	  	node.temporal = (int *) calloc((size_t) chip.n, sizeof(int));
+	  	node.model = (int *) calloc((size_t) chip.n, sizeof(int));
+	  	node.optimal = (int *) calloc((size_t) chip.n, sizeof(int));
+	  	std::atomic<bool> quit(false);
+	  	std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+	  	int solved = chip.dmm(&node, quit);
+	  	double walltime = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	  	result.variables = chip.n;
+	  	result.clauses = chip.m;
+	  	result.solved = solved == 1;
+	  	result.steps = chip.stepcounter[0];
+	  	result.walltime = walltime;
+	  	result.steps_per_second = (walltime > 0.0)? result.steps / walltime : 0.0;
+	  	result.time_to_solution = result.solved? walltime : -1.0;
+	  	result.best_loc = chip.global;
+	  	result.best_energy = chip.global_energy;
+	  	result.loc_trace = chip.loc_trace;
+
+	  	free(node.temporal);
+	  	free(node.model);
+	  	free(node.optimal);
+	  	chip.release_work();
+	  	return true;
+	  }
 
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2021-2022, The Dynex Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Dynex {
+
+// settings of an offline solver run, the defaults match a typical job
+struct benchmark_params {
+  std::string cnf_file;
+  double alpha = 5.0;
+  double beta = 20.0;
+  double gamma = 0.25;
+  double delta = 0.05;
+  double epsilon = 0.1;
+  double zeta = 0.1;
+  int xl_max = 10000;
+  int max_steps = 10000;
+  int seed = 1;
+  int kernel = 1;  // DXDT_KERNEL_CSR
+  int threads = 1; // dxdt threads
+};
+
+// a new lowest loc during the run
+struct benchmark_loc_point {
+  double walltime;
+  int steps;
+  int loc;
+  double energy;
+};
+
+struct benchmark_result {
+  int variables = 0;
+  int clauses = 0;
+  bool solved = false;
+  int steps = 0;
+  double walltime = 0.0;         // seconds spent in the integration
+  double steps_per_second = 0.0;
+  double time_to_solution = -1.0; // seconds, -1 if not solved
+  int best_loc = 0;
+  double best_energy = 0.0;
+  std::vector<benchmark_loc_point> loc_trace;
+};
+
+// Loads a local DIMACS cnf and runs the chip solver on it without network access.
+// Returns false if the file cannot be loaded.
+bool run_benchmark(const benchmark_params& params, benchmark_result& result);
+
+}
@@ -0,0 +1,214 @@
+// Copyright (c) 2021-2022, The Dynex Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Offline benchmark of the Dynex chip solver: runs local DIMACS cnf files with fixed seeds and
+// prints steps/s, time to solution, best loc over time and memory use as JSON.
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include <boost/program_options.hpp>
+
+#include "Common/BenchmarkReport.h"
+#include "Common/CommandLine.h"
+#include "Common/JsonValue.h"
+#include "Common/ScopeExit.h"
+#include "Dynexchip/DynexchipBenchmark.h"
+
+namespace po = boost::program_options;
+using Common::JsonValue;
+
+namespace {
+  const command_line::arg_descriptor<std::vector<std::string>> arg_cnf = {"cnf", "DIMACS cnf file, can be repeated or given as positional arguments"};
+  const command_line::arg_descriptor<int> arg_seed      = {"seed", "seed of the first run", 1};
+  const command_line::arg_descriptor<int> arg_runs      = {"runs", "runs per file, with seeds seed, seed+1, ...", 1};
+  const command_line::arg_descriptor<int> arg_max_steps = {"max-steps", "integration steps per run", 10000};
+  const command_line::arg_descriptor<std::string> arg_kernel = {"kernel", "dxdt kernel: reference, csr or compare", "csr"};
+  const command_line::arg_descriptor<int> arg_threads   = {"threads", "dxdt threads", 1};
+  const command_line::arg_descriptor<double> arg_alpha   = {"alpha", "job_param_01", 5.0};
+  const command_line::arg_descriptor<double> arg_beta    = {"beta", "job_param_02", 20.0};
+  const command_line::arg_descriptor<double> arg_gamma   = {"gamma", "job_param_03", 0.25};
+  const command_line::arg_descriptor<double> arg_delta   = {"delta", "job_param_04", 0.05};
+  const command_line::arg_descriptor<double> arg_epsilon = {"epsilon", "job_param_05", 0.1};
+  const command_line::arg_descriptor<double> arg_zeta    = {"zeta", "job_param_06", 0.1};
+  const command_line::arg_descriptor<int> arg_xl_max    = {"xl-max", "upper bound of the long term memory", 10000};
+
+  // peak resident set size of the process so far
+  int64_t peakRssKb() {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+      return 0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+  }
+
+  JsonValue toJson(const Dynex::benchmark_params& params, const Dynex::benchmark_result& result) {
+    JsonValue run(JsonValue::OBJECT);
+    run.insert("file", params.cnf_file);
+    run.insert("seed", static_cast<int64_t>(params.seed));
+    run.insert("variables", static_cast<int64_t>(result.variables));
+    run.insert("clauses", static_cast<int64_t>(result.clauses));
+    run.insert("solved", JsonValue(result.solved));
+    run.insert("steps", static_cast<int64_t>(result.steps));
+    run.insert("walltime", result.walltime);
+    run.insert("steps_per_second", result.steps_per_second);
+    run.insert("time_to_solution", result.solved ? JsonValue(result.time_to_solution) : JsonValue(nullptr));
+    run.insert("best_loc", static_cast<int64_t>(result.best_loc));
+    run.insert("best_energy", result.best_energy);
+
+    JsonValue trace(JsonValue::ARRAY);
+    for (const auto& point : result.loc_trace) {
+      JsonValue entry(JsonValue::OBJECT);
+      entry.insert("walltime", point.walltime);
+      entry.insert("steps", static_cast<int64_t>(point.steps));
+      entry.insert("loc", static_cast<int64_t>(point.loc));
+      entry.insert("energy", point.energy);
+      trace.pushBack(std::move(entry));
+    }
+    run.insert("loc_trace", std::move(trace));
+    run.insert("peak_rss_kb", peakRssKb());
+    return run;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  po::options_description desc_general("General options");
+  command_line::add_arg(desc_general, command_line::arg_help);
+
+  po::options_description desc_params("Benchmark options");
+  command_line::add_arg(desc_params, arg_cnf);
+  command_line::add_arg(desc_params, arg_seed);
+  command_line::add_arg(desc_params, arg_runs);
+  command_line::add_arg(desc_params, arg_max_steps);
+  command_line::add_arg(desc_params, arg_kernel);
+  command_line::add_arg(desc_params, arg_threads);
+  command_line::add_arg(desc_params, arg_alpha);
+  command_line::add_arg(desc_params, arg_beta);
+  command_line::add_arg(desc_params, arg_gamma);
+  command_line::add_arg(desc_params, arg_delta);
+  command_line::add_arg(desc_params, arg_epsilon);
+  command_line::add_arg(desc_params, arg_zeta);
+  command_line::add_arg(desc_params, arg_xl_max);
+  command_line::add_arg(desc_params, Common::arg_benchmark_output);
+
+  po::options_description desc_all;
+  desc_all.add(desc_general).add(desc_params);
+
+  po::positional_options_description positional;
+  positional.add(arg_cnf.name, -1);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_all, [&]() {
+    po::store(po::command_line_parser(argc, argv).options(desc_all).positional(positional).run(), vm);
+    if (command_line::get_arg(vm, command_line::arg_help)) {
+      std::cout << "Usage: dynexchip_bench [options] file.cnf..." << std::endl << desc_all << std::endl;
+      return false;
+    }
+
+    po::notify(vm);
+    return true;
+  });
+
+  if (!r) {
+    return 1;
+  }
+
+  std::vector<std::string> files = command_line::get_arg(vm, arg_cnf);
+  if (files.empty()) {
+    std::cerr << "No cnf files given" << std::endl;
+    return 1;
+  }
+
+  Dynex::benchmark_params params;
+  std::string kernel = command_line::get_arg(vm, arg_kernel);
+  if (kernel == "reference") {
+    params.kernel = 0;
+  } else if (kernel == "csr") {
+    params.kernel = 1;
+  } else if (kernel == "compare") {
+    params.kernel = 2;
+  } else {
+    std::cerr << "Unknown kernel: " << kernel << std::endl;
+    return 1;
+  }
+
+  params.alpha = command_line::get_arg(vm, arg_alpha);
+  params.beta = command_line::get_arg(vm, arg_beta);
+  params.gamma = command_line::get_arg(vm, arg_gamma);
+  params.delta = command_line::get_arg(vm, arg_delta);
+  params.epsilon = command_line::get_arg(vm, arg_epsilon);
+  params.zeta = command_line::get_arg(vm, arg_zeta);
+  params.xl_max = command_line::get_arg(vm, arg_xl_max);
+  params.max_steps = command_line::get_arg(vm, arg_max_steps);
+  params.threads = command_line::get_arg(vm, arg_threads);
+
+  return Common::runBenchmark(vm, [&] {
+    JsonValue report(JsonValue::OBJECT);
+    report.insert("kernel", kernel);
+    report.insert("threads", static_cast<int64_t>(params.threads));
+    report.insert("max_steps", static_cast<int64_t>(params.max_steps));
+    JsonValue runs(JsonValue::ARRAY);
+
+    // the chip reports its progress on std::cout, keep stdout for the report
+    std::streambuf* coutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+    Tools::ScopeExit restoreCout([&] { std::cout.rdbuf(coutBuffer); });
+
+    int seed = command_line::get_arg(vm, arg_seed);
+    int runCount = command_line::get_arg(vm, arg_runs);
+    for (const auto& file : files) {
+      for (int run = 0; run < runCount; ++run) {
+        params.cnf_file = file;
+        params.seed = seed + run;
+
+        Dynex::benchmark_result result;
+        if (!Dynex::run_benchmark(params, result)) {
+          throw std::runtime_error("Failed to load " + file);
+        }
+
+        runs.pushBack(toJson(params, result));
+      }
+    }
+
+    report.insert("runs", std::move(runs));
+    return report;
+  });
+}
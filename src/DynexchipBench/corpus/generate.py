@@ -0,0 +1,29 @@
+#!/usr/bin/env python3
+# Regenerates the benchmark corpus: python3 generate.py (output is deterministic)
+
+import os
+import random
+
+os.chdir(os.path.dirname(os.path.abspath(__file__)))
+
+def gen(name, n, m, ks, seed):
+    rnd = random.Random(seed)
+    sol = [rnd.random() < 0.5 for _ in range(n + 1)]
+    cls = []
+    while len(cls) < m:
+        k = rnd.choice(ks)
+        vs = rnd.sample(range(1, n + 1), k)
+        c = [v if rnd.random() < 0.5 else -v for v in vs]
+        if any((l > 0) == sol[abs(l)] for l in c):
+            cls.append(c)
+    with open(name, 'w') as f:
+        f.write("c %s: planted-solution random %s-SAT, satisfiable by construction\n" % (name, "/".join(map(str, ks))))
+        f.write("c n=%d m=%d generator seed=%d\n" % (n, m, seed))
+        f.write("p cnf %d %d\n" % (n, m))
+        for c in cls:
+            f.write(" ".join(map(str, c)) + " 0\n")
+gen("3sat_n100_r4.2.cnf", 100, 420, [3], 100)
+gen("3sat_n500_r4.2.cnf", 500, 2100, [3], 500)
+gen("3sat_n2000_r4.0.cnf", 2000, 8000, [3], 2000)
+gen("5sat_n200_r20.cnf", 200, 4000, [5], 200)
+gen("mixed_n300_k2-6.cnf", 300, 1500, [2, 3, 4, 5, 6], 300)
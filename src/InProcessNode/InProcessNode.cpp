@@ -263,6 +263,57 @@ std::error_code InProcessNode::doGetTransactionOutsGlobalIndices(const Crypto::H
   return std::error_code();
 }
 
+void InProcessNode::getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices,
+    const Callback& callback)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  if (state != INITIALIZED) {
+    lock.unlock();
+    callback(make_error_code(DynexCN::error::NOT_INITIALIZED));
+    return;
+  }
+
+  ioService.post(
+    std::bind(&InProcessNode::getTransactionsOutsGlobalIndicesAsync,
+      this,
+      std::cref(transactionHashes),
+      std::ref(outsGlobalIndices),
+      callback
+    )
+  );
+}
+
+void InProcessNode::getTransactionsOutsGlobalIndicesAsync(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices,
+    const Callback& callback)
+{
+  std::error_code ec = doGetTransactionsOutsGlobalIndices(transactionHashes, outsGlobalIndices);
+  callback(ec);
+}
+
+std::error_code InProcessNode::doGetTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices) {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (state != INITIALIZED) {
+      return make_error_code(DynexCN::error::NOT_INITIALIZED);
+    }
+  }
+
+  try {
+    outsGlobalIndices.resize(transactionHashes.size());
+    for (size_t i = 0; i < transactionHashes.size(); ++i) {
+      if (!core.get_tx_outputs_gindexs(transactionHashes[i], outsGlobalIndices[i])) {
+        return make_error_code(DynexCN::error::REQUEST_ERROR);
+      }
+    }
+  } catch (std::system_error& e) {
+    return e.code();
+  } catch (std::exception&) {
+    return make_error_code(DynexCN::error::INTERNAL_NODE_ERROR);
+  }
+
+  return std::error_code();
+}
+
 void InProcessNode::getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount,
     std::vector<DynexCN::COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback)
 {
@@ -803,11 +854,17 @@ void InProcessNode::getBlocksAsync(const std::vector<Crypto::Hash>& blockHashes,
 
 std::error_code InProcessNode::doGetBlocks(const std::vector<Crypto::Hash>& blockHashes, std::vector<BlockDetails>& blocks) {
   try {
+    std::vector<Block> rawBlocks;
     for (const Crypto::Hash& hash : blockHashes) {
       Block block;
       if (!core.getBlockByHash(hash, block)) {
         return make_error_code(DynexCN::error::REQUEST_ERROR);
       }
+      rawBlocks.push_back(std::move(block));
+    }
+
+    core.precomputeProofOfWork(rawBlocks);
+    for (const Block& block : rawBlocks) {
       BlockDetails blockDetails;
       if (!blockchainExplorerDataBuilder.fillBlockDetails(block, blockDetails)) {
         return make_error_code(DynexCN::error::INTERNAL_NODE_ERROR);
@@ -38,7 +38,9 @@
 #include "NodeRpcProxy.h"
 #include "NodeErrors.h"
 
+#include <algorithm>
 #include <atomic>
+#include <memory>
 #include <system_error>
 #include <thread>
 
@@ -47,7 +49,7 @@
 #include <System/ContextGroup.h>
 #include <System/Dispatcher.h>
 #include <System/Event.h>
-#include <System/EventLock.h>
+#include <System/InterruptedException.h>
 #include <System/Timer.h>
 #include <DynexCNCore/TransactionApi.h>
 
@@ -70,6 +72,49 @@ namespace DynexCN {
 
 namespace {
 
+const size_t DEFAULT_CONNECTION_COUNT = 4;
+const uint64_t MIN_PULL_INTERVAL = 1000;
+const uint64_t MAX_PULL_INTERVAL = 5000;
+
+// Interrupts the calling context if a request is still in flight when the timeout expires.
+class RequestTimeout {
+public:
+  RequestTimeout(Dispatcher& dispatcher, unsigned int timeout) : m_dispatcher(dispatcher), m_timerGroup(dispatcher), m_timer(dispatcher), m_expired(false) {
+    if (timeout == 0) {
+      return;
+    }
+
+    NativeContext* context = dispatcher.getCurrentContext();
+    m_timerGroup.spawn([this, context, timeout] {
+      try {
+        m_timer.sleep(std::chrono::milliseconds(timeout));
+        m_expired = true;
+        m_dispatcher.interrupt(context);
+      } catch (InterruptedException&) {
+      }
+    });
+  }
+
+  ~RequestTimeout() {
+    m_timerGroup.interrupt();
+    m_timerGroup.wait();
+    if (m_expired) {
+      // the request may have completed just before the timer fired, drop the pending interrupt
+      m_dispatcher.interrupted();
+    }
+  }
+
+  bool expired() const {
+    return m_expired;
+  }
+
+private:
+  Dispatcher& m_dispatcher;
+  ContextGroup m_timerGroup;
+  Timer m_timer;
+  bool m_expired;
+};
+
 std::error_code interpretResponseStatus(const std::string& status) {
   if (CORE_RPC_STATUS_BUSY == status) {
     return make_error_code(error::NODE_BUSY);
@@ -83,7 +128,8 @@ std::error_code interpretResponseStatus(const std::string& status) {
 
 NodeRpcProxy::NodeRpcProxy(const std::string& nodeHost, unsigned short nodePort) :
     m_rpcTimeout(10000),
-    m_pullInterval(5000),
+    m_connectionCount(DEFAULT_CONNECTION_COUNT),
+    m_pullInterval(MIN_PULL_INTERVAL),
     m_nodeHost(nodeHost),
     m_nodePort(nodePort),
     m_connected(true),
@@ -151,6 +197,7 @@ bool NodeRpcProxy::shutdown() {
 
   m_dispatcher->remoteSpawn([this]() {
     m_stop = true;
+    wakeStatusPull();
     // Run all spawned contexts
     m_dispatcher->yield();
   });
@@ -167,13 +214,19 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
   try {
     Dispatcher dispatcher;
     m_dispatcher = &dispatcher;
+    std::vector<std::unique_ptr<HttpClient>> httpClients;
+    m_idleClients.clear();
+    for (size_t i = 0; i < std::max<size_t>(m_connectionCount, 1); ++i) {
+      httpClients.emplace_back(new HttpClient(dispatcher, m_nodeHost, m_nodePort));
+      m_idleClients.push_back(httpClients.back().get());
+    }
+
+    Event clientReleased(dispatcher);
+    m_clientReleased = &clientReleased;
     ContextGroup contextGroup(dispatcher);
     m_context_group = &contextGroup;
-    HttpClient httpClient(dispatcher, m_nodeHost, m_nodePort);
-    m_httpClient = &httpClient;
-    Event httpEvent(dispatcher);
-    m_httpEvent = &httpEvent;
-    m_httpEvent->set();
+    ContextGroup pullContextGroup(dispatcher);
+    m_pullContextGroup = &pullContextGroup;
 
     {
       std::lock_guard<std::mutex> lock(m_mutex);
@@ -186,16 +239,31 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 
     initialized_callback(std::error_code());
 
-    contextGroup.spawn([this]() {
+    pullContextGroup.spawn([this]() {
       Timer pullTimer(*m_dispatcher);
       while (!m_stop) {
-        updateNodeStatus();
+        bool changed = updateNodeStatus();
+        if (changed || m_networkHeight.load(std::memory_order_relaxed) > lastLocalBlockHeaderInfo.index) {
+          m_pullInterval = MIN_PULL_INTERVAL;
+        } else {
+          m_pullInterval = std::min(m_pullInterval * 2, MAX_PULL_INTERVAL);
+        }
+
         if (!m_stop) {
-          pullTimer.sleep(std::chrono::milliseconds(m_pullInterval));
+          m_pullSleeping = true;
+          try {
+            pullTimer.sleep(std::chrono::milliseconds(m_pullInterval));
+          } catch (InterruptedException&) {
+          }
+
+          m_pullSleeping = false;
+          // a wake-up that raced with the timer must not interrupt the next request
+          m_dispatcher->interrupted();
         }
       }
     });
 
+    pullContextGroup.wait();
     contextGroup.wait();
     // Make sure all remote spawns are executed
     m_dispatcher->yield();
@@ -204,21 +272,39 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 
   m_dispatcher = nullptr;
   m_context_group = nullptr;
-  m_httpClient = nullptr;
-  m_httpEvent = nullptr;
+  m_pullContextGroup = nullptr;
+  m_clientReleased = nullptr;
+  m_idleClients.clear();
   m_connected = false;
   m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
 }
 
-void NodeRpcProxy::updateNodeStatus() {
+bool NodeRpcProxy::updateNodeStatus() {
+  bool changed = false;
   bool updateBlockchain = true;
   while (updateBlockchain) {
-    updateBlockchainStatus();
-    updateBlockchain = !updatePoolStatus();
+    changed |= updateBlockchainStatus();
+    updateBlockchain = !updatePoolStatus(changed);
+  }
+
+  return changed;
+}
+
+void NodeRpcProxy::wakeStatusPull() {
+  m_pullInterval = MIN_PULL_INTERVAL;
+  if (m_pullSleeping && m_pullContextGroup != nullptr) {
+    m_pullContextGroup->interrupt();
+  }
+}
+
+void NodeRpcProxy::updateConnectionStatus(bool connected) {
+  if (m_connected != connected) {
+    m_connected = connected;
+    m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
   }
 }
 
-bool NodeRpcProxy::updatePoolStatus() {
+bool NodeRpcProxy::updatePoolStatus(bool& poolChanged) {
   std::vector<Crypto::Hash> knownTxs = getKnownTxsVector();
   Crypto::Hash tailBlock = lastLocalBlockHeaderInfo.hash;
 
@@ -237,13 +323,15 @@ bool NodeRpcProxy::updatePoolStatus() {
 
   if (!addedTxs.empty() || !deletedTxsIds.empty()) {
     updatePoolState(addedTxs, deletedTxsIds);
+    poolChanged = true;
     m_observerManager.notify(&INodeObserver::poolChanged);
   }
 
   return true;
 }
 
-void NodeRpcProxy::updateBlockchainStatus() {
+bool NodeRpcProxy::updateBlockchainStatus() {
+  bool changed = false;
   DynexCN::COMMAND_RPC_GET_LAST_BLOCK_HEADER::request req = AUTO_VAL_INIT(req);
   DynexCN::COMMAND_RPC_GET_LAST_BLOCK_HEADER::response rsp = AUTO_VAL_INIT(rsp);
 
@@ -253,7 +341,7 @@ void NodeRpcProxy::updateBlockchainStatus() {
     Crypto::Hash blockHash;
     Crypto::Hash prevBlockHash;
     if (!parse_hash256(rsp.block_header.hash, blockHash) || !parse_hash256(rsp.block_header.prev_hash, prevBlockHash)) {
-      return;
+      return false;
     }
 
     std::unique_lock<std::mutex> lock(m_mutex);
@@ -271,6 +359,7 @@ void NodeRpcProxy::updateBlockchainStatus() {
       lastLocalBlockHeaderInfo.difficulty = rsp.block_header.difficulty;
       lastLocalBlockHeaderInfo.reward = rsp.block_header.reward;
       lock.unlock();
+      changed = true;
       m_observerManager.notify(&INodeObserver::localBlockchainUpdated, blockIndex);
     }
   }
@@ -287,6 +376,7 @@ void NodeRpcProxy::updateBlockchainStatus() {
     lock.unlock();
     if (m_networkHeight.load(std::memory_order_relaxed) != lastKnownBlockIndex) {
       m_networkHeight.store(lastKnownBlockIndex, std::memory_order_relaxed);
+      changed = true;
       m_observerManager.notify(&INodeObserver::lastKnownBlockHeightUpdated, m_networkHeight.load(std::memory_order_relaxed));
     }
 
@@ -296,10 +386,7 @@ void NodeRpcProxy::updateBlockchainStatus() {
 	m_nodeHeight.store(getInfoResp.height, std::memory_order_relaxed);
   }
 
-  if (m_connected != m_httpClient->isConnected()) {
-    m_connected = m_httpClient->isConnected();
-    m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
-  }
+  return changed;
 }
 
 void NodeRpcProxy::updatePeerCount(size_t peerCount) {
@@ -447,6 +534,18 @@ void NodeRpcProxy::getTransactionOutsGlobalIndices(const Crypto::Hash& transacti
     std::ref(outsGlobalIndices)), callback);
 }
 
+void NodeRpcProxy::getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+                                                    std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_state != STATE_INITIALIZED) {
+    callback(make_error_code(error::NOT_INITIALIZED));
+    return;
+  }
+
+  scheduleRequest(std::bind(&NodeRpcProxy::doGetTransactionsOutsGlobalIndices, this, transactionHashes,
+    std::ref(outsGlobalIndices)), callback);
+}
+
 void NodeRpcProxy::queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks,
   uint32_t& startHeight, const Callback& callback) {
   std::lock_guard<std::mutex> lock(m_mutex);
@@ -570,7 +669,13 @@ std::error_code NodeRpcProxy::doRelayTransaction(const DynexCN::Transaction& tra
   COMMAND_RPC_SEND_RAW_TX::request req;
   COMMAND_RPC_SEND_RAW_TX::response rsp;
   req.tx_as_hex = toHex(toBinaryArray(transaction));
-  return jsonCommand("/sendrawtransaction", req, rsp);
+  std::error_code ec = jsonCommand("/sendrawtransaction", req, rsp);
+  if (!ec) {
+    // pick up the relayed transaction from the pool without waiting for the next pull
+    wakeStatusPull();
+  }
+
+  return ec;
 }
 
 std::error_code NodeRpcProxy::doGetRandomOutsByAmounts(std::vector<uint64_t>& amounts, uint64_t outsCount,
@@ -621,6 +726,41 @@ std::error_code NodeRpcProxy::doGetTransactionOutsGlobalIndices(const Crypto::Ha
   return ec;
 }
 
+std::error_code NodeRpcProxy::doGetTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+                                                                 std::vector<std::vector<uint32_t>>& outsGlobalIndices) {
+  outsGlobalIndices.clear();
+  outsGlobalIndices.reserve(transactionHashes.size());
+
+  auto it = transactionHashes.begin();
+  while (it != transactionHashes.end()) {
+    size_t count = static_cast<size_t>(transactionHashes.end() - it);
+    if (count > COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::MAX_TRANSACTIONS) {
+      count = COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::MAX_TRANSACTIONS;
+    }
+
+    DynexCN::COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::request req = AUTO_VAL_INIT(req);
+    DynexCN::COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::response rsp = AUTO_VAL_INIT(rsp);
+    req.txids.assign(it, it + count);
+
+    std::error_code ec = binaryCommand("/get_txs_o_indexes.bin", req, rsp);
+    if (ec) {
+      return ec;
+    }
+
+    if (rsp.txs.size() != count) {
+      return make_error_code(error::INTERNAL_NODE_ERROR);
+    }
+
+    for (const auto& tx : rsp.txs) {
+      outsGlobalIndices.emplace_back(tx.o_indexes.begin(), tx.o_indexes.end());
+    }
+
+    it += count;
+  }
+
+  return std::error_code();
+}
+
 std::error_code NodeRpcProxy::doQueryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
         std::vector<DynexCN::BlockShortEntry>& newBlocks, uint32_t& startHeight) {
   DynexCN::COMMAND_RPC_QUERY_BLOCKS_LITE::request req = AUTO_VAL_INIT(req);
@@ -793,57 +933,80 @@ void NodeRpcProxy::scheduleRequest(std::function<std::error_code()>&& procedure,
           callback(std::make_error_code(std::errc::operation_canceled));
         } else {
           std::error_code ec = procedure();
-          if (m_connected != m_httpClient->isConnected()) {
-            m_connected = m_httpClient->isConnected();
-            m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
-          }
           callback(m_stop ? std::make_error_code(std::errc::operation_canceled) : ec);
         }
       }, std::move(procedure), std::move(callback)));
     }, std::move(procedure), callback));
 }
 
-template <typename Request, typename Response>
-std::error_code NodeRpcProxy::binaryCommand(const std::string& url, const Request& req, Response& res) {
-  std::error_code ec;
-
-  try {
-    EventLock eventLock(*m_httpEvent);
-    invokeBinaryCommand(*m_httpClient, url, req, res);
-    ec = interpretResponseStatus(res.status);
-  } catch (const ConnectException&) {
-    ec = make_error_code(error::CONNECT_ERROR);
-  } catch (const std::exception&) {
-    ec = make_error_code(error::NETWORK_ERROR);
+HttpClient& NodeRpcProxy::acquireClient() {
+  while (m_idleClients.empty()) {
+    m_clientReleased->clear();
+    m_clientReleased->wait();
   }
 
-  return ec;
+  HttpClient* client = m_idleClients.back();
+  m_idleClients.pop_back();
+  return *client;
 }
 
-template <typename Request, typename Response>
-std::error_code NodeRpcProxy::jsonCommand(const std::string& url, const Request& req, Response& res) {
+void NodeRpcProxy::releaseClient(HttpClient& client) {
+  m_idleClients.push_back(&client);
+  m_clientReleased->set();
+}
+
+template <typename Command>
+std::error_code NodeRpcProxy::invokeCommand(Command&& command) {
   std::error_code ec;
+  HttpClient* client = nullptr;
+
+  {
+    // the timeout covers the wait for an idle connection as well as the request itself
+    RequestTimeout timeout(*m_dispatcher, m_rpcTimeout);
+    try {
+      client = &acquireClient();
+      ec = command(*client);
+    } catch (const InterruptedException&) {
+      ec = std::make_error_code(std::errc::operation_canceled);
+    } catch (const ConnectException&) {
+      ec = make_error_code(error::CONNECT_ERROR);
+    } catch (const std::exception&) {
+      ec = make_error_code(error::NETWORK_ERROR);
+    }
 
-  try {
-    EventLock eventLock(*m_httpEvent);
-    invokeJsonCommand(*m_httpClient, url, req, res);
-    ec = interpretResponseStatus(res.status);
-  } catch (const ConnectException&) {
-    ec = make_error_code(error::CONNECT_ERROR);
-  } catch (const std::exception&) {
-    ec = make_error_code(error::NETWORK_ERROR);
+    if (ec && timeout.expired()) {
+      ec = make_error_code(error::TIMEOUT);
+    }
+  }
+
+  if (client != nullptr) {
+    bool connected = client->isConnected();
+    releaseClient(*client);
+    updateConnectionStatus(connected);
   }
 
   return ec;
 }
 
 template <typename Request, typename Response>
-std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Request& req, Response& res) {
-  std::error_code ec = make_error_code(error::INTERNAL_NODE_ERROR);
+std::error_code NodeRpcProxy::binaryCommand(const std::string& url, const Request& req, Response& res) {
+  return invokeCommand([&](HttpClient& client) {
+    invokeBinaryCommand(client, url, req, res);
+    return interpretResponseStatus(res.status);
+  });
+}
 
-  try {
-    EventLock eventLock(*m_httpEvent);
+template <typename Request, typename Response>
+std::error_code NodeRpcProxy::jsonCommand(const std::string& url, const Request& req, Response& res) {
+  return invokeCommand([&](HttpClient& client) {
+    invokeJsonCommand(client, url, req, res);
+    return interpretResponseStatus(res.status);
+  });
+}
 
+template <typename Request, typename Response>
+std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Request& req, Response& res) {
+  return invokeCommand([&](HttpClient& client) {
     JsonRpc::JsonRpcRequest jsReq;
 
     jsReq.setMethod(method);
@@ -856,23 +1019,19 @@ std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Re
     httpReq.setUrl("/json_rpc");
     httpReq.setBody(jsReq.getBody());
 
-    m_httpClient->request(httpReq, httpRes);
+    client.request(httpReq, httpRes);
 
     JsonRpc::JsonRpcResponse jsRes;
 
     if (httpRes.getStatus() == HttpResponse::STATUS_200) {
       jsRes.parse(httpRes.getBody());
       if (jsRes.getResult(res)) {
-        ec = interpretResponseStatus(res.status);
+        return interpretResponseStatus(res.status);
       }
     }
-  } catch (const ConnectException&) {
-    ec = make_error_code(error::CONNECT_ERROR);
-  } catch (const std::exception&) {
-    ec = make_error_code(error::NETWORK_ERROR);
-  }
 
-  return ec;
+    return make_error_code(error::INTERNAL_NODE_ERROR);
+  });
 }
 
 }
@@ -43,6 +43,7 @@
 #include <string>
 #include <thread>
 #include <unordered_set>
+#include <vector>
 
 #include "../DynexCNConfig.h"
 #include "Common/ObserverManager.h"
@@ -94,6 +95,7 @@ public:
   virtual void getRandomOutsByAmounts(std::vector<uint64_t>&& amounts, uint64_t outsCount, std::vector<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount>& result, const Callback& callback) override;
   virtual void getNewBlocks(std::vector<Crypto::Hash>&& knownBlockIds, std::vector<DynexCN::block_complete_entry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
   virtual void getTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices, const Callback& callback) override;
+  virtual void getTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices, const Callback& callback) override;
   virtual void queryBlocks(std::vector<Crypto::Hash>&& knownBlockIds, uint64_t timestamp, std::vector<BlockShortEntry>& newBlocks, uint32_t& startHeight, const Callback& callback) override;
   virtual void getPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
           std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds, const Callback& callback) override;
@@ -112,6 +114,10 @@ public:
   unsigned int rpcTimeout() const { return m_rpcTimeout; }
   void rpcTimeout(unsigned int val) { m_rpcTimeout = val; }
 
+  // number of keep-alive connections to the daemon, takes effect with the next init()
+  size_t connectionCount() const { return m_connectionCount; }
+  void connectionCount(size_t val) { m_connectionCount = val; }
+
   const std::string m_nodeHost;
   const unsigned short m_nodePort;
 
@@ -120,10 +126,11 @@ private:
   void workerThread(const Callback& initialized_callback);
 
   std::vector<Crypto::Hash> getKnownTxsVector() const;
-  void pullNodeStatusAndScheduleTheNext();
-  void updateNodeStatus();
-  void updateBlockchainStatus();
-  bool updatePoolStatus();
+  bool updateNodeStatus();
+  bool updateBlockchainStatus();
+  bool updatePoolStatus(bool& poolChanged);
+  void wakeStatusPull();
+  void updateConnectionStatus(bool connected);
   void updatePeerCount(size_t peerCount);
   void updatePoolState(const std::vector<std::unique_ptr<ITransactionReader>>& addedTxs, const std::vector<Crypto::Hash>& deletedTxsIds);
 
@@ -134,6 +141,8 @@ private:
     std::vector<DynexCN::block_complete_entry>& newBlocks, uint32_t& startHeight);
   std::error_code doGetTransactionOutsGlobalIndices(const Crypto::Hash& transactionHash,
                                                     std::vector<uint32_t>& outsGlobalIndices);
+  std::error_code doGetTransactionsOutsGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes,
+                                                     std::vector<std::vector<uint32_t>>& outsGlobalIndices);
   std::error_code doQueryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
     std::vector<DynexCN::BlockShortEntry>& newBlocks, uint32_t& startHeight);
   std::error_code doGetPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
@@ -145,6 +154,10 @@ private:
   std::error_code doGetTransactions(const std::vector<Crypto::Hash>& transactionHashes, std::vector<TransactionDetails>& transactions);
 
   void scheduleRequest(std::function<std::error_code()>&& procedure, const Callback& callback);
+  HttpClient& acquireClient();
+  void releaseClient(HttpClient& client);
+  template <typename Command>
+  std::error_code invokeCommand(Command&& command);
   template <typename Request, typename Response>
   std::error_code binaryCommand(const std::string& url, const Request& req, Response& res);
   template <typename Request, typename Response>
@@ -169,9 +182,13 @@ private:
   Tools::ObserverManager<DynexCN::INodeRpcProxyObserver> m_rpcProxyObserverManager;
 
   unsigned int m_rpcTimeout;
-  HttpClient* m_httpClient = nullptr;
-  System::Event* m_httpEvent = nullptr;
+  size_t m_connectionCount;
+  std::vector<HttpClient*> m_idleClients;
+  System::Event* m_clientReleased = nullptr;
 
+  // status is pulled more often right after a change and while the daemon catches up
+  System::ContextGroup* m_pullContextGroup = nullptr;
+  bool m_pullSleeping = false;
   uint64_t m_pullInterval;
 
   // Internal state
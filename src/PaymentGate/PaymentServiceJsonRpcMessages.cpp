@@ -90,6 +90,7 @@ void GetStatus::Response::serialize(DynexCN::ISerializer& serializer) {
   serializer(lastBlockHash, "lastBlockHash");
   serializer(peerCount, "peerCount");
   serializer(minimalFee, "minimalFee");
+  serializer(syncSpeed, "syncSpeed");
   serializer(version, "version");
 }
 
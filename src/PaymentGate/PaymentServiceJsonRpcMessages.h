@@ -125,6 +125,7 @@ struct GetStatus {
     std::string lastBlockHash;
     uint32_t peerCount;
     uint64_t minimalFee;
+    double syncSpeed;
     std::string version;
 
     void serialize(DynexCN::ISerializer& serializer);
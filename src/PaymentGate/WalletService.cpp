@@ -1381,7 +1381,7 @@ std::error_code WalletService::getUnconfirmedTransactionHashes(const std::vector
   return std::error_code();
 }
 
-std::error_code WalletService::getStatus(uint32_t& blockCount, uint32_t& knownBlockCount, uint32_t& localDaemonBlockCount, std::string& lastBlockHash, uint32_t& peerCount, uint64_t& minimalFee) {
+std::error_code WalletService::getStatus(uint32_t& blockCount, uint32_t& knownBlockCount, uint32_t& localDaemonBlockCount, std::string& lastBlockHash, uint32_t& peerCount, uint64_t& minimalFee, double& syncSpeed) {
   try {
     System::EventLock lk(readyEvent);
 
@@ -1390,6 +1390,7 @@ std::error_code WalletService::getStatus(uint32_t& blockCount, uint32_t& knownBl
     blockCount = wallet.getBlockCount();
 	localDaemonBlockCount = node.getLocalBlockCount();
 	minimalFee = node.getMinimalFee();
+    syncSpeed = wallet.getSyncSpeed();
 
     auto lastHashes = wallet.getBlockHashes(blockCount - 1, 1);
     lastBlockHash = Common::podToHex(lastHashes.back());
@@ -1581,26 +1582,53 @@ std::vector<DynexCN::TransactionsInBlockInfo> WalletService::getTransactions(uin
   return result;
 }
 
+std::vector<DynexCN::TransactionsInBlockInfo> WalletService::getTransactions(const Crypto::Hash& blockHash, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
+  if (!filter.havePaymentId) {
+    return getTransactions(blockHash, blockCount);
+  }
+
+  // the wallet indexes transactions by payment id, only the matching ones are returned
+  std::vector<DynexCN::TransactionsInBlockInfo> result = wallet.getTransactionsByPaymentId(filter.paymentId, blockHash, blockCount);
+  if (result.empty() && wallet.getTransactions(blockHash, 1).empty()) {
+    throw std::system_error(make_error_code(DynexCN::error::WalletServiceErrorCode::OBJECT_NOT_FOUND));
+  }
+
+  return result;
+}
+
+std::vector<DynexCN::TransactionsInBlockInfo> WalletService::getTransactions(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
+  if (!filter.havePaymentId) {
+    return getTransactions(firstBlockIndex, blockCount);
+  }
+
+  std::vector<DynexCN::TransactionsInBlockInfo> result = wallet.getTransactionsByPaymentId(filter.paymentId, firstBlockIndex, blockCount);
+  if (result.empty() && firstBlockIndex >= wallet.getBlockCount()) {
+    throw std::system_error(make_error_code(DynexCN::error::WalletServiceErrorCode::OBJECT_NOT_FOUND));
+  }
+
+  return result;
+}
+
 std::vector<TransactionHashesInBlockRpcInfo> WalletService::getRpcTransactionHashes(const Crypto::Hash& blockHash, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
-  std::vector<DynexCN::TransactionsInBlockInfo> allTransactions = getTransactions(blockHash, blockCount);
+  std::vector<DynexCN::TransactionsInBlockInfo> allTransactions = getTransactions(blockHash, blockCount, filter);
   std::vector<DynexCN::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
   return convertTransactionsInBlockInfoToTransactionHashesInBlockRpcInfo(filteredTransactions);
 }
 
 std::vector<TransactionHashesInBlockRpcInfo> WalletService::getRpcTransactionHashes(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
-  std::vector<DynexCN::TransactionsInBlockInfo> allTransactions = getTransactions(firstBlockIndex, blockCount);
+  std::vector<DynexCN::TransactionsInBlockInfo> allTransactions = getTransactions(firstBlockIndex, blockCount, filter);
   std::vector<DynexCN::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
   return convertTransactionsInBlockInfoToTransactionHashesInBlockRpcInfo(filteredTransactions);
 }
 
 std::vector<TransactionsInBlockRpcInfo> WalletService::getRpcTransactions(const Crypto::Hash& blockHash, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
-  std::vector<DynexCN::TransactionsInBlockInfo> allTransactions = getTransactions(blockHash, blockCount);
+  std::vector<DynexCN::TransactionsInBlockInfo> allTransactions = getTransactions(blockHash, blockCount, filter);
   std::vector<DynexCN::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
   return convertTransactionsInBlockInfoToTransactionsInBlockRpcInfo(filteredTransactions);
 }
 
 std::vector<TransactionsInBlockRpcInfo> WalletService::getRpcTransactions(uint32_t firstBlockIndex, size_t blockCount, const TransactionsInBlockInfoFilter& filter) const {
-  std::vector<DynexCN::TransactionsInBlockInfo> allTransactions = getTransactions(firstBlockIndex, blockCount);
+  std::vector<DynexCN::TransactionsInBlockInfo> allTransactions = getTransactions(firstBlockIndex, blockCount, filter);
   std::vector<DynexCN::TransactionsInBlockInfo> filteredTransactions = filterTransactions(allTransactions, filter);
   return convertTransactionsInBlockInfoToTransactionsInBlockRpcInfo(filteredTransactions);
 }
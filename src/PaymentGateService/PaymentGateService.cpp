@@ -279,6 +279,7 @@ void PaymentGateService::runWalletService(const DynexCN::Currency& currency, Dyn
   };
 
   std::unique_ptr<DynexCN::WalletGreen> wallet(new DynexCN::WalletGreen(*dispatcher, currency, node, logger));
+  wallet->setSyncThreads(config.gateConfiguration.syncThreads);
 
   service = new PaymentService::WalletService(currency, *dispatcher, node, *wallet, *wallet, walletConfiguration, logger);
   std::unique_ptr<PaymentService::WalletService> serviceGuard(service);
@@ -65,6 +65,7 @@ Configuration::Configuration() {
   secretViewKey = "";
   secretSpendKey = "";
   mnemonicSeed = "";
+  syncThreads = 0;
 }
 
 void Configuration::initOptions(boost::program_options::options_description& desc) {
@@ -88,6 +89,7 @@ void Configuration::initOptions(boost::program_options::options_description& des
       ("log-file,l", po::value<std::string>(), "log file")
       ("server-root", po::value<std::string>(), "server root. The service will use it as working directory. Don't set it if don't want to change it")
       ("log-level", po::value<size_t>(), "log level")
+      ("sync-threads", po::value<size_t>(), "threads scanning new blocks for wallet outputs, 0 for all cores")
       ("address", "print wallet addresses and exit");
 }
 
@@ -125,6 +127,10 @@ void Configuration::init(const boost::program_options::variables_map& options) {
     }
   }
 
+  if (options.count("sync-threads") != 0) {
+    syncThreads = options["sync-threads"].as<size_t>();
+  }
+
   if (options.count("server-root") != 0) {
     serverRoot = options["server-root"].as<std::string>();
   }
@@ -84,6 +84,7 @@ struct Configuration {
   bool printAddresses;
 
   size_t logLevel;
+  size_t syncThreads;
 };
 
 } //namespace PaymentService
@@ -17,6 +17,7 @@
 // along with Bytecoin.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdint.h>
+#include <algorithm>
 #include <stdexcept> 
 #include "Dispatcher.h"
 #include <pthread.h>
@@ -24,6 +25,7 @@
 
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <sys/timerfd.h>
 #include <fcntl.h>
 #include <string.h>
@@ -59,8 +61,32 @@ private:
 
 static_assert(Dispatcher::SIZEOF_PTHREAD_MUTEX_T == sizeof(pthread_mutex_t), "invalid pthread mutex size");
 
-//const size_t STACK_SIZE = 64 * 1024;
-const size_t STACK_SIZE = 512 * 1024;
+size_t pageSize() {
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+// The stack is reserved, not committed: pages are backed by memory only once the context touches them.
+// The page below the stack is inaccessible so that an overflow faults instead of corrupting the heap
+uint8_t* allocateStack(size_t size) {
+  void* mapping = mmap(nullptr, size + pageSize(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Dispatcher::getReusableContext, mmap failed, " + lastErrorMessage());
+  }
+
+  if (mprotect(mapping, pageSize(), PROT_NONE) == -1) {
+    std::string message = "Dispatcher::getReusableContext, mprotect failed, " + lastErrorMessage();
+    munmap(mapping, size + pageSize());
+    throw std::runtime_error(message);
+  }
+
+  return static_cast<uint8_t*>(mapping) + pageSize();
+}
+
+void freeStack(void* stack, size_t size) {
+  auto result = munmap(static_cast<uint8_t*>(stack) - pageSize(), size + pageSize());
+  assert(result == 0);
+}
 
 };
 
@@ -102,7 +128,15 @@ Dispatcher::Dispatcher() {
           currentContext = &mainContext;
           firstResumingContext = nullptr;
           firstReusableContext = nullptr;
+          firstRetiredContext = nullptr;
           runningContextCount = 0;
+          stackSize = DEFAULT_STACK_SIZE;
+          maxCachedContexts = DEFAULT_MAX_CACHED_CONTEXTS;
+          readyEventsSize = DEFAULT_EVENT_BATCH_SIZE;
+          readyEvents = new epoll_event[readyEventsSize];
+          statistics = DispatcherStatistics();
+          statistics.stackSize = stackSize;
+          creationTime = std::chrono::steady_clock::now();
           return;
         }
 
@@ -129,13 +163,14 @@ Dispatcher::~Dispatcher() {
   assert(firstResumingContext == nullptr);
   assert(runningContextCount == 0);
   while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
+    NativeContext* context = firstReusableContext;
     firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
+    releaseContext(*context);
   }
 
+  releaseRetiredContexts();
+  assert(firstRetiredContext == nullptr);
+
   while (!timers.empty()) {
     int result = ::close(timers.top());
     assert(result == 0);
@@ -148,17 +183,19 @@ Dispatcher::~Dispatcher() {
   assert(result == 0);
   result = pthread_mutex_destroy(reinterpret_cast<pthread_mutex_t*>(this->mutex));
   assert(result == 0);
+  delete[] readyEvents;
 }
 
 void Dispatcher::clear() {
   while (firstReusableContext != nullptr) {
-    auto ucontext = static_cast<ucontext_t*>(firstReusableContext->ucontext);
-    auto stackPtr = static_cast<uint8_t *>(firstReusableContext->stackPtr);
+    NativeContext* context = firstReusableContext;
     firstReusableContext = firstReusableContext->next;
-    delete[] stackPtr;
-    delete ucontext;
+    releaseContext(*context);
   }
 
+  statistics.cachedContexts = 0;
+  releaseRetiredContexts();
+
   while (!timers.empty()) {
     int result = ::close(timers.top());
     if (result == -1) {
@@ -170,6 +207,10 @@ void Dispatcher::clear() {
 }
 
 void Dispatcher::dispatch() {
+  if (firstRetiredContext != nullptr) {
+    releaseRetiredContexts();
+  }
+
   NativeContext* context;
   for (;;) {
     if (firstResumingContext != nullptr) {
@@ -180,46 +221,23 @@ void Dispatcher::dispatch() {
       break;
     }
 
-    epoll_event event;
-    int count = epoll_wait(epoll, &event, 1, -1);
-    if (count == 1) {
-      ContextPair *contextPair = static_cast<ContextPair*>(event.data.ptr);
-      if(((event.events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-        uint64_t buf;
-        auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-        if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-        }
-
-        MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-        while (!remoteSpawningProcedures.empty()) {
-          spawn(std::move(remoteSpawningProcedures.front()));
-          remoteSpawningProcedures.pop();
-        }
-
-        continue;
-      }
-
-      if ((event.events & EPOLLOUT) != 0) {
-        context = contextPair->writeContext->context;
-        contextPair->writeContext->events = event.events;
-      } else if ((event.events & EPOLLIN) != 0) {
-        context = contextPair->readContext->context;
-        contextPair->readContext->events = event.events;
-      } else {
-        continue;
-      }
-
-      assert(context != nullptr);
-      break;
+    auto waitStart = std::chrono::steady_clock::now();
+    int count = epoll_wait(epoll, readyEvents, static_cast<int>(readyEventsSize), -1);
+    statistics.waitTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - waitStart).count();
+    if (count > 0) {
+      ++statistics.wakeups;
+      statistics.events += count;
+      pushReadyContexts(count);
+      continue;
     }
 
-    if (errno != EINTR) {
+    if (count == -1 && errno != EINTR) {
       throw std::runtime_error("Dispatcher::dispatch, epoll_wait failed, "  + lastErrorMessage());
     }
   }
 
   if (context != currentContext) {
+    ++statistics.contextSwitches;
     ucontext_t* oldContext = static_cast<ucontext_t*>(currentContext->ucontext);
     currentContext = context;
     if (swapcontext(oldContext, static_cast<ucontext_t *>(context->ucontext)) == -1) {
@@ -307,53 +325,15 @@ void Dispatcher::spawn(std::function<void()>&& procedure) {
 
 void Dispatcher::yield() {
   for(;;){
-    epoll_event events[16];
-    int count = epoll_wait(epoll, events, 16, 0);
+    int count = epoll_wait(epoll, readyEvents, static_cast<int>(readyEventsSize), 0);
     if (count == 0) {
       break;
     }
 
     if(count > 0) {
-      for(int i = 0; i < count; ++i) {
-        ContextPair *contextPair = static_cast<ContextPair*>(events[i].data.ptr);
-        if(((events[i].events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
-          uint64_t buf;
-          auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
-          if(transferred == -1) {
-            throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
-          }
-
-          MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
-          while (!remoteSpawningProcedures.empty()) {
-            spawn(std::move(remoteSpawningProcedures.front()));
-            remoteSpawningProcedures.pop();
-          }
-
-          continue;
-        }
-
-        if ((events[i].events & EPOLLOUT) != 0) {
-          if(contextPair->writeContext != nullptr) {
-            if(contextPair->writeContext->context != nullptr) {
-              contextPair->writeContext->context->interruptProcedure = nullptr;
-            }
-          }
-          pushContext(contextPair->writeContext->context);
-          contextPair->writeContext->events = events[i].events;
-        } else if ((events[i].events & EPOLLIN) != 0) {
-          if(contextPair->readContext != nullptr) {
-            if(contextPair->readContext->context != nullptr) {
-              contextPair->readContext->context->interruptProcedure = nullptr;
-            }
-          }
-          pushContext(contextPair->readContext->context);
-          contextPair->readContext->events = events[i].events;
-        } else if ((events[i].events & (EPOLLERR | EPOLLHUP)) != 0) {
-          throw std::runtime_error("Dispatcher::dispatch, events & (EPOLLERR | EPOLLHUP) != 0");
-        } else {
-          continue;
-        }
-      }
+      ++statistics.wakeups;
+      statistics.events += count;
+      pushReadyContexts(count);
     } else {
       if (errno != EINTR) {
         throw std::runtime_error("Dispatcher::dispatch, epoll_wait failed, " + lastErrorMessage());
@@ -367,20 +347,81 @@ void Dispatcher::yield() {
   }
 }
 
+void Dispatcher::pushReadyContexts(int count) {
+  // every ready context is queued before any of them runs, so the events stay valid while the queue is drained
+  for (int i = 0; i < count; ++i) {
+    const epoll_event& event = readyEvents[i];
+    ContextPair *contextPair = static_cast<ContextPair*>(event.data.ptr);
+    if(((event.events & (EPOLLIN | EPOLLOUT)) != 0) && contextPair->readContext == nullptr && contextPair->writeContext == nullptr) {
+      uint64_t buf;
+      auto transferred = read(remoteSpawnEvent, &buf, sizeof buf);
+      if(transferred == -1) {
+        throw std::runtime_error("Dispatcher::dispatch, read(remoteSpawnEvent) failed, " + lastErrorMessage());
+      }
+
+      MutextGuard guard(*reinterpret_cast<pthread_mutex_t*>(this->mutex));
+      while (!remoteSpawningProcedures.empty()) {
+        spawn(std::move(remoteSpawningProcedures.front()));
+        remoteSpawningProcedures.pop();
+      }
+
+      continue;
+    }
+
+    OperationContext* operation;
+    if ((event.events & EPOLLOUT) != 0) {
+      operation = contextPair->writeContext;
+    } else if ((event.events & EPOLLIN) != 0) {
+      operation = contextPair->readContext;
+    } else {
+      continue;
+    }
+
+    assert(operation != nullptr && operation->context != nullptr);
+    // the operation has completed, an interrupt before the context runs is left to its next operation
+    operation->context->interruptProcedure = nullptr;
+    operation->events = event.events;
+    pushContext(operation->context);
+  }
+}
+
+void Dispatcher::setEventBatchSize(size_t size) {
+  size = std::max<size_t>(size, 1);
+  epoll_event* events = new epoll_event[size];
+  delete[] readyEvents;
+  readyEvents = events;
+  readyEventsSize = size;
+}
+
+DispatcherStatistics Dispatcher::getStatistics() const {
+  DispatcherStatistics result = statistics;
+  uint64_t lifetime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - creationTime).count();
+  result.runTime = lifetime > statistics.waitTime ? lifetime - statistics.waitTime : 0;
+  return result;
+}
+
 int Dispatcher::getEpoll() const {
   return epoll;
 }
 
 NativeContext& Dispatcher::getReusableContext() {
   if(firstReusableContext == nullptr) {
+    ++statistics.spawnedContexts;
     ucontext_t* newlyCreatedContext = new ucontext_t;
     if (getcontext(newlyCreatedContext) == -1) { //makecontext precondition
       throw std::runtime_error("Dispatcher::getReusableContext, getcontext failed, " + lastErrorMessage());
     }
 
-    auto stackPointer = new uint8_t[STACK_SIZE];
+    uint8_t* stackPointer;
+    try {
+      stackPointer = allocateStack(stackSize);
+    } catch (std::exception&) {
+      delete newlyCreatedContext;
+      throw;
+    }
+
     newlyCreatedContext->uc_stack.ss_sp = stackPointer;
-    newlyCreatedContext->uc_stack.ss_size = STACK_SIZE;
+    newlyCreatedContext->uc_stack.ss_size = stackSize;
 
     ContextMakingData makingContextData {this, newlyCreatedContext};
     makecontext(newlyCreatedContext, (void(*)())contextProcedureStatic, 1, reinterpret_cast<int*>(&makingContextData));
@@ -393,7 +434,12 @@ NativeContext& Dispatcher::getReusableContext() {
     assert(firstReusableContext != nullptr);
     assert(firstReusableContext->ucontext == newlyCreatedContext);
     firstReusableContext->stackPtr = stackPointer;
-  };
+    firstReusableContext->stackSize = stackSize;
+    ++statistics.liveStacks;
+  } else {
+    ++statistics.reusedContexts;
+    --statistics.cachedContexts;
+  }
 
   NativeContext* context = firstReusableContext;
   firstReusableContext = firstReusableContext-> next;
@@ -401,9 +447,60 @@ NativeContext& Dispatcher::getReusableContext() {
 }
 
 void Dispatcher::pushReusableContext(NativeContext& context) {
+  --runningContextCount;
+  if (statistics.cachedContexts >= maxCachedContexts) {
+    // called by the finishing context itself, its stack can only go once another context runs
+    context.next = firstRetiredContext;
+    firstRetiredContext = &context;
+    return;
+  }
+
   context.next = firstReusableContext;
   firstReusableContext = &context;
-  --runningContextCount;
+  ++statistics.cachedContexts;
+}
+
+void Dispatcher::releaseContext(NativeContext& context) {
+  // the context lives on its own stack, take what is needed before unmapping it
+  auto ucontext = static_cast<ucontext_t*>(context.ucontext);
+  void* stack = context.stackPtr;
+  size_t size = context.stackSize;
+  freeStack(stack, size);
+  delete ucontext;
+  --statistics.liveStacks;
+}
+
+void Dispatcher::releaseRetiredContexts() {
+  NativeContext* retired = firstRetiredContext;
+  firstRetiredContext = nullptr;
+  while (retired != nullptr) {
+    NativeContext* context = retired;
+    retired = retired->next;
+    if (context == currentContext) {
+      context->next = firstRetiredContext;
+      firstRetiredContext = context;
+    } else {
+      releaseContext(*context);
+      ++statistics.releasedStacks;
+    }
+  }
+}
+
+void Dispatcher::setStackSize(size_t size) {
+  size_t pages = (std::max<size_t>(size, 1) + pageSize() - 1) / pageSize();
+  stackSize = pages * pageSize();
+  statistics.stackSize = stackSize;
+}
+
+void Dispatcher::setMaxCachedContexts(size_t count) {
+  maxCachedContexts = count;
+  while (firstReusableContext != nullptr && statistics.cachedContexts > maxCachedContexts) {
+    NativeContext* context = firstReusableContext;
+    firstReusableContext = firstReusableContext->next;
+    --statistics.cachedContexts;
+    releaseContext(*context);
+    ++statistics.releasedStacks;
+  }
 }
 
 int Dispatcher::getTimer() {
@@ -444,6 +541,7 @@ void Dispatcher::contextProcedure(void* ucontext) {
 
   for (;;) {
     ++runningContextCount;
+    statistics.peakContexts = std::max<uint64_t>(statistics.peakContexts, runningContextCount);
     try {
       context.procedure();
     } catch(std::exception&) {
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <chrono>
 #include <cstddef>
 #include <functional>
 #include <queue>
@@ -27,6 +28,8 @@
 #include <bits/reg.h>
 #endif
 
+struct epoll_event;
+
 namespace System {
 
 struct NativeContextGroup;
@@ -34,6 +37,7 @@ struct NativeContextGroup;
 struct NativeContext {
   void* ucontext;
   void* stackPtr{nullptr};
+  size_t stackSize{0};
   bool interrupted;
   bool inExecutionQueue;
   NativeContext* next{nullptr};
@@ -62,8 +66,28 @@ struct ContextPair {
   OperationContext *writeContext;
 };
 
+struct DispatcherStatistics {
+  uint64_t wakeups;          // epoll_wait calls that returned events
+  uint64_t events;           // ready events, events / wakeups is the number drained per system call
+  uint64_t contextSwitches;
+  uint64_t spawnedContexts;  // contexts created with a new stack
+  uint64_t reusedContexts;
+  uint64_t waitTime;         // microseconds blocked in epoll_wait
+  uint64_t runTime;          // microseconds spent in contexts since the dispatcher was created
+  uint64_t peakContexts;     // most contexts running at the same time
+  uint64_t liveStacks;       // stacks allocated now, running and cached contexts
+  uint64_t cachedContexts;   // finished contexts kept for reuse
+  uint64_t releasedStacks;   // stacks returned to the system because the cache was full
+  uint64_t stackSize;        // reserved bytes per stack, committed only when touched
+};
+
 class Dispatcher {
 public:
+  static const size_t DEFAULT_EVENT_BATCH_SIZE = 256;
+  static const size_t DEFAULT_STACK_SIZE = 512 * 1024;
+  static const size_t DEFAULT_MAX_CACHED_CONTEXTS = 128;
+
+
   Dispatcher();
   Dispatcher(const Dispatcher&) = delete;
   ~Dispatcher();
@@ -85,6 +109,14 @@ public:
   int getTimer();
   void pushTimer(int timer);
 
+  // ready events taken from epoll per system call, 1 wakes a single context at a time
+  void setEventBatchSize(size_t size);
+  // applies to contexts created afterwards, rounded up to whole pages
+  void setStackSize(size_t size);
+  // finished contexts kept for reuse, the stacks of the others are unmapped
+  void setMaxCachedContexts(size_t count);
+  DispatcherStatistics getStatistics() const;
+
 #ifdef __x86_64__
 # if __WORDSIZE == 64
   static const int SIZEOF_PTHREAD_MUTEX_T = 40;
@@ -99,6 +131,9 @@ public:
 
 private:
   void spawn(std::function<void()>&& procedure);
+  void pushReadyContexts(int count);
+  void releaseContext(NativeContext& context);
+  void releaseRetiredContexts();
   int epoll;
   alignas(void*) uint8_t mutex[SIZEOF_PTHREAD_MUTEX_T];
   int remoteSpawnEvent;
@@ -112,7 +147,16 @@ private:
   NativeContext* firstResumingContext;
   NativeContext* lastResumingContext;
   NativeContext* firstReusableContext;
+  // finished contexts over the cache limit, unmapped once they are no longer the current one
+  NativeContext* firstRetiredContext;
   size_t runningContextCount;
+  size_t stackSize;
+  size_t maxCachedContexts;
+
+  epoll_event* readyEvents;
+  size_t readyEventsSize;
+  DispatcherStatistics statistics;
+  std::chrono::steady_clock::time_point creationTime;
 
   void contextProcedure(void* ucontext);
   static void contextProcedureStatic(void* context);
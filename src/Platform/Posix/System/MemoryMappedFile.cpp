@@ -182,6 +182,40 @@ void MemoryMappedFile::rename(const std::string& newPath) {
   }
 }
 
+void MemoryMappedFile::resize(uint64_t newSize, std::error_code& ec) {
+  assert(isOpened());
+
+  int result = ::ftruncate(m_file, static_cast<off_t>(newSize));
+  if (result == -1) {
+    ec = std::error_code(errno, std::system_category());
+    return;
+  }
+
+  // map the resized file before dropping the old view, so a failure leaves the old one usable
+  void* data = ::mmap(nullptr, static_cast<size_t>(newSize), PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+  if (data == MAP_FAILED) {
+    ec = std::error_code(errno, std::system_category());
+    if (newSize > m_size) {
+      ::ftruncate(m_file, static_cast<off_t>(m_size));
+    }
+
+    return;
+  }
+
+  ::munmap(m_data, static_cast<size_t>(m_size));
+  m_data = reinterpret_cast<uint8_t*>(data);
+  m_size = newSize;
+  ec = std::error_code();
+}
+
+void MemoryMappedFile::resize(uint64_t newSize) {
+  std::error_code ec;
+  resize(newSize, ec);
+  if (ec) {
+    throw std::system_error(ec, "MemoryMappedFile::resize");
+  }
+}
+
 void MemoryMappedFile::close(std::error_code& ec) {
   int result;
   if (m_data != nullptr) {
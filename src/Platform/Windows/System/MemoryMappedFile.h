@@ -45,6 +45,10 @@ public:
   void rename(const std::string& newPath, std::error_code& ec);
   void rename(const std::string& newPath);
 
+  // grows or shrinks the file in place, the mapping address may change
+  void resize(uint64_t newSize, std::error_code& ec);
+  void resize(uint64_t newSize);
+
   void flush(uint8_t* data, uint64_t size, std::error_code& ec);
   void flush(uint8_t* data, uint64_t size);
 
@@ -196,6 +196,37 @@ struct COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES {
     }
   };
 };
+
+struct COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES {
+  // upper bound on txids per request, clients split larger batches
+  static const size_t MAX_TRANSACTIONS = 1000;
+
+  struct request {
+    std::vector<Crypto::Hash> txids;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(txids)
+    }
+  };
+
+  struct transaction_indexes {
+    std::vector<uint64_t> o_indexes;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(o_indexes)
+    }
+  };
+
+  struct response {
+    std::vector<transaction_indexes> txs; // same order as request txids
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(txs)
+      KV_MEMBER(status)
+    }
+  };
+};
 //-----------------------------------------------
 struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_request {
   std::vector<uint64_t> amounts;
@@ -326,6 +357,56 @@ struct COMMAND_RPC_GET_INFO {
   };
 };
 
+//-----------------------------------------------
+struct COMMAND_RPC_GET_STATS {
+  typedef EMPTY_STRUCT request;
+
+  struct endpoint_stats {
+    std::string endpoint;
+    uint64_t calls;
+    uint64_t max_latency;
+    // request latencies in the same buckets as the lock hold times
+    std::vector<uint64_t> latency;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(endpoint)
+      KV_MEMBER(calls)
+      KV_MEMBER(max_latency)
+      KV_MEMBER(latency)
+    }
+  };
+
+  struct response {
+    uint64_t block_cache_hits;
+    uint64_t block_cache_misses;
+    // encoded blocks served to wallet sync requests
+    uint64_t response_cache_hits;
+    uint64_t response_cache_misses;
+    uint64_t response_cache_bytes_served;
+    uint64_t response_cache_entries;
+    uint64_t response_cache_size;
+    // blockchain lock hold times, log2 buckets: [0] < 1 us, [i] < 2^i us
+    std::vector<uint64_t> lock_hold_exclusive;
+    std::vector<uint64_t> lock_hold_shared;
+    std::vector<endpoint_stats> rpc_endpoints;
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(block_cache_hits)
+      KV_MEMBER(block_cache_misses)
+      KV_MEMBER(response_cache_hits)
+      KV_MEMBER(response_cache_misses)
+      KV_MEMBER(response_cache_bytes_served)
+      KV_MEMBER(response_cache_entries)
+      KV_MEMBER(response_cache_size)
+      KV_MEMBER(lock_hold_exclusive)
+      KV_MEMBER(lock_hold_shared)
+      KV_MEMBER(rpc_endpoints)
+      KV_MEMBER(status)
+    }
+  };
+};
+
 //-----------------------------------------------
 struct COMMAND_RPC_STOP_DAEMON {
   typedef EMPTY_STRUCT request;
@@ -62,6 +62,14 @@ HttpServer::HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log)
 
 }
 
+void HttpServer::setWorkerThreads(size_t threadCount) {
+  if (threadCount == 0) {
+    m_workers.reset();
+  } else {
+    m_workers.reset(new Tools::WorkerPool(threadCount));
+  }
+}
+
 void HttpServer::start(const std::string& address, uint16_t port, const std::string& user, const std::string& password) {
   m_listener = System::TcpListener(m_dispatcher, System::Ipv4Address(address), port);
   workingContextGroup.spawn(std::bind(&HttpServer::acceptLoop, this));
@@ -143,6 +151,44 @@ void HttpServer::acceptLoop() {
   }
 }
 
+void HttpServer::executeOnWorker(const std::function<void()>& job) {
+  if (!m_workers) {
+    job();
+    return;
+  }
+
+  System::Event done(m_dispatcher);
+  std::exception_ptr error;
+  m_workers->post([this, &job, &done, &error] {
+    try {
+      job();
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    auto event = &done;
+    m_dispatcher.remoteSpawn([event] { event->set(); });
+  });
+
+  // job refers to the caller's request and response, it has to finish even if this context is interrupted
+  bool interrupted = false;
+  while (!done.get()) {
+    try {
+      done.wait();
+    } catch (System::InterruptedException&) {
+      interrupted = true;
+    }
+  }
+
+  if (interrupted) {
+    throw System::InterruptedException();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
 bool HttpServer::authenticate(const HttpRequest& request) const {
 	if (!m_credentials.empty()) {
 		auto headerIt = request.getHeaders().find("authorization");
@@ -37,6 +37,8 @@
 
 #pragma once 
 
+#include <functional>
+#include <memory>
 #include <unordered_set>
 
 #include <HTTP/HttpRequest.h>
@@ -48,6 +50,7 @@
 #include <System/TcpConnection.h>
 #include <System/Event.h>
 
+#include <Common/WorkerPool.h>
 #include <Logging/LoggerRef.h>
 
 namespace DynexCN {
@@ -58,6 +61,9 @@ public:
 
   HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log);
 
+  // threads executing the requests handed to executeOnWorker, 0 keeps everything on the dispatcher thread.
+  // Must be called before start()
+  void setWorkerThreads(size_t threadCount);
   void start(const std::string& address, uint16_t port, const std::string& user = "", const std::string& password = "");
   void stop();
 
@@ -66,6 +72,10 @@ public:
 
 protected:
 
+  // Runs job on a worker thread while the calling connection context waits, other connections are served
+  // meanwhile. Exceptions thrown by job are rethrown here. Runs job in place when there are no workers
+  void executeOnWorker(const std::function<void()>& job);
+
   System::Dispatcher& m_dispatcher;
 
 private:
@@ -79,6 +89,7 @@ private:
   System::TcpListener m_listener;
   std::unordered_set<System::TcpConnection*> m_connections;
   std::string m_credentials;
+  std::unique_ptr<Tools::WorkerPool> m_workers;
 };
 
 }
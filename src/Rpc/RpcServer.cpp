@@ -45,6 +45,7 @@
 #include "BlockchainExplorerData.h"
 #include "Common/StringTools.h"
 #include "Common/Base58.h"
+#include "Common/RecursiveSharedMutex.h"
 #include "DynexCNCore/TransactionUtils.h"
 #include "DynexCNCore/DynexCNTools.h"
 #include "DynexCNCore/DynexCNFormatUtils.h"
@@ -121,17 +122,19 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
   { "/queryblocks.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), false } },
   { "/queryblockslite.bin", { binMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), false } },
   { "/get_o_indexes.bin", { binMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_indexes), false } },
+  { "/get_txs_o_indexes.bin", { binMethod<COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_txs_indexes), false } },
   { "/getrandom_outs.bin", { binMethod<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS>(&RpcServer::on_get_random_outs), false } },
   { "/get_pool_changes.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::onGetPoolChanges), false } },
   { "/get_pool_changes_lite.bin", { binMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::onGetPoolChangesLite), false } },
 
   // http get json handlers
-  { "/getinfo", { jsonMethod<COMMAND_RPC_GET_INFO>(&RpcServer::on_get_info), true } },
-  { "/getheight", { jsonMethod<COMMAND_RPC_GET_HEIGHT>(&RpcServer::on_get_height), true } },
-  { "/feeaddress", { jsonMethod<COMMAND_RPC_GET_FEE_ADDRESS>(&RpcServer::on_get_fee_address), true } },
-  { "/peers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true } }, // deprecated
-  { "/getpeers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true } },
-  { "/paymentid", { jsonMethod<COMMAND_RPC_GEN_PAYMENT_ID>(&RpcServer::on_get_payment_id), true } },
+  { "/getinfo", { jsonMethod<COMMAND_RPC_GET_INFO>(&RpcServer::on_get_info), true, true } },
+  { "/getheight", { jsonMethod<COMMAND_RPC_GET_HEIGHT>(&RpcServer::on_get_height), true, true } },
+  { "/getstats", { jsonMethod<COMMAND_RPC_GET_STATS>(&RpcServer::on_get_stats), true, true } },
+  { "/feeaddress", { jsonMethod<COMMAND_RPC_GET_FEE_ADDRESS>(&RpcServer::on_get_fee_address), true, true } },
+  { "/peers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true, true } }, // deprecated
+  { "/getpeers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true, true } },
+  { "/paymentid", { jsonMethod<COMMAND_RPC_GEN_PAYMENT_ID>(&RpcServer::on_get_payment_id), true, true } },
 
   // rpc post json handlers
   { "/gettransactions", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS>(&RpcServer::on_get_transactions), false } },
@@ -140,6 +143,7 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
   { "/queryblocks", { jsonMethod<COMMAND_RPC_QUERY_BLOCKS>(&RpcServer::on_query_blocks), false } },
   { "/queryblockslite", { jsonMethod<COMMAND_RPC_QUERY_BLOCKS_LITE>(&RpcServer::on_query_blocks_lite), false } },
   { "/get_o_indexes", { jsonMethod<COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_indexes), false } },
+  { "/get_txs_o_indexes", { jsonMethod<COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES>(&RpcServer::on_get_txs_indexes), false } },
   { "/getrandom_outs", { jsonMethod<COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS>(&RpcServer::on_get_random_outs), false } },
   { "/get_pool_changes", { jsonMethod<COMMAND_RPC_GET_POOL_CHANGES>(&RpcServer::onGetPoolChanges), false } },
   { "/get_pool_changes_lite", { jsonMethod<COMMAND_RPC_GET_POOL_CHANGES_LITE>(&RpcServer::onGetPoolChangesLite), false } },
@@ -151,7 +155,7 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
   { "/get_transaction_hashes_by_payment_id", { jsonMethod<COMMAND_RPC_GET_TRANSACTION_HASHES_BY_PAYMENT_ID>(&RpcServer::onGetTransactionHashesByPaymentId), false } },
 
   // json rpc
-  { "/json_rpc", { std::bind(&RpcServer::processJsonRpcRequest, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true } }
+  { "/json_rpc", { std::bind(&RpcServer::processJsonRpcRequest, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), true, true } }
 };
 
 RpcServer::RpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, core& c, NodeServer& p2p, IDynexCNProtocolQuery& protocolQuery) :
@@ -174,8 +178,34 @@ void RpcServer::processRequest(const HttpRequest& request, HttpResponse& respons
     response.setBody("Core is busy");
     return;
   }
-  
-  it->second.handler(this, request, response);
+
+  auto start = std::chrono::steady_clock::now();
+  const auto& handler = it->second.handler;
+  if (it->second.onDispatcher) {
+    handler(this, request, response);
+  } else {
+    executeOnWorker([this, &handler, &request, &response] { handler(this, request, response); });
+  }
+
+  recordLatency(url, start);
+}
+
+void RpcServer::recordLatency(const std::string& endpoint, std::chrono::steady_clock::time_point start) {
+  uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  size_t bucket = 0;
+  for (uint64_t value = microseconds; value != 0 && bucket + 1 < Tools::RecursiveSharedMutex::HOLD_TIME_BUCKETS; value >>= 1) {
+    ++bucket;
+  }
+
+  std::lock_guard<std::mutex> lock(m_endpointStatsMutex);
+  EndpointStats& stats = m_endpointStats[endpoint];
+  if (stats.latency.empty()) {
+    stats.latency.resize(Tools::RecursiveSharedMutex::HOLD_TIME_BUCKETS);
+  }
+
+  ++stats.calls;
+  stats.maxLatency = std::max(stats.maxLatency, microseconds);
+  ++stats.latency[bucket];
 }
 
 bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse& response) {
@@ -199,7 +229,7 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
 
     static std::unordered_map<std::string, RpcServer::RpcHandler<JsonMemberMethod>> jsonRpcHandlers = {
 	
-      { "getblockcount", { makeMemberMethod(&RpcServer::on_getblockcount), true } },
+      { "getblockcount", { makeMemberMethod(&RpcServer::on_getblockcount), true, true } },
       { "getblockhash", { makeMemberMethod(&RpcServer::on_getblockhash), false } },
       { "getblocktemplate", { makeMemberMethod(&RpcServer::on_getblocktemplate), false } },
       { "getblockheaderbyhash", { makeMemberMethod(&RpcServer::on_get_block_header_by_hash), false } },
@@ -216,7 +246,7 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
       { "gettransactionsbypaymentid", { makeMemberMethod(&RpcServer::on_get_transactions_by_payment_id), false } },
       { "gettransactionhashesbypaymentid", { makeMemberMethod(&RpcServer::onGetTransactionHashesByPaymentId), false } },
       { "gettransactionsbyhashes", { makeMemberMethod(&RpcServer::onGetTransactionsDetailsByHashes), false } },
-      { "getcurrencyid", { makeMemberMethod(&RpcServer::on_get_currency_id), true } },
+      { "getcurrencyid", { makeMemberMethod(&RpcServer::on_get_currency_id), true, true } },
       { "checktransactionkey", { makeMemberMethod(&RpcServer::on_check_tx_key), false } },
       { "checktransactionbyviewkey", { makeMemberMethod(&RpcServer::on_check_tx_with_view_key), false } },
       { "checktransactionproof", { makeMemberMethod(&RpcServer::on_check_tx_proof), false } },
@@ -260,7 +290,15 @@ bool RpcServer::processJsonRpcRequest(const HttpRequest& request, HttpResponse&
       throw JsonRpcError(CORE_RPC_ERROR_CODE_CORE_BUSY, "Core is busy");
     }
 
-    it->second.handler(this, jsonRequest, jsonResponse);
+    auto start = std::chrono::steady_clock::now();
+    const auto& handler = it->second.handler;
+    if (it->second.onDispatcher) {
+      handler(this, jsonRequest, jsonResponse);
+    } else {
+      executeOnWorker([this, &handler, &jsonRequest, &jsonResponse] { handler(this, jsonRequest, jsonResponse); });
+    }
+
+    recordLatency("json_rpc/" + jsonRequest.getMethod(), start);
 
   } catch (const JsonRpcError& err) {
     jsonResponse.setError(err);
@@ -376,6 +414,14 @@ bool RpcServer::on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, C
 
   for (const auto& blockId : supplement) {
     assert(m_core.have_block(blockId));
+    std::shared_ptr<const EncodedBlock> encoded = m_core.get_blockchain_storage().getEncodedBlock(blockId);
+    if (encoded) {
+      res.blocks.resize(res.blocks.size() + 1);
+      res.blocks.back().block = encoded->block;
+      res.blocks.back().txs = encoded->transactions;
+      continue;
+    }
+
     auto completeBlock = m_core.getBlock(blockId);
     assert(completeBlock != nullptr);
 
@@ -438,6 +484,29 @@ bool RpcServer::on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::
   return true;
 }
 
+bool RpcServer::on_get_txs_indexes(const COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::response& res) {
+  if (req.txids.size() > COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES::MAX_TRANSACTIONS) {
+    res.status = "Too many transactions requested";
+    return true;
+  }
+
+  res.txs.resize(req.txids.size());
+  std::vector<uint32_t> outputIndexes;
+  for (size_t i = 0; i < req.txids.size(); ++i) {
+    if (!m_core.get_tx_outputs_gindexs(req.txids[i], outputIndexes)) {
+      res.txs.clear();
+      res.status = "Failed";
+      return true;
+    }
+
+    res.txs[i].o_indexes.assign(outputIndexes.begin(), outputIndexes.end());
+  }
+
+  res.status = CORE_RPC_STATUS_OK;
+  logger(TRACE) << "COMMAND_RPC_GET_TXS_GLOBAL_OUTPUTS_INDEXES: [" << res.txs.size() << "]";
+  return true;
+}
+
 bool RpcServer::on_get_random_outs(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) {
   res.status = "Failed";
   if (!m_core.get_random_outs_for_amounts(req, res)) {
@@ -492,7 +561,7 @@ bool RpcServer::onGetPoolChangesLite(const COMMAND_RPC_GET_POOL_CHANGES_LITE::re
 }
 
 bool RpcServer::onGetBlocksDetailsByHeights(const COMMAND_RPC_GET_BLOCKS_DETAILS_BY_HEIGHTS::request& req, COMMAND_RPC_GET_BLOCKS_DETAILS_BY_HEIGHTS::response& rsp) {
-  std::vector<BlockDetails> blockDetails;
+  std::vector<Block> blocks;
   for (const uint32_t& height : req.blockHeights) {
     if (m_core.get_current_blockchain_height() <= height) {
       throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_TOO_BIG_HEIGHT,
@@ -503,6 +572,12 @@ bool RpcServer::onGetBlocksDetailsByHeights(const COMMAND_RPC_GET_BLOCKS_DETAILS
     if (!m_core.getBlockByHash(block_hash, blk)) {
       throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR, "Internal error: can't get block by height " + std::to_string(height) + '.' };
     }
+    blocks.push_back(std::move(blk));
+  }
+
+  m_core.precomputeProofOfWork(blocks);
+  std::vector<BlockDetails> blockDetails;
+  for (const Block& blk : blocks) {
     BlockDetails detail;
     if (!blockchainExplorerDataBuilder.fillBlockDetails(blk, detail)) {
       throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR, "Internal error: can't fill block details." };
@@ -516,12 +591,18 @@ bool RpcServer::onGetBlocksDetailsByHeights(const COMMAND_RPC_GET_BLOCKS_DETAILS
 }
 
 bool RpcServer::onGetBlocksDetailsByHashes(const COMMAND_RPC_GET_BLOCKS_DETAILS_BY_HASHES::request& req, COMMAND_RPC_GET_BLOCKS_DETAILS_BY_HASHES::response& rsp) {
-  std::vector<BlockDetails> blockDetails;
+  std::vector<Block> blocks;
   for (const Crypto::Hash& hash : req.blockHashes) {
     Block blk;
     if (!m_core.getBlockByHash(hash, blk)) {
       //throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR, "Internal error: can't get block by hash " + Common::PodToHex(hash) + '.' };
     }
+    blocks.push_back(std::move(blk));
+  }
+
+  m_core.precomputeProofOfWork(blocks);
+  std::vector<BlockDetails> blockDetails;
+  for (const Block& blk : blocks) {
     BlockDetails detail;
     if (!blockchainExplorerDataBuilder.fillBlockDetails(blk, detail)) {
       throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR, "Internal error: can't fill block details." };
@@ -719,6 +800,31 @@ bool RpcServer::on_get_height(const COMMAND_RPC_GET_HEIGHT::request& req, COMMAN
   return true;
 }
 
+bool RpcServer::on_get_stats(const COMMAND_RPC_GET_STATS::request& req, COMMAND_RPC_GET_STATS::response& res) {
+  m_core.get_blockchain_storage().getBlockCacheStatistics(res.block_cache_hits, res.block_cache_misses);
+  m_core.get_blockchain_storage().getLockStatistics(res.lock_hold_exclusive, res.lock_hold_shared);
+  BlockResponseCache::Statistics responseCache = m_core.get_blockchain_storage().getResponseCacheStatistics();
+  res.response_cache_hits = responseCache.hits;
+  res.response_cache_misses = responseCache.misses;
+  res.response_cache_bytes_served = responseCache.bytesServed;
+  res.response_cache_entries = responseCache.entries;
+  res.response_cache_size = responseCache.size;
+
+  {
+    std::lock_guard<std::mutex> lock(m_endpointStatsMutex);
+    for (const auto& endpoint : m_endpointStats) {
+      COMMAND_RPC_GET_STATS::endpoint_stats stats;
+      stats.endpoint = endpoint.first;
+      stats.calls = endpoint.second.calls;
+      stats.max_latency = endpoint.second.maxLatency;
+      stats.latency = endpoint.second.latency;
+      res.rpc_endpoints.push_back(std::move(stats));
+    }
+  }
+  res.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
 bool RpcServer::on_get_transactions(const COMMAND_RPC_GET_TRANSACTIONS::request& req, COMMAND_RPC_GET_TRANSACTIONS::response& res) {
   std::vector<Hash> vh;
   for (const auto& tx_hex_str : req.txs_hashes) {
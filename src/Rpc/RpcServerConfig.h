@@ -53,6 +53,7 @@ public:
 
   std::string bindIp;
   uint16_t bindPort;
+  size_t threads;
 };
 
 }
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <limits>
 #include <stdexcept>
 #include <Common/StreamTools.h>
 #include "KVBinaryCommon.h"
@@ -19,27 +20,226 @@ using namespace DynexCN;
 
 namespace {
 
+const size_t UNKNOWN_OFFSET = std::numeric_limits<size_t>::max();
+
+size_t itemSize(uint8_t type) {
+  switch (type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:
+  case BIN_KV_SERIALIZE_TYPE_UINT64:
+  case BIN_KV_SERIALIZE_TYPE_DOUBLE:
+    return 8;
+  case BIN_KV_SERIALIZE_TYPE_INT32:
+  case BIN_KV_SERIALIZE_TYPE_UINT32:
+    return 4;
+  case BIN_KV_SERIALIZE_TYPE_INT16:
+  case BIN_KV_SERIALIZE_TYPE_UINT16:
+    return 2;
+  case BIN_KV_SERIALIZE_TYPE_INT8:
+  case BIN_KV_SERIALIZE_TYPE_UINT8:
+  case BIN_KV_SERIALIZE_TYPE_BOOL:
+    return 1;
+  default:
+    // variable size
+    return 0;
+  }
+}
+
 template <typename T>
-T readPod(Common::IInputStream& s) {
+T readPod(const uint8_t* data) {
   T v;
-  read(s, &v, sizeof(T));
+  memcpy(&v, data, sizeof(T));
   return v;
 }
 
-template <typename T, typename JsonT = T>
-JsonValue readPodJson(Common::IInputStream& s) {
-  JsonValue jv;
-  jv = static_cast<JsonT>(readPod<T>(s));
-  return jv;
 }
 
-template <typename T>
-JsonValue readIntegerJson(Common::IInputStream& s) {
-  return readPodJson<T, int64_t>(s);
+KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(const void* data, size_t size) :
+  m_data(static_cast<const uint8_t*>(data)), m_size(size) {
+  readHeader();
+}
+
+KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(Common::IInputStream& strm) {
+  char chunk[4096];
+  size_t readSize;
+  while ((readSize = strm.readSome(chunk, sizeof(chunk))) != 0) {
+    m_buffer.append(chunk, readSize);
+  }
+
+  m_data = reinterpret_cast<const uint8_t*>(m_buffer.data());
+  m_size = m_buffer.size();
+  readHeader();
+}
+
+KVBinaryInputStreamSerializer::~KVBinaryInputStreamSerializer() {
+}
+
+ISerializer::SerializerType KVBinaryInputStreamSerializer::type() const {
+  return ISerializer::INPUT;
+}
+
+bool KVBinaryInputStreamSerializer::beginObject(Common::StringView name) {
+  Value value;
+  if (!findValue(name, value)) {
+    return false;
+  }
+
+  if (value.type != BIN_KV_SERIALIZE_TYPE_OBJECT || value.isArray) {
+    throw std::runtime_error("Object expected");
+  }
+
+  pushSection(value.offset);
+  return true;
+}
+
+void KVBinaryInputStreamSerializer::endObject() {
+  assert(m_stack.size() > 1);
+  assert(!m_stack.back().isArray);
+
+  const Level& level = m_stack.back();
+  size_t end = skipEntries(level.count - level.knownIndex, level.knownOffset);
+  m_stack.pop_back();
+  valueRead(end);
+}
+
+bool KVBinaryInputStreamSerializer::beginArray(size_t& size, Common::StringView name) {
+  Value value;
+  if (!findValue(name, value)) {
+    size = 0;
+    return false;
+  }
+
+  if (!value.isArray) {
+    // nested arrays are items of type array carrying their own item type and count
+    if (value.type != BIN_KV_SERIALIZE_TYPE_ARRAY) {
+      throw std::runtime_error("Array expected");
+    }
+
+    value.type = *take(value.offset, 1) & ~BIN_KV_SERIALIZE_FLAG_ARRAY;
+    value.count = readCount(value.offset);
+  }
+
+  Level level = { true, value.type, value.count, 0, value.offset, 0, 0, 0 };
+  m_stack.push_back(level);
+  size = value.count;
+  return true;
 }
 
-size_t readVarint(Common::IInputStream& s) {
-  uint8_t b = read<uint8_t>(s);
+void KVBinaryInputStreamSerializer::endArray() {
+  assert(m_stack.size() > 1);
+  assert(m_stack.back().isArray);
+
+  const Level& level = m_stack.back();
+  assert(level.offset != UNKNOWN_OFFSET);
+  Value rest = { level.itemType, true, level.count - level.index, level.offset };
+  size_t end = skipValue(rest);
+  m_stack.pop_back();
+  valueRead(end);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(uint8_t& value, Common::StringView name) {
+  return readNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(int16_t& value, Common::StringView name) {
+  return readNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(uint16_t& value, Common::StringView name) {
+  return readNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(int32_t& value, Common::StringView name) {
+  return readNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(uint32_t& value, Common::StringView name) {
+  return readNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(int64_t& value, Common::StringView name) {
+  return readNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(uint64_t& value, Common::StringView name) {
+  return readNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(double& value, Common::StringView name) {
+  return readNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(bool& value, Common::StringView name) {
+  Value v;
+  if (!findValue(name, v)) {
+    return false;
+  }
+
+  if (v.type != BIN_KV_SERIALIZE_TYPE_BOOL || v.isArray) {
+    throw std::runtime_error("Boolean expected");
+  }
+
+  value = *take(v.offset, 1) != 0;
+  valueRead(v.offset);
+  return true;
+}
+
+bool KVBinaryInputStreamSerializer::operator()(std::string& value, Common::StringView name) {
+  Common::StringView view;
+  if (!readString(name, view)) {
+    return false;
+  }
+
+  value.assign(view.getData(), view.getSize());
+  return true;
+}
+
+bool KVBinaryInputStreamSerializer::binary(void* value, size_t size, Common::StringView name) {
+  Common::StringView view;
+  if (!readString(name, view)) {
+    return false;
+  }
+
+  if (view.getSize() != size) {
+    throw std::runtime_error("Binary block size mismatch");
+  }
+
+  memcpy(value, view.getData(), size);
+  return true;
+}
+
+bool KVBinaryInputStreamSerializer::binary(std::string& value, Common::StringView name) {
+  return (*this)(value, name); // load as string
+}
+
+void KVBinaryInputStreamSerializer::readHeader() {
+  size_t offset = 0;
+  KVBinaryStorageBlockHeader hdr = readPod<KVBinaryStorageBlockHeader>(take(offset, sizeof(KVBinaryStorageBlockHeader)));
+  if (
+    hdr.m_signature_a != PORTABLE_STORAGE_SIGNATUREA ||
+    hdr.m_signature_b != PORTABLE_STORAGE_SIGNATUREB) {
+    throw std::runtime_error("Invalid binary storage signature");
+  }
+
+  if (hdr.m_ver != PORTABLE_STORAGE_FORMAT_VER) {
+    throw std::runtime_error("Unknown binary storage format version");
+  }
+
+  m_stack.reserve(8);
+  pushSection(offset);
+}
+
+const uint8_t* KVBinaryInputStreamSerializer::take(size_t& offset, size_t size) const {
+  if (size > m_size - offset) {
+    throw std::runtime_error("Unexpected end of binary storage");
+  }
+
+  const uint8_t* data = m_data + offset;
+  offset += size;
+  return data;
+}
+
+size_t KVBinaryInputStreamSerializer::readVarint(size_t& offset) const {
+  uint8_t b = *take(offset, 1);
   uint8_t size_mask = b & PORTABLE_RAW_SIZE_MARK_MASK;
   size_t bytesLeft = 0;
 
@@ -58,10 +258,10 @@ size_t readVarint(Common::IInputStream& s) {
     break;
   }
 
+  const uint8_t* rest = take(offset, bytesLeft);
   size_t value = b;
-
   for (size_t i = 1; i <= bytesLeft; ++i) {
-    size_t n = read<uint8_t>(s);
+    size_t n = rest[i - 1];
     value |= n << (i * 8);
   }
 
@@ -69,129 +269,193 @@ size_t readVarint(Common::IInputStream& s) {
   return value;
 }
 
-std::string readString(Common::IInputStream& s) {
-  auto size = readVarint(s);
-
-  std::string str;
-  str.resize(size);
-  if (size) {
-    read(s, &str[0], size);
+// Every entry and item takes at least a byte, larger counts can only come from a damaged payload
+size_t KVBinaryInputStreamSerializer::readCount(size_t& offset) const {
+  size_t count = readVarint(offset);
+  if (count > m_size - offset) {
+    throw std::runtime_error("Invalid element count in binary storage");
   }
-  return str;
-}
 
-JsonValue readStringJson(Common::IInputStream& s) {
-  return JsonValue(readString(s));
+  return count;
 }
 
-void readName(Common::IInputStream& s, std::string& name) {
-  uint8_t len = readPod<uint8_t>(s);
-  if (len) {
-    name.resize(len);
-    read(s, &name[0], len);
+void KVBinaryInputStreamSerializer::readEntry(size_t& offset, Common::StringView& name, Value& value) const {
+  uint8_t nameSize = *take(offset, 1);
+  name = Common::StringView(reinterpret_cast<const char*>(take(offset, nameSize)), nameSize);
+  value.type = *take(offset, 1);
+  value.isArray = (value.type & BIN_KV_SERIALIZE_FLAG_ARRAY) != 0;
+  if (value.isArray) {
+    value.type &= ~BIN_KV_SERIALIZE_FLAG_ARRAY;
+    value.count = readCount(offset);
+  } else {
+    value.count = 1;
   }
-}
 
-JsonValue loadValue(Common::IInputStream& stream, uint8_t type);
-JsonValue loadSection(Common::IInputStream& stream);
-JsonValue loadEntry(Common::IInputStream& stream);
-JsonValue loadArray(Common::IInputStream& stream, uint8_t itemType);
+  value.offset = offset;
+}
 
+size_t KVBinaryInputStreamSerializer::skipValue(const Value& value) const {
+  size_t offset = value.offset;
+  size_t size = itemSize(value.type);
+  if (size != 0) {
+    if (value.count > (m_size - offset) / size) {
+      throw std::runtime_error("Unexpected end of binary storage");
+    }
 
-JsonValue loadSection(Common::IInputStream& stream) {
-  JsonValue sec(JsonValue::OBJECT);
-  size_t count = readVarint(stream);
-  std::string name;
+    return offset + value.count * size;
+  }
 
-  while (count--) {
-    readName(stream, name);
-    sec.insert(name, loadEntry(stream));
+  for (size_t i = 0; i < value.count; ++i) {
+    offset = skipItem(value.type, offset);
   }
 
-  return sec;
+  return offset;
 }
 
-JsonValue loadValue(Common::IInputStream& stream, uint8_t type) {
+size_t KVBinaryInputStreamSerializer::skipItem(uint8_t type, size_t offset) const {
   switch (type) {
-  case BIN_KV_SERIALIZE_TYPE_INT64:  return readIntegerJson<int64_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT32:  return readIntegerJson<int32_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT16:  return readIntegerJson<int16_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT8:   return readIntegerJson<int8_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT64: return readIntegerJson<uint64_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT32: return readIntegerJson<uint32_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT16: return readIntegerJson<uint16_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT8:  return readIntegerJson<uint8_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_DOUBLE: return readPodJson<double>(stream);
-  case BIN_KV_SERIALIZE_TYPE_BOOL:   return JsonValue(read<uint8_t>(stream) != 0);
-  case BIN_KV_SERIALIZE_TYPE_STRING: return readStringJson(stream);
-  case BIN_KV_SERIALIZE_TYPE_OBJECT: return loadSection(stream);
-  case BIN_KV_SERIALIZE_TYPE_ARRAY:  return loadArray(stream, type);
-  default:
-    throw std::runtime_error("Unknown data type");
-    break;
+  case BIN_KV_SERIALIZE_TYPE_STRING: {
+    size_t size = readVarint(offset);
+    take(offset, size);
+    return offset;
+  }
+  case BIN_KV_SERIALIZE_TYPE_OBJECT: {
+    size_t count = readCount(offset);
+    return skipEntries(count, offset);
+  }
+  case BIN_KV_SERIALIZE_TYPE_ARRAY: {
+    Value items;
+    items.type = *take(offset, 1) & ~BIN_KV_SERIALIZE_FLAG_ARRAY;
+    items.isArray = true;
+    items.count = readCount(offset);
+    items.offset = offset;
+    return skipValue(items);
+  }
+  default: {
+    size_t size = itemSize(type);
+    if (size == 0) {
+      throw std::runtime_error("Unknown data type");
+    }
+
+    take(offset, size);
+    return offset;
   }
-}
-
-JsonValue loadEntry(Common::IInputStream& stream) {
-  uint8_t type = readPod<uint8_t>(stream);
-
-  if (type & BIN_KV_SERIALIZE_FLAG_ARRAY) {
-    type &= ~BIN_KV_SERIALIZE_FLAG_ARRAY;
-    return loadArray(stream, type);
   }
-
-  return loadValue(stream, type);
 }
 
-JsonValue loadArray(Common::IInputStream& stream, uint8_t itemType) {
-  JsonValue arr(JsonValue::ARRAY);
-  size_t count = readVarint(stream);
-
-  while (count--) {
-    arr.pushBack(loadValue(stream, itemType));
+size_t KVBinaryInputStreamSerializer::skipEntries(size_t count, size_t offset) const {
+  Common::StringView name;
+  Value value;
+  for (size_t i = 0; i < count; ++i) {
+    readEntry(offset, name, value);
+    offset = skipValue(value);
   }
 
-  return arr;
+  return offset;
 }
 
+void KVBinaryInputStreamSerializer::pushSection(size_t offset) {
+  size_t count = readCount(offset);
+  Level level = { false, 0, count, 0, offset, offset, 0, offset };
+  m_stack.push_back(level);
+}
 
-JsonValue parseBinary(Common::IInputStream& stream) {
-  auto hdr = readPod<KVBinaryStorageBlockHeader>(stream);
-
-  if (
-    hdr.m_signature_a != PORTABLE_STORAGE_SIGNATUREA ||
-    hdr.m_signature_b != PORTABLE_STORAGE_SIGNATUREB) {
-    throw std::runtime_error("Invalid binary storage signature");
+bool KVBinaryInputStreamSerializer::findValue(Common::StringView name, Value& value) {
+  Level& level = m_stack.back();
+  assert(level.offset != UNKNOWN_OFFSET);
+  if (level.isArray) {
+    if (level.index == level.count) {
+      throw std::runtime_error("Array index out of range");
+    }
+
+    value.type = level.itemType;
+    value.isArray = false;
+    value.count = 1;
+    value.offset = level.offset;
+    ++level.index;
+    level.offset = UNKNOWN_OFFSET;
+    return true;
   }
 
-  if (hdr.m_ver != PORTABLE_STORAGE_FORMAT_VER) {
-    throw std::runtime_error("Unknown binary storage format version");
+  // start at the entry following the previous match and wrap around once
+  size_t index = level.index;
+  size_t offset = level.offset;
+  Common::StringView entryName;
+  for (size_t scanned = 0; scanned < level.count; ++scanned) {
+    if (index == level.count) {
+      index = 0;
+      offset = level.firstOffset;
+    }
+
+    readEntry(offset, entryName, value);
+    ++index;
+    if (entryName == name) {
+      level.index = index;
+      level.offset = UNKNOWN_OFFSET;
+      return true;
+    }
+
+    offset = skipValue(value);
+    if (index > level.knownIndex) {
+      level.knownIndex = index;
+      level.knownOffset = offset;
+    }
   }
 
-  return loadSection(stream);
-}
-
+  return false;
 }
 
-KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(Common::IInputStream& strm) : JsonInputValueSerializer(parseBinary(strm)) {
+void KVBinaryInputStreamSerializer::valueRead(size_t end) {
+  Level& level = m_stack.back();
+  level.offset = end;
+  if (!level.isArray && level.index > level.knownIndex) {
+    level.knownIndex = level.index;
+    level.knownOffset = end;
+  }
 }
 
-bool KVBinaryInputStreamSerializer::binary(void* value, size_t size, Common::StringView name) {
-  std::string str;
-
-  if (!(*this)(str, name)) {
+bool KVBinaryInputStreamSerializer::readString(Common::StringView name, Common::StringView& value) {
+  Value v;
+  if (!findValue(name, v)) {
     return false;
   }
 
-  if (str.size() != size) {
-    throw std::runtime_error("Binary block size mismatch");
+  if (v.type != BIN_KV_SERIALIZE_TYPE_STRING || v.isArray) {
+    throw std::runtime_error("String expected");
   }
 
-  memcpy(value, str.data(), size);
+  size_t size = readVarint(v.offset);
+  value = Common::StringView(reinterpret_cast<const char*>(take(v.offset, size)), size);
+  valueRead(v.offset);
   return true;
 }
 
-bool KVBinaryInputStreamSerializer::binary(std::string& value, Common::StringView name) {
-  return (*this)(value, name); // load as string
-}
+template <typename T>
+bool KVBinaryInputStreamSerializer::readNumber(Common::StringView name, T& value) {
+  Value v;
+  if (!findValue(name, v)) {
+    return false;
+  }
+
+  if (v.isArray) {
+    throw std::runtime_error("Number expected");
+  }
+
+  const uint8_t* data = take(v.offset, itemSize(v.type));
+  switch (v.type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:  value = static_cast<T>(readPod<int64_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_INT32:  value = static_cast<T>(readPod<int32_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_INT16:  value = static_cast<T>(readPod<int16_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_INT8:   value = static_cast<T>(readPod<int8_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_UINT64: value = static_cast<T>(readPod<uint64_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_UINT32: value = static_cast<T>(readPod<uint32_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_UINT16: value = static_cast<T>(readPod<uint16_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_UINT8:  value = static_cast<T>(readPod<uint8_t>(data)); break;
+  case BIN_KV_SERIALIZE_TYPE_DOUBLE: value = static_cast<T>(readPod<double>(data)); break;
+  default:
+    throw std::runtime_error("Number expected");
+  }
 
+  valueRead(v.offset);
+  return true;
+}
@@ -18,18 +18,93 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include <Common/IInputStream.h>
 #include "ISerializer.h"
-#include "JsonInputValueSerializer.h"
 
 namespace DynexCN {
 
-class KVBinaryInputStreamSerializer : public JsonInputValueSerializer {
+// Reads the portable storage (KV-binary) format straight from the payload buffer. Entries of a section are looked up
+// from the position after the previous match, so fields read in the order they were written cost a single pass and
+// strings are copied only into their destination. Out of order fields are found by rescanning the section.
+class KVBinaryInputStreamSerializer : public ISerializer {
 public:
+  // The buffer must outlive the serializer
+  KVBinaryInputStreamSerializer(const void* data, size_t size);
   KVBinaryInputStreamSerializer(Common::IInputStream& strm);
+  virtual ~KVBinaryInputStreamSerializer();
+
+  virtual SerializerType type() const override;
+
+  virtual bool beginObject(Common::StringView name) override;
+  virtual void endObject() override;
 
+  virtual bool beginArray(size_t& size, Common::StringView name) override;
+  virtual void endArray() override;
+
+  virtual bool operator()(uint8_t& value, Common::StringView name) override;
+  virtual bool operator()(int16_t& value, Common::StringView name) override;
+  virtual bool operator()(uint16_t& value, Common::StringView name) override;
+  virtual bool operator()(int32_t& value, Common::StringView name) override;
+  virtual bool operator()(uint32_t& value, Common::StringView name) override;
+  virtual bool operator()(int64_t& value, Common::StringView name) override;
+  virtual bool operator()(uint64_t& value, Common::StringView name) override;
+  virtual bool operator()(double& value, Common::StringView name) override;
+  virtual bool operator()(bool& value, Common::StringView name) override;
+  virtual bool operator()(std::string& value, Common::StringView name) override;
   virtual bool binary(void* value, size_t size, Common::StringView name) override;
   virtual bool binary(std::string& value, Common::StringView name) override;
+
+  template<typename T>
+  bool operator()(T& value, Common::StringView name) {
+    return ISerializer::operator()(value, name);
+  }
+
+private:
+  struct Value {
+    uint8_t type;
+    bool isArray;
+    size_t count;
+    size_t offset;
+  };
+
+  // A section being read or an array whose items are read in order
+  struct Level {
+    bool isArray;
+    uint8_t itemType;
+    size_t count;
+    // next entry or item and its position, the position is unknown while the previous value is being read
+    size_t index;
+    size_t offset;
+    // sections only: first entry and the furthest entry whose position is known
+    size_t firstOffset;
+    size_t knownIndex;
+    size_t knownOffset;
+  };
+
+  std::string m_buffer;
+  const uint8_t* m_data;
+  size_t m_size;
+  std::vector<Level> m_stack;
+
+  void readHeader();
+  const uint8_t* take(size_t& offset, size_t size) const;
+  size_t readVarint(size_t& offset) const;
+  size_t readCount(size_t& offset) const;
+  void readEntry(size_t& offset, Common::StringView& name, Value& value) const;
+  size_t skipValue(const Value& value) const;
+  size_t skipItem(uint8_t type, size_t offset) const;
+  size_t skipEntries(size_t count, size_t offset) const;
+
+  void pushSection(size_t offset);
+  bool findValue(Common::StringView name, Value& value);
+  void valueRead(size_t end);
+  bool readString(Common::StringView name, Common::StringView& value);
+
+  template <typename T>
+  bool readNumber(Common::StringView name, T& value);
 };
 
 }
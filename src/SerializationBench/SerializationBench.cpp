@@ -0,0 +1,339 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+// Decodes a large NOTIFY_RESPONSE_GET_OBJECTS payload with the streaming KV-binary serializer and with the
+// previous two pass decoder, which built a JsonValue tree first and then walked it. Reports time and heap
+// allocations per decode.
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "Common/BenchmarkReport.h"
+#include "Common/CommandLine.h"
+#include "Common/JsonValue.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/StreamTools.h"
+#include "Common/StringOutputStream.h"
+#include "DynexCNProtocol/DynexCNProtocolDefinitions.h"
+#include "Serialization/JsonInputValueSerializer.h"
+#include "Serialization/KVBinaryCommon.h"
+#include "Serialization/KVBinaryInputStreamSerializer.h"
+#include "Serialization/KVBinaryOutputStreamSerializer.h"
+
+namespace po = boost::program_options;
+using Common::JsonValue;
+using namespace DynexCN;
+
+namespace {
+  std::atomic<uint64_t> allocationCount(0);
+  std::atomic<uint64_t> allocatedBytes(0);
+}
+
+void* operator new(size_t size) {
+  ++allocationCount;
+  allocatedBytes += size;
+  void* p = std::malloc(size != 0 ? size : 1);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+  const command_line::arg_descriptor<uint32_t> arg_blocks = {"blocks", "blocks in the response", 200};
+  const command_line::arg_descriptor<uint32_t> arg_transactions = {"transactions", "transactions per block", 20};
+  const command_line::arg_descriptor<uint32_t> arg_transaction_size = {"transaction-size", "bytes per transaction blob", 2000};
+  const command_line::arg_descriptor<uint32_t> arg_iterations = {"iterations", "decodes per run", 20};
+
+  // The decoder replaced by the streaming serializer, kept as the baseline
+  namespace tree {
+    size_t readVarint(Common::IInputStream& s) {
+      uint8_t b = Common::read<uint8_t>(s);
+      size_t bytesLeft = 0;
+      switch (b & PORTABLE_RAW_SIZE_MARK_MASK) {
+      case PORTABLE_RAW_SIZE_MARK_WORD: bytesLeft = 1; break;
+      case PORTABLE_RAW_SIZE_MARK_DWORD: bytesLeft = 3; break;
+      case PORTABLE_RAW_SIZE_MARK_INT64: bytesLeft = 7; break;
+      }
+
+      size_t value = b;
+      for (size_t i = 1; i <= bytesLeft; ++i) {
+        size_t n = Common::read<uint8_t>(s);
+        value |= n << (i * 8);
+      }
+
+      return value >> 2;
+    }
+
+    template <typename T>
+    JsonValue readInteger(Common::IInputStream& s) {
+      T v;
+      Common::read(s, &v, sizeof(v));
+      return JsonValue(static_cast<int64_t>(v));
+    }
+
+    JsonValue loadSection(Common::IInputStream& s);
+    JsonValue loadArray(Common::IInputStream& s, uint8_t itemType);
+
+    JsonValue loadValue(Common::IInputStream& s, uint8_t type) {
+      switch (type) {
+      case BIN_KV_SERIALIZE_TYPE_INT64:  return readInteger<int64_t>(s);
+      case BIN_KV_SERIALIZE_TYPE_INT32:  return readInteger<int32_t>(s);
+      case BIN_KV_SERIALIZE_TYPE_INT16:  return readInteger<int16_t>(s);
+      case BIN_KV_SERIALIZE_TYPE_INT8:   return readInteger<int8_t>(s);
+      case BIN_KV_SERIALIZE_TYPE_UINT64: return readInteger<uint64_t>(s);
+      case BIN_KV_SERIALIZE_TYPE_UINT32: return readInteger<uint32_t>(s);
+      case BIN_KV_SERIALIZE_TYPE_UINT16: return readInteger<uint16_t>(s);
+      case BIN_KV_SERIALIZE_TYPE_UINT8:  return readInteger<uint8_t>(s);
+      case BIN_KV_SERIALIZE_TYPE_BOOL:   return JsonValue(Common::read<uint8_t>(s) != 0);
+      case BIN_KV_SERIALIZE_TYPE_STRING: {
+        std::string str(readVarint(s), '\0');
+        if (!str.empty()) {
+          Common::read(s, &str[0], str.size());
+        }
+
+        return JsonValue(str);
+      }
+      case BIN_KV_SERIALIZE_TYPE_OBJECT: return loadSection(s);
+      default:
+        throw std::runtime_error("Unsupported data type");
+      }
+    }
+
+    JsonValue loadArray(Common::IInputStream& s, uint8_t itemType) {
+      JsonValue arr(JsonValue::ARRAY);
+      size_t count = readVarint(s);
+      while (count--) {
+        arr.pushBack(loadValue(s, itemType));
+      }
+
+      return arr;
+    }
+
+    JsonValue loadSection(Common::IInputStream& s) {
+      JsonValue sec(JsonValue::OBJECT);
+      size_t count = readVarint(s);
+      std::string name;
+      while (count--) {
+        name.resize(Common::read<uint8_t>(s));
+        Common::read(s, &name[0], name.size());
+        uint8_t type = Common::read<uint8_t>(s);
+        if (type & BIN_KV_SERIALIZE_FLAG_ARRAY) {
+          sec.insert(name, loadArray(s, type & ~BIN_KV_SERIALIZE_FLAG_ARRAY));
+        } else {
+          sec.insert(name, loadValue(s, type));
+        }
+      }
+
+      return sec;
+    }
+
+    JsonValue parse(const std::string& buffer) {
+      Common::MemoryInputStream s(buffer.data(), buffer.size());
+      KVBinaryStorageBlockHeader hdr;
+      Common::read(s, &hdr, sizeof(hdr));
+      if (hdr.m_signature_a != PORTABLE_STORAGE_SIGNATUREA || hdr.m_signature_b != PORTABLE_STORAGE_SIGNATUREB) {
+        throw std::runtime_error("Invalid binary storage signature");
+      }
+
+      return loadSection(s);
+    }
+
+    class Serializer : public DynexCN::JsonInputValueSerializer {
+    public:
+      Serializer(const std::string& buffer) : JsonInputValueSerializer(parse(buffer)) {
+      }
+
+      virtual bool binary(void* value, size_t size, Common::StringView name) override {
+        std::string str;
+        if (!(*this)(str, name)) {
+          return false;
+        }
+
+        if (str.size() != size) {
+          throw std::runtime_error("Binary block size mismatch");
+        }
+
+        memcpy(value, str.data(), size);
+        return true;
+      }
+
+      virtual bool binary(std::string& value, Common::StringView name) override {
+        return (*this)(value, name);
+      }
+    };
+  }
+
+  struct RunResult {
+    std::string decoder;
+    double seconds;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+  };
+
+  template <typename Decode>
+  RunResult run(const std::string& decoder, uint32_t iterations, const DynexCN::NOTIFY_RESPONSE_GET_OBJECTS_request& expected, Decode decode) {
+    RunResult result = { decoder, 0, 0, 0 };
+    for (uint32_t i = 0; i < iterations; ++i) {
+      DynexCN::NOTIFY_RESPONSE_GET_OBJECTS_request value;
+      uint64_t allocationsBefore = allocationCount;
+      uint64_t bytesBefore = allocatedBytes;
+      auto start = std::chrono::steady_clock::now();
+      decode(value);
+      result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      result.allocations += allocationCount - allocationsBefore;
+      result.allocatedBytes += allocatedBytes - bytesBefore;
+
+      if (value.blocks.size() != expected.blocks.size() || value.current_blockchain_height != expected.current_blockchain_height ||
+          value.missed_ids.size() != expected.missed_ids.size() || (!value.blocks.empty() && value.blocks.back().txs != expected.blocks.back().txs)) {
+        throw std::runtime_error(decoder + " decoded a different response");
+      }
+    }
+
+    return result;
+  }
+
+  JsonValue toJson(const RunResult& result, uint32_t iterations) {
+    JsonValue run(JsonValue::OBJECT);
+    run.insert("decoder", result.decoder);
+    run.insert("seconds", result.seconds);
+    run.insert("decode_time_us", result.seconds * 1000000 / iterations);
+    run.insert("allocations_per_decode", static_cast<int64_t>(result.allocations / iterations));
+    run.insert("allocated_bytes_per_decode", static_cast<int64_t>(result.allocatedBytes / iterations));
+    return run;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  po::options_description desc_general("General options");
+  command_line::add_arg(desc_general, command_line::arg_help);
+
+  po::options_description desc_params("Benchmark options");
+  command_line::add_arg(desc_params, arg_blocks);
+  command_line::add_arg(desc_params, arg_transactions);
+  command_line::add_arg(desc_params, arg_transaction_size);
+  command_line::add_arg(desc_params, arg_iterations);
+  command_line::add_arg(desc_params, Common::arg_benchmark_output);
+
+  po::options_description desc_all;
+  desc_all.add(desc_general).add(desc_params);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_all, [&]() {
+    po::store(command_line::parse_command_line(argc, argv, desc_all), vm);
+    if (command_line::get_arg(vm, command_line::arg_help)) {
+      std::cout << desc_all << std::endl;
+      return false;
+    }
+
+    po::notify(vm);
+    return true;
+  });
+
+  if (!r) {
+    return 1;
+  }
+
+  uint32_t blocks = command_line::get_arg(vm, arg_blocks);
+  uint32_t transactions = command_line::get_arg(vm, arg_transactions);
+  uint32_t transactionSize = command_line::get_arg(vm, arg_transaction_size);
+  uint32_t iterations = std::max<uint32_t>(command_line::get_arg(vm, arg_iterations), 1);
+
+  return Common::runBenchmark(vm, [&] {
+    DynexCN::NOTIFY_RESPONSE_GET_OBJECTS_request request;
+    request.current_blockchain_height = 1000000;
+    request.missed_ids.resize(4);
+    for (uint32_t b = 0; b < blocks; ++b) {
+      DynexCN::block_complete_entry entry;
+      entry.block.assign(transactionSize / 2 + b % 64, static_cast<char>(b));
+      for (uint32_t t = 0; t < transactions; ++t) {
+        entry.txs.push_back(std::string(transactionSize + t % 32, static_cast<char>(t)));
+      }
+
+      request.blocks.push_back(std::move(entry));
+    }
+
+    std::string payload;
+    {
+      DynexCN::KVBinaryOutputStreamSerializer serializer;
+      serialize(request, serializer);
+      Common::StringOutputStream stream(payload);
+      serializer.dump(stream);
+    }
+
+    RunResult streaming = run("streaming", iterations, request, [&](DynexCN::NOTIFY_RESPONSE_GET_OBJECTS_request& value) {
+      DynexCN::KVBinaryInputStreamSerializer serializer(payload.data(), payload.size());
+      serialize(value, serializer);
+    });
+
+    RunResult jsonTree = run("json_tree", iterations, request, [&](DynexCN::NOTIFY_RESPONSE_GET_OBJECTS_request& value) {
+      tree::Serializer serializer(payload);
+      serialize(value, serializer);
+    });
+
+    JsonValue runs(JsonValue::ARRAY);
+    runs.pushBack(toJson(jsonTree, iterations));
+    runs.pushBack(toJson(streaming, iterations));
+
+    JsonValue report(JsonValue::OBJECT);
+    report.insert("blocks", static_cast<int64_t>(blocks));
+    report.insert("transactions_per_block", static_cast<int64_t>(transactions));
+    report.insert("payload_size", static_cast<int64_t>(payload.size()));
+    report.insert("iterations", static_cast<int64_t>(iterations));
+    report.insert("runs", std::move(runs));
+    report.insert("speedup", jsonTree.seconds / streaming.seconds);
+
+    return report;
+  });
+}
@@ -0,0 +1,160 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+// Measures CryptoNight throughput in hashes/s per core: one hash at a time as block validation does it, two
+// interleaved hashes on one thread, and the batch API on all requested threads.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "Common/BenchmarkReport.h"
+#include "Common/CommandLine.h"
+#include "Common/JsonValue.h"
+#include "crypto/hash.h"
+
+namespace po = boost::program_options;
+using Common::JsonValue;
+
+namespace {
+  const command_line::arg_descriptor<uint32_t> arg_hashes = {"hashes", "blobs hashed per run", 256};
+  const command_line::arg_descriptor<uint32_t> arg_threads = {"threads", "threads of the batch run, 0 for one per core", 0};
+  const command_line::arg_descriptor<uint32_t> arg_blob_size = {"blob-size", "bytes per blob, a block hashing blob is about 80", 80};
+
+  JsonValue toJson(const std::string& mode, size_t threads, size_t hashes, double seconds) {
+    JsonValue run(JsonValue::OBJECT);
+    run.insert("mode", mode);
+    run.insert("threads", static_cast<int64_t>(threads));
+    run.insert("seconds", seconds);
+    run.insert("hashes_per_second", hashes / seconds);
+    run.insert("hashes_per_second_per_core", hashes / seconds / threads);
+    return run;
+  }
+
+  double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+int main(int argc, char* argv[]) {
+  po::options_description desc_general("General options");
+  command_line::add_arg(desc_general, command_line::arg_help);
+
+  po::options_description desc_params("Benchmark options");
+  command_line::add_arg(desc_params, arg_hashes);
+  command_line::add_arg(desc_params, arg_threads);
+  command_line::add_arg(desc_params, arg_blob_size);
+  command_line::add_arg(desc_params, Common::arg_benchmark_output);
+
+  po::options_description desc_all;
+  desc_all.add(desc_general).add(desc_params);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_all, [&]() {
+    po::store(command_line::parse_command_line(argc, argv, desc_all), vm);
+    if (command_line::get_arg(vm, command_line::arg_help)) {
+      std::cout << desc_all << std::endl;
+      return false;
+    }
+
+    po::notify(vm);
+    return true;
+  });
+
+  if (!r) {
+    return 1;
+  }
+
+  uint32_t hashes = std::max<uint32_t>(command_line::get_arg(vm, arg_hashes), 2) & ~1u;
+  uint32_t blobSize = command_line::get_arg(vm, arg_blob_size);
+  size_t threads = command_line::get_arg(vm, arg_threads);
+  if (threads == 0) {
+    threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  threads = std::min<size_t>(threads, hashes / 2);
+
+  return Common::runBenchmark(vm, [&] {
+    std::vector<std::vector<uint8_t>> blobs(hashes);
+    for (uint32_t i = 0; i < hashes; ++i) {
+      blobs[i].resize(blobSize);
+      for (uint32_t j = 0; j < blobSize; ++j) {
+        blobs[i][j] = static_cast<uint8_t>(i * 31 + j * 7);
+      }
+    }
+
+    std::vector<Crypto::Hash> expected(hashes);
+    Crypto::cn_context context;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < hashes; ++i) {
+      Crypto::cn_slow_hash(context, blobs[i].data(), blobs[i].size(), expected[i]);
+    }
+    double single = secondsSince(start);
+
+    std::vector<Crypto::Hash> interleaved;
+    start = std::chrono::steady_clock::now();
+    Crypto::cn_slow_hash_batch(blobs, interleaved, 1);
+    double x2 = secondsSince(start);
+
+    std::vector<Crypto::Hash> batch;
+    start = std::chrono::steady_clock::now();
+    Crypto::cn_slow_hash_batch(blobs, batch, threads);
+    double parallel = secondsSince(start);
+
+    if (interleaved != expected || batch != expected) {
+      throw std::runtime_error("batch hashes differ from cn_slow_hash");
+    }
+
+    JsonValue runs(JsonValue::ARRAY);
+    runs.pushBack(toJson("single", 1, hashes, single));
+    runs.pushBack(toJson("interleaved_x2", 1, hashes, x2));
+    runs.pushBack(toJson("batch", threads, hashes, parallel));
+
+    JsonValue report(JsonValue::OBJECT);
+    report.insert("hashes", static_cast<int64_t>(hashes));
+    report.insert("blob_size", static_cast<int64_t>(blobSize));
+    report.insert("huge_pages", JsonValue(Crypto::cn_scratchpads_on_huge_pages()));
+    report.insert("runs", std::move(runs));
+
+    return report;
+  });
+}
@@ -42,7 +42,6 @@
 
 #include "CommonTypes.h"
 #include "Common/StringTools.h"
-#include "Common/BlockingQueue.h"
 #include "DynexCNCore/DynexCNFormatUtils.h"
 #include "DynexCNCore/TransactionApi.h"
 
@@ -61,6 +60,10 @@ namespace {
 
 using namespace DynexCN;
 
+const std::chrono::seconds SYNC_SPEED_WINDOW(10);
+// transactions whose global output indices are kept, so a retried batch does not query the node again
+const size_t GLOBAL_INDICES_CACHE_SIZE = 10000;
+
 void checkOutputKey(
   const KeyDerivation& derivation,
   const PublicKey& key,
@@ -138,10 +141,35 @@ std::vector<Crypto::Hash> getBlockHashes(const DynexCN::CompleteBlock* blocks, s
 namespace DynexCN {
 
 TransfersConsumer::TransfersConsumer(const DynexCN::Currency& currency, INode& node, Logging::ILogger& logger, const SecretKey& viewSecret) :
-  m_node(node), m_viewSecret(viewSecret), m_currency(currency), m_logger(logger, "TransfersConsumer") {
+  m_node(node), m_viewSecret(viewSecret), m_currency(currency), m_logger(logger, "TransfersConsumer"), m_scanThreads(0) {
   updateSyncStart();
 }
 
+void TransfersConsumer::setScanThreads(size_t threadCount) {
+  if (threadCount != m_scanThreads) {
+    m_scanThreads = threadCount;
+    m_scanPool.reset();
+  }
+}
+
+double TransfersConsumer::getSyncSpeed() const {
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lk(m_syncSpeedMutex);
+
+  uint64_t blocks = 0;
+  auto oldest = now;
+  for (const auto& entry : m_syncedBlocks) {
+    if (now - entry.first <= SYNC_SPEED_WINDOW) {
+      blocks += entry.second;
+      oldest = std::min(oldest, entry.first);
+    }
+  }
+
+  // the first batch in the window was scanned before its timestamp was taken, count at least a second for it
+  std::chrono::duration<double> elapsed = std::max<std::chrono::steady_clock::duration>(now - oldest, std::chrono::seconds(1));
+  return blocks / elapsed.count();
+}
+
 ITransfersSubscription& TransfersConsumer::addSubscription(const AccountSubscription& subscription) {
   if (subscription.keys.viewSecretKey != m_viewSecret) {
     throw std::runtime_error("TransfersConsumer: view secret key mismatch");
@@ -152,20 +180,24 @@ ITransfersSubscription& TransfersConsumer::addSubscription(const AccountSubscrip
   if (res.get() == nullptr) {
     res.reset(new TransfersSubscription(m_currency, m_logger.getLogger(), subscription));
     m_spendKeys.insert(subscription.keys.address.spendPublicKey);
-    if (m_subscriptions.size() == 1) {
-      m_syncStart = res->getSyncStart();
-    } else {
-      auto subStart = res->getSyncStart();
-      m_syncStart.height = std::min(m_syncStart.height, subStart.height);
-      m_syncStart.timestamp = std::min(m_syncStart.timestamp, subStart.timestamp);
-    }
+    auto subStart = res->getSyncStart();
+    m_syncStartHeights.insert(subStart.height);
+    m_syncStartTimestamps.insert(subStart.timestamp);
+    updateSyncStart();
   }
 
   return *res;
 }
 
 bool TransfersConsumer::removeSubscription(const AccountPublicAddress& address) {
-  m_subscriptions.erase(address.spendPublicKey);
+  auto it = m_subscriptions.find(address.spendPublicKey);
+  if (it != m_subscriptions.end()) {
+    auto subStart = it->second->getSyncStart();
+    m_syncStartHeights.erase(m_syncStartHeights.find(subStart.height));
+    m_syncStartTimestamps.erase(m_syncStartTimestamps.find(subStart.timestamp));
+    m_subscriptions.erase(it);
+  }
+
   m_spendKeys.erase(address.spendPublicKey);
   updateSyncStart();
   return m_subscriptions.empty();
@@ -198,14 +230,8 @@ void TransfersConsumer::initTransactionPool(const std::unordered_set<Crypto::Has
 void TransfersConsumer::updateSyncStart() {
   SynchronizationStart start;
 
-  start.height =   std::numeric_limits<uint64_t>::max();
-  start.timestamp = std::numeric_limits<uint64_t>::max();
-
-  for (const auto& kv : m_subscriptions) {
-    auto subStart = kv.second->getSyncStart();
-    start.height = std::min(start.height, subStart.height);
-    start.timestamp = std::min(start.timestamp, subStart.timestamp);
-  }
+  start.height = m_syncStartHeights.empty() ? std::numeric_limits<uint64_t>::max() : *m_syncStartHeights.begin();
+  start.timestamp = m_syncStartTimestamps.empty() ? std::numeric_limits<uint64_t>::max() : *m_syncStartTimestamps.begin();
 
   m_syncStart = start;
 }
@@ -217,6 +243,10 @@ SynchronizationStart TransfersConsumer::getSyncStart() {
 void TransfersConsumer::onBlockchainDetach(uint32_t height) {
   m_observerManager.notify(&IBlockchainConsumerObserver::onBlockchainDetach, this, height);
 
+  // a transaction that comes back in a different block gets new global indices
+  m_globalIndicesCache.clear();
+  m_globalIndicesCacheIndex.clear();
+
   for (const auto& kv : m_subscriptions) {
     kv.second->onBlockchainDetach(height);
   }
@@ -231,101 +261,111 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
     const ITransactionReader* tx;
   };
 
-  struct PreprocessedTx : Tx, PreprocessInfo {};
+  struct PreprocessedTx : Tx, PreprocessInfo {
+    std::unordered_map<PublicKey, std::vector<uint32_t>> myOutputs;
+  };
 
+  // transactions are laid out in (height, index in block) order, every worker fills the slots it takes
   std::vector<PreprocessedTx> preprocessedTransactions;
-  std::mutex preprocessedTransactionsMutex;
+  for (uint32_t i = 0; i < count; ++i) {
+    const auto& block = blocks[i].block;
 
-  size_t workers = std::thread::hardware_concurrency();
-  if (workers == 0) {
-    workers = 2;
-  }
-
-  BlockingQueue<Tx> inputQueue(workers * 2);
+    if (!block.is_initialized()) {
+      continue;
+    }
 
-  std::atomic<bool> stopProcessing(false);
+    // filter by syncStartTimestamp
+    if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
+      continue;
+    }
 
-  auto pushingThread = std::async(std::launch::async, [&] {
-    for( uint32_t i = 0; i < count && !stopProcessing; ++i) {
-      const auto& block = blocks[i].block;
+    TransactionBlockInfo blockInfo;
+    blockInfo.height = startHeight + i;
+    blockInfo.timestamp = block->timestamp;
+    blockInfo.transactionIndex = 0; // position in block
 
-      if (!block.is_initialized()) {
+    for (const auto& tx : blocks[i].transactions) {
+      auto pubKey = tx->getTransactionPublicKey();
+      if (pubKey == NULL_PUBLIC_KEY) {
+        ++blockInfo.transactionIndex;
         continue;
       }
 
-      // filter by syncStartTimestamp
-      if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
-        continue;
-      }
+      preprocessedTransactions.emplace_back();
+      preprocessedTransactions.back().blockInfo = blockInfo;
+      preprocessedTransactions.back().tx = tx.get();
+      ++blockInfo.transactionIndex;
+    }
+  }
 
-      TransactionBlockInfo blockInfo;
-      blockInfo.height = startHeight + i;
-      blockInfo.timestamp = block->timestamp;
-      blockInfo.transactionIndex = 0; // position in block
+  if (!m_scanPool) {
+    m_scanPool.reset(new Tools::WorkerPool(m_scanThreads));
+  }
 
-      for (const auto& tx : blocks[i].transactions) {
-        auto pubKey = tx->getTransactionPublicKey();
-        if (pubKey == NULL_PUBLIC_KEY) {
-          ++blockInfo.transactionIndex;
-          continue;
-        }
+  // runs task over slots [0, size) on the scan pool, the error of the lowest failed slot wins
+  auto scan = [this](size_t size, const std::function<std::error_code(size_t)>& task) {
+    std::vector<std::error_code> errors(size);
+    m_scanPool->parallelFor(size, [&](size_t i) {
+      try {
+        errors[i] = task(i);
+      } catch (const std::system_error& e) {
+        errors[i] = e.code();
+      } catch (const std::exception&) {
+        errors[i] = std::make_error_code(std::errc::operation_canceled);
+      }
 
-        Tx item = { blockInfo, tx.get() };
-        inputQueue.push(item);
-        ++blockInfo.transactionIndex;
+      return !errors[i];
+    });
+
+    for (const auto& ec : errors) {
+      if (ec) {
+        return ec;
       }
     }
 
-    inputQueue.close();
-  });
+    return std::error_code();
+  };
 
-  auto processingFunction = [&] {
-    Tx item;
-    std::error_code ec;
-    while (!stopProcessing && inputQueue.pop(item)) {
-      PreprocessedTx output;
-      static_cast<Tx&>(output) = item;
+  std::error_code processingError = scan(preprocessedTransactions.size(), [&](size_t i) {
+    PreprocessedTx& output = preprocessedTransactions[i];
+    findMyOutputs(*output.tx, m_viewSecret, m_spendKeys, output.myOutputs);
+    return std::error_code();
+  });
 
-      ec = preprocessOutputs(item.blockInfo, *item.tx, output);
-      if (ec) {
-        stopProcessing = true;
-        break;
+  // global indices of every owned transaction in the batch are fetched with a single node request
+  std::vector<size_t> ownedTransactions;
+  if (!processingError) {
+    std::vector<Hash> ownedHashes;
+    for (size_t i = 0; i < preprocessedTransactions.size(); ++i) {
+      if (!preprocessedTransactions[i].myOutputs.empty()) {
+        ownedTransactions.push_back(i);
+        ownedHashes.push_back(preprocessedTransactions[i].tx->getTransactionHash());
       }
-
-      std::lock_guard<std::mutex> lk(preprocessedTransactionsMutex);
-      preprocessedTransactions.push_back(std::move(output));
     }
-    return ec;
-  };
 
-  std::vector<std::future<std::error_code>> processingThreads;
-  for (size_t i = 0; i < workers; ++i) {
-    processingThreads.push_back(std::async(std::launch::async, processingFunction));
-  }
+    std::vector<std::vector<uint32_t>> globalIndices;
+    if (!ownedHashes.empty()) {
+      processingError = getGlobalIndices(ownedHashes, globalIndices);
+    }
 
-  std::error_code processingError;
-  for (auto& f : processingThreads) {
-    try {
-      std::error_code ec = f.get();
-      if (!processingError && ec) {
-        processingError = ec;
+    if (!processingError) {
+      for (size_t i = 0; i < ownedTransactions.size(); ++i) {
+        preprocessedTransactions[ownedTransactions[i]].globalIdxs = std::move(globalIndices[i]);
       }
-    } catch (const std::system_error& e) {
-      processingError = e.code();
-    } catch (const std::exception&) {
-      processingError = std::make_error_code(std::errc::operation_canceled);
     }
   }
 
+  if (!processingError) {
+    processingError = scan(ownedTransactions.size(), [&](size_t i) {
+      PreprocessedTx& output = preprocessedTransactions[ownedTransactions[i]];
+      return preprocessTransfers(output.blockInfo, *output.tx, output.myOutputs, output);
+    });
+  }
+
   std::vector<Crypto::Hash> blockHashes = getBlockHashes(blocks, count);
   if (!processingError) {
     m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
 
-    // sort by block height and transaction index in block
-    std::sort(preprocessedTransactions.begin(), preprocessedTransactions.end(), [](const PreprocessedTx& a, const PreprocessedTx& b) {
-      return std::tie(a.blockInfo.height, a.blockInfo.transactionIndex) < std::tie(b.blockInfo.height, b.blockInfo.transactionIndex);
-    });
-
     for (const auto& tx : preprocessedTransactions) {
       processTransaction(tx.blockInfo, *tx.tx, tx);
     }
@@ -342,6 +382,15 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
     sub.advanceHeight(newHeight);
   });
 
+  {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lk(m_syncSpeedMutex);
+    m_syncedBlocks.emplace_back(now, count);
+    while (now - m_syncedBlocks.front().first > SYNC_SPEED_WINDOW) {
+      m_syncedBlocks.pop_front();
+    }
+  }
+
   return true;
 }
 
@@ -510,20 +559,26 @@ std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo&
     return std::error_code();
   }
 
-  std::error_code errorCode;
-  auto txHash = tx.getTransactionHash();
   if (blockInfo.height != WALLET_UNCONFIRMED_TRANSACTION_HEIGHT) {
-    errorCode = getGlobalIndices(reinterpret_cast<const Hash&>(txHash), info.globalIdxs);
+    std::vector<std::vector<uint32_t>> globalIndices;
+    auto errorCode = getGlobalIndices({ tx.getTransactionHash() }, globalIndices);
     if (errorCode) {
       return errorCode;
     }
+
+    info.globalIdxs = std::move(globalIndices.front());
   }
 
+  return preprocessTransfers(blockInfo, tx, outputs, info);
+}
+
+std::error_code TransfersConsumer::preprocessTransfers(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
+  const std::unordered_map<PublicKey, std::vector<uint32_t>>& outputs, PreprocessInfo& info) {
   for (const auto& kv : outputs) {
     auto it = m_subscriptions.find(kv.first);
     if (it != m_subscriptions.end()) {
       auto& transfers = info.outputs[kv.first];
-      errorCode = createTransfers(it->second->getKeys(), blockInfo, tx, kv.second, info.globalIdxs, transfers);
+      auto errorCode = createTransfers(it->second->getKeys(), blockInfo, tx, kv.second, info.globalIdxs, transfers);
       if (errorCode) {
         return errorCode;
       }
@@ -587,7 +642,27 @@ void TransfersConsumer::processOutputs(const TransactionBlockInfo& blockInfo, Tr
   }
 }
 
-std::error_code TransfersConsumer::getGlobalIndices(const Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices) {  
+std::error_code TransfersConsumer::getGlobalIndices(const std::vector<Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices) {
+  outsGlobalIndices.clear();
+  outsGlobalIndices.resize(transactionHashes.size());
+
+  std::vector<Hash> missingHashes;
+  std::vector<size_t> missingPositions;
+  for (size_t i = 0; i < transactionHashes.size(); ++i) {
+    auto it = m_globalIndicesCacheIndex.find(transactionHashes[i]);
+    if (it != m_globalIndicesCacheIndex.end()) {
+      m_globalIndicesCache.splice(m_globalIndicesCache.begin(), m_globalIndicesCache, it->second);
+      outsGlobalIndices[i] = it->second->second;
+    } else {
+      missingHashes.push_back(transactionHashes[i]);
+      missingPositions.push_back(i);
+    }
+  }
+
+  if (missingHashes.empty()) {
+    return std::error_code();
+  }
+
   std::promise<std::error_code> prom;
   std::future<std::error_code> f = prom.get_future();
 
@@ -596,10 +671,34 @@ std::error_code TransfersConsumer::getGlobalIndices(const Hash& transactionHash,
     p.set_value(ec);
   };
 
-  outsGlobalIndices.clear();
-  m_node.getTransactionOutsGlobalIndices(transactionHash, outsGlobalIndices, cb);
+  std::vector<std::vector<uint32_t>> fetchedIndices;
+  m_node.getTransactionsOutsGlobalIndices(missingHashes, fetchedIndices, cb);
+
+  auto ec = f.get();
+  if (ec) {
+    return ec;
+  }
 
-  return f.get();
+  if (fetchedIndices.size() != missingHashes.size()) {
+    return std::make_error_code(std::errc::bad_message);
+  }
+
+  for (size_t i = 0; i < missingHashes.size(); ++i) {
+    outsGlobalIndices[missingPositions[i]] = fetchedIndices[i];
+
+    if (m_globalIndicesCacheIndex.count(missingHashes[i]) != 0) {
+      continue;
+    }
+
+    m_globalIndicesCache.emplace_front(missingHashes[i], std::move(fetchedIndices[i]));
+    m_globalIndicesCacheIndex.emplace(missingHashes[i], m_globalIndicesCache.begin());
+    if (m_globalIndicesCache.size() > GLOBAL_INDICES_CACHE_SIZE) {
+      m_globalIndicesCacheIndex.erase(m_globalIndicesCache.back().first);
+      m_globalIndicesCache.pop_back();
+    }
+  }
+
+  return std::error_code();
 }
 
 }
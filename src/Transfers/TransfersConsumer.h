@@ -43,10 +43,17 @@
 #include "TypeHelpers.h"
 
 #include "crypto/crypto.h"
+#include "Common/WorkerPool.h"
 #include "Logging/LoggerRef.h"
 
 #include "IObservableImpl.h"
 
+#include <chrono>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <unordered_set>
 
 namespace DynexCN {
@@ -66,6 +73,11 @@ public:
 
   void initTransactionPool(const std::unordered_set<Crypto::Hash>& uncommitedTransactions);
   void addPublicKeysSeen(const Crypto::Hash& transactionHash, const Crypto::PublicKey& outputKey);
+
+  // 0 selects std::thread::hardware_concurrency(), takes effect with the next batch of blocks
+  void setScanThreads(size_t threadCount);
+  // blocks per second scanned over the last few seconds
+  double getSyncSpeed() const;
   
   // IBlockchainConsumer
   virtual SynchronizationStart getSyncStart() override;
@@ -92,17 +104,22 @@ private:
   };
 
   std::error_code preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info);
+  std::error_code preprocessTransfers(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
+    const std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>>& outputs, PreprocessInfo& info);
   std::error_code processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx);
   void processTransaction(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, const PreprocessInfo& info);
   void processOutputs(const TransactionBlockInfo& blockInfo, TransfersSubscription& sub, const ITransactionReader& tx,
     const std::vector<TransactionOutputInformationIn>& outputs, const std::vector<uint32_t>& globalIdxs, bool& contains, bool& updated);
   std::error_code createTransfers(const AccountKeys& account, const TransactionBlockInfo& blockInfo, const ITransactionReader& tx,
     const std::vector<uint32_t>& outputs, const std::vector<uint32_t>& globalIdxs, std::vector<TransactionOutputInformationIn>& transfers);
-  std::error_code getGlobalIndices(const Crypto::Hash& transactionHash, std::vector<uint32_t>& outsGlobalIndices);
+  std::error_code getGlobalIndices(const std::vector<Crypto::Hash>& transactionHashes, std::vector<std::vector<uint32_t>>& outsGlobalIndices);
 
   void updateSyncStart();
 
   SynchronizationStart m_syncStart;
+  // sync starts of all subscriptions, so removing one of many does not rescan the rest
+  std::multiset<uint64_t> m_syncStartHeights;
+  std::multiset<uint64_t> m_syncStartTimestamps;
   const Crypto::SecretKey m_viewSecret;
   // map { spend public key -> subscription }
   std::unordered_map<Crypto::PublicKey, std::unique_ptr<TransfersSubscription>> m_subscriptions;
@@ -112,6 +129,16 @@ private:
   INode& m_node;
   const DynexCN::Currency& m_currency;
   Logging::LoggerRef m_logger;
+
+  size_t m_scanThreads;
+  std::unique_ptr<Tools::WorkerPool> m_scanPool;
+
+  // LRU of transaction hash -> global output indices, most recent first
+  std::list<std::pair<Crypto::Hash, std::vector<uint32_t>>> m_globalIndicesCache;
+  std::unordered_map<Crypto::Hash, std::list<std::pair<Crypto::Hash, std::vector<uint32_t>>>::iterator> m_globalIndicesCacheIndex;
+
+  mutable std::mutex m_syncSpeedMutex;
+  std::deque<std::pair<std::chrono::steady_clock::time_point, uint32_t>> m_syncedBlocks;
 };
 
 }
@@ -36,9 +36,16 @@
 
 
 #include "TransfersContainer.h"
+
+#include <algorithm>
+#include <ctime>
+#include <limits>
+
 #include "IWalletLegacy.h"
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/StringOutputStream.h"
 #include "DynexCNCore/DynexCNBasicImpl.h"
 #include "DynexCNCore/DynexCNFormatUtils.h"
 #include "Serialization/BinaryInputStreamSerializer.h"
@@ -118,6 +125,15 @@ namespace {
   TransferIteratorList<TIterator> createTransferIteratorList(const std::pair<TIterator, TIterator>& itPair) {
     return TransferIteratorList<TIterator>(itPair.first, itPair.second);
   }
+
+  template<typename Element>
+  Hash getRecordDigest(const Element& element) {
+    std::string blob;
+    StringOutputStream stream(blob);
+    BinaryOutputStreamSerializer s(stream);
+    s(const_cast<Element&>(element), "");
+    return cn_fast_hash(blob.data(), blob.size());
+  }
 }
 
 
@@ -192,7 +208,39 @@ TransfersContainer::TransfersContainer(const Currency& currency, Logging::ILogge
   m_currentHeight(0),
   m_currency(currency),
   m_logger(logger, "TransfersContainer"),
-  m_transactionSpendableAge(transactionSpendableAge) {
+  m_transactionSpendableAge(transactionSpendableAge),
+  m_unlockCheckHeight(0),
+  m_nextUnlockTime(std::numeric_limits<uint64_t>::max()),
+  m_savedHeight(0),
+  m_trackChanges(false) {
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+template<typename Element>
+void TransfersContainer::recordInserted(RecordChanges<Element>& changes, const Element& element) {
+  if (m_trackChanges) {
+    Hash digest = getRecordDigest(element);
+    // a saved record that comes back unchanged cancels its removal
+    if (changes.removed.erase(digest) == 0) {
+      changes.added.emplace(digest, element);
+    }
+  }
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+template<typename Element>
+void TransfersContainer::recordErased(RecordChanges<Element>& changes, const Element& element) {
+  if (m_trackChanges) {
+    Hash digest = getRecordDigest(element);
+    // a record added since the last save was never written, so it is just dropped
+    if (changes.added.erase(digest) == 0) {
+      changes.removed.insert(digest);
+    }
+  }
 }
 
 bool TransfersContainer::addTransaction(const TransactionBlockInfo& block, const ITransactionReader& tx,
@@ -261,8 +309,8 @@ void TransfersContainer::addTransaction(const TransactionBlockInfo& block, const
   }
 
   auto result = m_transactions.emplace(std::move(txInfo));
-  (void)result; // Disable unused warning
   assert(result.second);
+  recordInserted(m_transactionChanges, *result.first);
 }
 
 /**
@@ -296,8 +344,9 @@ bool TransfersContainer::addTransactionOutputs(const TransactionBlockInfo& block
 
     if (transferIsUnconfirmed) {
       auto result = m_unconfirmedTransfers.emplace(std::move(info));
-      (void)result; // Disable unused warning
       assert(result.second);
+      recordInserted(m_unconfirmedTransferChanges, *result.first);
+      onUnconfirmedTransferInserted(*result.first);
     } else {
       if (info.type == TransactionTypes::OutputType::Key) {
         bool duplicate = false;
@@ -334,8 +383,9 @@ bool TransfersContainer::addTransactionOutputs(const TransactionBlockInfo& block
       }
 
       auto result = m_availableTransfers.emplace(std::move(info));
-      (void)result; // Disable unused warning
       assert(result.second);
+      recordInserted(m_availableTransferChanges, *result.first);
+      onAvailableTransferInserted(*result.first);
     }
 
     if (info.type == TransactionTypes::OutputType::Key) {
@@ -418,6 +468,8 @@ bool TransfersContainer::addTransactionInputs(const TransactionBlockInfo& block,
       assert(spendingTransferIt->keyImage == input.keyImage);
       copyToSpent(block, tx, i, *spendingTransferIt);
       // erase from available outputs
+      recordErased(m_availableTransferChanges, *spendingTransferIt);
+      onAvailableTransferErased(*spendingTransferIt);
       outputDescriptorIndex.erase(spendingTransferIt);
       updateTransfersVisibility(input.keyImage);
 
@@ -431,6 +483,8 @@ bool TransfersContainer::addTransactionInputs(const TransactionBlockInfo& block,
       if (availableOutputIt != outputDescriptorIndex.end()) {
         copyToSpent(block, tx, i, *availableOutputIt);
         // erase from available outputs
+        recordErased(m_availableTransferChanges, *availableOutputIt);
+        onAvailableTransferErased(*availableOutputIt);
         outputDescriptorIndex.erase(availableOutputIt);
 
         inputsAdded = true;
@@ -453,6 +507,7 @@ bool TransfersContainer::deleteUnconfirmedTransaction(const Hash& transactionHas
     return false;
   } else {
     deleteTransactionTransfers(it->transactionHash);
+    recordErased(m_transactionChanges, *it);
     m_transactions.erase(it);
     return true;
   }
@@ -480,7 +535,9 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
   auto txInfo = *transactionIt;
   txInfo.blockHeight = block.height;
   txInfo.timestamp = block.timestamp;
+  recordErased(m_transactionChanges, *transactionIt);
   m_transactions.replace(transactionIt, txInfo);
+  recordInserted(m_transactionChanges, *transactionIt);
 
   auto availableRange = m_unconfirmedTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
   for (auto transferIt = availableRange.first; transferIt != availableRange.second; ) {
@@ -509,9 +566,12 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
     }
 
     auto result = m_availableTransfers.emplace(std::move(transfer));
-    (void)result; // Disable unused warning
     assert(result.second);
+    recordInserted(m_availableTransferChanges, *result.first);
+    onAvailableTransferInserted(*result.first);
 
+    recordErased(m_unconfirmedTransferChanges, *transferIt);
+    onUnconfirmedTransferErased(*transferIt);
     transferIt = m_unconfirmedTransfers.get<ContainingTransactionIndex>().erase(transferIt);
 
     if (transfer.type == TransactionTypes::OutputType::Key) {
@@ -526,7 +586,9 @@ bool TransfersContainer::markTransactionConfirmed(const TransactionBlockInfo& bl
     assert(transfer.spendingBlock.height == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT);
 
     transfer.spendingBlock = block;
+    recordErased(m_spentTransferChanges, *transferIt);
     spendingTransactionIndex.replace(transferIt, transfer);
+    recordInserted(m_spentTransferChanges, *transferIt);
   }
 
   return true;
@@ -544,6 +606,9 @@ void TransfersContainer::deleteTransactionTransfers(const Hash& transactionHash)
 
     auto result = m_availableTransfers.emplace(static_cast<const TransactionOutputInformationEx&>(*it));
     assert(result.second);
+    recordInserted(m_availableTransferChanges, *result.first);
+    onAvailableTransferInserted(*result.first);
+    recordErased(m_spentTransferChanges, *it);
     it = spendingTransactionIndex.erase(it);
 
     if (result.first->type == TransactionTypes::OutputType::Key) {
@@ -553,6 +618,8 @@ void TransfersContainer::deleteTransactionTransfers(const Hash& transactionHash)
 
   auto unconfirmedTransfersRange = m_unconfirmedTransfers.get<ContainingTransactionIndex>().equal_range(transactionHash);
   for (auto it = unconfirmedTransfersRange.first; it != unconfirmedTransfersRange.second;) {
+    recordErased(m_unconfirmedTransferChanges, *it);
+    onUnconfirmedTransferErased(*it);
     if (it->type == TransactionTypes::OutputType::Key) {
       KeyImage keyImage = it->keyImage;
       it = m_unconfirmedTransfers.get<ContainingTransactionIndex>().erase(it);
@@ -565,6 +632,8 @@ void TransfersContainer::deleteTransactionTransfers(const Hash& transactionHash)
   auto& transactionTransfersIndex = m_availableTransfers.get<ContainingTransactionIndex>();
   auto transactionTransfersRange = transactionTransfersIndex.equal_range(transactionHash);
   for (auto it = transactionTransfersRange.first; it != transactionTransfersRange.second;) {
+    recordErased(m_availableTransferChanges, *it);
+    onAvailableTransferErased(*it);
     if (it->type == TransactionTypes::OutputType::Key) {
       KeyImage keyImage = it->keyImage;
       it = transactionTransfersIndex.erase(it);
@@ -589,8 +658,8 @@ void TransfersContainer::copyToSpent(const TransactionBlockInfo& block, const IT
   spentOutput.spendingTransactionHash = tx.getTransactionHash();
   spentOutput.inputInTransaction = static_cast<uint32_t>(inputIndex);
   auto result = m_spentTransfers.emplace(std::move(spentOutput));
-  (void)result; // Disable unused warning
   assert(result.second);
+  recordInserted(m_spentTransferChanges, *result.first);
 }
 
 std::vector<Hash> TransfersContainer::detach(uint32_t height) {
@@ -624,12 +693,15 @@ std::vector<Hash> TransfersContainer::detach(uint32_t height) {
     if (doDelete) {
       deleteTransactionTransfers(it->transactionHash);
       deletedTransactions.emplace_back(it->transactionHash);
+      recordErased(m_transactionChanges, *it);
       it = blockHeightIndex.erase(it);
     }
   }
 
   // TODO: notification on detach
   m_currentHeight = height == 0 ? 0 : height - 1;
+  // lowering the height can lock outputs again
+  rebuildBalances();
 
   return deletedTransactions;
 }
@@ -663,6 +735,21 @@ void TransfersContainer::updateTransfersVisibility(const KeyImage& keyImage) {
   size_t spentCount = std::distance(spentRange.first, spentRange.second);
   assert(spentCount == 0 || spentCount == 1);
 
+  // replace() keeps the nodes in place, so the ranges stay valid while the visibility changes
+  for (auto it = unconfirmedRange.first; it != unconfirmedRange.second; ++it) {
+    recordErased(m_unconfirmedTransferChanges, *it);
+    onUnconfirmedTransferErased(*it);
+  }
+
+  for (auto it = availableRange.first; it != availableRange.second; ++it) {
+    recordErased(m_availableTransferChanges, *it);
+    onAvailableTransferErased(*it);
+  }
+
+  for (auto it = spentRange.first; it != spentRange.second; ++it) {
+    recordErased(m_spentTransferChanges, *it);
+  }
+
   if (spentCount > 0) {
     updateVisibility(unconfirmedIndex, unconfirmedRange, false);
     updateVisibility(availableIndex, availableRange, false);
@@ -681,6 +768,20 @@ void TransfersContainer::updateTransfersVisibility(const KeyImage& keyImage) {
   } else {
     updateVisibility(unconfirmedIndex, unconfirmedRange, unconfirmedCount == 1);
   }
+
+  for (auto it = unconfirmedRange.first; it != unconfirmedRange.second; ++it) {
+    recordInserted(m_unconfirmedTransferChanges, *it);
+    onUnconfirmedTransferInserted(*it);
+  }
+
+  for (auto it = availableRange.first; it != availableRange.second; ++it) {
+    recordInserted(m_availableTransferChanges, *it);
+    onAvailableTransferInserted(*it);
+  }
+
+  for (auto it = spentRange.first; it != spentRange.second; ++it) {
+    recordInserted(m_spentTransferChanges, *it);
+  }
 }
 
 bool TransfersContainer::advanceHeight(uint32_t height) {
@@ -706,20 +807,26 @@ size_t TransfersContainer::transactionsCount() const {
 
 uint64_t TransfersContainer::balance(uint32_t flags) const {
   std::lock_guard<std::mutex> lk(m_mutex);
+  updateUnlockedTransfers();
+
   uint64_t amount = 0;
+  if ((flags & IncludeStateUnlocked) != 0) {
+    amount += m_unlockedBalance.get(flags);
+  }
 
-  for (const auto& t : m_availableTransfers) {
-    if (t.visible && isIncluded(t, flags)) {
-      amount += t.amount;
+  uint32_t lockedStates = flags & (IncludeStateLocked | IncludeStateSoftLocked);
+  if (lockedStates == (IncludeStateLocked | IncludeStateSoftLocked)) {
+    amount += m_lockedBalance.get(flags);
+  } else if (lockedStates != 0) {
+    for (auto t : m_lockedTransfers) {
+      if (isIncluded(*t, flags)) {
+        amount += t->amount;
+      }
     }
   }
 
   if ((flags & IncludeStateLocked) != 0) {
-    for (const auto& t : m_unconfirmedTransfers) {
-      if (t.visible && isIncluded(t.type, IncludeStateLocked, flags)) {
-        amount += t.amount;
-      }
-    }
+    amount += m_unconfirmedBalance.get(flags);
   }
 
   return amount;
@@ -727,9 +834,21 @@ uint64_t TransfersContainer::balance(uint32_t flags) const {
 
 void TransfersContainer::getOutputs(std::vector<TransactionOutputInformation>& transfers, uint32_t flags) const {
   std::lock_guard<std::mutex> lk(m_mutex);
-  for (const auto& t : m_availableTransfers) {
-    if (t.visible && isIncluded(t, flags)) {
-      transfers.push_back(t);
+  updateUnlockedTransfers();
+
+  if ((flags & IncludeStateUnlocked) != 0) {
+    for (auto t : m_unlockedTransfers.get<AmountIndex>()) {
+      if (isIncluded(t->type, IncludeStateUnlocked, flags)) {
+        transfers.push_back(*t);
+      }
+    }
+  }
+
+  if ((flags & (IncludeStateLocked | IncludeStateSoftLocked)) != 0) {
+    for (auto t : m_lockedTransfers) {
+      if (isIncluded(*t, flags)) {
+        transfers.push_back(*t);
+      }
     }
   }
 
@@ -869,6 +988,90 @@ std::vector<TransactionSpentOutputInformation> TransfersContainer::getSpentOutpu
   return spentOutputs;
 }
 
+size_t TransfersContainer::unlockedOutputsCount() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  updateUnlockedTransfers();
+  return m_unlockedTransfers.size();
+}
+
+bool TransfersContainer::getUnlockedOutput(size_t index, TransactionOutputInformation& output) const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  updateUnlockedTransfers();
+  if (index >= m_unlockedTransfers.size()) {
+    return false;
+  }
+
+  output = *m_unlockedTransfers[index];
+  return true;
+}
+
+namespace {
+
+template<typename Changes>
+void writeSequenceChanges(Changes& changes, Common::StringView name, DynexCN::ISerializer& s) {
+  s.beginObject(name);
+  writeSequence<Hash>(changes.removed.begin(), changes.removed.end(), "removed", s);
+
+  size_t addedCount = changes.added.size();
+  s.beginArray(addedCount, "added");
+  for (auto& record : changes.added) {
+    s(record.second, "");
+  }
+
+  s.endArray();
+  s.endObject();
+
+  changes.clear();
+}
+
+template<typename Element, typename Container>
+void readSequenceChanges(Container& container, std::unordered_map<Hash, typename Container::iterator>& index, Common::StringView name, DynexCN::ISerializer& s) {
+  s.beginObject(name);
+
+  size_t removedCount = 0;
+  s.beginArray(removedCount, "removed");
+  while (removedCount--) {
+    Hash digest;
+    s(digest, "");
+    auto it = index.find(digest);
+    if (it == index.end()) {
+      throw std::runtime_error("Failed to load container changes: removed record not found");
+    }
+
+    container.erase(it->second);
+    index.erase(it);
+  }
+
+  s.endArray();
+
+  size_t addedCount = 0;
+  s.beginArray(addedCount, "added");
+  while (addedCount--) {
+    Element element;
+    s(element, "");
+    Hash digest = getRecordDigest(element);
+    auto result = container.insert(std::move(element));
+    if (!result.second) {
+      throw std::runtime_error("Failed to load container changes: duplicate record");
+    }
+
+    index[digest] = result.first;
+  }
+
+  s.endArray();
+  s.endObject();
+}
+
+template<typename Container>
+void indexSequence(Container& container, std::unordered_map<Hash, typename Container::iterator>& index) {
+  index.reserve(container.size());
+  for (auto it = container.begin(); it != container.end(); ++it) {
+    index.emplace(getRecordDigest(*it), it);
+  }
+}
+
+}
+
 void TransfersContainer::save(std::ostream& os) {
   std::lock_guard<std::mutex> lk(m_mutex);
   StdOutputStream stream(os);
@@ -909,16 +1112,101 @@ void TransfersContainer::load(std::istream& in) {
   readSequence<TransactionOutputInformationEx>(std::inserter(availableTransfers, availableTransfers.end()), "availableTransfers", s);
   readSequence<SpentTransactionOutput>(std::inserter(spentTransfers, spentTransfers.end()), "spentTransfers", s);
 
+  clearBalances();
   m_currentHeight = currentHeight;
   m_transactions = std::move(transactions);
   m_unconfirmedTransfers = std::move(unconfirmedTransfers);
   m_availableTransfers = std::move(availableTransfers);
   m_spentTransfers = std::move(spentTransfers);
+  clearChanges();
+  rebuildBalances();
 
   // Repair the container if it was broken while handling addTransaction() in previous version of the code
   repair();
 }
 
+void TransfersContainer::trackChanges(bool enable) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_trackChanges = enable;
+  clearChanges();
+}
+
+bool TransfersContainer::hasChanges() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_currentHeight != m_savedHeight ||
+    !m_transactionChanges.empty() ||
+    !m_unconfirmedTransferChanges.empty() ||
+    !m_availableTransferChanges.empty() ||
+    !m_spentTransferChanges.empty();
+}
+
+void TransfersContainer::saveChanges(std::ostream& os) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  assert(m_trackChanges);
+  StdOutputStream stream(os);
+  DynexCN::BinaryOutputStreamSerializer s(stream);
+
+  s(const_cast<uint32_t&>(TRANSFERS_CONTAINER_STORAGE_VERSION), "version");
+
+  s(m_currentHeight, "height");
+  m_savedHeight = m_currentHeight;
+  writeSequenceChanges(m_transactionChanges, "transactions", s);
+  writeSequenceChanges(m_unconfirmedTransferChanges, "unconfirmedTransfers", s);
+  writeSequenceChanges(m_availableTransferChanges, "availableTransfers", s);
+  writeSequenceChanges(m_spentTransferChanges, "spentTransfers", s);
+}
+
+void TransfersContainer::loadChanges(const std::vector<std::string>& changes) {
+  std::lock_guard<std::mutex> lk(m_mutex);
+
+  std::unordered_map<Hash, TransactionMultiIndex::iterator> transactionsIndex;
+  std::unordered_map<Hash, UnconfirmedTransfersMultiIndex::iterator> unconfirmedTransfersIndex;
+  std::unordered_map<Hash, AvailableTransfersMultiIndex::iterator> availableTransfersIndex;
+  std::unordered_map<Hash, SpentTransfersMultiIndex::iterator> spentTransfersIndex;
+  indexSequence(m_transactions, transactionsIndex);
+  indexSequence(m_unconfirmedTransfers, unconfirmedTransfersIndex);
+  indexSequence(m_availableTransfers, availableTransfersIndex);
+  indexSequence(m_spentTransfers, spentTransfersIndex);
+
+  // records are replaced wholesale below, the totals are rebuilt once all changes are applied
+  clearBalances();
+
+  for (const auto& change : changes) {
+    MemoryInputStream stream(change.data(), change.size());
+    DynexCN::BinaryInputStreamSerializer s(stream);
+
+    uint32_t version = 0;
+    s(version, "version");
+
+    if (version > TRANSFERS_CONTAINER_STORAGE_VERSION) {
+      auto message = "Failed to load changes: unsupported version";
+      m_logger(ERROR, BRIGHT_RED) << message << ", version " << version << ", supported version " << TRANSFERS_CONTAINER_STORAGE_VERSION;
+      throw std::runtime_error(message);
+    }
+
+    s(m_currentHeight, "height");
+    readSequenceChanges<TransactionInformation>(m_transactions, transactionsIndex, "transactions", s);
+    readSequenceChanges<TransactionOutputInformationEx>(m_unconfirmedTransfers, unconfirmedTransfersIndex, "unconfirmedTransfers", s);
+    readSequenceChanges<TransactionOutputInformationEx>(m_availableTransfers, availableTransfersIndex, "availableTransfers", s);
+    readSequenceChanges<SpentTransactionOutput>(m_spentTransfers, spentTransfersIndex, "spentTransfers", s);
+  }
+
+  clearChanges();
+  rebuildBalances();
+  repair();
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::clearChanges() {
+  m_savedHeight = m_currentHeight;
+  m_transactionChanges.clear();
+  m_unconfirmedTransferChanges.clear();
+  m_availableTransferChanges.clear();
+  m_spentTransferChanges.clear();
+}
+
 void TransfersContainer::repair() {
   size_t deletedInputCount = 0;
   for (auto it = m_spentTransfers.begin(); it != m_spentTransfers.end();) {
@@ -941,6 +1229,9 @@ void TransfersContainer::repair() {
 
       auto result = m_availableTransfers.emplace(static_cast<const TransactionOutputInformationEx&>(*it));
       assert(result.second);
+      recordInserted(m_availableTransferChanges, *result.first);
+      onAvailableTransferInserted(*result.first);
+      recordErased(m_spentTransferChanges, *it);
       it = m_spentTransfers.erase(it);
 
       if (result.first->type == TransactionTypes::OutputType::Key) {
@@ -963,6 +1254,8 @@ void TransfersContainer::repair() {
         ", output " << std::setw(2) << it->outputInTransaction <<
         ", amount " << m_currency.formatAmount(it->amount);
 
+      recordErased(m_unconfirmedTransferChanges, *it);
+      onUnconfirmedTransferErased(*it);
       if (it->type == TransactionTypes::OutputType::Key) {
         KeyImage keyImage = it->keyImage;
         it = m_unconfirmedTransfers.erase(it);
@@ -989,6 +1282,8 @@ void TransfersContainer::repair() {
         ", output " << std::setw(2) << it->outputInTransaction <<
         ", amount " << m_currency.formatAmount(it->amount);
 
+      recordErased(m_availableTransferChanges, *it);
+      onAvailableTransferErased(*it);
       if (it->type == TransactionTypes::OutputType::Key) {
         KeyImage keyImage = it->keyImage;
         it = m_availableTransfers.erase(it);
@@ -1026,17 +1321,18 @@ bool TransfersContainer::isSpendTimeUnlocked(uint64_t unlockTime) const {
   return false;
 }
 
-bool TransfersContainer::isIncluded(const TransactionOutputInformationEx& info, uint32_t flags) const {
-  uint32_t state;
+uint32_t TransfersContainer::getTransferState(const TransactionOutputInformationEx& info) const {
   if (info.blockHeight == WALLET_LEGACY_UNCONFIRMED_TRANSACTION_HEIGHT || !isSpendTimeUnlocked(info.unlockTime)) {
-    state = IncludeStateLocked;
+    return IncludeStateLocked;
   } else if (m_currentHeight < info.blockHeight + m_transactionSpendableAge) {
-    state = IncludeStateSoftLocked;
+    return IncludeStateSoftLocked;
   } else {
-    state = IncludeStateUnlocked;
+    return IncludeStateUnlocked;
   }
+}
 
-  return isIncluded(info.type, state, flags);
+bool TransfersContainer::isIncluded(const TransactionOutputInformationEx& info, uint32_t flags) const {
+  return isIncluded(info.type, getTransferState(info), flags);
 }
 
 bool TransfersContainer::isIncluded(TransactionTypes::OutputType type, uint32_t state, uint32_t flags) {
@@ -1051,4 +1347,148 @@ bool TransfersContainer::isIncluded(TransactionTypes::OutputType type, uint32_t
     ((flags & state) != 0);
 }
 
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::onAvailableTransferInserted(const TransactionOutputInformationEx& transfer) const {
+  if (!transfer.visible) {
+    return;
+  }
+
+  if (getTransferState(transfer) == IncludeStateUnlocked) {
+    m_unlockedTransfers.push_back(&transfer);
+    m_unlockedBalance.add(transfer.type, transfer.amount);
+  } else {
+    m_lockedTransfers.insert(&transfer);
+    m_lockedBalance.add(transfer.type, transfer.amount);
+    if (transfer.unlockTime >= m_currency.maxBlockHeight()) {
+      m_nextUnlockTime = std::min(m_nextUnlockTime, transfer.unlockTime);
+    }
+  }
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::onAvailableTransferErased(const TransactionOutputInformationEx& transfer) const {
+  if (!transfer.visible) {
+    return;
+  }
+
+  auto& pointerIndex = m_unlockedTransfers.get<TransferPointerIndex>();
+  auto it = pointerIndex.find(&transfer);
+  if (it != pointerIndex.end()) {
+    pointerIndex.erase(it);
+    m_unlockedBalance.subtract(transfer.type, transfer.amount);
+  } else if (m_lockedTransfers.erase(&transfer) > 0) {
+    m_lockedBalance.subtract(transfer.type, transfer.amount);
+  }
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::onUnconfirmedTransferInserted(const TransactionOutputInformationEx& transfer) {
+  if (transfer.visible) {
+    m_unconfirmedBalance.add(transfer.type, transfer.amount);
+  }
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::onUnconfirmedTransferErased(const TransactionOutputInformationEx& transfer) {
+  if (transfer.visible) {
+    m_unconfirmedBalance.subtract(transfer.type, transfer.amount);
+  }
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::updateUnlockedTransfers() const {
+  uint64_t currentTime = static_cast<uint64_t>(time(NULL));
+  if (m_unlockCheckHeight == m_currentHeight && currentTime + m_currency.lockedTxAllowedDeltaSeconds() < m_nextUnlockTime) {
+    return;
+  }
+
+  m_nextUnlockTime = std::numeric_limits<uint64_t>::max();
+  for (auto it = m_lockedTransfers.begin(); it != m_lockedTransfers.end();) {
+    const TransactionOutputInformationEx* transfer = *it;
+    if (getTransferState(*transfer) == IncludeStateUnlocked) {
+      m_lockedBalance.subtract(transfer->type, transfer->amount);
+      m_unlockedBalance.add(transfer->type, transfer->amount);
+      m_unlockedTransfers.push_back(transfer);
+      it = m_lockedTransfers.erase(it);
+    } else {
+      if (transfer->unlockTime >= m_currency.maxBlockHeight()) {
+        m_nextUnlockTime = std::min(m_nextUnlockTime, transfer->unlockTime);
+      }
+
+      ++it;
+    }
+  }
+
+  m_unlockCheckHeight = m_currentHeight;
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::clearBalances() {
+  m_unlockedTransfers.clear();
+  m_lockedTransfers.clear();
+  m_unlockedBalance = TypeBalance();
+  m_lockedBalance = TypeBalance();
+  m_unconfirmedBalance = TypeBalance();
+  m_nextUnlockTime = std::numeric_limits<uint64_t>::max();
+  m_unlockCheckHeight = m_currentHeight;
+}
+
+/**
+ * \pre m_mutex is locked.
+ */
+void TransfersContainer::rebuildBalances() {
+  clearBalances();
+
+  for (const auto& transfer : m_availableTransfers) {
+    onAvailableTransferInserted(transfer);
+  }
+
+  for (const auto& transfer : m_unconfirmedTransfers) {
+    onUnconfirmedTransferInserted(transfer);
+  }
+}
+
+void TransfersContainer::TypeBalance::add(TransactionTypes::OutputType type, uint64_t amount) {
+  if (type == TransactionTypes::OutputType::Key) {
+    key += amount;
+  } else if (type == TransactionTypes::OutputType::Multisignature) {
+    multisignature += amount;
+  }
+}
+
+void TransfersContainer::TypeBalance::subtract(TransactionTypes::OutputType type, uint64_t amount) {
+  if (type == TransactionTypes::OutputType::Key) {
+    assert(key >= amount);
+    key -= amount;
+  } else if (type == TransactionTypes::OutputType::Multisignature) {
+    assert(multisignature >= amount);
+    multisignature -= amount;
+  }
+}
+
+uint64_t TransfersContainer::TypeBalance::get(uint32_t flags) const {
+  uint64_t amount = 0;
+  if ((flags & IncludeTypeKey) != 0) {
+    amount += key;
+  }
+
+  if ((flags & IncludeTypeMultisignature) != 0) {
+    amount += multisignature;
+  }
+
+  return amount;
+}
+
 }
@@ -38,14 +38,19 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <mutex>
+#include <vector>
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/identity.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 #include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/random_access_index.hpp>
 
 #include "crypto/crypto.h"
 #include "DynexCNCore/DynexCNBasic.h"
@@ -192,15 +197,27 @@ public:
   virtual std::vector<TransactionOutputInformation> getTransactionInputs(const Crypto::Hash& transactionHash, uint32_t flags) const override;
   virtual void getUnconfirmedTransactions(std::vector<Crypto::Hash>& transactions) const override;
   virtual std::vector<TransactionSpentOutputInformation> getSpentOutputs() const override;
+  virtual size_t unlockedOutputsCount() const override;
+  virtual bool getUnlockedOutput(size_t index, TransactionOutputInformation& output) const override;
 
   // IStreamSerializable
   virtual void save(std::ostream& os) override;
   virtual void load(std::istream& in) override;
 
+  // starts or stops recording added and removed records, in either case the current state counts as saved
+  void trackChanges(bool enable);
+  bool hasChanges() const;
+  // writes only the records added and removed since the last save, requires trackChanges(true)
+  void saveChanges(std::ostream& os);
+  // applies change sets written by saveChanges(), in order, on top of the state restored by load()
+  void loadChanges(const std::vector<std::string>& changes);
+
 private:
   struct ContainingTransactionIndex { };
   struct SpendingTransactionIndex { };
   struct SpentOutputDescriptorIndex { };
+  struct TransferPointerIndex { };
+  struct AmountIndex { };
 
   typedef boost::multi_index_container<
     TransactionInformation,
@@ -280,6 +297,47 @@ private:
     >
   > SpentTransfersMultiIndex;
 
+  struct TransferAmount {
+    typedef uint64_t result_type;
+    result_type operator()(const TransactionOutputInformationEx* transfer) const { return transfer->amount; }
+  };
+
+  // visible unlocked elements of m_availableTransfers
+  typedef boost::multi_index_container<
+    const TransactionOutputInformationEx*,
+    boost::multi_index::indexed_by<
+      boost::multi_index::random_access<>,
+      boost::multi_index::hashed_unique<
+        boost::multi_index::tag<TransferPointerIndex>,
+        boost::multi_index::identity<const TransactionOutputInformationEx*>
+      >,
+      boost::multi_index::ordered_non_unique<
+        boost::multi_index::tag<AmountIndex>,
+        TransferAmount
+      >
+    >
+  > UnlockedTransfersMultiIndex;
+
+  // records added and removed since the last save, keyed by the digest of their serialized form
+  template<typename Element>
+  struct RecordChanges {
+    std::unordered_map<Crypto::Hash, Element> added;
+    std::unordered_set<Crypto::Hash> removed;
+
+    bool empty() const { return added.empty() && removed.empty(); }
+    void clear() { added.clear(); removed.clear(); }
+  };
+
+  struct TypeBalance {
+    uint64_t key;
+    uint64_t multisignature;
+
+    TypeBalance() : key(0), multisignature(0) {}
+    void add(TransactionTypes::OutputType type, uint64_t amount);
+    void subtract(TransactionTypes::OutputType type, uint64_t amount);
+    uint64_t get(uint32_t flags) const;
+  };
+
 private:
   void addTransaction(const TransactionBlockInfo& block, const ITransactionReader& tx);
   bool addTransactionOutputs(const TransactionBlockInfo& block, const ITransactionReader& tx,
@@ -287,6 +345,7 @@ private:
   bool addTransactionInputs(const TransactionBlockInfo& block, const ITransactionReader& tx);
   void deleteTransactionTransfers(const Crypto::Hash& transactionHash);
   bool isSpendTimeUnlocked(uint64_t unlockTime) const;
+  uint32_t getTransferState(const TransactionOutputInformationEx& info) const;
   bool isIncluded(const TransactionOutputInformationEx& info, uint32_t flags) const;
   static bool isIncluded(TransactionTypes::OutputType type, uint32_t state, uint32_t flags);
   void updateTransfersVisibility(const Crypto::KeyImage& keyImage);
@@ -294,12 +353,44 @@ private:
   void copyToSpent(const TransactionBlockInfo& block, const ITransactionReader& tx, size_t inputIndex, const TransactionOutputInformationEx& output);
   void repair();
 
+  void onAvailableTransferInserted(const TransactionOutputInformationEx& transfer) const;
+  void onAvailableTransferErased(const TransactionOutputInformationEx& transfer) const;
+  void onUnconfirmedTransferInserted(const TransactionOutputInformationEx& transfer);
+  void onUnconfirmedTransferErased(const TransactionOutputInformationEx& transfer);
+  void updateUnlockedTransfers() const;
+  void clearBalances();
+  void rebuildBalances();
+
+  template<typename Element>
+  void recordInserted(RecordChanges<Element>& changes, const Element& element);
+  template<typename Element>
+  void recordErased(RecordChanges<Element>& changes, const Element& element);
+  void clearChanges();
+
 private:
   TransactionMultiIndex m_transactions;
   UnconfirmedTransfersMultiIndex m_unconfirmedTransfers;
   AvailableTransfersMultiIndex m_availableTransfers;
   SpentTransfersMultiIndex m_spentTransfers;
 
+  // Running totals of visible available and unconfirmed transfers. Transfers are moved from
+  // m_lockedTransfers to m_unlockedTransfers lazily, as the height and the clock advance
+  mutable UnlockedTransfersMultiIndex m_unlockedTransfers;
+  mutable std::unordered_set<const TransactionOutputInformationEx*> m_lockedTransfers;
+  mutable TypeBalance m_unlockedBalance;
+  mutable TypeBalance m_lockedBalance;
+  TypeBalance m_unconfirmedBalance;
+  mutable uint32_t m_unlockCheckHeight;
+  mutable uint64_t m_nextUnlockTime;
+
+  // change log for saveChanges(), kept only while m_trackChanges is set
+  RecordChanges<TransactionInformation> m_transactionChanges;
+  RecordChanges<TransactionOutputInformationEx> m_unconfirmedTransferChanges;
+  RecordChanges<TransactionOutputInformationEx> m_availableTransferChanges;
+  RecordChanges<SpentTransactionOutput> m_spentTransferChanges;
+  uint32_t m_savedHeight;
+  bool m_trackChanges;
+
   uint32_t m_currentHeight; // current height is needed to check if a transfer is unlocked
   size_t m_transactionSpendableAge;
   const DynexCN::Currency& m_currency;
@@ -38,9 +38,12 @@
 #include "TransfersSynchronizer.h"
 #include "TransfersConsumer.h"
 
+#include <algorithm>
+
 #include "Common/StdInputStream.h"
 #include "Common/StdOutputStream.h"
 #include "DynexCNCore/DynexCNBasicImpl.h"
+#include "DynexCNCore/DynexCNSerialization.h"
 #include "Serialization/BinaryInputStreamSerializer.h"
 #include "Serialization/BinaryOutputStreamSerializer.h"
 
@@ -52,7 +55,7 @@ namespace DynexCN {
 const uint32_t TRANSFERS_STORAGE_ARCHIVE_VERSION = 0;
 
 TransfersSyncronizer::TransfersSyncronizer(const DynexCN::Currency& currency, Logging::ILogger& logger, IBlockchainSynchronizer& sync, INode& node) :
-  m_currency(currency), m_logger(logger, "TransfersSyncronizer"), m_sync(sync), m_node(node) {
+  m_currency(currency), m_logger(logger, "TransfersSyncronizer"), m_sync(sync), m_node(node), m_scanThreads(0) {
 }
 
 TransfersSyncronizer::~TransfersSyncronizer() {
@@ -68,6 +71,23 @@ void TransfersSyncronizer::initTransactionPool(const std::unordered_set<Crypto::
   }
 }
 
+void TransfersSyncronizer::setScanThreads(size_t threadCount) {
+  m_scanThreads = threadCount;
+  for (const auto& kv : m_consumers) {
+    kv.second->setScanThreads(threadCount);
+  }
+}
+
+double TransfersSyncronizer::getSyncSpeed() const {
+  // every consumer scans the same blocks
+  double speed = 0;
+  for (const auto& kv : m_consumers) {
+    speed = std::max(speed, kv.second->getSyncSpeed());
+  }
+
+  return speed;
+}
+
 ITransfersSubscription& TransfersSyncronizer::addSubscription(const AccountSubscription& acc) {
   auto it = m_consumers.find(acc.keys.address.viewPublicKey);
 
@@ -75,6 +95,7 @@ ITransfersSubscription& TransfersSyncronizer::addSubscription(const AccountSubsc
     std::unique_ptr<TransfersConsumer> consumer(
       new TransfersConsumer(m_currency, m_node, m_logger.getLogger(), acc.keys.viewSecretKey));
 
+    consumer->setScanThreads(m_scanThreads);
     m_sync.addConsumer(consumer.get());
     consumer->addObserver(this);
     it = m_consumers.insert(std::make_pair(acc.keys.address.viewPublicKey, std::move(consumer))).first;
@@ -338,6 +359,222 @@ void TransfersSyncronizer::load(std::istream& is) {
 
 }
 
+namespace {
+
+// enough to find the common part of the saved and current chains after any realistic reorganization
+const size_t SAVED_KNOWN_BLOCK_COUNT = 100;
+
+// every subscription created by TransfersConsumer keeps its transfers in a TransfersContainer
+TransfersContainer& getTransfersContainer(ITransfersSubscription& subscription) {
+  return static_cast<TransfersContainer&>(subscription.getContainer());
+}
+
+void getSavedKnownBlocks(const std::vector<Hash>& knownBlocks, TransfersSyncronizer::SavedConsumerState& saved) {
+  size_t lastCount = std::min(knownBlocks.size(), SAVED_KNOWN_BLOCK_COUNT);
+  saved.knownBlockCount = static_cast<uint32_t>(knownBlocks.size());
+  saved.lastKnownBlocks.assign(knownBlocks.end() - lastCount, knownBlocks.end());
+}
+
+// block hashes are chained, so the highest saved hash that is still known ends the common part of both chains
+uint32_t getKeptKnownBlockCount(const std::vector<Hash>& knownBlocks, const TransfersSyncronizer::SavedConsumerState& saved) {
+  uint32_t firstSavedCount = saved.knownBlockCount - static_cast<uint32_t>(saved.lastKnownBlocks.size());
+  for (size_t i = saved.lastKnownBlocks.size(); i > 0; --i) {
+    uint32_t count = firstSavedCount + static_cast<uint32_t>(i);
+    if (count <= knownBlocks.size() && knownBlocks[count - 1] == saved.lastKnownBlocks[i - 1]) {
+      return count;
+    }
+  }
+
+  return 0;
+}
+
+// same layout as SynchronizationState::save()
+std::string getConsumerState(std::vector<Hash>& knownBlocks) {
+  std::stringstream stream;
+  StdOutputStream output(stream);
+  DynexCN::BinaryOutputStreamSerializer s(output);
+  s.beginObject("state");
+  s(knownBlocks, "blockchain");
+  s.endObject();
+  return stream.str();
+}
+
+}
+
+void TransfersSyncronizer::getSavedState(SavedState& saved) {
+  saved.clear();
+
+  for (const auto& consumer : m_consumers) {
+    SavedConsumerState& consumerState = saved[consumer.first];
+    getSavedKnownBlocks(m_sync.getConsumerKnownBlocks(*consumer.second), consumerState);
+
+    std::vector<AccountPublicAddress> subscriptions;
+    consumer.second->getSubscriptions(subscriptions);
+    for (auto& addr : subscriptions) {
+      auto sub = consumer.second->getSubscription(addr);
+      if (sub != nullptr) {
+        getTransfersContainer(*sub).trackChanges(true);
+      }
+    }
+  }
+}
+
+void TransfersSyncronizer::discardSavedState() {
+  for (const auto& consumer : m_consumers) {
+    std::vector<AccountPublicAddress> subscriptions;
+    consumer.second->getSubscriptions(subscriptions);
+    for (auto& addr : subscriptions) {
+      auto sub = consumer.second->getSubscription(addr);
+      if (sub != nullptr) {
+        getTransfersContainer(*sub).trackChanges(false);
+      }
+    }
+  }
+}
+
+void TransfersSyncronizer::saveChanges(std::ostream& os, SavedState& saved) {
+  StdOutputStream stream(os);
+  DynexCN::BinaryOutputStreamSerializer s(stream);
+  s(const_cast<uint32_t&>(TRANSFERS_STORAGE_ARCHIVE_VERSION), "version");
+
+  size_t subscriptionCount = m_consumers.size();
+
+  s.beginArray(subscriptionCount, "consumers");
+
+  for (const auto& consumer : m_consumers) {
+    s.beginObject("");
+    s(const_cast<PublicKey&>(consumer.first), "view_key");
+
+    std::vector<Hash> knownBlocks = m_sync.getConsumerKnownBlocks(*consumer.second);
+    SavedConsumerState& consumerState = saved[consumer.first];
+    uint32_t keptBlockCount = getKeptKnownBlockCount(knownBlocks, consumerState);
+    s(keptBlockCount, "keptBlockCount");
+    writeSequence<Hash>(knownBlocks.begin() + keptBlockCount, knownBlocks.end(), "addedBlocks", s);
+    getSavedKnownBlocks(knownBlocks, consumerState);
+
+    // containers that neither moved nor changed a record since the last save are left out
+    std::vector<AccountPublicAddress> subscriptions;
+    consumer.second->getSubscriptions(subscriptions);
+    std::vector<std::pair<AccountPublicAddress, TransfersContainer*>> changedContainers;
+    for (auto& addr : subscriptions) {
+      auto sub = consumer.second->getSubscription(addr);
+      if (sub != nullptr && getTransfersContainer(*sub).hasChanges()) {
+        changedContainers.emplace_back(addr, &getTransfersContainer(*sub));
+      }
+    }
+
+    size_t subCount = changedContainers.size();
+
+    s.beginArray(subCount, "subscriptions");
+
+    for (auto& changed : changedContainers) {
+      s.beginObject("");
+
+      std::stringstream subChanges;
+      changed.second->saveChanges(subChanges);
+      std::string blob = subChanges.str();
+      s(changed.first, "address");
+      s(blob, "changes");
+
+      s.endObject();
+    }
+
+    s.endArray();
+    s.endObject();
+  }
+}
+
+void TransfersSyncronizer::loadChanges(const std::vector<std::string>& changes) {
+  // known blocks are replayed in memory and container change sets are gathered, so that each is applied only once
+  std::unordered_map<PublicKey, std::vector<Hash>> knownBlocks;
+  std::unordered_map<PublicKey, std::vector<std::string>> containerChanges;
+
+  for (const auto& change : changes) {
+    std::stringstream changeStream(change);
+    StdInputStream inputStream(changeStream);
+    DynexCN::BinaryInputStreamSerializer s(inputStream);
+
+    uint32_t version = 0;
+    s(version, "version");
+
+    if (version > TRANSFERS_STORAGE_ARCHIVE_VERSION) {
+      throw std::runtime_error("TransfersSyncronizer version mismatch");
+    }
+
+    size_t subscriptionCount = 0;
+    s.beginArray(subscriptionCount, "consumers");
+
+    while (subscriptionCount--) {
+      s.beginObject("");
+      PublicKey viewKey;
+      s(viewKey, "view_key");
+
+      uint32_t keptBlockCount = 0;
+      std::vector<Hash> addedBlocks;
+      s(keptBlockCount, "keptBlockCount");
+      s(addedBlocks, "addedBlocks");
+
+      auto subIter = m_consumers.find(viewKey);
+      if (subIter != m_consumers.end()) {
+        auto blocksIter = knownBlocks.find(viewKey);
+        if (blocksIter == knownBlocks.end()) {
+          blocksIter = knownBlocks.emplace(viewKey, m_sync.getConsumerKnownBlocks(*subIter->second)).first;
+        }
+
+        std::vector<Hash>& blocks = blocksIter->second;
+        if (keptBlockCount > blocks.size()) {
+          throw std::runtime_error("TransfersSyncronizer changes don't match the saved state");
+        }
+
+        blocks.resize(keptBlockCount);
+        blocks.insert(blocks.end(), addedBlocks.begin(), addedBlocks.end());
+      } else {
+        m_logger(Logging::DEBUGGING) << "Consumer not found: " << viewKey;
+      }
+
+      size_t subCount = 0;
+      s.beginArray(subCount, "subscriptions");
+
+      while (subCount--) {
+        s.beginObject("");
+
+        AccountPublicAddress acc;
+        std::string blob;
+
+        s(acc, "address");
+        s(blob, "changes");
+
+        if (subIter != m_consumers.end() && subIter->second->getSubscription(acc) != nullptr) {
+          containerChanges[acc.spendPublicKey].push_back(std::move(blob));
+        } else {
+          m_logger(Logging::DEBUGGING) << "Subscription not found: " << m_currency.accountAddressAsString(acc);
+        }
+
+        s.endObject();
+      }
+
+      s.endArray();
+      s.endObject();
+    }
+
+    s.endArray();
+  }
+
+  for (auto& blocks : knownBlocks) {
+    auto consumer = m_consumers.find(blocks.first)->second.get();
+    setObjectState(*m_sync.getConsumerState(consumer), getConsumerState(blocks.second));
+
+    std::vector<AccountPublicAddress> subscriptions;
+    consumer->getSubscriptions(subscriptions);
+    for (auto& addr : subscriptions) {
+      auto changesIter = containerChanges.find(addr.spendPublicKey);
+      if (changesIter != containerChanges.end()) {
+        getTransfersContainer(*consumer->getSubscription(addr)).loadChanges(changesIter->second);
+      }
+    }
+  }
+}
+
 bool TransfersSyncronizer::findViewKeyForConsumer(IBlockchainConsumer* consumer, Crypto::PublicKey& viewKey) const {
   //since we have only couple of consumers linear complexity is fine
   auto it = std::find_if(m_consumers.begin(), m_consumers.end(), [consumer] (const ConsumersContainer::value_type& subscription) {
@@ -40,6 +40,7 @@
 #include "Common/ObserverManager.h"
 #include "ITransfersSynchronizer.h"
 #include "IBlockchainSynchronizer.h"
+#include "TransfersContainer.h"
 #include "TypeHelpers.h"
 
 #include <unordered_map>
@@ -76,10 +77,32 @@ public:
 
   void addPublicKeysSeen(const AccountPublicAddress& acc, const Crypto::Hash& transactionHash, const Crypto::PublicKey& outputKey);
 
+  // threads scanning blocks in every consumer, 0 selects all cores; set before synchronization starts
+  void setScanThreads(size_t threadCount);
+  double getSyncSpeed() const;
+
   // IStreamSerializable
   virtual void save(std::ostream& os) override;
   virtual void load(std::istream& in) override;
 
+  // what the last save wrote for a consumer: its known block count and the hashes just below it
+  struct SavedConsumerState {
+    uint32_t knownBlockCount;
+    std::vector<Crypto::Hash> lastKnownBlocks;
+  };
+
+  // map { view public key -> saved consumer state }
+  typedef std::unordered_map<Crypto::PublicKey, SavedConsumerState> SavedState;
+
+  // also starts recording container changes, so that saveChanges() writes only the changed records
+  void getSavedState(SavedState& saved);
+  // stops recording container changes, saveChanges() can't be called until the next getSavedState()
+  void discardSavedState();
+  // writes the known blocks and container records changed since saved was taken, and updates saved
+  void saveChanges(std::ostream& os, SavedState& saved);
+  // applies change sets written by saveChanges(), in order, on top of the state restored by load()
+  void loadChanges(const std::vector<std::string>& changes);
+
 private:
   Logging::LoggerRef m_logger;
 
@@ -95,6 +118,7 @@ private:
   IBlockchainSynchronizer& m_sync;
   INode& m_node;
   const DynexCN::Currency& m_currency;
+  size_t m_scanThreads;
 
   virtual void onBlocksAdded(IBlockchainConsumer* consumer, const std::vector<Crypto::Hash>& blockHashes) override;
   virtual void onBlockchainDetach(IBlockchainConsumer* consumer, uint32_t blockIndex) override;
@@ -45,6 +45,7 @@
 #include <random>
 #include <set>
 #include <tuple>
+#include <unordered_set>
 #include <utility>
 
 #include <System/EventLock.h>
@@ -63,6 +64,7 @@
 #include "Common/StreamTools.h"
 #include "Common/StringOutputStream.h"
 #include "Common/StringTools.h"
+#include "Common/WorkerPool.h"
 #include "DynexCNCore/Account.h"
 #include "DynexCNCore/Currency.h"
 #include "DynexCNCore/DynexCNBasicImpl.h"
@@ -133,6 +135,12 @@ DynexCN::WalletEvent makeSyncCompletedEvent() {
   return event;
 }
 
+// save() rewrites the whole cache once this many change sets were appended after its snapshot, or once they outgrow it
+const size_t MAX_CACHE_CHANGE_COUNT = 256;
+
+// below this many keys the worker threads cost more than they save
+const size_t MIN_PARALLEL_KEY_DERIVATION_COUNT = 256;
+
 size_t getTransactionSize(const ITransactionReader& transaction) {
   return transaction.getTransactionData().size();
 }
@@ -172,6 +180,10 @@ WalletGreen::WalletGreen(System::Dispatcher& dispatcher, const Currency& currenc
   m_eventOccurred(m_dispatcher),
   m_readyEvent(m_dispatcher),
   m_state(WalletState::NOT_INITIALIZED),
+  m_cacheChangesAllowed(false),
+  m_cacheChangeCount(0),
+  m_cacheChangesSize(0),
+  m_cacheSnapshotSize(0),
   m_actualBalance(0),
   m_pendingBalance(0),
   m_transactionSoftLockTime(transactionSoftLockTime)
@@ -180,6 +192,10 @@ WalletGreen::WalletGreen(System::Dispatcher& dispatcher, const Currency& currenc
   m_readyEvent.set();
 }
 
+void WalletGreen::setSyncThreads(size_t threadCount) {
+  m_synchronizer.setScanThreads(threadCount);
+}
+
 WalletGreen::~WalletGreen() {
   if (m_state == WalletState::INITIALIZED) {
     doShutdown();
@@ -252,6 +268,7 @@ void WalletGreen::doShutdown() {
   m_containerStorage.close();
   m_walletsContainer.clear();
   clearCaches(true, true);
+  resetSavedCache(false, 0, 0, 0);
 
   std::queue<WalletEvent> noEvents;
   std::swap(m_events, noEvents);
@@ -276,11 +293,13 @@ void WalletGreen::clearCaches(bool clearTransactions, bool clearCachedData) {
     }
 
     if (!clearTransactions) {
+      size_t transactionId = 0;
       for (auto it = m_transactions.begin(); it != m_transactions.end(); ++it) {
         m_transactions.modify(it, [](WalletTransaction& tx) {
           tx.state = WalletTransactionState::CANCELLED;
           tx.blockHeight = WALLET_UNCONFIRMED_TRANSACTION_HEIGHT;
         });
+        markTransactionChanged(transactionId++);
       }
     }
 
@@ -522,6 +541,7 @@ void WalletGreen::load(const std::string& path, const std::string& password, std
         }
       } catch (const std::exception& e) {
         m_logger(ERROR, BRIGHT_RED) << "Failed to load cache: " << e.what() << ", reset wallet data";
+        resetSavedCache(false, 0, 0, 0);
         clearCaches(true, true);
         subscribeWallets();
       }
@@ -610,7 +630,8 @@ void WalletGreen::loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKe
   assert(m_containerStorage.isOpened());
 
   BinaryArray contanerData;
-  loadAndDecryptContainerData(m_containerStorage, m_key, contanerData);
+  std::vector<BinaryArray> containerChanges;
+  bool containerChangesIntact = loadAndDecryptContainerData(m_containerStorage, m_key, contanerData, containerChanges);
 
   WalletSerializerV2 s(
     *this,
@@ -630,15 +651,49 @@ void WalletGreen::loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKe
 
   Common::MemoryInputStream containerStream(contanerData.data(), contanerData.size());
   s.load(containerStream, reinterpret_cast<const ContainerStoragePrefix*>(m_containerStorage.prefix())->version);
+
+  uint64_t containerChangesSize = 0;
+  if (!containerChanges.empty()) {
+    if (s.loadedSaveLevel() != WalletSaveLevel::SAVE_ALL) {
+      throw std::runtime_error("Container changes follow a partial cache");
+    }
+
+    s.loadChanges(containerChanges);
+    for (const auto& changes : containerChanges) {
+      containerChangesSize += changes.size();
+    }
+  }
+
+  if (!containerChangesIntact) {
+    m_logger(WARNING, BRIGHT_YELLOW) << "Container cache ends with damaged changes, they are ignored";
+  }
+
   addedKeys = std::move(s.addedKeys());
   deletedKeys = std::move(s.deletedKeys());
 
-  m_logger(DEBUGGING) << "Container cache loaded";
+  // changes can only be appended to a cache that matches the loaded wallet, a damaged tail or a different
+  // address list must be replaced by a full save first
+  bool cacheChangesAllowed = s.loadedSaveLevel() == WalletSaveLevel::SAVE_ALL && containerChangesIntact && addedKeys.empty() && deletedKeys.empty();
+  resetSavedCache(cacheChangesAllowed, contanerData.size(), containerChanges.size(), containerChangesSize);
+
+  m_logger(DEBUGGING) << "Container cache loaded, change set count " << containerChanges.size();
 }
 
 void WalletGreen::saveWalletCache(ContainerStorage& storage, const Crypto::chacha8_key& key, WalletSaveLevel saveLevel, const std::string& extra) {
   m_logger(DEBUGGING) << "Saving cache...";
 
+  bool ownStorage = &storage == &m_containerStorage;
+  if (ownStorage && saveLevel == WalletSaveLevel::SAVE_ALL && saveWalletCacheChanges(extra)) {
+    m_extra = extra;
+
+    m_logger(DEBUGGING) << "Container changes saved, change set count " << m_cacheChangeCount;
+    return;
+  }
+
+  if (ownStorage) {
+    resetSavedCache(false, 0, 0, 0);
+  }
+
   WalletTransactions transactions;
   WalletTransfers transfers;
 
@@ -685,9 +740,100 @@ void WalletGreen::saveWalletCache(ContainerStorage& storage, const Crypto::chach
 
   m_extra = extra;
 
+  if (ownStorage) {
+    // deleted transactions are left out of the snapshot, so it doesn't match the ids changes refer to
+    resetSavedCache(saveLevel == WalletSaveLevel::SAVE_ALL && transactions.size() == m_transactions.size(), containerData.size(), 0, 0);
+  }
+
   m_logger(DEBUGGING) << "Container saving finished";
 }
 
+bool WalletGreen::saveWalletCacheChanges(const std::string& extra) {
+  if (!m_cacheChangesAllowed || m_cacheChangeCount >= MAX_CACHE_CHANGE_COUNT || m_cacheChangesSize >= m_cacheSnapshotSize) {
+    return false;
+  }
+
+  bool hasDeletedTransactions = std::any_of(m_transactions.begin(), m_transactions.end(), [](const WalletTransaction& tx) {
+    return tx.state == WalletTransactionState::DELETED;
+  });
+
+  if (hasDeletedTransactions) {
+    return false;
+  }
+
+  std::string containerChanges;
+  Common::StringOutputStream containerStream(containerChanges);
+
+  WalletSerializerV2 s(
+    *this,
+    m_viewPublicKey,
+    m_viewSecretKey,
+    m_actualBalance,
+    m_pendingBalance,
+    m_walletsContainer,
+    m_synchronizer,
+    m_unlockTransactionsJob,
+    m_transactions,
+    m_transfers,
+    m_uncommitedTransactions,
+    const_cast<std::string&>(extra),
+    m_transactionSoftLockTime
+  );
+
+  // m_savedCache is updated while the changes are written, so it doesn't match the storage until they are appended
+  m_cacheChangesAllowed = false;
+  if (!s.saveChanges(containerStream, m_savedCache)) {
+    return false;
+  }
+
+  encryptAndAppendContainerChanges(m_containerStorage, m_key, containerChanges.data(), containerChanges.size());
+  m_containerStorage.flush();
+
+  m_cacheChangesAllowed = true;
+  ++m_cacheChangeCount;
+  m_cacheChangesSize += containerChanges.size();
+
+  return true;
+}
+
+void WalletGreen::resetSavedCache(bool cacheChangesAllowed, uint64_t snapshotSize, size_t changeCount, uint64_t changesSize) {
+  m_cacheChangesAllowed = false;
+  m_savedCache = WalletSerializerV2::SavedState();
+  m_cacheChangeCount = changeCount;
+  m_cacheChangesSize = changesSize;
+  m_cacheSnapshotSize = snapshotSize;
+
+  if (cacheChangesAllowed) {
+    WalletSerializerV2 s(
+      *this,
+      m_viewPublicKey,
+      m_viewSecretKey,
+      m_actualBalance,
+      m_pendingBalance,
+      m_walletsContainer,
+      m_synchronizer,
+      m_unlockTransactionsJob,
+      m_transactions,
+      m_transfers,
+      m_uncommitedTransactions,
+      m_extra,
+      m_transactionSoftLockTime
+    );
+
+    s.getSavedState(m_savedCache);
+    m_cacheChangesAllowed = true;
+  } else {
+    m_synchronizer.discardSavedState();
+  }
+}
+
+// transactions appended after the last save are written anyway, only modified saved ones need marking
+void WalletGreen::markTransactionChanged(size_t transactionId) {
+  if (m_cacheChangesAllowed && transactionId < m_savedCache.transactionCount) {
+    m_savedCache.changedTransactions.insert(transactionId);
+  }
+}
+
 void WalletGreen::copyContainerStorageKeys(ContainerStorage& src, const chacha8_key& srcKey, ContainerStorage& dst, const chacha8_key& dstKey) {
   dst.reserve(src.size());
 
@@ -748,7 +894,29 @@ void WalletGreen::encryptAndSaveContainerData(ContainerStorage& storage, const C
   std::copy(suffix.begin(), suffix.end(), storage.suffix());
 }
 
-void WalletGreen::loadAndDecryptContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, BinaryArray& containerData) {
+void WalletGreen::encryptAndAppendContainerChanges(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* containerChanges, size_t containerChangesSize) {
+  ContainerStoragePrefix* prefix = reinterpret_cast<ContainerStoragePrefix*>(storage.prefix());
+
+  Crypto::chacha8_iv changesIv = prefix->nextIv;
+  incIv(prefix->nextIv);
+
+  BinaryArray encryptedChanges;
+  encryptedChanges.resize(containerChangesSize);
+  chacha8(containerChanges, containerChangesSize, key, changesIv, reinterpret_cast<char*>(encryptedChanges.data()));
+  Crypto::Hash checksum = cn_fast_hash(encryptedChanges.data(), encryptedChanges.size());
+
+  std::string suffix;
+  Common::StringOutputStream suffixStream(suffix);
+  BinaryOutputStreamSerializer suffixSerializer(suffixStream);
+  suffixSerializer(changesIv, "changesIv");
+  suffixSerializer(encryptedChanges, "encryptedChanges");
+  suffixSerializer(checksum, "checksum");
+
+  // readers of the snapshot alone stop before the changes, so older versions still load the container
+  storage.appendSuffix(reinterpret_cast<const uint8_t*>(suffix.data()), suffix.size());
+}
+
+bool WalletGreen::loadAndDecryptContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, BinaryArray& containerData, std::vector<BinaryArray>& containerChanges) {
   Common::MemoryInputStream suffixStream(storage.suffix(), storage.suffixSize());
   BinaryInputStreamSerializer suffixSerializer(suffixStream);
   Crypto::chacha8_iv suffixIv;
@@ -758,6 +926,33 @@ void WalletGreen::loadAndDecryptContainerData(ContainerStorage& storage, const C
 
   containerData.resize(encryptedContainer.size());
   chacha8(encryptedContainer.data(), encryptedContainer.size(), key, suffixIv, reinterpret_cast<char*>(containerData.data()));
+
+  // a save interrupted while appending leaves its change set incomplete, the ones before it are still valid
+  containerChanges.clear();
+  while (!suffixStream.endOfStream()) {
+    Crypto::chacha8_iv changesIv;
+    BinaryArray encryptedChanges;
+    Crypto::Hash checksum;
+
+    try {
+      suffixSerializer(changesIv, "changesIv");
+      suffixSerializer(encryptedChanges, "encryptedChanges");
+      suffixSerializer(checksum, "checksum");
+    } catch (const std::exception&) {
+      return false;
+    }
+
+    if (checksum != cn_fast_hash(encryptedChanges.data(), encryptedChanges.size())) {
+      return false;
+    }
+
+    BinaryArray changes;
+    changes.resize(encryptedChanges.size());
+    chacha8(encryptedChanges.data(), encryptedChanges.size(), key, changesIv, reinterpret_cast<char*>(changes.data()));
+    containerChanges.push_back(std::move(changes));
+  }
+
+  return true;
 }
 
 void WalletGreen::initTransactionPool() {
@@ -945,8 +1140,12 @@ void WalletGreen::changePassword(const std::string& oldPassword, const std::stri
 
     if (m_containerStorage.suffixSize() > 0) {
       BinaryArray containerData;
-      loadAndDecryptContainerData(m_containerStorage, m_key, containerData);
+      std::vector<BinaryArray> containerChanges;
+      loadAndDecryptContainerData(m_containerStorage, m_key, containerData, containerChanges);
       encryptAndSaveContainerData(newStorage, newKey, containerData.data(), containerData.size());
+      for (const auto& changes : containerChanges) {
+        encryptAndAppendContainerChanges(newStorage, newKey, changes.data(), changes.size());
+      }
     }
   });
 
@@ -1085,16 +1284,8 @@ std::string WalletGreen::createAddress(const Crypto::PublicKey& spendPublicKey,
 }
 
 std::vector<std::string> WalletGreen::createAddressList(const std::vector<Crypto::SecretKey>& spendSecretKeys, bool reset) {
-  std::vector<NewAddressData> addressDataList(spendSecretKeys.size());
-  for (size_t i = 0; i < spendSecretKeys.size(); ++i) {
-    Crypto::PublicKey spendPublicKey;
-    if (!Crypto::secret_key_to_public_key(spendSecretKeys[i], spendPublicKey)) {
-      m_logger(ERROR, BRIGHT_RED) << "createAddressList(): failed to convert secret key to public key, secret key " << spendSecretKeys[i];
-      throw std::system_error(make_error_code(DynexCN::error::KEY_GENERATION_ERROR));
-    }
-
-    addressDataList[i].spendSecretKey = spendSecretKeys[i];
-    addressDataList[i].spendPublicKey = spendPublicKey;
+  std::vector<NewAddressData> addressDataList = deriveAddressData(spendSecretKeys);
+  for (size_t i = 0; i < addressDataList.size(); ++i) {
     addressDataList[i].creationTimestamp = reset ? 0 : static_cast<uint64_t>(time(nullptr));
   }
 
@@ -1106,16 +1297,8 @@ std::vector<std::string> WalletGreen::createAddressList(const std::vector<Crypto
     m_logger(ERROR, BRIGHT_RED) << "createAddressList(): the sizes of keys and timestamps vectors do not match.";
     throw std::system_error(make_error_code(std::errc::invalid_argument));
   }
-  std::vector<NewAddressData> addressDataList(spendSecretKeys.size());
-  for (size_t i = 0; i < spendSecretKeys.size(); ++i) {
-    Crypto::PublicKey spendPublicKey;
-    if (!Crypto::secret_key_to_public_key(spendSecretKeys[i], spendPublicKey)) {
-      m_logger(ERROR, BRIGHT_RED) << "createAddressList(): failed to convert secret key to public key, secret key " << spendSecretKeys[i];
-      throw std::system_error(make_error_code(DynexCN::error::KEY_GENERATION_ERROR));
-    }
-
-    addressDataList[i].spendSecretKey = spendSecretKeys[i];
-    addressDataList[i].spendPublicKey = spendPublicKey;
+  std::vector<NewAddressData> addressDataList = deriveAddressData(spendSecretKeys);
+  for (size_t i = 0; i < addressDataList.size(); ++i) {
     addressDataList[i].creationTimestamp = creationTimestamps[i];
   }
 
@@ -1127,22 +1310,48 @@ std::vector<std::string> WalletGreen::createAddressList(const std::vector<Crypto
     m_logger(ERROR, BRIGHT_RED) << "createAddressList(): the sizes of keys and scan heights vectors do not match.";
     throw std::system_error(make_error_code(std::errc::invalid_argument));
   }
-  std::vector<NewAddressData> addressDataList(spendSecretKeys.size());
-  for (size_t i = 0; i < spendSecretKeys.size(); ++i) {
-    Crypto::PublicKey spendPublicKey;
-    if (!Crypto::secret_key_to_public_key(spendSecretKeys[i], spendPublicKey)) {
-      m_logger(ERROR, BRIGHT_RED) << "createAddressList(): failed to convert secret key to public key, secret key " << spendSecretKeys[i];
-      throw std::system_error(make_error_code(DynexCN::error::KEY_GENERATION_ERROR));
+  std::vector<NewAddressData> addressDataList = deriveAddressData(spendSecretKeys);
+  // imported addresses usually share a few scan heights, each of them costs a node request
+  std::unordered_map<uint32_t, uint64_t> scanHeightTimestamps;
+  for (size_t i = 0; i < addressDataList.size(); ++i) {
+    auto it = scanHeightTimestamps.find(scanHeights[i]);
+    if (it == scanHeightTimestamps.end()) {
+      it = scanHeightTimestamps.emplace(scanHeights[i], scanHeightToTimestamp(scanHeights[i])).first;
     }
 
-    addressDataList[i].spendSecretKey = spendSecretKeys[i];
-    addressDataList[i].spendPublicKey = spendPublicKey;
-    addressDataList[i].creationTimestamp = scanHeightToTimestamp(scanHeights[i]);
+    addressDataList[i].creationTimestamp = it->second;
   }
 
   return doCreateAddressList(addressDataList);
 }
 
+std::vector<WalletGreen::NewAddressData> WalletGreen::deriveAddressData(const std::vector<Crypto::SecretKey>& spendSecretKeys) const {
+  std::vector<NewAddressData> addressDataList(spendSecretKeys.size());
+  auto derive = [&](size_t i) {
+    addressDataList[i].spendSecretKey = spendSecretKeys[i];
+    return Crypto::secret_key_to_public_key(spendSecretKeys[i], addressDataList[i].spendPublicKey);
+  };
+
+  // the scalar multiplications dominate large imports, so they are spread over all cores
+  bool derived;
+  if (spendSecretKeys.size() < MIN_PARALLEL_KEY_DERIVATION_COUNT) {
+    derived = true;
+    for (size_t i = 0; derived && i < spendSecretKeys.size(); ++i) {
+      derived = derive(i);
+    }
+  } else {
+    Tools::WorkerPool pool;
+    derived = pool.parallelFor(spendSecretKeys.size(), derive);
+  }
+
+  if (!derived) {
+    m_logger(ERROR, BRIGHT_RED) << "createAddressList(): failed to convert secret key to public key";
+    throw std::system_error(make_error_code(DynexCN::error::KEY_GENERATION_ERROR));
+  }
+
+  return addressDataList;
+}
+
 std::string WalletGreen::doCreateAddress(const Crypto::PublicKey& spendPublicKey, const Crypto::SecretKey& spendSecretKey, uint64_t creationTimestamp) {
   assert(creationTimestamp <= std::numeric_limits<uint64_t>::max() - m_currency.blockFutureTimeLimit());
 
@@ -1176,16 +1385,23 @@ std::vector<std::string> WalletGreen::doCreateAddressList(const std::vector<NewA
         }
       });
 
-      for (auto& addressData : addressDataList) {
-        assert(addressData.creationTimestamp <= std::numeric_limits<uint64_t>::max() - m_currency.blockFutureTimeLimit());
-        std::string address = addWallet(addressData.spendPublicKey, addressData.spendSecretKey, addressData.creationTimestamp);
-        m_logger(INFO, BRIGHT_WHITE) << "New wallet added " << address << ", creation timestamp " << addressData.creationTimestamp;
-        addresses.push_back(std::move(address));
+      addresses = addWallets(addressDataList);
+      for (size_t i = 0; i < addressDataList.size(); ++i) {
+        assert(addressDataList[i].creationTimestamp <= std::numeric_limits<uint64_t>::max() - m_currency.blockFutureTimeLimit());
+        if (addressDataList.size() == 1) {
+          m_logger(INFO, BRIGHT_WHITE) << "New wallet added " << addresses[i] << ", creation timestamp " << addressDataList[i].creationTimestamp;
+        }
+
+        minCreationTimestamp = std::min(minCreationTimestamp, addressDataList[i].creationTimestamp);
+      }
 
-        minCreationTimestamp = std::min(minCreationTimestamp, addressData.creationTimestamp);
+      if (addressDataList.size() > 1) {
+        m_logger(INFO, BRIGHT_WHITE) << "New wallets added: " << addresses.size() << ", minimal creation timestamp " << minCreationTimestamp;
       }
     }
 
+    // all new subscriptions share the view key, so a single rescan from the earliest creation time covers them
+
     m_containerStorage.setAutoFlush(true);
     auto currentTime = static_cast<uint64_t>(time(nullptr));
     if (minCreationTimestamp + m_currency.blockFutureTimeLimit() < currentTime) {
@@ -1205,70 +1421,104 @@ std::vector<std::string> WalletGreen::doCreateAddressList(const std::vector<NewA
   return addresses;
 }
 
-std::string WalletGreen::addWallet(const Crypto::PublicKey& spendPublicKey, const Crypto::SecretKey& spendSecretKey, uint64_t creationTimestamp) {
+std::vector<std::string> WalletGreen::addWallets(const std::vector<NewAddressData>& addressDataList) {
   auto& index = m_walletsContainer.get<KeysIndex>();
 
   auto trackingMode = getTrackingMode();
 
-  if ((trackingMode == WalletTrackingMode::TRACKING && spendSecretKey != NULL_SECRET_KEY) ||
-      (trackingMode == WalletTrackingMode::NOT_TRACKING && spendSecretKey == NULL_SECRET_KEY)) {
-    m_logger(ERROR, BRIGHT_RED) << "Failed to add wallet: incompatible tracking mode and spend secret key, tracking mode=" << trackingMode <<
-      ", spendSecretKey " << (spendSecretKey == NULL_SECRET_KEY ? "is null" : "is not null");
-    throw std::system_error(make_error_code(error::WRONG_PARAMETERS));
+  // the whole list is checked before anything is written
+  std::unordered_set<Crypto::PublicKey> newKeys;
+  newKeys.reserve(addressDataList.size());
+  for (const auto& addressData : addressDataList) {
+    const Crypto::PublicKey& spendPublicKey = addressData.spendPublicKey;
+    const Crypto::SecretKey& spendSecretKey = addressData.spendSecretKey;
+    if ((trackingMode == WalletTrackingMode::TRACKING && spendSecretKey != NULL_SECRET_KEY) ||
+        (trackingMode == WalletTrackingMode::NOT_TRACKING && spendSecretKey == NULL_SECRET_KEY)) {
+      m_logger(ERROR, BRIGHT_RED) << "Failed to add wallet: incompatible tracking mode and spend secret key, tracking mode=" << trackingMode <<
+        ", spendSecretKey " << (spendSecretKey == NULL_SECRET_KEY ? "is null" : "is not null");
+      throw std::system_error(make_error_code(error::WRONG_PARAMETERS));
+    }
+
+    if (index.count(spendPublicKey) != 0 || !newKeys.insert(spendPublicKey).second) {
+      m_logger(ERROR, BRIGHT_RED) << "Failed to add wallet: address already exists, " <<
+        m_currency.accountAddressAsString(AccountPublicAddress{spendPublicKey, m_viewPublicKey});
+      throw std::system_error(make_error_code(error::ADDRESS_ALREADY_EXISTS));
+    }
   }
 
-  auto insertIt = index.find(spendPublicKey);
-  if (insertIt != index.end()) {
-    m_logger(ERROR, BRIGHT_RED) << "Failed to add wallet: address already exists, " <<
-      m_currency.accountAddressAsString(AccountPublicAddress{spendPublicKey, m_viewPublicKey});
-    throw std::system_error(make_error_code(error::ADDRESS_ALREADY_EXISTS));
+  // grow the storage once for the whole batch rather than every time its capacity runs out
+  uint64_t storageSize = m_containerStorage.size();
+  if (addressDataList.size() > 1 && m_containerStorage.capacity() < storageSize + addressDataList.size()) {
+    m_containerStorage.reserve(storageSize + addressDataList.size());
   }
 
-  m_containerStorage.push_back(encryptKeyPair(spendPublicKey, spendSecretKey, creationTimestamp));
-  incNextIv();
+  std::vector<std::string> addresses;
+  addresses.reserve(addressDataList.size());
+
+  // every subscription made so far, including one whose wallet record was not inserted yet
+  std::vector<AccountPublicAddress> subscriptions;
+  subscriptions.reserve(addressDataList.size());
 
   try {
-    AccountSubscription sub;
-    sub.keys.address.viewPublicKey = m_viewPublicKey;
-    sub.keys.address.spendPublicKey = spendPublicKey;
-    sub.keys.viewSecretKey = m_viewSecretKey;
-    sub.keys.spendSecretKey = spendSecretKey;
-    sub.transactionSpendableAge = m_transactionSoftLockTime;
-    sub.syncStart.height = 0;
-    sub.syncStart.timestamp = std::max(creationTimestamp, ACCOUNT_CREATE_TIME_ACCURACY) - ACCOUNT_CREATE_TIME_ACCURACY;
-
-    auto& trSubscription = m_synchronizer.addSubscription(sub);
-    ITransfersContainer* container = &trSubscription.getContainer();
+    for (const auto& addressData : addressDataList) {
+      m_containerStorage.push_back(encryptKeyPair(addressData.spendPublicKey, addressData.spendSecretKey, addressData.creationTimestamp));
+      incNextIv();
+    }
 
-    WalletRecord wallet;
-    wallet.spendPublicKey = spendPublicKey;
-    wallet.spendSecretKey = spendSecretKey;
-    wallet.container = container;
-    wallet.creationTimestamp = static_cast<time_t>(creationTimestamp);
-    trSubscription.addObserver(this);
+    for (const auto& addressData : addressDataList) {
+      AccountSubscription sub;
+      sub.keys.address.viewPublicKey = m_viewPublicKey;
+      sub.keys.address.spendPublicKey = addressData.spendPublicKey;
+      sub.keys.viewSecretKey = m_viewSecretKey;
+      sub.keys.spendSecretKey = addressData.spendSecretKey;
+      sub.transactionSpendableAge = m_transactionSoftLockTime;
+      sub.syncStart.height = 0;
+      sub.syncStart.timestamp = std::max(addressData.creationTimestamp, ACCOUNT_CREATE_TIME_ACCURACY) - ACCOUNT_CREATE_TIME_ACCURACY;
 
-    index.insert(insertIt, std::move(wallet));
-    m_logger(DEBUGGING) << "Wallet count " << m_walletsContainer.size();
+      auto& trSubscription = m_synchronizer.addSubscription(sub);
+      subscriptions.push_back(sub.keys.address);
+      ITransfersContainer* container = &trSubscription.getContainer();
+
+      WalletRecord wallet;
+      wallet.spendPublicKey = addressData.spendPublicKey;
+      wallet.spendSecretKey = addressData.spendSecretKey;
+      wallet.container = container;
+      wallet.creationTimestamp = static_cast<time_t>(addressData.creationTimestamp);
+      trSubscription.addObserver(this);
 
-    if (index.size() == 1) {
-      m_synchronizer.subscribeConsumerNotifications(m_viewPublicKey, this);
-      initBlockchain(m_viewPublicKey);
+      index.insert(std::move(wallet));
+
+      if (index.size() == 1) {
+        m_synchronizer.subscribeConsumerNotifications(m_viewPublicKey, this);
+        initBlockchain(m_viewPublicKey);
+      }
+
+      auto address = m_currency.accountAddressAsString({ addressData.spendPublicKey, m_viewPublicKey });
+      m_logger(DEBUGGING) << "Wallet added " << address << ", creation timestamp " << addressData.creationTimestamp;
+      addresses.push_back(std::move(address));
     }
 
-    auto address = m_currency.accountAddressAsString({ spendPublicKey, m_viewPublicKey });
-    m_logger(DEBUGGING) << "Wallet added " << address << ", creation timestamp " << creationTimestamp;
-    return address;
+    m_logger(DEBUGGING) << "Wallet count " << m_walletsContainer.size();
   } catch (const std::exception& e) {
     m_logger(ERROR) << "Failed to add wallet: " << e.what();
 
+    for (const auto& address : subscriptions) {
+      m_synchronizer.removeSubscription(address);
+      index.erase(address.spendPublicKey);
+    }
+
     try {
-      m_containerStorage.pop_back();
+      while (m_containerStorage.size() > storageSize) {
+        m_containerStorage.pop_back();
+      }
     } catch (...) {
       m_logger(ERROR) << "Failed to rollback adding wallet to storage";
     }
 
     throw;
   }
+
+  return addresses;
 }
 
 DynexCN::BlockDetails WalletGreen::getBlock(const uint32_t blockHeight) {
@@ -1566,7 +1816,7 @@ size_t WalletGreen::transfer(const TransactionParameters& transactionParameters,
 
 uint64_t WalletGreen::getBalanceMinusDust(const std::vector<std::string>& addresses)
 {
-    std::vector<WalletOuts> wallets = addresses.empty() ? pickWalletsWithMoney() : pickWallets(addresses);
+    std::vector<WalletOuts> wallets = addresses.empty() ? pickWalletsWithMoney(false) : pickWallets(addresses, false);
     std::vector<OutputToTransfer> unused;
 
 	/* We want to get the full balance, so don't stop getting outputs early */
@@ -1828,9 +2078,9 @@ size_t WalletGreen::doTransfer(const TransactionParameters& transactionParameter
 
   std::vector<WalletOuts> wallets;
   if (!transactionParameters.sourceAddresses.empty()) {
-    wallets = pickWallets(transactionParameters.sourceAddresses);
+    wallets = pickWallets(transactionParameters.sourceAddresses, false);
   } else {
-    wallets = pickWalletsWithMoney();
+    wallets = pickWalletsWithMoney(false);
   }
 
   PreparedTransaction preparedTransaction;
@@ -1884,9 +2134,9 @@ size_t WalletGreen::makeTransaction(const TransactionParameters& sendingTransact
 
   std::vector<WalletOuts> wallets;
   if (!sendingTransaction.sourceAddresses.empty()) {
-    wallets = pickWallets(sendingTransaction.sourceAddresses);
+    wallets = pickWallets(sendingTransaction.sourceAddresses, false);
   } else {
-    wallets = pickWalletsWithMoney();
+    wallets = pickWalletsWithMoney(false);
   }
 
   PreparedTransaction preparedTransaction;
@@ -1984,6 +2234,8 @@ void WalletGreen::pushBackOutgoingTransfers(size_t txId, const std::vector<Walle
 
     m_transfers.emplace_back(txId, std::move(d));
   }
+
+  markTransactionChanged(txId);
 }
 
 size_t WalletGreen::insertOutgoingTransactionAndPushEvent(const Hash& transactionHash, uint64_t fee, const BinaryArray& extra, uint64_t unlockTimestamp, Crypto::SecretKey& txSecretKey) {
@@ -2015,6 +2267,7 @@ void WalletGreen::updateTransactionStateAndPushEvent(size_t transactionId, Walle
     m_transactions.get<RandomAccessIndex>().modify(it, [state](WalletTransaction& tx) {
       tx.state = state;
     });
+    markTransactionChanged(transactionId);
 
     pushEvent(makeTransactionUpdatedEvent(transactionId));
     m_logger(DEBUGGING) << "Transaction state changed, ID " << transactionId << ", hash " << it->hash << ", new state " << it->state;
@@ -2027,7 +2280,7 @@ bool WalletGreen::updateWalletTransactionInfo(size_t transactionId, const DynexC
   auto it = std::next(txIdIndex.begin(), transactionId);
 
   bool updated = false;
-  bool r = txIdIndex.modify(it, [this, transactionId, &info, totalAmount, &updated](WalletTransaction& transaction) {
+  bool r = txIdIndex.modify(it, [this, transactionId, &info, totalAmount, &updated](WalletTransactionRecord& transaction) {
     if (transaction.blockHeight != info.blockHeight) {
       transaction.blockHeight = info.blockHeight;
       updated = true;
@@ -2056,6 +2309,7 @@ bool WalletGreen::updateWalletTransactionInfo(size_t transactionId, const DynexC
     // Fix LegacyWallet error. Some old versions didn't fill extra field
     if (transaction.extra.empty() && !info.extra.empty()) {
       transaction.extra = Common::asString(info.extra);
+      transaction.updatePaymentId();
       updated = true;
     }
 
@@ -2069,6 +2323,7 @@ bool WalletGreen::updateWalletTransactionInfo(size_t transactionId, const DynexC
   assert(r);
 
   if (updated) {
+    markTransactionChanged(transactionId);
     m_logger(DEBUGGING) << "Transaction updated, ID " << transactionId <<
       ", hash " << it->hash <<
       ", block " << it->blockHeight <<
@@ -2236,6 +2491,7 @@ void WalletGreen::appendTransfer(size_t transactionId, size_t firstTransferIdx,
 
   WalletTransfer transfer{ WalletTransferType::USUAL, address, amount };
   m_transfers.emplace(insertIt, std::piecewise_construct, std::forward_as_tuple(transactionId), std::forward_as_tuple(transfer));
+  markTransactionChanged(transactionId);
 }
 
 bool WalletGreen::adjustTransfer(size_t transactionId, size_t firstTransferIdx, const std::string& address, int64_t amount) {
@@ -2272,6 +2528,10 @@ bool WalletGreen::adjustTransfer(size_t transactionId, size_t firstTransferIdx,
     updated = true;
   }
 
+  if (updated) {
+    markTransactionChanged(transactionId);
+  }
+
   return updated;
 }
 
@@ -2288,6 +2548,10 @@ bool WalletGreen::eraseTransfers(size_t transactionId, size_t firstTransferIdx,
     }
   }
 
+  if (erased) {
+    markTransactionChanged(transactionId);
+  }
+
   return erased;
 }
 
@@ -2487,54 +2751,57 @@ uint64_t WalletGreen::selectTransfers(
 
   uint64_t foundMoney = 0;
 
-  typedef std::pair<WalletRecord*, TransactionOutputInformation> OutputData;
-  std::vector<OutputData> dustOutputs;
-  std::vector<OutputData> walletOuts;
-  for (auto walletIt = wallets.begin(); walletIt != wallets.end(); ++walletIt) {
-    for (auto outIt = walletIt->outs.begin(); outIt != walletIt->outs.end(); ++outIt) {
-      if (outIt->amount > dustThreshold) {
-        walletOuts.emplace_back(std::piecewise_construct, std::forward_as_tuple(walletIt->wallet), std::forward_as_tuple(*outIt));
-      } else if (dust) {
-        dustOutputs.emplace_back(std::piecewise_construct, std::forward_as_tuple(walletIt->wallet), std::forward_as_tuple(*outIt));
-      }
-    }
+  // outputs are sampled uniformly straight from the containers' unlocked output indexes,
+  // so only the outputs actually drawn are copied
+  std::vector<size_t> walletOffsets;
+  walletOffsets.reserve(wallets.size());
+  size_t outputCount = 0;
+  for (const auto& wallet : wallets) {
+    outputCount += wallet.wallet->container->unlockedOutputsCount();
+    walletOffsets.push_back(outputCount);
   }
 
-  ShuffleGenerator<size_t, Crypto::random_engine<size_t>> indexGenerator(walletOuts.size());
+  typedef std::pair<WalletRecord*, TransactionOutputInformation> OutputData;
+  std::vector<OutputData> dustOutputs;
+  std::unordered_set<Crypto::PublicKey> drawnOutputs;
+  ShuffleGenerator<size_t, Crypto::random_engine<size_t>> indexGenerator(outputCount);
+
+  auto drawOutput = [&](OutputData& out) {
+    size_t index = indexGenerator();
+    size_t walletIndex = std::upper_bound(walletOffsets.begin(), walletOffsets.end(), index) - walletOffsets.begin();
+    size_t walletBegin = walletIndex == 0 ? 0 : walletOffsets[walletIndex - 1];
+
+    out.first = wallets[walletIndex].wallet;
+    return out.first->container->getUnlockedOutput(index - walletBegin, out.second) &&
+      out.second.type == TransactionTypes::OutputType::Key &&
+      drawnOutputs.insert(out.second.outputKey).second;
+  };
 
   // build up transactions here:
   while (foundMoney < neededMoney && !indexGenerator.empty()) {
-    // new: find closest amount:
-    /*
-    int ideal_index = -1;
-    uint64_t max_amout = 0;
-    //std::cout << "*** DEBUG: need " << (neededMoney-foundMoney) << " of total " << neededMoney << std::endl;
-    for (int i=0; i<walletOuts.size(); i++) {
-        OutputData _out = walletOuts[i];
-        //std::cout << "     checking " << _out.second.amount << " at idx" << i << std::endl;
-        if (_out.second.amount <= (neededMoney-foundMoney) && _out.second.amount > max_amout) {
-            ideal_index = i;
-            max_amout = _out.second.amount;
-            //std::cout << "     *** amount " << max_amout << " found at idx" << ideal_index << std::endl;
-        }
-    }
-    //std::cout << "     ==> RESULT " << walletOuts[ideal_index].second.amount << " found at idx" << ideal_index << std::endl;
-    //ideal_index = -1;
     OutputData out;
-    if (ideal_index!=-1) {
-        out = walletOuts[ideal_index];
-    } else {
-        out = walletOuts[indexGenerator()];
-        //std::cout << "     *** amount " << out.second.amount << " added." << std::endl;
+    if (!drawOutput(out)) {
+      continue;
+    }
+
+    if (out.second.amount > dustThreshold) {
+      foundMoney += out.second.amount;
+      selectedTransfers.emplace_back(OutputToTransfer{ std::move(out.second), std::move(out.first) });
+    } else if (dust) {
+      dustOutputs.emplace_back(std::move(out));
     }
-    // ---
-    */
-    auto& out = walletOuts[indexGenerator()];
-    foundMoney += out.second.amount;
-    selectedTransfers.emplace_back(OutputToTransfer{ std::move(out.second), std::move(out.first) });
   }
-  //return 0;
+
   // build up dust here:
+  if (dust) {
+    while (!indexGenerator.empty()) {
+      OutputData out;
+      if (drawOutput(out) && out.second.amount <= dustThreshold) {
+        dustOutputs.emplace_back(std::move(out));
+      }
+    }
+  }
+
   if (dust && !dustOutputs.empty()) {
     ShuffleGenerator<size_t, Crypto::random_engine<size_t>> dustIndexGenerator(dustOutputs.size());
     do {
@@ -2547,7 +2814,7 @@ uint64_t WalletGreen::selectTransfers(
   return foundMoney;
 };
 
-std::vector<WalletGreen::WalletOuts> WalletGreen::pickWalletsWithMoney() const {
+std::vector<WalletGreen::WalletOuts> WalletGreen::pickWalletsWithMoney(bool withOutputs) const {
   auto& walletsIndex = m_walletsContainer.get<RandomAccessIndex>();
 
   std::vector<WalletOuts> walletOuts;
@@ -2559,7 +2826,10 @@ std::vector<WalletGreen::WalletOuts> WalletGreen::pickWalletsWithMoney() const {
     ITransfersContainer* container = wallet.container;
 
     WalletOuts outs;
-    container->getOutputs(outs.outs, ITransfersContainer::IncludeKeyUnlocked);
+    if (withOutputs) {
+      container->getOutputs(outs.outs, ITransfersContainer::IncludeKeyUnlocked);
+    }
+
     outs.wallet = const_cast<WalletRecord *>(&wallet);
 
     walletOuts.push_back(std::move(outs));
@@ -2568,24 +2838,28 @@ std::vector<WalletGreen::WalletOuts> WalletGreen::pickWalletsWithMoney() const {
   return walletOuts;
 }
 
-WalletGreen::WalletOuts WalletGreen::pickWallet(const std::string& address) const {
+WalletGreen::WalletOuts WalletGreen::pickWallet(const std::string& address, bool withOutputs) const {
   const auto& wallet = getWalletRecord(address);
 
   ITransfersContainer* container = wallet.container;
   WalletOuts outs;
-  container->getOutputs(outs.outs, ITransfersContainer::IncludeKeyUnlocked);
+  if (withOutputs) {
+    container->getOutputs(outs.outs, ITransfersContainer::IncludeKeyUnlocked);
+  }
+
   outs.wallet = const_cast<WalletRecord *>(&wallet);
 
   return outs;
 }
 
-std::vector<WalletGreen::WalletOuts> WalletGreen::pickWallets(const std::vector<std::string>& addresses) const {
+std::vector<WalletGreen::WalletOuts> WalletGreen::pickWallets(const std::vector<std::string>& addresses, bool withOutputs) const {
   std::vector<WalletOuts> wallets;
   wallets.reserve(addresses.size());
 
   for (const auto& address: addresses) {
-    WalletOuts wallet = pickWallet(address);
-    if (!wallet.outs.empty()) {
+    WalletOuts wallet = pickWallet(address, withOutputs);
+    bool hasOutputs = withOutputs ? !wallet.outs.empty() : wallet.wallet->container->balance(ITransfersContainer::IncludeKeyUnlocked) != 0;
+    if (hasOutputs) {
       wallets.emplace_back(std::move(wallet));
     }
   }
@@ -2724,6 +2998,29 @@ std::vector<TransactionsInBlockInfo> WalletGreen::getTransactions(uint32_t block
   return getTransactionsInBlocks(blockIndex, count);
 }
 
+std::vector<TransactionsInBlockInfo> WalletGreen::getTransactionsByPaymentId(const Crypto::Hash& paymentId, const Crypto::Hash& blockHash, size_t count) const {
+  throwIfNotInitialized();
+  throwIfStopped();
+
+  auto& hashIndex = m_blockchain.get<BlockHashIndex>();
+  auto it = hashIndex.find(blockHash);
+  if (it == hashIndex.end()) {
+    return std::vector<TransactionsInBlockInfo>();
+  }
+
+  auto heightIt = m_blockchain.project<BlockHeightIndex>(it);
+
+  uint32_t blockIndex = static_cast<uint32_t>(std::distance(m_blockchain.get<BlockHeightIndex>().begin(), heightIt));
+  return getTransactionsByPaymentIdInBlocks(paymentId, blockIndex, count);
+}
+
+std::vector<TransactionsInBlockInfo> WalletGreen::getTransactionsByPaymentId(const Crypto::Hash& paymentId, uint32_t blockIndex, size_t count) const {
+  throwIfNotInitialized();
+  throwIfStopped();
+
+  return getTransactionsByPaymentIdInBlocks(paymentId, blockIndex, count);
+}
+
 std::vector<Crypto::Hash> WalletGreen::getBlockHashes(uint32_t blockIndex, size_t count) const {
   throwIfNotInitialized();
   throwIfStopped();
@@ -2739,6 +3036,13 @@ std::vector<Crypto::Hash> WalletGreen::getBlockHashes(uint32_t blockIndex, size_
   return std::vector<Crypto::Hash>(start, end);
 }
 
+double WalletGreen::getSyncSpeed() const {
+  throwIfNotInitialized();
+  throwIfStopped();
+
+  return m_synchronizer.getSyncSpeed();
+}
+
 uint32_t WalletGreen::getBlockCount() const {
   throwIfNotInitialized();
   throwIfStopped();
@@ -2863,11 +3167,11 @@ std::string WalletGreen::getReserveProof(const uint64_t &reserve, const std::str
   // determine which outputs to include in the proof
   // if account is provided use it, otherwise try to find account with sufficient balance
   if (!address.empty()) {
-    WalletOuts wallet = pickWallet(address);
+    WalletOuts wallet = pickWallet(address, false);
     wallets.push_back(wallet);	
   }
   else {
-    std::vector<WalletOuts> walletsWithMoney = pickWalletsWithMoney();
+    std::vector<WalletOuts> walletsWithMoney = pickWalletsWithMoney(false);
 	for (const auto& w : walletsWithMoney) {
       if (w.wallet->actualBalance >= reserve) {
         wallets.push_back(w);
@@ -3272,6 +3576,7 @@ void WalletGreen::transactionDeleted(ITransfersSubscription* object, const Hash&
 
   if (updated) {
     auto transactionId = getTransactionId(transactionHash);
+    markTransactionChanged(transactionId);
     auto tx = m_transactions[transactionId];
     m_logger(INFO, BRIGHT_WHITE) << "Transaction deleted, ID " << transactionId <<
       ", hash " << transactionHash <<
@@ -3757,6 +4062,54 @@ std::vector<TransactionsInBlockInfo> WalletGreen::getTransactionsInBlocks(uint32
   return result;
 }
 
+std::vector<TransactionsInBlockInfo> WalletGreen::getTransactionsByPaymentIdInBlocks(const Crypto::Hash& paymentId, uint32_t blockIndex, size_t count) const {
+  if (count == 0) {
+    m_logger(ERROR, BRIGHT_RED) << "Bad argument: block count must be greater than zero";
+    throw std::system_error(make_error_code(error::WRONG_PARAMETERS), "blocks count must be greater than zero");
+  }
+
+  std::vector<TransactionsInBlockInfo> result;
+
+  if (blockIndex >= m_blockchain.size()) {
+    return result;
+  }
+
+  uint32_t stopIndex = static_cast<uint32_t>(std::min(m_blockchain.size(), blockIndex + count));
+
+  // (block height, transaction id) of the matching transactions, so the result keeps the block order
+  std::vector<std::pair<uint32_t, size_t>> transactionIds;
+  auto& transactionIdIndex = m_transactions.get<RandomAccessIndex>();
+  auto range = m_transactions.get<TransactionPaymentIdIndex>().equal_range(paymentId);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->state != WalletTransactionState::SUCCEEDED || it->blockHeight < blockIndex || it->blockHeight >= stopIndex) {
+      continue;
+    }
+
+    auto idIt = m_transactions.project<RandomAccessIndex>(it);
+    transactionIds.emplace_back(it->blockHeight, static_cast<size_t>(std::distance(transactionIdIndex.begin(), idIt)));
+  }
+
+  std::sort(transactionIds.begin(), transactionIds.end());
+
+  for (const auto& transactionId : transactionIds) {
+    if (result.empty() || result.back().blockHash != m_blockchain[transactionId.first]) {
+      TransactionsInBlockInfo info;
+      info.blockHash = m_blockchain[transactionId.first];
+      result.emplace_back(std::move(info));
+    }
+
+    const WalletTransaction& transaction = transactionIdIndex[transactionId.second];
+
+    WalletTransactionWithTransfers transactionWithTransfers;
+    transactionWithTransfers.transaction = transaction;
+    transactionWithTransfers.transfers = getTransactionTransfers(transaction);
+
+    result.back().transactions.emplace_back(std::move(transactionWithTransfers));
+  }
+
+  return result;
+}
+
 Crypto::Hash WalletGreen::getBlockHashByIndex(uint32_t blockIndex) const {
   assert(blockIndex < m_blockchain.size());
   return m_blockchain.get<BlockHeightIndex>()[blockIndex];
@@ -3900,6 +4253,7 @@ std::vector<size_t> WalletGreen::deleteTransfersForAddress(const std::string& ad
             ", new state " << transaction.state;
         }
       });
+      markTransactionChanged(transactionId);
 
       if (!transfersLeft) {
         deletedTransactions.push_back(transactionId);
@@ -3958,9 +4312,9 @@ size_t WalletGreen::getTxSize(const TransactionParameters &sendingTransaction)
 
   std::vector<WalletOuts> wallets;
   if (!sendingTransaction.sourceAddresses.empty()) {
-    wallets = pickWallets(sendingTransaction.sourceAddresses);
+    wallets = pickWallets(sendingTransaction.sourceAddresses, false);
   } else {
-    wallets = pickWalletsWithMoney();
+    wallets = pickWalletsWithMoney(false);
   }
 
   PreparedTransaction preparedTransaction;
@@ -50,6 +50,7 @@
 #include <System/Event.h>
 #include "Transfers/TransfersSynchronizer.h"
 #include "Transfers/BlockchainSynchronizer.h"
+#include "WalletSerializationV2.h"
 #include "../DynexCNConfig.h"
 
 namespace DynexCN {
@@ -63,6 +64,9 @@ public:
   WalletGreen(System::Dispatcher& dispatcher, const Currency& currency, INode& node, Logging::ILogger& logger, uint32_t transactionSoftLockTime = DynexCN::parameters::CRYPTONOTE_TX_SPENDABLE_AGE);
   virtual ~WalletGreen();
 
+  // threads scanning new blocks for wallet outputs, 0 selects all cores; call before the wallet is initialized
+  void setSyncThreads(size_t threadCount);
+
   virtual void initialize(const std::string& path, const std::string& password) override;
   virtual void initializeWithViewKey(const std::string& path, const std::string& password, const Crypto::SecretKey& viewSecretKey) override;
   virtual void initializeWithViewKey(const std::string& path, const std::string& password, const Crypto::SecretKey& viewSecretKey, const uint64_t& creationTimestamp) override;
@@ -112,8 +116,11 @@ public:
   virtual WalletTransactionWithTransfers getTransaction(const Crypto::Hash& transactionHash) const override;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(const Crypto::Hash& blockHash, size_t count) const override;
   virtual std::vector<TransactionsInBlockInfo> getTransactions(uint32_t blockIndex, size_t count) const override;
+  virtual std::vector<TransactionsInBlockInfo> getTransactionsByPaymentId(const Crypto::Hash& paymentId, const Crypto::Hash& blockHash, size_t count) const override;
+  virtual std::vector<TransactionsInBlockInfo> getTransactionsByPaymentId(const Crypto::Hash& paymentId, uint32_t blockIndex, size_t count) const override;
   virtual std::vector<Crypto::Hash> getBlockHashes(uint32_t blockIndex, size_t count) const override;
   virtual uint32_t getBlockCount() const override;
+  virtual double getSyncSpeed() const override;
   virtual std::vector<WalletTransactionWithTransfers> getUnconfirmedTransactions() const override;
   virtual std::vector<size_t> getDelayedTransactionIds() const override;
   virtual std::vector<TransactionOutputInformation> getTransfers(size_t index, uint32_t flags) const override;
@@ -172,6 +179,7 @@ protected:
   void initWithKeys(const std::string& path, const std::string& password, const Crypto::PublicKey& viewPublicKey, const Crypto::SecretKey& viewSecretKey, const uint64_t& _creationTimestamp);
   std::string doCreateAddress(const Crypto::PublicKey& spendPublicKey, const Crypto::SecretKey& spendSecretKey, uint64_t creationTimestamp);
   std::vector<std::string> doCreateAddressList(const std::vector<NewAddressData>& addressDataList);
+  std::vector<NewAddressData> deriveAddressData(const std::vector<Crypto::SecretKey>& spendSecretKeys) const;
 
   DynexCN::BlockDetails getBlock(const uint32_t blockHeight);
 
@@ -249,9 +257,10 @@ protected:
   virtual void onTransactionDeleteEnd(const Crypto::PublicKey& viewPublicKey, Crypto::Hash transactionHash) override;
   void transactionDeleteEnd(Crypto::Hash transactionHash);
 
-  std::vector<WalletOuts> pickWalletsWithMoney() const;
-  WalletOuts pickWallet(const std::string& address) const;
-  std::vector<WalletOuts> pickWallets(const std::vector<std::string>& addresses) const;
+  // withOutputs == false leaves outs empty, for callers that only need the wallets to select from
+  std::vector<WalletOuts> pickWalletsWithMoney(bool withOutputs = true) const;
+  WalletOuts pickWallet(const std::string& address, bool withOutputs = true) const;
+  std::vector<WalletOuts> pickWallets(const std::vector<std::string>& addresses, bool withOutputs = true) const;
 
   void updateBalance(DynexCN::ITransfersContainer* container);
   void unlockBalances(uint32_t height);
@@ -261,7 +270,8 @@ protected:
   const WalletRecord& getWalletRecord(DynexCN::ITransfersContainer* container) const;
 
   DynexCN::AccountPublicAddress parseAddress(const std::string& address) const;
-  std::string addWallet(const Crypto::PublicKey& spendPublicKey, const Crypto::SecretKey& spendSecretKey, uint64_t creationTimestamp);
+  // adds all wallets or none of them, the storage records are written in one batch
+  std::vector<std::string> addWallets(const std::vector<NewAddressData>& addressDataList);
   AccountKeys makeAccountKeys(const WalletRecord& wallet) const;
   size_t getTransactionId(const Crypto::Hash& transactionHash) const;
   void pushEvent(const WalletEvent& event);
@@ -350,12 +360,17 @@ protected:
   static void copyContainerStoragePrefix(ContainerStorage& src, const Crypto::chacha8_key& srcKey, ContainerStorage& dst, const Crypto::chacha8_key& dstKey);
   void deleteOrphanTransactions(const std::unordered_set<Crypto::PublicKey>& deletedKeys);
   static void encryptAndSaveContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* containerData, size_t containerDataSize);
-  static void loadAndDecryptContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, BinaryArray& containerData);
+  static void encryptAndAppendContainerChanges(ContainerStorage& storage, const Crypto::chacha8_key& key, const void* containerChanges, size_t containerChangesSize);
+  // returns false if the storage ends with a damaged change set, which is left out of containerChanges
+  static bool loadAndDecryptContainerData(ContainerStorage& storage, const Crypto::chacha8_key& key, BinaryArray& containerData, std::vector<BinaryArray>& containerChanges);
   void initTransactionPool();
   void loadSpendKeys();
   void loadContainerStorage(const std::string& path);
   void loadWalletCache(std::unordered_set<Crypto::PublicKey>& addedKeys, std::unordered_set<Crypto::PublicKey>& deletedKeys, std::string& extra);
   void saveWalletCache(ContainerStorage& storage, const Crypto::chacha8_key& key, WalletSaveLevel saveLevel, const std::string& extra);
+  bool saveWalletCacheChanges(const std::string& extra);
+  void resetSavedCache(bool cacheChangesAllowed, uint64_t snapshotSize, size_t changeCount, uint64_t changesSize);
+  void markTransactionChanged(size_t transactionId);
   void subscribeWallets();
 
   std::vector<OutputToTransfer> pickRandomFusionInputs(const std::vector<std::string>& addresses,
@@ -377,6 +392,7 @@ protected:
 
   TransfersRange getTransactionTransfersRange(size_t transactionIndex) const;
   std::vector<TransactionsInBlockInfo> getTransactionsInBlocks(uint32_t blockIndex, size_t count) const;
+  std::vector<TransactionsInBlockInfo> getTransactionsByPaymentIdInBlocks(const Crypto::Hash& paymentId, uint32_t blockIndex, size_t count) const;
   Crypto::Hash getBlockHashByIndex(uint32_t blockIndex) const;
 
   std::vector<WalletTransfer> getTransactionTransfers(const WalletTransaction& transaction) const;
@@ -418,6 +434,13 @@ protected:
   std::string m_path;
   std::string m_extra; // workaround for wallet reset
 
+  // the storage suffix is a SAVE_ALL snapshot followed by change sets, which save() appends while this is set
+  bool m_cacheChangesAllowed;
+  WalletSerializerV2::SavedState m_savedCache;
+  size_t m_cacheChangeCount;
+  uint64_t m_cacheChangesSize;
+  uint64_t m_cacheSnapshotSize;
+
   Crypto::PublicKey m_viewPublicKey;
   Crypto::SecretKey m_viewSecretKey;
 
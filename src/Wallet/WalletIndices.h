@@ -51,6 +51,9 @@
 #include <boost/multi_index/member.hpp>
 
 #include "Common/FileMappedVector.h"
+#include "Common/StringTools.h"
+#include "DynexCNCore/DynexCNBasic.h"
+#include "DynexCNCore/TransactionExtra.h"
 #include "crypto/chacha8.h"
 
 namespace DynexCN {
@@ -85,6 +88,7 @@ struct BlockHeightIndex {};
 struct TransactionHashIndex {};
 struct TransactionIndex {};
 struct BlockHashIndex {};
+struct TransactionPaymentIdIndex {};
 
 typedef boost::multi_index_container <
   WalletRecord,
@@ -115,8 +119,28 @@ typedef boost::multi_index_container <
   >
 > UnlockTransactionJobs;
 
+// A wallet transaction along with the payment id from its extra, parsed once when the record is stored.
+// Transactions without a payment id are keyed by NULL_HASH, whoever changes extra calls updatePaymentId()
+struct WalletTransactionRecord : DynexCN::WalletTransaction {
+  Crypto::Hash paymentId;
+
+  WalletTransactionRecord(const DynexCN::WalletTransaction& transaction) : DynexCN::WalletTransaction(transaction) {
+    updatePaymentId();
+  }
+
+  WalletTransactionRecord(DynexCN::WalletTransaction&& transaction) : DynexCN::WalletTransaction(std::move(transaction)) {
+    updatePaymentId();
+  }
+
+  void updatePaymentId() {
+    if (!getPaymentIdFromTxExtra(Common::asBinaryArray(extra), paymentId)) {
+      paymentId = NULL_HASH;
+    }
+  }
+};
+
 typedef boost::multi_index_container <
-  DynexCN::WalletTransaction,
+  WalletTransactionRecord,
   boost::multi_index::indexed_by <
     boost::multi_index::random_access < boost::multi_index::tag <RandomAccessIndex> >,
     boost::multi_index::hashed_unique < boost::multi_index::tag <TransactionIndex>,
@@ -124,6 +148,9 @@ typedef boost::multi_index_container <
     >,
     boost::multi_index::ordered_non_unique < boost::multi_index::tag <BlockHeightIndex>,
       boost::multi_index::member<DynexCN::WalletTransaction, uint32_t, &DynexCN::WalletTransaction::blockHeight >
+    >,
+    boost::multi_index::hashed_non_unique < boost::multi_index::tag <TransactionPaymentIdIndex>,
+      boost::multi_index::member<WalletTransactionRecord, Crypto::Hash, &WalletTransactionRecord::paymentId >
     >
   >
 > WalletTransactions;
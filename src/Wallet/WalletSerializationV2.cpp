@@ -37,6 +37,7 @@
 
 #include "WalletSerializationV2.h"
 
+#include "Common/MemoryInputStream.h"
 #include "DynexCNCore/DynexCNSerialization.h"
 #include "Serialization/BinaryInputStreamSerializer.h"
 #include "Serialization/BinaryOutputStreamSerializer.h"
@@ -136,6 +137,39 @@ void serialize(WalletTransferDtoV2& value, DynexCN::ISerializer& serializer) {
   serializer(value.type, "type");
 }
 
+DynexCN::WalletTransaction toWalletTransaction(const WalletTransactionDtoV2& dto) {
+  DynexCN::WalletTransaction tx;
+  tx.state = dto.state;
+  tx.timestamp = dto.timestamp;
+  tx.blockHeight = dto.blockHeight;
+  tx.hash = dto.hash;
+  tx.totalAmount = dto.totalAmount;
+  tx.fee = dto.fee;
+  tx.creationTime = dto.creationTime;
+  tx.unlockTime = dto.unlockTime;
+  tx.extra = dto.extra;
+  tx.isBase = dto.isBase;
+  if (dto.secretKey)
+    tx.secretKey = reinterpret_cast<const Crypto::SecretKey&>(dto.secretKey.get());
+
+  return tx;
+}
+
+DynexCN::WalletTransfer toWalletTransfer(const WalletTransferDtoV2& dto) {
+  DynexCN::WalletTransfer tr;
+  tr.address = dto.address;
+  tr.amount = dto.amount;
+  tr.type = static_cast<DynexCN::WalletTransferType>(dto.type);
+  return tr;
+}
+
+std::pair<DynexCN::WalletTransfers::const_iterator, DynexCN::WalletTransfers::const_iterator> getTransactionTransfers(const DynexCN::WalletTransfers& transfers, uint64_t transactionId) {
+  return std::equal_range(transfers.begin(), transfers.end(), DynexCN::TransactionTransferPair(transactionId, DynexCN::WalletTransfer()),
+    [](const DynexCN::TransactionTransferPair& a, const DynexCN::TransactionTransferPair& b) {
+      return a.first < b.first;
+    });
+}
+
 }
 
 namespace DynexCN {
@@ -165,7 +199,8 @@ WalletSerializerV2::WalletSerializerV2(
   m_transfers(transfers),
   m_uncommitedTransactions(uncommitedTransactions),
   m_extra(extra),
-  m_transactionSoftLockTime(transactionSoftLockTime)
+  m_transactionSoftLockTime(transactionSoftLockTime),
+  m_loadedSaveLevel(WalletSaveLevel::SAVE_KEYS_ONLY)
 {
 }
 
@@ -175,6 +210,7 @@ void WalletSerializerV2::load(Common::IInputStream& source, uint8_t version) {
   uint8_t saveLevelValue;
   s(saveLevelValue, "saveLevel");
   WalletSaveLevel saveLevel = static_cast<WalletSaveLevel>(saveLevelValue);
+  m_loadedSaveLevel = saveLevel;
 
   loadKeyListAndBalances(s, saveLevel == WalletSaveLevel::SAVE_ALL);
 
@@ -214,6 +250,103 @@ void WalletSerializerV2::save(Common::IOutputStream& destination, WalletSaveLeve
   s(m_extra, "extra");
 }
 
+void WalletSerializerV2::getSavedState(SavedState& saved) {
+  saved.spendKeys.clear();
+  for (const auto& wallet : m_walletsContainer.get<RandomAccessIndex>()) {
+    saved.spendKeys.push_back(wallet.spendPublicKey);
+  }
+
+  saved.transactionCount = m_transactions.size();
+  saved.changedTransactions.clear();
+  m_synchronizer.getSavedState(saved.synchronizer);
+}
+
+void WalletSerializerV2::discardSavedState() {
+  m_synchronizer.discardSavedState();
+}
+
+bool WalletSerializerV2::saveChanges(Common::IOutputStream& destination, SavedState& saved) {
+  auto& wallets = m_walletsContainer.get<RandomAccessIndex>();
+  bool sameWallets = wallets.size() == saved.spendKeys.size() && std::equal(wallets.begin(), wallets.end(), saved.spendKeys.begin(),
+    [](const WalletRecord& wallet, const Crypto::PublicKey& spendPublicKey) {
+      return wallet.spendPublicKey == spendPublicKey;
+    });
+
+  if (!sameWallets || m_transactions.size() < saved.transactionCount) {
+    return false;
+  }
+
+  DynexCN::BinaryOutputStreamSerializer s(destination);
+
+  saveKeyListAndBanalces(s, true);
+  saveTransactionChanges(s, saved);
+
+  std::stringstream stream;
+  m_synchronizer.saveChanges(stream, saved.synchronizer);
+  stream.flush();
+
+  std::string transfersSynchronizerData = stream.str();
+  s(transfersSynchronizerData, "transfersSynchronizer");
+
+  saveUnlockTransactionsJobs(s);
+  s(m_uncommitedTransactions, "uncommitedTransactions");
+  s(m_extra, "extra");
+
+  return true;
+}
+
+void WalletSerializerV2::loadChanges(const std::vector<BinaryArray>& changes) {
+  assert(m_loadedSaveLevel == WalletSaveLevel::SAVE_ALL);
+
+  std::map<uint64_t, std::vector<WalletTransfer>> changedTransfers;
+  std::vector<std::string> transfersSynchronizerChanges;
+
+  for (const auto& change : changes) {
+    Common::MemoryInputStream source(change.data(), change.size());
+    DynexCN::BinaryInputStreamSerializer s(source);
+
+    loadKeyListAndBalances(s, true);
+    loadTransactionChanges(s, changedTransfers);
+
+    std::string transfersSynchronizerData;
+    s(transfersSynchronizerData, "transfersSynchronizer");
+    transfersSynchronizerChanges.push_back(std::move(transfersSynchronizerData));
+
+    m_unlockTransactions.clear();
+    loadUnlockTransactionsJobs(s);
+
+    m_uncommitedTransactions.clear();
+    s(m_uncommitedTransactions, "uncommitedTransactions");
+    s(m_extra, "extra");
+  }
+
+  if (!changedTransfers.empty()) {
+    WalletTransfers transfers;
+    transfers.reserve(m_transfers.size());
+    std::copy_if(m_transfers.begin(), m_transfers.end(), std::back_inserter(transfers), [&changedTransfers](const TransactionTransferPair& pair) {
+      return changedTransfers.count(pair.first) == 0;
+    });
+
+    for (auto& kv : changedTransfers) {
+      for (auto& tr : kv.second) {
+        transfers.emplace_back(std::piecewise_construct, std::forward_as_tuple(kv.first), std::forward_as_tuple(std::move(tr)));
+      }
+    }
+
+    std::stable_sort(transfers.begin(), transfers.end(), [](const TransactionTransferPair& a, const TransactionTransferPair& b) {
+      return a.first < b.first;
+    });
+
+    m_transfers.swap(transfers);
+  }
+
+  m_synchronizer.loadChanges(transfersSynchronizerChanges);
+}
+
+WalletSaveLevel WalletSerializerV2::loadedSaveLevel() const {
+  return m_loadedSaveLevel;
+}
+
 std::unordered_set<Crypto::PublicKey>& WalletSerializerV2::addedKeys() {
   return m_addedKeys;
 }
@@ -289,21 +422,7 @@ void WalletSerializerV2::loadTransactions(DynexCN::ISerializer& serializer) {
     WalletTransactionDtoV2 dto;
     serializer(dto, "transaction");
 
-    WalletTransaction tx;
-    tx.state = dto.state;
-    tx.timestamp = dto.timestamp;
-    tx.blockHeight = dto.blockHeight;
-    tx.hash = dto.hash;
-    tx.totalAmount = dto.totalAmount;
-    tx.fee = dto.fee;
-    tx.creationTime = dto.creationTime;
-    tx.unlockTime = dto.unlockTime;
-    tx.extra = dto.extra;
-    tx.isBase = dto.isBase;
-    if (dto.secretKey)
-      tx.secretKey = reinterpret_cast<const Crypto::SecretKey&>(dto.secretKey.get());
-
-    m_transactions.get<RandomAccessIndex>().emplace_back(std::move(tx));
+    m_transactions.get<RandomAccessIndex>().emplace_back(toWalletTransaction(dto));
   }
 }
 
@@ -330,12 +449,7 @@ void WalletSerializerV2::loadTransfers(DynexCN::ISerializer& serializer) {
     WalletTransferDtoV2 dto;
     serializer(dto, "transfer");
 
-    WalletTransfer tr;
-    tr.address = dto.address;
-    tr.amount = dto.amount;
-    tr.type = static_cast<WalletTransferType>(dto.type);
-
-    m_transfers.emplace_back(std::piecewise_construct, std::forward_as_tuple(txId), std::forward_as_tuple(std::move(tr)));
+    m_transfers.emplace_back(std::piecewise_construct, std::forward_as_tuple(txId), std::forward_as_tuple(toWalletTransfer(dto)));
   }
 }
 
@@ -353,6 +467,87 @@ void WalletSerializerV2::saveTransfers(DynexCN::ISerializer& serializer) {
   }
 }
 
+void WalletSerializerV2::loadTransactionChanges(DynexCN::ISerializer& serializer, std::map<uint64_t, std::vector<WalletTransfer>>& changedTransfers) {
+  uint64_t count = 0;
+  serializer(count, "transactionCount");
+
+  auto& transactions = m_transactions.get<RandomAccessIndex>();
+  if (count < transactions.size()) {
+    throw std::runtime_error("Wallet changes remove transactions");
+  }
+
+  transactions.reserve(count);
+
+  uint64_t changedCount = 0;
+  serializer(changedCount, "changedTransactionCount");
+
+  for (uint64_t i = 0; i < changedCount; ++i) {
+    uint64_t txId = 0;
+    serializer(txId, "transactionId");
+
+    WalletTransactionDtoV2 dto;
+    serializer(dto, "transaction");
+
+    std::vector<WalletTransferDtoV2> transferDtos;
+    serializer(transferDtos, "transfers");
+
+    if (txId < transactions.size()) {
+      if (!transactions.replace(std::next(transactions.begin(), txId), toWalletTransaction(dto))) {
+        throw std::runtime_error("Wallet changes duplicate a transaction");
+      }
+    } else if (txId == transactions.size()) {
+      if (!transactions.emplace_back(toWalletTransaction(dto)).second) {
+        throw std::runtime_error("Wallet changes duplicate a transaction");
+      }
+    } else {
+      throw std::runtime_error("Wallet changes skip a transaction");
+    }
+
+    std::vector<WalletTransfer>& transfers = changedTransfers[txId];
+    transfers.clear();
+    for (const auto& transferDto : transferDtos) {
+      transfers.push_back(toWalletTransfer(transferDto));
+    }
+  }
+
+  if (transactions.size() != count) {
+    throw std::runtime_error("Wallet changes don't match transaction count");
+  }
+}
+
+void WalletSerializerV2::saveTransactionChanges(DynexCN::ISerializer& serializer, SavedState& saved) {
+  // transactions appended since the last save are new, the wallet marks the modified ones
+  uint64_t count = m_transactions.size();
+  std::vector<uint64_t> changedIds(saved.changedTransactions.begin(), saved.changedTransactions.lower_bound(saved.transactionCount));
+  for (uint64_t txId = saved.transactionCount; txId < count; ++txId) {
+    changedIds.push_back(txId);
+  }
+
+  serializer(count, "transactionCount");
+
+  uint64_t changedCount = changedIds.size();
+  serializer(changedCount, "changedTransactionCount");
+
+  auto& transactions = m_transactions.get<RandomAccessIndex>();
+  for (uint64_t txId : changedIds) {
+    serializer(txId, "transactionId");
+
+    WalletTransactionDtoV2 dto(transactions[txId]);
+    serializer(dto, "transaction");
+
+    auto range = getTransactionTransfers(m_transfers, txId);
+    std::vector<WalletTransferDtoV2> transferDtos;
+    for (auto it = range.first; it != range.second; ++it) {
+      transferDtos.emplace_back(it->second);
+    }
+
+    serializer(transferDtos, "transfers");
+  }
+
+  saved.transactionCount = count;
+  saved.changedTransactions.clear();
+}
+
 void WalletSerializerV2::loadTransfersSynchronizer(DynexCN::ISerializer& serializer) {
   std::string transfersSynchronizerData;
   serializer(transfersSynchronizerData, "transfersSynchronizer");
@@ -37,6 +37,8 @@
 
 #pragma once
 
+#include <set>
+
 #include "Common/IInputStream.h"
 #include "Common/IOutputStream.h"
 #include "Serialization/ISerializer.h"
@@ -66,6 +68,28 @@ public:
   void load(Common::IInputStream& source, uint8_t version);
   void save(Common::IOutputStream& destination, WalletSaveLevel saveLevel);
 
+  // what the last SAVE_ALL snapshot or change set wrote
+  struct SavedState {
+    std::vector<Crypto::PublicKey> spendKeys;
+    uint64_t transactionCount;
+    // ids of saved transactions modified since, along with their transfers, filled in by the wallet
+    std::set<uint64_t> changedTransactions;
+    TransfersSyncronizer::SavedState synchronizer;
+
+    SavedState() : transactionCount(0) {}
+  };
+
+  void getSavedState(SavedState& saved);
+  // stops the change tracking started by getSavedState()
+  void discardSavedState();
+  // writes what changed since saved was taken and updates saved, returns false without writing anything
+  // if a change set can't describe the difference, i.e. the address list changed or transactions were removed
+  bool saveChanges(Common::IOutputStream& destination, SavedState& saved);
+  // applies change sets written by saveChanges(), in order, on top of a SAVE_ALL snapshot restored by load()
+  void loadChanges(const std::vector<BinaryArray>& changes);
+
+  WalletSaveLevel loadedSaveLevel() const;
+
   std::unordered_set<Crypto::PublicKey>& addedKeys();
   std::unordered_set<Crypto::PublicKey>& deletedKeys();
 
@@ -88,6 +112,9 @@ private:
   void loadUnlockTransactionsJobs(DynexCN::ISerializer& serializer);
   void saveUnlockTransactionsJobs(DynexCN::ISerializer& serializer);
 
+  void loadTransactionChanges(DynexCN::ISerializer& serializer, std::map<uint64_t, std::vector<WalletTransfer>>& changedTransfers);
+  void saveTransactionChanges(DynexCN::ISerializer& serializer, SavedState& saved);
+
   ITransfersObserver& m_transfersObserver;
   uint64_t& m_actualBalance;
   uint64_t& m_pendingBalance;
@@ -99,6 +126,7 @@ private:
   UncommitedTransactions& m_uncommitedTransactions;
   std::string& m_extra;
   uint32_t m_transactionSoftLockTime;
+  WalletSaveLevel m_loadedSaveLevel;
 
   std::unordered_set<Crypto::PublicKey> m_addedKeys;
   std::unordered_set<Crypto::PublicKey> m_deletedKeys;
@@ -0,0 +1,179 @@
+// Copyright (c) 2021-2022, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The DynexCN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+// Imports lists of spend keys into a fresh container with createAddressList(), the path walletd takes for
+// createAddressList requests, and for the smaller lists also one createAddress() call per key as the import did before
+// it was batched. Reports time and addresses per second for every list size.
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include "Common/BenchmarkReport.h"
+#include "Common/CommandLine.h"
+#include "Common/JsonValue.h"
+#include "crypto/crypto.h"
+#include "DynexCNCore/Currency.h"
+#include "Logging/ConsoleLogger.h"
+#include "PaymentGate/NodeFactory.h"
+#include "System/Dispatcher.h"
+#include "Wallet/WalletGreen.h"
+
+namespace po = boost::program_options;
+using Common::JsonValue;
+
+namespace {
+  const command_line::arg_descriptor<std::string> arg_keys = {"keys", "comma separated key counts to import", "1000,10000,100000"};
+  const command_line::arg_descriptor<uint32_t> arg_sequential_limit = {"sequential-limit", "largest key count also imported one key at a time", 1000};
+
+  double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  JsonValue toJson(const std::string& mode, size_t keys, double seconds) {
+    JsonValue run(JsonValue::OBJECT);
+    run.insert("mode", mode);
+    run.insert("keys", static_cast<int64_t>(keys));
+    run.insert("seconds", seconds);
+    run.insert("addresses_per_second", keys / seconds);
+    return run;
+  }
+
+  // Creates an empty container, runs the import and checks every key ended up in it
+  template <typename Import>
+  double import(System::Dispatcher& dispatcher, const DynexCN::Currency& currency, DynexCN::INode& node, Logging::ILogger& logger,
+    const std::vector<Crypto::SecretKey>& keys, Import importKeys) {
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("walletimport-%%%%-%%%%.wallet");
+
+    DynexCN::WalletGreen wallet(dispatcher, currency, node, logger);
+    wallet.initialize(path.string(), "bench");
+
+    auto start = std::chrono::steady_clock::now();
+    importKeys(wallet);
+    double seconds = secondsSince(start);
+
+    size_t count = wallet.getAddressCount();
+    wallet.shutdown();
+    boost::system::error_code ignore;
+    boost::filesystem::remove(path, ignore);
+
+    if (count != keys.size()) {
+      throw std::runtime_error("imported " + std::to_string(count) + " of " + std::to_string(keys.size()) + " keys");
+    }
+
+    return seconds;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  po::options_description desc_general("General options");
+  command_line::add_arg(desc_general, command_line::arg_help);
+
+  po::options_description desc_params("Benchmark options");
+  command_line::add_arg(desc_params, arg_keys);
+  command_line::add_arg(desc_params, arg_sequential_limit);
+  command_line::add_arg(desc_params, Common::arg_benchmark_output);
+
+  po::options_description desc_all;
+  desc_all.add(desc_general).add(desc_params);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_all, [&]() {
+    po::store(command_line::parse_command_line(argc, argv, desc_all), vm);
+    if (command_line::get_arg(vm, command_line::arg_help)) {
+      std::cout << desc_all << std::endl;
+      return false;
+    }
+
+    po::notify(vm);
+    return true;
+  });
+
+  if (!r) {
+    return 1;
+  }
+
+  std::vector<size_t> keyCounts;
+  std::stringstream counts(command_line::get_arg(vm, arg_keys));
+  std::string count;
+  while (std::getline(counts, count, ',')) {
+    keyCounts.push_back(std::stoul(count));
+  }
+
+  uint32_t sequentialLimit = command_line::get_arg(vm, arg_sequential_limit);
+
+  return Common::runBenchmark(vm, [&] {
+    Logging::ConsoleLogger logger(Logging::WARNING);
+    DynexCN::Currency currency = DynexCN::CurrencyBuilder(logger).currency();
+    std::unique_ptr<DynexCN::INode> node(PaymentService::NodeFactory::createNodeStub());
+    System::Dispatcher dispatcher;
+
+    JsonValue runs(JsonValue::ARRAY);
+    for (size_t keyCount : keyCounts) {
+      std::vector<Crypto::SecretKey> keys(keyCount);
+      for (auto& key : keys) {
+        Crypto::PublicKey publicKey;
+        Crypto::generate_keys(publicKey, key);
+      }
+
+      double batch = import(dispatcher, currency, *node, logger, keys, [&](DynexCN::WalletGreen& wallet) {
+        wallet.createAddressList(keys, false);
+      });
+      runs.pushBack(toJson("batch", keyCount, batch));
+
+      if (keyCount <= sequentialLimit) {
+        double sequential = import(dispatcher, currency, *node, logger, keys, [&](DynexCN::WalletGreen& wallet) {
+          for (const auto& key : keys) {
+            wallet.createAddress(key);
+          }
+        });
+        runs.pushBack(toJson("sequential", keyCount, sequential));
+      }
+    }
+
+    JsonValue report(JsonValue::OBJECT);
+    report.insert("runs", std::move(runs));
+
+    return report;
+  });
+}
@@ -80,12 +80,18 @@ void hash_process(union hash_state *state, const uint8_t *buf, size_t count);
 enum {
   HASH_SIZE = 32,
   HASH_DATA_AREA = 136,
-  SLOW_HASH_CONTEXT_SIZE = 2097552
+  SLOW_HASH_CONTEXT_SIZE = 2097552,
+  // scratchpad of cn_slow_hash, MEMORY in slow-hash.c
+  SLOW_HASH_SCRATCHPAD_SIZE = 1 << 18
 };
 
 void cn_fast_hash(const void *data, size_t length, char *hash);
 
 void cn_slow_hash(const void *data, size_t length, char *hash);
+// the scratchpads hold SLOW_HASH_SCRATCHPAD_SIZE bytes and are 16 byte aligned
+void cn_slow_hash_scratchpad(const void *data, size_t length, char *hash, void *scratchpad);
+void cn_slow_hash_x2(const void *data0, size_t length0, char *hash0, void *scratchpad0,
+                     const void *data1, size_t length1, char *hash1, void *scratchpad1);
 
 void hash_extra_blake(const void *data, size_t length, char *hash);
 void hash_extra_groestl(const void *data, size_t length, char *hash);
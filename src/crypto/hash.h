@@ -38,6 +38,8 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
+#include <vector>
 
 #include <CryptoTypes.h>
 #include "generic-ops.h"
@@ -62,6 +64,8 @@ namespace Crypto {
     return h;
   }
 
+  // Scratchpad for cn_slow_hash, taken from a pool shared by the whole process and returned to it on destruction.
+  // The pool carves scratchpads out of 2MB huge pages where the system provides them.
   class cn_context {
   public:
 
@@ -76,12 +80,20 @@ namespace Crypto {
 
     void *data;
     friend inline void cn_slow_hash(cn_context &, const void *, size_t, Hash &);
+    friend void cn_slow_hash_batch(const std::vector<std::vector<uint8_t>> &, std::vector<Hash> &, size_t);
   };
 
   inline void cn_slow_hash(cn_context &context, const void *data, size_t length, Hash &hash) {
-	cn_slow_hash(data, length, reinterpret_cast<char *>(&hash));
+    cn_slow_hash_scratchpad(data, length, reinterpret_cast<char *>(&hash), context.data);
   }
 
+  // Hashes every blob on up to threadCount threads, 0 for one per core. Each thread computes two hashes at a time
+  // with interleaved main loops, see cn_slow_hash_x2.
+  void cn_slow_hash_batch(const std::vector<std::vector<uint8_t>> &blobs, std::vector<Hash> &hashes, size_t threadCount = 0);
+
+  // True if the pooled scratchpads are backed by huge pages
+  bool cn_scratchpads_on_huge_pages();
+
   inline void tree_hash(const Hash *hashes, size_t count, Hash &root_hash) {
     tree_hash(reinterpret_cast<const char (*)[HASH_SIZE]>(hashes), count, reinterpret_cast<char *>(&root_hash));
   }
@@ -117,7 +117,7 @@
 
 #define pre_aes() \
   j = state_index(a); \
-  _c = _mm_load_si128(R128(&hp_state[j])); \
+  _c = _mm_load_si128(R128(&long_state[j])); \
   _a = _mm_load_si128(R128(a)); \
 
 /*
@@ -132,13 +132,13 @@
 #define post_aes() \
   _mm_store_si128(R128(c), _c); \
   _b = _mm_xor_si128(_b, _c); \
-  _mm_store_si128(R128(&hp_state[j]), _b); \
+  _mm_store_si128(R128(&long_state[j]), _b); \
   j = state_index(c); \
-  p = U64(&hp_state[j]); \
+  p = U64(&long_state[j]); \
   b[0] = p[0]; b[1] = p[1]; \
   __mul(); \
   a[0] += hi; a[1] += lo; \
-  p = U64(&hp_state[j]); \
+  p = U64(&long_state[j]); \
   p[0] = a[0];  p[1] = a[1]; \
   a[0] ^= b[0]; a[1] ^= b[1]; \
   _b = _c; \
@@ -531,7 +531,28 @@ void slow_hash_free_state(void)
 void cn_slow_hash(const void *data, size_t length, char *hash) 
 {
 //printf("*** DEBUG *** slow-hash.c -> cn_slow_hash() \n"); // MAIN CRYPTONIGHT HASHING ALGO
-    
+
+	// hp_state is supposed to be managed externally with respect to the 2MB scratchpad reusage logic.
+	// However, if it is not managed, it needs to be locally allocated/freed.
+    int bLocalStateAllocation = (hp_state == NULL);
+	if (bLocalStateAllocation)
+        slow_hash_allocate_state();
+
+    cn_slow_hash_scratchpad(data, length, hash, hp_state);
+
+	if (bLocalStateAllocation)
+		slow_hash_free_state();
+}
+
+/**
+ * @brief cn_slow_hash on a scratchpad owned by the caller
+ *
+ * @param scratchpad MEMORY bytes, 16 byte aligned
+ */
+
+void cn_slow_hash_scratchpad(const void *data, size_t length, char *hash, void *scratchpad)
+{
+    uint8_t *long_state = (uint8_t *) scratchpad;
     RDATA_ALIGN16 uint8_t expandedKey[240];  /* These buffers are aligned to use later with SSE functions */
 
     uint8_t text[INIT_SIZE_BYTE];
@@ -553,12 +574,6 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
         //hash_extra_jh, hash_extra_blake, hash_extra_skein, hash_extra_groestl
     };
 
-	// hp_state is supposed to be managed externally with respect to the 2MB scratchpad reusage logic.
-	// However, if it is not managed, it needs to be locally allocated/freed.
-    int bLocalStateAllocation = (hp_state == NULL);
-	if (bLocalStateAllocation)
-        slow_hash_allocate_state();
-
     /* CryptoNight Step 1:  Use Keccak1600 to initialize the 'state' (and 'text') buffers from the data. */
 
     hash_process(&state.hs, data, length);
@@ -574,7 +589,7 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
         for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
         {
             aes_pseudo_round(text, text, expandedKey, INIT_SIZE_BLK);
-            memcpy(&hp_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
+            memcpy(&long_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
         }
     }
     else
@@ -586,7 +601,7 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
             for(j = 0; j < INIT_SIZE_BLK; j++)
                 aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], aes_ctx->key->exp_data);
 
-            memcpy(&hp_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
+            memcpy(&long_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
         }
     }
 
@@ -633,7 +648,7 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
         for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
         {
             // add the xor to the pseudo round
-            aes_pseudo_round_xor(text, text, expandedKey, &hp_state[i * INIT_SIZE_BYTE], INIT_SIZE_BLK);
+            aes_pseudo_round_xor(text, text, expandedKey, &long_state[i * INIT_SIZE_BYTE], INIT_SIZE_BLK);
         }
     }
     else
@@ -643,7 +658,7 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
         {
             for(j = 0; j < INIT_SIZE_BLK; j++)
             {
-                xor_blocks(&text[j * AES_BLOCK_SIZE], &hp_state[i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]);
+                xor_blocks(&text[j * AES_BLOCK_SIZE], &long_state[i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]);
                 aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], aes_ctx->key->exp_data);
             }
         }
@@ -660,9 +675,141 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
     memcpy(state.init, text, INIT_SIZE_BYTE);
     hash_permutation(&state.hs);
     extra_hashes[state.hs.b[0] & 3](&state, 200, hash);
+}
 
-	if (bLocalStateAllocation)
-		slow_hash_free_state();
+#if defined(_MSC_VER)
+#define umul128_x2(a, b, hi) _umul128(a, b, hi)
+#else
+STATIC INLINE uint64_t umul128_x2(uint64_t a, uint64_t b, uint64_t *hi)
+{
+    unsigned __int128 r = (unsigned __int128) a * b;
+    *hi = (uint64_t) (r >> 64);
+    return (uint64_t) r;
+}
+#endif
+
+/**
+ * @brief two CryptoNight hashes computed together
+ *
+ * Each iteration of the main loop waits on a scratchpad read, an AES round and a 64 bit
+ * multiply that all depend on each other.  Running the loops of two independent hashes
+ * side by side gives the CPU a second dependency chain to execute while the first one
+ * stalls.  Without hardware AES the hashes are computed one after the other.
+ */
+
+void cn_slow_hash_x2(const void *data0, size_t length0, char *hash0, void *scratchpad0,
+                     const void *data1, size_t length1, char *hash1, void *scratchpad1)
+{
+    RDATA_ALIGN16 uint8_t expandedKey0[240];
+    RDATA_ALIGN16 uint8_t expandedKey1[240];
+    uint8_t text0[INIT_SIZE_BYTE];
+    uint8_t text1[INIT_SIZE_BYTE];
+    RDATA_ALIGN16 uint64_t a0[2];
+    RDATA_ALIGN16 uint64_t a1[2];
+    RDATA_ALIGN16 uint64_t b0[2];
+    RDATA_ALIGN16 uint64_t b1[2];
+    RDATA_ALIGN16 uint64_t c0[2];
+    RDATA_ALIGN16 uint64_t c1[2];
+    union cn_slow_hash_state state0;
+    union cn_slow_hash_state state1;
+    __m128i _a0, _b0, _c0, _a1, _b1, _c1;
+    uint64_t hi0, lo0, hi1, lo1;
+    uint64_t *p0, *p1;
+    size_t i, j0, j1;
+    uint8_t *long_state0 = (uint8_t *) scratchpad0;
+    uint8_t *long_state1 = (uint8_t *) scratchpad1;
+
+    static void (*const extra_hashes[4])(const void *, size_t, char *) =
+    {
+        hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
+    };
+
+    if(force_software_aes() || !check_aes_hw())
+    {
+        cn_slow_hash_scratchpad(data0, length0, hash0, scratchpad0);
+        cn_slow_hash_scratchpad(data1, length1, hash1, scratchpad1);
+        return;
+    }
+
+    hash_process(&state0.hs, data0, length0);
+    hash_process(&state1.hs, data1, length1);
+    memcpy(text0, state0.init, INIT_SIZE_BYTE);
+    memcpy(text1, state1.init, INIT_SIZE_BYTE);
+
+    aes_expand_key(state0.hs.b, expandedKey0);
+    aes_expand_key(state1.hs.b, expandedKey1);
+    for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
+    {
+        aes_pseudo_round(text0, text0, expandedKey0, INIT_SIZE_BLK);
+        aes_pseudo_round(text1, text1, expandedKey1, INIT_SIZE_BLK);
+        memcpy(&long_state0[i * INIT_SIZE_BYTE], text0, INIT_SIZE_BYTE);
+        memcpy(&long_state1[i * INIT_SIZE_BYTE], text1, INIT_SIZE_BYTE);
+    }
+
+    U64(a0)[0] = U64(&state0.k[0])[0] ^ U64(&state0.k[32])[0];
+    U64(a0)[1] = U64(&state0.k[0])[1] ^ U64(&state0.k[32])[1];
+    U64(b0)[0] = U64(&state0.k[16])[0] ^ U64(&state0.k[48])[0];
+    U64(b0)[1] = U64(&state0.k[16])[1] ^ U64(&state0.k[48])[1];
+    U64(a1)[0] = U64(&state1.k[0])[0] ^ U64(&state1.k[32])[0];
+    U64(a1)[1] = U64(&state1.k[0])[1] ^ U64(&state1.k[32])[1];
+    U64(b1)[0] = U64(&state1.k[16])[0] ^ U64(&state1.k[48])[0];
+    U64(b1)[1] = U64(&state1.k[16])[1] ^ U64(&state1.k[48])[1];
+
+    /* Step 3 of both hashes, each half is pre_aes(), the AES round and post_aes() of one of them */
+
+    _b0 = _mm_load_si128(R128(b0));
+    _b1 = _mm_load_si128(R128(b1));
+    for(i = 0; i < ITER / 2; i++)
+    {
+        j0 = state_index(a0);
+        j1 = state_index(a1);
+        _c0 = _mm_load_si128(R128(&long_state0[j0]));
+        _c1 = _mm_load_si128(R128(&long_state1[j1]));
+        _a0 = _mm_load_si128(R128(a0));
+        _a1 = _mm_load_si128(R128(a1));
+
+        _c0 = _mm_aesenc_si128(_c0, _a0);
+        _c1 = _mm_aesenc_si128(_c1, _a1);
+
+        _mm_store_si128(R128(c0), _c0);
+        _mm_store_si128(R128(c1), _c1);
+        _mm_store_si128(R128(&long_state0[j0]), _mm_xor_si128(_b0, _c0));
+        _mm_store_si128(R128(&long_state1[j1]), _mm_xor_si128(_b1, _c1));
+
+        j0 = state_index(c0);
+        j1 = state_index(c1);
+        p0 = U64(&long_state0[j0]);
+        p1 = U64(&long_state1[j1]);
+        b0[0] = p0[0]; b0[1] = p0[1];
+        b1[0] = p1[0]; b1[1] = p1[1];
+        lo0 = umul128_x2(c0[0], b0[0], &hi0);
+        lo1 = umul128_x2(c1[0], b1[0], &hi1);
+        a0[0] += hi0; a0[1] += lo0;
+        a1[0] += hi1; a1[1] += lo1;
+        p0[0] = a0[0]; p0[1] = a0[1];
+        p1[0] = a1[0]; p1[1] = a1[1];
+        a0[0] ^= b0[0]; a0[1] ^= b0[1];
+        a1[0] ^= b1[0]; a1[1] ^= b1[1];
+        _b0 = _c0;
+        _b1 = _c1;
+    }
+
+    memcpy(text0, state0.init, INIT_SIZE_BYTE);
+    memcpy(text1, state1.init, INIT_SIZE_BYTE);
+    aes_expand_key(&state0.hs.b[32], expandedKey0);
+    aes_expand_key(&state1.hs.b[32], expandedKey1);
+    for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
+    {
+        aes_pseudo_round_xor(text0, text0, expandedKey0, &long_state0[i * INIT_SIZE_BYTE], INIT_SIZE_BLK);
+        aes_pseudo_round_xor(text1, text1, expandedKey1, &long_state1[i * INIT_SIZE_BYTE], INIT_SIZE_BLK);
+    }
+
+    memcpy(state0.init, text0, INIT_SIZE_BYTE);
+    memcpy(state1.init, text1, INIT_SIZE_BYTE);
+    hash_permutation(&state0.hs);
+    hash_permutation(&state1.hs);
+    extra_hashes[state0.hs.b[0] & 3](&state0, 200, hash0);
+    extra_hashes[state1.hs.b[0] & 3](&state1, 200, hash1);
 }
 
 #elif !defined NO_AES && (defined(__arm__) || defined(__aarch64__))
@@ -1297,3 +1444,22 @@ void cn_slow_hash(const void *data, size_t length, char *hash) {
 }
 
 #endif
+
+#if defined NO_AES || !(defined(__x86_64__) || (defined(_MSC_VER) && defined(_WIN64)))
+// Only the x86 implementation works on a scratchpad of the caller, the others manage their own
+
+void cn_slow_hash_scratchpad(const void *data, size_t length, char *hash, void *scratchpad)
+{
+    (void) scratchpad;
+    cn_slow_hash(data, length, hash);
+}
+
+void cn_slow_hash_x2(const void *data0, size_t length0, char *hash0, void *scratchpad0,
+                     const void *data1, size_t length1, char *hash1, void *scratchpad1)
+{
+    (void) scratchpad0;
+    (void) scratchpad1;
+    cn_slow_hash(data0, length0, hash0);
+    cn_slow_hash(data1, length1, hash1);
+}
+#endif
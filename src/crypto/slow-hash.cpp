@@ -35,8 +35,12 @@
 // Copyright (c) 2017-2022, The CROAT.community developers
 
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <new>
 #include <iterator>
+#include <thread>
 
 #include "hash.h"
 
@@ -50,46 +54,159 @@ using std::bad_alloc;
 
 namespace Crypto {
 
-  enum {
-    MAP_SIZE = SLOW_HASH_CONTEXT_SIZE + ((-SLOW_HASH_CONTEXT_SIZE) & 0xfff)
-  };
+  namespace {
 
-#ifdef _WIN32
-
-  cn_context::cn_context() {
-    data = VirtualAlloc(nullptr, MAP_SIZE, MEM_COMMIT, PAGE_READWRITE);
-    if (data == nullptr) {
-      throw bad_alloc();
-    }
-  }
+    enum {
+      CHUNK_SIZE = 2 * 1024 * 1024,
+      SCRATCHPADS_PER_CHUNK = CHUNK_SIZE / SLOW_HASH_SCRATCHPAD_SIZE
+    };
 
-  cn_context::~cn_context() {
-    if (!VirtualFree(data, 0, MEM_RELEASE)) {
-      //throw bad_alloc();
-    }
-  }
+    void *allocateChunk(bool &hugePages) {
+#ifdef _WIN32
+      SIZE_T largePage = GetLargePageMinimum();
+      if (largePage != 0 && CHUNK_SIZE % largePage == 0) {
+        void *chunk = VirtualAlloc(nullptr, CHUNK_SIZE, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (chunk != nullptr) {
+          hugePages = true;
+          return chunk;
+        }
+      }
 
+      hugePages = false;
+      return VirtualAlloc(nullptr, CHUNK_SIZE, MEM_COMMIT, PAGE_READWRITE);
 #else
+#if defined(MAP_HUGETLB)
+      void *chunk = mmap(nullptr, CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (chunk != MAP_FAILED) {
+        hugePages = true;
+        return chunk;
+      }
+#endif
 
-  cn_context::cn_context() {
+      hugePages = false;
 #if !defined(__APPLE__) && !defined(__FreeBSD__)
-    data = mmap(nullptr, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+      void *pages = mmap(nullptr, CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
 #else
-    data = mmap(nullptr, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+      void *pages = mmap(nullptr, CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
 #endif
-    if (data == MAP_FAILED) {
-      throw bad_alloc();
+      if (pages == MAP_FAILED) {
+        return nullptr;
+      }
+
+#if defined(MADV_HUGEPAGE)
+      madvise(pages, CHUNK_SIZE, MADV_HUGEPAGE);
+#endif
+      mlock(pages, CHUNK_SIZE);
+      return pages;
+#endif
+    }
+
+    // Chunks are never unmapped, the pool only grows to the number of contexts alive at the same time
+    class ScratchpadPool {
+    public:
+      ScratchpadPool() : m_hugePages(false) {
+      }
+
+      void *acquire() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_free.empty()) {
+          bool hugePages;
+          uint8_t *chunk = static_cast<uint8_t *>(allocateChunk(hugePages));
+          if (chunk == nullptr) {
+            throw bad_alloc();
+          }
+
+          m_hugePages = hugePages;
+          for (size_t i = 0; i < SCRATCHPADS_PER_CHUNK; ++i) {
+            m_free.push_back(chunk + i * SLOW_HASH_SCRATCHPAD_SIZE);
+          }
+        }
+
+        void *scratchpad = m_free.back();
+        m_free.pop_back();
+        return scratchpad;
+      }
+
+      void release(void *scratchpad) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(scratchpad);
+      }
+
+      bool hugePages() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_hugePages;
+      }
+
+    private:
+      std::mutex m_mutex;
+      std::vector<void *> m_free;
+      bool m_hugePages;
+    };
+
+    ScratchpadPool &scratchpadPool() {
+      // not destroyed at exit, contexts with static storage may outlive it
+      static ScratchpadPool *pool = new ScratchpadPool();
+      return *pool;
     }
-    mlock(data, MAP_SIZE);
+
+  }
+
+  cn_context::cn_context() {
+    data = scratchpadPool().acquire();
   }
 
   cn_context::~cn_context() {
-    if (munmap(data, MAP_SIZE) != 0) {
-    //  throw bad_alloc();
-		std::terminate();
-    }
+    scratchpadPool().release(data);
   }
 
-#endif
+  bool cn_scratchpads_on_huge_pages() {
+    return scratchpadPool().hugePages();
+  }
+
+  void cn_slow_hash_batch(const std::vector<std::vector<uint8_t>> &blobs, std::vector<Hash> &hashes, size_t threadCount) {
+    hashes.resize(blobs.size());
+    size_t pairs = (blobs.size() + 1) / 2;
+    if (threadCount == 0) {
+      threadCount = std::thread::hardware_concurrency() != 0 ? std::thread::hardware_concurrency() : 1;
+    }
+
+    if (threadCount > pairs) {
+      threadCount = pairs;
+    }
+
+    // taken here so that a failed allocation is thrown to the caller
+    std::vector<std::unique_ptr<cn_context>> contexts;
+    for (size_t i = 0; i < 2 * threadCount; ++i) {
+      contexts.emplace_back(new cn_context());
+    }
+
+    std::atomic<size_t> nextPair(0);
+    auto hashPairs = [&](size_t thread) {
+      void *first = contexts[2 * thread]->data;
+      void *second = contexts[2 * thread + 1]->data;
+      for (size_t pair = nextPair++; pair < pairs; pair = nextPair++) {
+        size_t i = 2 * pair;
+        if (i + 1 < blobs.size()) {
+          cn_slow_hash_x2(blobs[i].data(), blobs[i].size(), reinterpret_cast<char *>(&hashes[i]), first,
+            blobs[i + 1].data(), blobs[i + 1].size(), reinterpret_cast<char *>(&hashes[i + 1]), second);
+        } else {
+          cn_slow_hash_scratchpad(blobs[i].data(), blobs[i].size(), reinterpret_cast<char *>(&hashes[i]), first);
+        }
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t thread = 1; thread < threadCount; ++thread) {
+      threads.emplace_back(hashPairs, thread);
+    }
+
+    if (threadCount != 0) {
+      hashPairs(0);
+    }
+
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
 
 }